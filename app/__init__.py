@@ -7,13 +7,15 @@ import logging
 # Get project root for version file access
 PROJECT_ROOT = os.path.abspath(os.path.dirname(os.path.dirname(__file__)))
 
-def create_app():
+def create_app(role=None):
     # Corrected Flask app initialization to point to 'templates' and 'static'
     # within the 'app' package.
     app = Flask(__name__, instance_relative_config=True)
 
     # Load configuration from config.py
     app.config.from_object('app.config')
+    if role is not None:
+        app.config['APP_ROLE'] = role  # Overrides APP_ROLE for this app only
 
     # Ensure the instance folder exists (for config, if needed)
     try:
@@ -38,6 +40,10 @@ def create_app():
 
     app.logger.info("Flask app initialized and logging configured.")
 
+    # Request latency and DB statement metrics (/api/metrics)
+    from .metrics import metrics
+    metrics.init_app(app)
+
     # Import and register database functions
     from .db import get_connection, init_db
     
@@ -62,6 +68,9 @@ def create_app():
         db = g.pop('db', None)
         if db is not None:
             db.close()
+        # Hand the request's shared connection back to the pool
+        from .db import release_request_connection
+        release_request_connection()
 
     # Import helper functions that need app context or db
     from .db import get_system_parameters # Now lives in db.py or a database utility module
@@ -150,6 +159,7 @@ def create_app():
     from .api.photo_gallery_api import photo_gallery_api_bp
     from .api.custom_columns_api import custom_columns_api_bp
     from .api.entry_metrics_api import entry_metrics_api_bp
+    from .api.jobs_api import jobs_api_bp
 
     # Import Git integration blueprints
     from .api.git_api import git_api_bp
@@ -202,6 +212,7 @@ def create_app():
         photo_gallery_api_bp,
         custom_columns_api_bp,
         entry_metrics_api_bp,
+        jobs_api_bp,
     ):
         app.register_blueprint(bp, url_prefix='/api')
 
@@ -304,25 +315,67 @@ def create_app():
                 'is_dev_environment': False
             }
 
+    # Sensor data retention policy (pruned by the task scheduler)
+    from .services.sensor_retention_service import sensor_retention
+    sensor_retention.init_app(app)
+
+    # Wakes long-polls and nodes when a sensor command is queued
+    from .services.command_push import command_push
+    command_push.init_app(app)
+
+    # Slow external calls (AI, git, Garmin/Strava) deferred to the background worker
+    from .job_queue import job_queue
+    job_queue.init_app(app)
+
+    # Which threads this process runs (APP_ROLE): gunicorn workers ("web")
+    # serve requests, worker.py ("worker") runs the schedulers and the job
+    # queue, and the dev server ("all") does both. Only the dev server has a
+    # reloader parent process, which must not start anything. The gunicorn
+    # master ("migrate") only prepares the schema and starts nothing either.
+    role = app.config.get('APP_ROLE', 'all')
+    start_threads = role != 'all' or not app.debug or os.environ.get('WERKZEUG_RUN_MAIN') == 'true'
+    runs_background = start_threads and role in ('all', 'worker')
+    serves_requests = start_threads and role in ('all', 'web')
+
     # Initialize and start the task scheduler
     from .scheduler import scheduler
     scheduler.init_app(app)
     
-    # Start scheduler in production or when not in debug mode
-    if not app.debug or os.environ.get('WERKZEUG_RUN_MAIN') == 'true':
+    # Start scheduler once, in the background worker (or the dev server)
+    if runs_background:
         scheduler.start()
         app.logger.info("Task scheduler started.")
 
     # Initialize and start the device polling scheduler
-    from .device_scheduler import DevicePollingScheduler
-    device_scheduler = DevicePollingScheduler()
+    from .device_scheduler import device_scheduler
     device_scheduler.init_app(app)
+
+    # Initialize the write-behind queue for sensor data uploads
+    from .sensor_ingest_queue import ingest_queue
+    ingest_queue.init_app(app)
+
+    # Dashboard widget cache; write requests bump the data version it keys on
+    from .services.widget_cache import widget_cache
+    widget_cache.init_app(app)
+
+    # Saved search results, maintained from entry change reports
+    from .services.saved_search_cache import saved_search_cache
+    saved_search_cache.init_app(app)
     
-    # Start device scheduler in production or when not in debug mode
-    if not app.debug or os.environ.get('WERKZEUG_RUN_MAIN') == 'true':
+    # Start device scheduler and job queue once, in the background worker
+    if runs_background:
         device_scheduler.start()
         app.logger.info("Device polling scheduler started.")
-        
+
+        job_queue.start()
+        app.logger.info("Job queue started.")
+
+    # Sensor uploads are stored synchronously until this is running
+    if serves_requests:
+        ingest_queue.start()
+        app.logger.info("Sensor ingest queue started.")
+
+    if runs_background or serves_requests:
         # Reconfigure AI service now that app context is available
         # This allows it to read API keys from the database
         # Only run in the main process (not the reloader parent process)
@@ -11,6 +11,7 @@ from app.services.ai_service import (
     normalize_ollama_base_url,
 )
 from app.db import get_connection
+from app.job_queue import job_queue
 import logging
 import os
 import requests
@@ -1391,6 +1392,7 @@ def _build_diagram_specification(chat_history, final_message, entry_title='', en
 
 
 @ai_api_bp.route('/ai/diagram', methods=['POST'])
+@job_queue.deferrable
 def generate_diagram():
     """Generate or modify Draw.io diagram based on natural language request"""
     try:
@@ -1574,6 +1576,7 @@ Keep your response concise and helpful."""
 
 
 @ai_api_bp.route('/ai/generate_image', methods=['POST'])
+@job_queue.deferrable
 def generate_image():
     """Generate an image using Hugging Face API"""
     try:
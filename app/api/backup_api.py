@@ -4,8 +4,11 @@ import os
 import shutil
 import signal
 import logging
+from urllib.parse import urlparse
 from datetime import datetime, timezone
 
+from ..services import backup_service
+
 backup_api_bp = Blueprint('backup_api', __name__)
 logger = logging.getLogger(__name__)
 
@@ -14,7 +17,8 @@ logger = logging.getLogger(__name__)
 # ---------------------------------------------------------------------------
 
 def _db_path():
-    return current_app.config['DATABASE_PATH']
+    """Database file of pre-MariaDB installs (only used to restore their .bak copies)"""
+    return current_app.config.get('DATABASE_PATH')
 
 
 def _backup_dir():
@@ -25,7 +29,7 @@ def _backup_dir():
     Override by mounting a NAS path to /app/backups in docker-compose.yml.
     """
     return current_app.config.get('BACKUP_DIR') or os.path.join(
-        os.path.dirname(os.path.dirname(_db_path())), 'backups'
+        os.path.dirname(os.path.dirname(os.path.dirname(os.path.abspath(__file__)))), 'backups'
     )
 
 
@@ -37,8 +41,13 @@ def _ensure_backup_dir():
 
 def _backup_filename():
     ts = datetime.now(timezone.utc).strftime('%Y%m%d_%H%M%S')
-    db_name = os.path.basename(_db_path())
-    return f"{db_name}.{ts}.bak"
+    db_name = urlparse(current_app.config.get('DATABASE_URL', '')).path.lstrip('/') or 'database'
+    return f"{db_name}.{ts}{backup_service.DUMP_SUFFIX}"
+
+
+def _is_backup(name):
+    # .bak files are whole-file copies from before the move to MariaDB
+    return name.endswith((backup_service.DUMP_SUFFIX, '.bak'))
 
 
 def _list_backups_raw():
@@ -48,13 +57,16 @@ def _list_backups_raw():
     entries = []
     for name in sorted(os.listdir(backup_dir), reverse=True):
         path = os.path.join(backup_dir, name)
-        if os.path.isfile(path) and name.endswith('.bak'):
+        if os.path.isfile(path) and _is_backup(name):
             stat = os.stat(path)
+            meta = backup_service.read_metadata(path)
             entries.append({
                 'filename': name,
                 'size_bytes': stat.st_size,
                 'size_human': _human_size(stat.st_size),
                 'created_at': datetime.fromtimestamp(stat.st_mtime, tz=timezone.utc).isoformat(),
+                'duration_seconds': meta.get('duration_seconds'),
+                'rows': meta.get('rows'),
             })
     return entries
 
@@ -69,7 +81,7 @@ def _human_size(n):
 
 def _safe_filename(name):
     """Reject filenames that try to escape the backup dir."""
-    return name == os.path.basename(name) and name.endswith('.bak') and '..' not in name
+    return name == os.path.basename(name) and _is_backup(name) and '..' not in name
 
 
 # ---------------------------------------------------------------------------
@@ -94,25 +106,30 @@ def list_backups():
 
 @backup_api_bp.route('/backup/create', methods=['POST'])
 def create_backup():
-    """Copy the live database to the backup directory right now."""
-    try:
-        src = _db_path()
-        if not os.path.isfile(src):
-            return jsonify({'error': 'Database file not found'}), 404
+    """
+    Dump the live database to the backup directory right now.
 
+    The dump reads a consistent snapshot without locking tables, so ingest
+    carries on while it runs.
+    """
+    try:
         dest_dir = _ensure_backup_dir()
         filename = _backup_filename()
         dest = os.path.join(dest_dir, filename)
 
-        shutil.copy2(src, dest)
-        stat = os.stat(dest)
+        stats = backup_service.create_dump(dest)
         logger.info(f"Backup created: {dest}")
 
         return jsonify({
             'success': True,
-            'message': f'Backup created: {filename}',
+            'message': f"Backup created: {filename} ({_human_size(stats['size_bytes'])} in {stats['duration_seconds']:.1f}s)",
             'filename': filename,
-            'size_human': _human_size(stat.st_size),
+            'size_bytes': stats['size_bytes'],
+            'size_human': _human_size(stats['size_bytes']),
+            'uncompressed_bytes': stats['uncompressed_bytes'],
+            'duration_seconds': stats['duration_seconds'],
+            'tables': stats['tables'],
+            'rows': stats['rows'],
             'backup_dir': dest_dir
         })
     except Exception as e:
@@ -123,13 +140,16 @@ def create_backup():
 @backup_api_bp.route('/backup/restore', methods=['POST'])
 def restore_backup():
     """
-    Restore a named backup over the live database, then restart the process so
-    the app re-opens the replaced file.
+    Restore a named backup over the live database, then restart every process
+    so in-memory caches start from the restored data.
 
-    Body: { "filename": "template.db.20260507_120000.bak" }
+    Body: { "filename": "template.20260507_120000.sql.gz" }
 
-    The container's restart policy (always/unless-stopped) means Docker will
-    bring it back up automatically after the SIGTERM.
+    Under gunicorn (APP_ROLE "web") the master is sent SIGHUP, which replaces
+    all web workers, and the background worker is asked through the job queue
+    to exit; the gunicorn master (or the worker's own service) starts it again.
+    The single dev server process is sent SIGTERM, and the container's restart
+    policy (always/unless-stopped) brings it back up.
     """
     try:
         data = request.get_json() or {}
@@ -145,23 +165,36 @@ def restore_backup():
         if not os.path.isfile(src):
             return jsonify({'error': f'Backup not found: {filename}'}), 404
 
-        dest = _db_path()
+        if filename.endswith(backup_service.DUMP_SUFFIX):
+            backup_service.restore_dump(src)
+            logger.info(f"Restored {filename}. Restarting process.")
+        else:
+            dest = _db_path()
+            if not dest:
+                return jsonify({'error': 'File backups can only be restored on a file database'}), 400
 
-        # Write an atomic replacement: copy to a temp file beside the target,
-        # then rename (atomic on POSIX within the same filesystem).
-        tmp = dest + '.restore_tmp'
-        shutil.copy2(src, tmp)
-        os.replace(tmp, dest)
+            # Write an atomic replacement: copy to a temp file beside the target,
+            # then rename (atomic on POSIX within the same filesystem).
+            tmp = dest + '.restore_tmp'
+            shutil.copy2(src, tmp)
+            os.replace(tmp, dest)
 
-        logger.info(f"Restored {filename} → {dest}. Restarting process.")
+            logger.info(f"Restored {filename} → {dest}. Restarting process.")
 
-        # Schedule a clean shutdown so Docker restarts the container.
-        # We respond first, then signal after a short delay via a background thread.
+        # Schedule the restart: we respond first, then signal after a short
+        # delay via a background thread.
         import threading
+        if current_app.config.get('APP_ROLE', 'all') == 'web':
+            from ..job_queue import job_queue
+            job_queue.enqueue('restart_worker')
+            pid, signum = os.getppid(), signal.SIGHUP  # The gunicorn master
+        else:
+            pid, signum = os.getpid(), signal.SIGTERM
+
         def _shutdown():
             import time
             time.sleep(1)          # let the response flush
-            os.kill(os.getpid(), signal.SIGTERM)
+            os.kill(pid, signum)
 
         threading.Thread(target=_shutdown, daemon=True).start()
 
@@ -179,7 +212,7 @@ def restore_backup():
 def delete_backup():
     """Delete a named backup file.
 
-    Body: { "filename": "template.db.20260507_120000.bak" }
+    Body: { "filename": "template.20260507_120000.sql.gz" }
     """
     try:
         data = request.get_json() or {}
@@ -196,6 +229,8 @@ def delete_backup():
             return jsonify({'error': f'Backup not found: {filename}'}), 404
 
         os.remove(path)
+        if os.path.exists(path + '.json'):
+            os.remove(path + '.json')
         logger.info(f"Deleted backup: {path}")
         return jsonify({'success': True, 'message': f'Deleted {filename}'})
 
@@ -408,7 +408,7 @@ def delete_widget(widget_id):
 def get_widget_data(widget_id):
     """Get data for a specific widget"""
     try:
-        # Check if force_refresh parameter is set (for AI summaries)
+        # force_refresh recomputes cached widget data and regenerates AI summaries
         force_refresh = request.args.get('force_refresh', 'false').lower() == 'true'
         
         conn = get_db()
@@ -436,7 +436,7 @@ def get_widget_data(widget_id):
             widget['config'] = json.dumps(config)
         
         # Get widget data using DashboardService
-        data = DashboardService.get_widget_data(widget)
+        data = DashboardService.get_widget_data(widget, use_cache=not force_refresh)
         
         return jsonify(data), 200
         
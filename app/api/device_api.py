@@ -11,6 +11,9 @@ from datetime import datetime, timedelta, timezone
 import json
 from ..db import get_connection
 from ..utils.sensor_type_manager import auto_register_sensor_types, get_sensor_types_from_device_data
+from ..services.device_registry import device_registry
+from ..services.sensor_rollup_service import record_rollups
+from ..device_scheduler import device_scheduler, next_poll_time
 
 # Define a Blueprint for Device API
 device_api_bp = Blueprint('device_api', __name__)
@@ -384,6 +387,8 @@ def register_device():
                 ''', (device_db_id, int(entry_id)))
         
         conn.commit()
+        device_registry.invalidate(data['device_id'])
+        device_scheduler.wake()
         
         return jsonify({
             'message': 'Device registered successfully',
@@ -418,6 +423,10 @@ def update_device(device_id):
                 else:
                     values.append(data[field])
         
+        # Poll on the next cycle with the new settings
+        if any(field in data for field in ('ip', 'polling_enabled', 'polling_interval')):
+            update_fields.append("next_poll_at = NULL")
+        
         # Handle linked entries separately
         if 'linked_entry_ids' in data:
             # Delete existing links
@@ -448,6 +457,8 @@ def update_device(device_id):
                 return jsonify({'error': 'Device not found'}), 404
         
         conn.commit()
+        device_registry.invalidate_device(device_id)
+        device_scheduler.wake()
         
         return jsonify({'message': 'Device updated successfully'})
         
@@ -469,6 +480,7 @@ def delete_device(device_id):
             return jsonify({'error': 'Device not found'}), 404
         
         conn.commit()
+        device_registry.invalidate_device(device_id)
         
         return jsonify({'message': 'Device deleted successfully'})
         
@@ -477,7 +489,17 @@ def delete_device(device_id):
         conn.rollback()
         return jsonify({'error': 'Failed to delete device'}), 500
 
-def extract_sensor_data_using_mappings(device_id, device_data, cursor):
+def get_device_sensor_mappings(device_id, cursor):
+    """Enabled sensor mappings for a device"""
+    cursor.execute('''
+        SELECT sensor_name, entry_field, data_type, unit, enabled
+        FROM DeviceSensorMapping 
+        WHERE device_id = ? AND enabled = 1
+    ''', (device_id,))
+    return cursor.fetchall()
+
+
+def extract_sensor_data_using_mappings(device_id, device_data, cursor, mappings=None, recorded_at=None):
     """
     Extract sensor data based on configured device sensor mappings
     
@@ -485,20 +507,18 @@ def extract_sensor_data_using_mappings(device_id, device_data, cursor):
         device_id: ID of the device
         device_data: Raw JSON data from device
         cursor: Database cursor
+        mappings: Pre-fetched mappings (batch callers fetch them once)
+        recorded_at: ISO timestamp for the points (defaults to now)
         
     Returns:
         List of sensor data points with mapped sensor types
     """
     # Get configured sensor mappings for this device
-    cursor.execute('''
-        SELECT sensor_name, entry_field, data_type, unit, enabled
-        FROM DeviceSensorMapping 
-        WHERE device_id = ? AND enabled = 1
-    ''', (device_id,))
+    if mappings is None:
+        mappings = get_device_sensor_mappings(device_id, cursor)
     
-    mappings = cursor.fetchall()
     sensor_data_points = []
-    timestamp = datetime.now(timezone.utc).isoformat()
+    timestamp = recorded_at or datetime.now(timezone.utc).isoformat()
     
     def get_nested_value(data, path):
         """Get value from nested dictionary using dot notation and array notation path"""
@@ -596,37 +616,40 @@ def poll_device_data(device_id):
             
             # Store sensor data to all linked entries and trigger notification checks
             stored_count = 0
+            stored_rows = []
             for entry_id in linked_entry_ids:
                 for sensor_point in sensor_data_points:
-                    cursor.execute('''
-                        INSERT INTO SensorData (entry_id, sensor_type, value, recorded_at)
-                        VALUES (?, ?, ?, ?)
-                    ''', (
+                    row = (
                         entry_id,
                         sensor_point['sensor_type'],
                         sensor_point['value'],
                         sensor_point['recorded_at']
-                    ))
+                    )
+                    cursor.execute('''
+                        INSERT INTO SensorData (entry_id, sensor_type, value, recorded_at)
+                        VALUES (?, ?, ?, ?)
+                    ''', row)
+                    stored_rows.append(row)
                     stored_count += 1
-                    
-                    # Check sensor notification rules for each data point
-                    try:
-                        from ..api.notifications_api import check_sensor_rules
-                        check_sensor_rules(entry_id, sensor_point['sensor_type'], 
-                                         sensor_point['value'], sensor_point['recorded_at'])
-                    except Exception as e:
-                        logger.warning(f"Error checking sensor rules for entry {entry_id}: {e}")
-                        # Don't fail the data collection if notification checking fails
             
-            # Update device last_seen
-            timestamp = datetime.now(timezone.utc).isoformat()
+            record_rollups(cursor, stored_rows)
+            
+            # Check sensor notification rules for the whole poll at once
+            from ..api.notifications_api import check_sensor_rules_batch_with_connection
+            check_sensor_rules_batch_with_connection(cursor, stored_rows)
+            
+            # Update device last_seen (and last_data_stored, which push rate limiting reads)
+            polled_at = datetime.now(timezone.utc)
+            timestamp = polled_at.isoformat()
             cursor.execute('''
                 UPDATE RegisteredDevices 
-                SET last_seen = ?, status = 'online', last_poll_success = ?
+                SET last_seen = ?, status = 'online', last_poll_success = ?, next_poll_at = ?
                 WHERE id = ?
-            ''', (timestamp, timestamp, device_id))
+            ''', (timestamp, timestamp, next_poll_time(device['polling_interval'], polled_at), device_id))
+            device_registry.claim_stored(cursor, device_id, polled_at, polled_at)
             
             conn.commit()
+            device_registry.note_stored(device['device_id'], polled_at)
             
             return jsonify({
                 'message': f'Successfully polled device and stored {stored_count} sensor readings to {len(linked_entry_ids)} entries',
@@ -668,6 +691,7 @@ def poll_all_devices():
         
         devices = cursor.fetchall()
         results = []
+        stored = []  # (sensor_id, stored_at) for the device registry after commit
         
         for device in devices:
             try:
@@ -694,34 +718,37 @@ def poll_all_devices():
                 
                 # Store sensor data to all linked entries and trigger notification checks
                 stored_count = 0
+                stored_rows = []
                 for entry_id in linked_entry_ids:
                     for sensor_point in sensor_data_points:
-                        cursor.execute('''
-                            INSERT INTO SensorData (entry_id, sensor_type, value, recorded_at)
-                            VALUES (?, ?, ?, ?)
-                        ''', (
+                        row = (
                             entry_id,
                             sensor_point['sensor_type'],
                             sensor_point['value'],
                             sensor_point['recorded_at']
-                        ))
+                        )
+                        cursor.execute('''
+                            INSERT INTO SensorData (entry_id, sensor_type, value, recorded_at)
+                            VALUES (?, ?, ?, ?)
+                        ''', row)
+                        stored_rows.append(row)
                         stored_count += 1
-                        
-                        # Check sensor notification rules for each data point
-                        try:
-                            from ..api.notifications_api import check_sensor_rules
-                            check_sensor_rules(entry_id, sensor_point['sensor_type'], 
-                                             sensor_point['value'], sensor_point['recorded_at'])
-                        except Exception as e:
-                            logger.warning(f"Error checking sensor rules for entry {entry_id}: {e}")
-                            # Don't fail the data collection if notification checking fails
                 
-                timestamp = datetime.now(timezone.utc).isoformat()
+                record_rollups(cursor, stored_rows)
+                
+                # Check sensor notification rules for the whole poll at once
+                from ..api.notifications_api import check_sensor_rules_batch_with_connection
+                check_sensor_rules_batch_with_connection(cursor, stored_rows)
+                
+                polled_at = datetime.now(timezone.utc)
+                timestamp = polled_at.isoformat()
                 cursor.execute('''
                     UPDATE RegisteredDevices 
-                    SET last_seen = ?, status = 'online', last_poll_success = ?
+                    SET last_seen = ?, status = 'online', last_poll_success = ?, next_poll_at = ?
                     WHERE id = ?
-                ''', (timestamp, timestamp, device['id']))
+                ''', (timestamp, timestamp, next_poll_time(device['polling_interval'], polled_at), device['id']))
+                device_registry.claim_stored(cursor, device['id'], polled_at, polled_at)
+                stored.append((device['device_id'], polled_at))
                 
                 results.append({
                     'device_id': device['id'],
@@ -746,6 +773,8 @@ def poll_all_devices():
                 })
         
         conn.commit()
+        for sensor_id, stored_at in stored:
+            device_registry.note_stored(sensor_id, stored_at)
         
         return jsonify({
             'message': f'Polled {len(results)} devices',
@@ -863,6 +892,11 @@ def get_api_status():
             'status': 'active',
             'local_network_range': local_network,
             'timestamp': datetime.now().isoformat(),
+            'polling': {
+                'running': device_scheduler.running,
+                'workers': device_scheduler.max_workers,
+                'last_cycle': device_scheduler.last_cycle
+            },
             'available_endpoints': [
                 '/devices/scan - Full network scan with threading',
                 '/devices/test-connection - Test single IP',
@@ -1205,6 +1239,7 @@ def save_sensor_mappings(device_id):
             ))
         
         db.commit()
+        device_registry.invalidate_device(device_id)
         
         logger.info(f"Saved {len(mappings)} sensor mappings for device {device_id}")
         
@@ -1482,6 +1517,8 @@ def link_device_to_entry(device_id):
         ''', (device_id, entry_id, True))
         
         db.commit()
+        device_registry.invalidate_device(device_id)
+        device_scheduler.wake()
         
         return jsonify({
             'message': 'Device linked to entry successfully',
@@ -1515,6 +1552,7 @@ def unlink_device_from_entry(device_id):
             return jsonify({'error': 'Device link not found'}), 404
         
         db.commit()
+        device_registry.invalidate_device(device_id)
         
         return jsonify({
             'message': 'Device unlinked from entry successfully',
@@ -3,6 +3,8 @@ from flask import Blueprint, request, jsonify, g, url_for, current_app
 from datetime import datetime, timezone
 import logging
 from ..utils.sensor_type_manager import auto_register_sensor_types
+from ..services.sensor_rollup_service import record_rollups, rebuild_rollups
+from ..services.saved_search_cache import saved_search_cache
 
 # Define a Blueprint for Entry API
 entry_api_bp = Blueprint('entry_api', __name__)
@@ -145,6 +147,7 @@ def add_entry():
             (title, description, entry_type_id, intended_end_date, commenced_at, status, now)
         )
         conn.commit()
+        saved_search_cache.entries_changed([cursor.lastrowid])
         # Use main_bp.entry_detail_v2 because it's in a different blueprint (now the default view)
         return jsonify({'message': 'Entry added successfully!', 'redirect': url_for('main.entry_detail_v2', entry_id=cursor.lastrowid)}), 201
     except Exception as e:
@@ -286,6 +289,7 @@ def update_entry(entry_id):
         conn.commit()
         if cursor.rowcount == 0:
             return jsonify({'error': 'Entry not found or no changes made.'}), 404
+        saved_search_cache.entries_changed([entry_id])
         
         # Check if status changed and create an auto-note
         new_status = data.get('status')
@@ -326,6 +330,7 @@ def delete_entry(entry_id):
         conn.commit()
         if cursor.rowcount == 0:
             return jsonify({'error': 'Entry not found.'}), 404
+        saved_search_cache.entries_changed([entry_id])
         return jsonify({'message': 'Entry and its related data deleted successfully!'}), 200
     except Exception as e:
         logger.error(f"Error deleting entry {entry_id}: {e}", exc_info=True)
@@ -346,6 +351,7 @@ def archive_entry(entry_id):
         conn.commit()
         if cursor.rowcount == 0:
             return jsonify({'error': 'Entry not found or already archived.'}), 404
+        saved_search_cache.entries_changed([entry_id])
         return jsonify({'message': 'Entry archived successfully.', 'archived_at': now}), 200
     except Exception as e:
         logger.error(f"Error archiving entry {entry_id}: {e}", exc_info=True)
@@ -365,6 +371,7 @@ def restore_entry(entry_id):
         conn.commit()
         if cursor.rowcount == 0:
             return jsonify({'error': 'Entry not found or not archived.'}), 404
+        saved_search_cache.entries_changed([entry_id])
         return jsonify({'message': 'Entry restored successfully.'}), 200
     except Exception as e:
         logger.error(f"Error restoring entry {entry_id}: {e}", exc_info=True)
@@ -639,8 +646,9 @@ def add_sensor_data_to_entry(entry_id):
             "INSERT INTO SensorData (entry_id, sensor_type, value, recorded_at) VALUES (?, ?, ?, ?)",
             (entry_id, sensor_type, value, recorded_at)
         )
-        conn.commit()
         sensor_id = cursor.lastrowid
+        record_rollups(cursor, [(entry_id, sensor_type, value, recorded_at)])
+        conn.commit()
         
         # Check sensor notification rules
         try:
@@ -668,10 +676,13 @@ def delete_sensor_data(sensor_id):
         conn = get_db()
         cursor = conn.cursor()
         
-        cursor.execute("DELETE FROM SensorData WHERE id = ?", (sensor_id,))
-        if cursor.rowcount == 0:
+        cursor.execute("SELECT entry_id, sensor_type FROM SensorData WHERE id = ?", (sensor_id,))
+        reading = cursor.fetchone()
+        if not reading:
             return jsonify({'error': 'Sensor data not found.'}), 404
         
+        cursor.execute("DELETE FROM SensorData WHERE id = ?", (sensor_id,))
+        rebuild_rollups(cursor, [reading['entry_id']], reading['sensor_type'])
         conn.commit()
         return jsonify({'message': 'Sensor data deleted successfully!'}), 200
         
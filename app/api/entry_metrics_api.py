@@ -23,7 +23,7 @@ Data points (per entry):
 Chart data (dashboard widget + entry section):
   GET    /api/entry-metrics/chart-data
          params: metric_ids, search_id|entry_ids, time_range,
-                 x_axis_type, x_axis_field, x_axis_custom_column_id
+                 x_axis_type, x_axis_field, x_axis_custom_column_id, max_points
 """
 
 import json
@@ -32,6 +32,8 @@ import re
 from datetime import datetime, timezone, timedelta
 from flask import Blueprint, request, jsonify, g
 from ..db import get_connection
+from ..services.dashboard_service import series_count_query
+from ..utils.downsample import fetch_series
 
 logger = logging.getLogger(__name__)
 
@@ -413,6 +415,8 @@ def get_chart_data():
     x_axis_field    : Entry field name when x_axis_type=entry_field
                       (commenced_at | created_at | intended_end_date | actual_end_date)
     x_axis_custom_column_id : CustomColumn.id when x_axis_type=custom_column
+    max_points      : per-series point budget for x_axis_type=recorded_at; longer
+                      series are downsampled with LTTB  (optional)
 
     Response
     --------
@@ -446,6 +450,7 @@ def get_chart_data():
     x_axis_type = request.args.get('x_axis_type', 'recorded_at')
     x_axis_field = request.args.get('x_axis_field', 'commenced_at')
     x_axis_custom_column_id = request.args.get('x_axis_custom_column_id', type=int)
+    max_points = request.args.get('max_points', type=int)
 
     VALID_ENTRY_FIELDS = {'commenced_at', 'created_at', 'intended_end_date', 'actual_end_date'}
     if x_axis_type == 'entry_field' and x_axis_field not in VALID_ENTRY_FIELDS:
@@ -509,8 +514,8 @@ def get_chart_data():
                     query += ' AND edp.recorded_at >= ?'
                     params.append(tf)
                 query += ' ORDER BY edp.recorded_at ASC'
-                cursor.execute(query, params)
-                rows = cursor.fetchall()
+                rows = fetch_series(conn, cursor, query, params,
+                                    series_count_query(mid, entry_ids, tf), max_points)
                 data_points = [
                     {
                         'x': r['recorded_at'],
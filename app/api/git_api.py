@@ -6,6 +6,8 @@ from functools import wraps
 import logging
 from datetime import datetime
 
+from app.job_queue import job_queue
+
 logger = logging.getLogger(__name__)
 
 
@@ -346,6 +348,7 @@ def update_repository(repo_id):
         }), 500
 
 @git_api_bp.route('/api/git/repositories/<int:repo_id>/sync', methods=['POST'])
+@job_queue.deferrable
 def sync_repository(repo_id):
     """Sync repository commits and branches"""
     try:
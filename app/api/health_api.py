@@ -1,5 +1,5 @@
 # app/api/health_api.py
-from flask import Blueprint, jsonify
+from flask import Blueprint, Response, jsonify
 import os
 from datetime import datetime
 from app.db import get_connection
@@ -57,6 +57,46 @@ def health_check():
         health_status['checks']['upload_directory'] = f'error: {str(e)}'
         overall_healthy = False
     
+    # Informational only, never affects the overall status
+    try:
+        from app.services.widget_cache import widget_cache
+        health_status['widget_cache'] = widget_cache.stats()
+    except Exception:
+        pass
+    
+    try:
+        from app.db import get_pool_stats
+        health_status['db_pool'] = get_pool_stats()
+    except Exception:
+        pass
+    
+    try:
+        from app.sensor_ingest_queue import ingest_queue
+        health_status['ingest_queue'] = ingest_queue.stats()
+    except Exception:
+        pass
+    
+    # Polling, retention and jobs run in the background worker; a web
+    # worker reports what it last published (see app/worker_status.py)
+    try:
+        from flask import current_app
+        from app.job_queue import job_queue
+        from app.worker_status import worker_status
+        role = current_app.config.get('APP_ROLE', 'all')
+        health_status['role'] = role
+        background = worker_status.current(role)
+        if role == 'web':
+            health_status['worker'] = background and {
+                key: background[key] for key in ('pid', 'updated_at', 'age_seconds')
+            }
+        background = background or {}
+        health_status['device_poll'] = background.get('device_poll')
+        health_status['job_queue'] = dict(background.get('job_queue') or {}, jobs=job_queue.counts())
+        if background.get('sensor_retention'):
+            health_status['sensor_retention'] = background['sensor_retention']
+    except Exception:
+        pass
+    
     # Add version information
     try:
         version_file = '/app/VERSION'
@@ -81,6 +121,76 @@ def health_check():
     
     return jsonify(health_status), 200
 
+@health_api_bp.route('/metrics', methods=['GET'])
+def prometheus_metrics():
+    """
+    Request, database and background-cycle metrics in the Prometheus text
+    format, plus queue depths, cache hit rates and pool counters.
+    """
+    from app.metrics import metrics, snapshot_gauges
+    
+    gauges = []
+    
+    try:
+        from app.sensor_ingest_queue import ingest_queue
+        gauges += snapshot_gauges('ingest_queue', 'Sensor upload write-behind queue', ingest_queue.stats())
+    except Exception:
+        pass
+    
+    # The background worker's reports, as in /api/health
+    background = {}
+    try:
+        from flask import current_app
+        from app.worker_status import worker_status
+        background = worker_status.current(current_app.config.get('APP_ROLE', 'all')) or {}
+    except Exception:
+        pass
+    
+    try:
+        gauges += snapshot_gauges('device_poll_last_cycle', 'Last device polling cycle',
+                                  background.get('device_poll') or {})
+    except Exception:
+        pass
+    
+    try:
+        from app.services.widget_cache import widget_cache
+        gauges += snapshot_gauges('widget_cache', 'Dashboard widget cache', widget_cache.stats())
+    except Exception:
+        pass
+    
+    try:
+        from app.services.saved_search_cache import saved_search_cache
+        gauges += snapshot_gauges('saved_search_cache', 'Saved search cache', saved_search_cache.stats())
+    except Exception:
+        pass
+    
+    try:
+        from app.db import get_pool_stats
+        for pool, stats in get_pool_stats().items():
+            gauges += snapshot_gauges('db_pool', 'Database connection pool', stats, (('pool', pool),))
+    except Exception:
+        pass
+    
+    try:
+        from app.job_queue import job_queue
+        gauges += snapshot_gauges('job_queue', 'Background job workers', background.get('job_queue') or {})
+        gauges.append(('job_queue_jobs', 'Background jobs by status',
+                       [((('status', status),), count) for status, count in job_queue.counts().items()]))
+    except Exception:
+        pass
+    
+    try:
+        report = background.get('sensor_retention')
+        if report:
+            gauges += snapshot_gauges('sensor_retention_last_run', 'Last sensor retention run', report)
+            gauges.append(('sensor_retention_last_run_deleted_rows', 'Rows deleted by the last retention run',
+                           [((('table', table),), count) for table, count in sorted(report['deleted'].items())]))
+    except Exception:
+        pass
+    
+    return Response(metrics.render(gauges), mimetype='text/plain; version=0.0.4')
+
+
 @health_api_bp.route('/version', methods=['GET'])
 def version_info():
     """
@@ -0,0 +1,25 @@
+# app/api/jobs_api.py
+from flask import Blueprint, jsonify
+import logging
+
+from app.job_queue import job_queue
+
+jobs_api_bp = Blueprint('jobs_api', __name__)
+
+logger = logging.getLogger(__name__)
+
+@jobs_api_bp.route('/jobs/<int:job_id>', methods=['GET'])
+def get_job(job_id):
+    """
+    Status of a background job (see app/job_queue.py). ``status`` is queued,
+    running, done or failed; a deferred request's ``result`` holds the
+    status_code and body the view answered with.
+    """
+    try:
+        job = job_queue.get(job_id)
+    except Exception as e:
+        logger.error(f"Error reading job {job_id}: {e}")
+        return jsonify({'error': str(e)}), 500
+    if job is None:
+        return jsonify({'error': 'Job not found'}), 404
+    return jsonify(job)
@@ -5,6 +5,7 @@ Provides endpoints for managing kanban boards and columns
 """
 
 from ..db import get_connection
+from ..services.saved_search_cache import saved_search_cache
 from flask import Blueprint, request, jsonify, g, current_app
 import json
 import logging
@@ -541,6 +542,7 @@ def move_entry(entry_id):
         """, (entry_id, "Status Change", note_text, "System", now))
         
         conn.commit()
+        saved_search_cache.entries_changed([entry_id])
         
         logger.info(f"Entry {entry_id} ('{entry['title']}') moved from '{old_status}' to '{new_status}' via Kanban")
         
@@ -1123,22 +1123,23 @@ def print_niimbot_image():
         printer_address = data.get('printer_address')
         printer_model = data.get('printer_model', 'd110')
         image_data = data.get('image_data')  # Base64 encoded PNG
+        images_data = data.get('images') or ([image_data] if image_data else [])  # batch of base64 PNGs
         density = int(data.get('density', 3))
         quantity = int(data.get('quantity', 1))
         
         if not printer_address:
             return jsonify({'success': False, 'error': 'Printer address required'}), 400
         
-        if not image_data:
+        if not images_data:
             return jsonify({'success': False, 'error': 'Image data required'}), 400
         
-        # Decode base64 image
+        # Decode base64 images
         import base64
         from io import BytesIO
-        image_bytes = base64.b64decode(image_data)
-        label_image = Image.open(BytesIO(image_bytes))
+        label_images = [Image.open(BytesIO(base64.b64decode(encoded))) for encoded in images_data]
         
-        logger.info(f"Received image for printing: {label_image.size} ({label_image.mode})")
+        for label_image in label_images:
+            logger.info(f"Received image for printing: {label_image.size} ({label_image.mode})")
         
         # Print to Niimbot
         import asyncio
@@ -1157,39 +1158,37 @@ def print_niimbot_image():
             
             # The Niimbot service handles color inversion internally, so just pass RGB
             # Convert to RGB if needed
-            if label_image.mode != 'RGB':
-                rgb_image = label_image.convert('RGB')
-            else:
-                rgb_image = label_image
-            
-            logger.info(f"Sending image to printer: {rgb_image.size}")
-            
-            logger.info(f"Sending print job (density: {density}, quantity: {quantity})...")
-            success = await printer.print_image(rgb_image, density, quantity)
+            rgb_images = [image if image.mode == 'RGB' else image.convert('RGB') for image in label_images]
             
-            logger.info("Disconnecting from printer...")
-            await printer.disconnect()
+            # Every label in the batch goes over this one connection
+            logger.info(f"Sending {len(rgb_images)} print job(s) (density: {density}, quantity: {quantity})...")
+            try:
+                printed = await printer.print_images(rgb_images, density, quantity)
+            finally:
+                logger.info("Disconnecting from printer...")
+                await printer.disconnect()
             
-            logger.info(f"Print job completed: {'success' if success else 'failed'}")
-            return success
+            logger.info(f"Print job completed: {printed}/{len(rgb_images)} label(s) printed")
+            return printed
         
         try:
-            success = loop.run_until_complete(print_job())
+            printed = loop.run_until_complete(print_job())
         except Exception as e:
             logger.error(f"Print job failed with exception: {type(e).__name__}: {e}")
             raise
         finally:
             loop.close()
         
-        if success:
+        if printed == len(label_images):
             return jsonify({
                 'success': True,
-                'message': f'Successfully printed {quantity} label(s)'
+                'message': f'Successfully printed {quantity * printed} label(s)'
             })
         else:
             return jsonify({
                 'success': False,
-                'error': 'Print job failed'
+                'error': 'Print job failed',
+                'printed': printed
             }), 500
         
     except ImportError:
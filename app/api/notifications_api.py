@@ -5,6 +5,7 @@ import logging
 from ..utils.sensor_type_manager import ensure_sensor_type_exists
 from ..services.ntfy_service import send_app_notification_via_ntfy
 from ..db import get_connection
+from ..services.notification_rule_engine import rule_engine
 
 # Define a Blueprint for Notifications API
 notifications_api_bp = Blueprint('notifications_api', __name__)
@@ -310,6 +311,7 @@ def create_notification_rule():
         
         conn.commit()
         rule_id = cursor.lastrowid
+        rule_engine.invalidate()
         
         return jsonify({
             'message': 'Notification rule created successfully!',
@@ -330,6 +332,7 @@ def delete_notification_rule(rule_id):
     try:
         cursor.execute('DELETE FROM NotificationRule WHERE id = ?', (rule_id,))
         conn.commit()
+        rule_engine.invalidate()
         
         if cursor.rowcount == 0:
             return jsonify({'error': 'Notification rule not found.'}), 404
@@ -377,6 +380,7 @@ def patch_notification_rule(rule_id):
         cursor.execute(query, update_values)
         
         conn.commit()
+        rule_engine.invalidate()
         
         return jsonify({'message': 'Notification rule updated successfully!', 'id': rule_id}), 200
         
@@ -439,6 +443,7 @@ def update_notification_rule(rule_id):
               notification_title, notification_message, priority, cooldown_minutes, rule_id))
         
         conn.commit()
+        rule_engine.invalidate()
         
         return jsonify({'message': 'Notification rule updated successfully!', 'id': rule_id}), 200
         
@@ -449,201 +454,44 @@ def update_notification_rule(rule_id):
 
 def check_sensor_rules(entry_id, sensor_type, value, recorded_at):
     """Check if sensor data triggers any notification rules"""
+    check_sensor_rules_batch([(entry_id, sensor_type, value, recorded_at)])
+
+def check_sensor_rules_batch(readings):
+    """Check (entry_id, sensor_type, value, recorded_at) readings against the rules and commit any notifications"""
     conn = get_db()
     cursor = conn.cursor()
     
     try:
-        # First check if the entry is active - don't create notifications for inactive entries
-        cursor.execute('SELECT status FROM Entry WHERE id = ?', (entry_id,))
-        entry_result = cursor.fetchone()
-        if not entry_result or entry_result['status'] == 'inactive':
-            logger.debug(f"Skipping sensor rule check for inactive entry {entry_id}")
-            return
-        
-        # Get applicable rules for this sensor data
-        cursor.execute('''
-            SELECT * FROM NotificationRule 
-            WHERE is_active = 1 
-            AND sensor_type = ?
-            AND (entry_id = ? OR entry_id IS NULL)
-            AND (entry_type_id IS NULL OR entry_type_id IN (
-                SELECT entry_type_id FROM Entry WHERE id = ?
-            ))
-        ''', (sensor_type, entry_id, entry_id))
-        
-        rules = cursor.fetchall()
-        
-        for rule in rules:
-            # Check if cooldown period has passed
-            cursor.execute('''
-                SELECT created_at FROM Notification 
-                WHERE notification_type = 'sensor_based'
-                AND entry_id = ?
-                ORDER BY created_at DESC
-                LIMIT 1
-            ''', (entry_id,))
-            
-            last_notification = cursor.fetchone()
-            if last_notification:
-                last_time = datetime.fromisoformat(last_notification['created_at'])
-                cooldown_end = last_time + timedelta(minutes=rule['cooldown_minutes'])
-                if datetime.now() < cooldown_end:
-                    continue  # Still in cooldown period
-            
-            # Check if condition is met
-            try:
-                # Extract numeric value from potentially formatted string (e.g., "232724 bytes" -> 232724)
-                # This handles sensor values that include units from device data formatting
-                import re
-                numeric_match = re.match(r'^(-?\d+(?:\.\d+)?)', str(value).strip())
-                if numeric_match:
-                    sensor_value = float(numeric_match.group(1))
-                else:
-                    sensor_value = float(value)
-                threshold = rule['threshold_value']
-                
-                condition_met = False
-                if rule['condition_type'] == 'greater_than':
-                    condition_met = sensor_value > threshold
-                elif rule['condition_type'] == 'less_than':
-                    condition_met = sensor_value < threshold
-                elif rule['condition_type'] == 'equals':
-                    condition_met = abs(sensor_value - threshold) < 0.01  # Allow small floating point differences
-                elif rule['condition_type'] == 'between':
-                    threshold_secondary = rule['threshold_value_secondary']
-                    condition_met = min(threshold, threshold_secondary) <= sensor_value <= max(threshold, threshold_secondary)
-                
-                if condition_met:
-                    # Create notification - sensor notifications should show immediately
-                    cursor.execute('''
-                        INSERT INTO Notification 
-                        (title, message, notification_type, priority, entry_id, scheduled_for)
-                        VALUES (?, ?, ?, ?, ?, ?)
-                    ''', (rule['notification_title'], rule['notification_message'], 
-                          'sensor_based', rule['priority'], entry_id, datetime.now().isoformat()))
-                    
-                    notification_id = cursor.lastrowid
-                    conn.commit()
-                    logger.info(f"Created sensor-based notification for rule {rule['id']}")
-                    
-                    # Send ntfy notification immediately for sensor-based notifications
-                    try:
-                        notification_data = {
-                            'title': rule['notification_title'],
-                            'message': rule['notification_message'],
-                            'type': 'sensor_based',
-                            'priority': rule['priority'],
-                            'entry_id': entry_id,
-                            'notification_id': notification_id
-                        }
-                        send_app_notification_via_ntfy(notification_data)
-                    except Exception as e:
-                        logger.error(f"Failed to send ntfy notification for sensor rule {rule['id']}: {e}")
-                    
-            except (ValueError, TypeError):
-                # Skip non-numeric sensor values for numeric comparisons
-                continue
-                
+        created = rule_engine.evaluate(cursor, readings)
+        if created:
+            conn.commit()
+            rule_engine.committed(created)
+        _send_sensor_notifications(created)
     except Exception as e:
         logger.error(f"Error checking sensor rules: {e}", exc_info=True)
+        conn.rollback()
 
 def check_sensor_rules_with_connection(cursor, entry_id, sensor_type, value, recorded_at):
     """Check if sensor data triggers any notification rules - version that accepts external cursor"""
+    check_sensor_rules_batch_with_connection(cursor, [(entry_id, sensor_type, value, recorded_at)])
+
+def check_sensor_rules_batch_with_connection(cursor, readings):
+    """Batch rule check on an external cursor; the caller commits the notifications"""
     try:
-        # First check if the entry is active - don't create notifications for inactive entries
-        cursor.execute('SELECT status FROM Entry WHERE id = ?', (entry_id,))
-        entry_result = cursor.fetchone()
-        if not entry_result or entry_result['status'] == 'inactive':
-            logger.debug(f"Skipping sensor rule check for inactive entry {entry_id}")
-            return
-        
-        # Get applicable rules for this sensor data
-        cursor.execute('''
-            SELECT * FROM NotificationRule 
-            WHERE is_active = 1 
-            AND sensor_type = ?
-            AND (entry_id = ? OR entry_id IS NULL)
-            AND (entry_type_id IS NULL OR entry_type_id IN (
-                SELECT entry_type_id FROM Entry WHERE id = ?
-            ))
-        ''', (sensor_type, entry_id, entry_id))
-        
-        rules = cursor.fetchall()
-        
-        for rule in rules:
-            # Check if cooldown period has passed
-            cursor.execute('''
-                SELECT created_at FROM Notification 
-                WHERE notification_type = 'sensor_based'
-                AND entry_id = ?
-                ORDER BY created_at DESC
-                LIMIT 1
-            ''', (entry_id,))
-            
-            last_notification = cursor.fetchone()
-            if last_notification:
-                last_time = datetime.fromisoformat(last_notification['created_at'])
-                cooldown_end = last_time + timedelta(minutes=rule['cooldown_minutes'])
-                if datetime.now() < cooldown_end:
-                    continue  # Still in cooldown period
-            
-            # Check if condition is met
-            try:
-                # Extract numeric value from potentially formatted string (e.g., "232724 bytes" -> 232724)
-                # This handles sensor values that include units from device data formatting
-                import re
-                numeric_match = re.match(r'^(-?\d+(?:\.\d+)?)', str(value).strip())
-                if numeric_match:
-                    sensor_value = float(numeric_match.group(1))
-                else:
-                    sensor_value = float(value)
-                threshold = rule['threshold_value']
-                
-                condition_met = False
-                if rule['condition_type'] == 'greater_than':
-                    condition_met = sensor_value > threshold
-                elif rule['condition_type'] == 'less_than':
-                    condition_met = sensor_value < threshold
-                elif rule['condition_type'] == 'equals':
-                    condition_met = abs(sensor_value - threshold) < 0.01  # Allow small floating point differences
-                elif rule['condition_type'] == 'between':
-                    threshold_secondary = rule['threshold_value_secondary']
-                    condition_met = min(threshold, threshold_secondary) <= sensor_value <= max(threshold, threshold_secondary)
-                
-                if condition_met:
-                    # Create notification - sensor notifications should show immediately
-                    cursor.execute('''
-                        INSERT INTO Notification 
-                        (title, message, notification_type, priority, entry_id, scheduled_for)
-                        VALUES (?, ?, ?, ?, ?, ?)
-                    ''', (rule['notification_title'], rule['notification_message'], 
-                          'sensor_based', rule['priority'], entry_id, datetime.now().isoformat()))
-                    
-                    notification_id = cursor.lastrowid
-                    # Note: Don't commit here - let the calling function handle the transaction
-                    logger.info(f"Created sensor-based notification for rule {rule['id']}")
-                    
-                    # Send ntfy notification immediately for sensor-based notifications
-                    try:
-                        notification_data = {
-                            'title': rule['notification_title'],
-                            'message': rule['notification_message'],
-                            'type': 'sensor_based',
-                            'priority': rule['priority'],
-                            'entry_id': entry_id,
-                            'notification_id': notification_id
-                        }
-                        send_app_notification_via_ntfy(notification_data)
-                    except Exception as e:
-                        logger.error(f"Failed to send ntfy notification for sensor rule {rule['id']}: {e}")
-                    
-            except (ValueError, TypeError):
-                # Skip non-numeric sensor values for numeric comparisons
-                continue
-                
+        _send_sensor_notifications(rule_engine.evaluate(cursor, readings))
     except Exception as e:
         logger.error(f"Error checking sensor rules with connection: {e}", exc_info=True)
 
+def _send_sensor_notifications(created):
+    """Send ntfy notifications immediately for sensor-based notifications"""
+    for notification in created:
+        rule_id = notification['rule_id']
+        notification = {key: value for key, value in notification.items() if key not in ('rule_id', 'created_at')}
+        try:
+            send_app_notification_via_ntfy(notification)
+        except Exception as e:
+            logger.error(f"Failed to send ntfy notification for sensor rule {rule_id}: {e}")
+
 def create_note_notification(note_id, entry_id, scheduled_for, title, message):
     """Create a notification from a note with future date"""
     conn = get_db()
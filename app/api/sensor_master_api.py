@@ -18,16 +18,28 @@ Endpoints:
 6. POST /api/sensor-master/command - Queue commands for sensors
 """
 
-from flask import Blueprint, request, jsonify, g
+from flask import Blueprint, request, jsonify, g, make_response, current_app, send_file
 import pymysql
 import json
 import hashlib
+import io
 import logging
 import re
+import threading
+import time
+from collections import OrderedDict
 from datetime import datetime, timedelta, timezone
-from ..db import get_connection
+from ..db import get_connection, get_dedicated_connection
 from app.utils.discovery import DeviceScanner
 from app.utils.discovery import DeviceScanner
+from app.utils.msgpack_codec import MSGPACK_MIMETYPES, MessagePackError, unpackb
+from app.utils.keyset import encode_cursor, keyset_clause, keyset_params
+from app.utils.event_stream import stream_format, ndjson_response, sse_tail, last_event_id
+from app.utils.firmware_patch import FirmwarePatchError, patch_firmware
+from app.services.device_registry import device_registry, parse_stored_timestamp
+from app.services.command_push import command_push
+from app.device_scheduler import next_poll_time
+from app.services.sensor_rollup_service import record_rollups
 
 # Define a Blueprint for Sensor Master Control API
 sensor_master_api_bp = Blueprint('sensor_master_api', __name__)
@@ -35,6 +47,27 @@ sensor_master_api_bp = Blueprint('sensor_master_api', __name__)
 # Get a logger for this module
 logger = logging.getLogger(__name__)
 
+# How long a sensor that announced deep sleep may stay silent before it is
+# considered offline. Sent to firmware so duty-cycled nodes check in in time.
+HIBERNATION_TIMEOUT_MINUTES = 120
+
+# Pin-control action types and the execute_script action the generated
+# firmware runs for each (see runCommandActions / run_command_actions)
+PIN_CONTROL_ACTIONS = {
+    'gpio_write': 'gpio_write',
+    'set_pump': 'gpio_write',
+    'set_solenoid': 'gpio_write',
+    'set_relay': 'set_relay',
+}
+
+
+def pin_level(value):
+    """Read a pin-control value (true/false, 1/0, 'HIGH'/'LOW', 'on'/'off') as a level"""
+    if isinstance(value, str):
+        return value.strip().lower() in ('high', '1', 'true', 'on')
+    return bool(value)
+
+
 def get_db():
     """Get database connection"""
     if 'db' not in g:
@@ -42,12 +75,288 @@ def get_db():
     return g.db
 
 
+def get_sensor_payload():
+    """
+    Request body from a sensor, sent as JSON or MessagePack.
+    
+    Returns None for an empty or undecodable body so callers keep their
+    usual "sensor_id is required" handling.
+    """
+    if request.mimetype in MSGPACK_MIMETYPES:
+        try:
+            data = unpackb(request.get_data(cache=False))
+        except MessagePackError as e:
+            logger.warning(f"Rejected MessagePack payload: {e}")
+            return None
+        return data if isinstance(data, dict) else None
+    return request.get_json()
+
+
 def generate_config_hash(config_data):
     """Generate a hash for configuration data to detect changes"""
     config_str = json.dumps(config_data, sort_keys=True)
     return hashlib.sha256(config_str.encode()).hexdigest()
 
 
+def db_timestamp(dt=None):
+    """UTC timestamp in the 'YYYY-MM-DD HH:MM:SS' form MariaDB compares natively"""
+    return (dt or datetime.now(timezone.utc)).strftime('%Y-%m-%d %H:%M:%S')
+
+
+def build_sensor_config(sensor):
+    """
+    Configuration pushed to a sensor, derived from its registration row.
+    
+    SensorMasterConfig has been removed, so the registration is the only
+    source of per-sensor settings.
+    """
+    return {
+        'check_in_interval': sensor['check_in_interval'] or 5,
+        'hibernation_timeout_minutes': HIBERNATION_TIMEOUT_MINUTES,
+        'battery_r1': sensor.get('battery_r1'),
+        'battery_r2': sensor.get('battery_r2'),
+    }
+
+
+def generate_script_hash(script_row, sensor):
+    """Short hash identifying the script build a sensor should be running"""
+    return generate_config_hash({
+        'script_id': script_row['id'],
+        'version': script_row['script_version'],
+        'updated_at': str(script_row['updated_at']),
+        'battery_r1': sensor.get('battery_r1'),
+        'battery_r2': sensor.get('battery_r2'),
+    })[:16]
+
+
+# Firmware builds of active scripts, keyed by generate_script_hash(). Scripts
+# are immutable once stored (edits insert a new row), so a build only changes
+# with a new script or new battery calibration.
+FIRMWARE_SCRIPT_CACHE_SIZE = 256
+_firmware_script_cache = OrderedDict()
+_firmware_script_cache_lock = threading.Lock()
+
+
+def inject_battery_calibration(script_content, sensor):
+    """Set the sensor's calibrated R1/R2 on every read_battery action in a JSON script"""
+    if not (sensor['battery_r1'] and sensor['battery_r2']):
+        return script_content
+    
+    try:
+        script_data = json.loads(script_content) if isinstance(script_content, str) else script_content
+        
+        def update_battery_actions(actions):
+            if not isinstance(actions, list):
+                return
+            for action in actions:
+                if isinstance(action, dict):
+                    if action.get('type') == 'read_battery':
+                        action['r1'] = sensor['battery_r1']
+                        action['r2'] = sensor['battery_r2']
+                    
+                    # Recurse into conditional blocks
+                    if 'then' in action and isinstance(action['then'], list):
+                        update_battery_actions(action['then'])
+                    if 'else' in action and isinstance(action['else'], list):
+                        update_battery_actions(action['else'])
+        
+        if 'actions' in script_data:
+            update_battery_actions(script_data['actions'])
+        
+        # Convert back to string if needed
+        return json.dumps(script_data) if isinstance(script_content, str) else script_data
+    
+    except Exception as e:
+        logger.warning(f"Failed to inject calibration data into script for {sensor['sensor_id']}: {e}")
+        return script_content
+
+
+def get_firmware_script(cursor, script_row, sensor):
+    """
+    Calibrated script and compiled bytecode for a sensor's active script.
+    
+    Built once per script hash and cached, so repeated downloads skip loading
+    the content, the JSON parse, the calibration rewrite and the compile.
+    """
+    script_hash = generate_script_hash(script_row, sensor)
+    with _firmware_script_cache_lock:
+        build = _firmware_script_cache.get(script_hash)
+        if build is not None:
+            _firmware_script_cache.move_to_end(script_hash)
+            return build
+    
+    cursor.execute('SELECT script_content FROM SensorScripts WHERE id = ?', (script_row['id'],))
+    script_content = cursor.fetchone()['script_content']
+    compiled = None
+    if script_row['script_type'] == 'json':
+        script_content = inject_battery_calibration(script_content, sensor)
+        # Pre-compile JSON scripts so the firmware runs bytecode instead of walking JSON
+        compiled = compile_script_for_firmware(script_content)
+    
+    build = {'hash': script_hash, 'script': script_content, 'compiled': compiled}
+    with _firmware_script_cache_lock:
+        _firmware_script_cache[script_hash] = build
+        while len(_firmware_script_cache) > FIRMWARE_SCRIPT_CACHE_SIZE:
+            _firmware_script_cache.popitem(last=False)
+    return build
+
+
+def claim_pending_commands(cursor, sensor_id, limit=10):
+    """Fetch a sensor's pending, unexpired commands and mark them delivered"""
+    cursor.execute('''
+        SELECT id, command_type, command_data, priority, created_at
+        FROM SensorCommandQueue
+        WHERE sensor_id = ? 
+        AND status = 'pending'
+        AND (expires_at IS NULL OR expires_at > ?)
+        ORDER BY priority ASC, created_at ASC
+        LIMIT ?
+    ''', (sensor_id, db_timestamp(), limit))
+    
+    commands = []
+    for row in cursor.fetchall():
+        command = dict(row)
+        if command['command_data']:
+            try:
+                command['command_data'] = json.loads(command['command_data'])
+            except (TypeError, ValueError):
+                pass
+        commands.append(command)
+    
+    if commands:
+        command_ids = [cmd['id'] for cmd in commands]
+        cursor.execute(f'''
+            UPDATE SensorCommandQueue
+            SET status = 'delivered', attempts = attempts + 1
+            WHERE id IN ({','.join('?' * len(command_ids))})
+        ''', command_ids)
+    
+    return commands
+
+
+def record_heartbeat(cursor, data, timestamp, sensor=None):
+    """
+    Apply a heartbeat payload to SensorRegistration (status, metrics, battery,
+    telemetry and command results).
+    
+    Args:
+        sensor: Registration row if the caller already loaded it (saves a query)
+    
+    Returns:
+        False if the sensor is not registered
+    """
+    sensor_id = data['sensor_id']
+    
+    # Build update query dynamically to include script version if provided
+    update_fields = {
+        'last_check_in': timestamp,
+        'status': data.get('status', 'online'),
+        'ip_address': data.get('ip_address', ''),
+        'updated_at': timestamp
+    }
+    
+    # If sensor reports current script version, update it
+    if 'current_script_version' in data:
+        update_fields['current_script_version'] = data['current_script_version']
+    
+    if 'current_script_id' in data:
+        update_fields['current_script_id'] = data['current_script_id']
+        
+    # Extract metrics for direct display if available
+    metrics = data.get('metrics', {})
+    if 'temperature' in metrics:
+        update_fields['last_temperature'] = metrics['temperature']
+    if 'relay_state' in metrics:
+        update_fields['last_relay_state'] = metrics['relay_state']
+    
+    # Extract battery info if available (check both metrics and root data)
+    # Firmware sends dynamic variables in root of /api response, but heartbeat puts them in metrics
+    battery_pct = metrics.get('battery_pct') or data.get('battery_pct')
+    battery_voltage = metrics.get('battery') or data.get('battery')
+    
+    should_update_battery = True
+    if battery_pct is not None or battery_voltage is not None:
+        # Check if we should ignore this update because a log update happened recently
+        try:
+            current_state = sensor
+            if current_state is None:
+                cursor.execute('SELECT updated_at, last_battery_update_source FROM SensorRegistration WHERE sensor_id = ?', (sensor_id,))
+                current_state = cursor.fetchone()
+            
+            if current_state and current_state['last_battery_update_source'] == 'log':
+                last_update = current_state['updated_at']
+                if last_update:
+                    # Handle timestamp parsing
+                    if 'Z' in last_update:
+                        last_dt = datetime.fromisoformat(last_update.replace('Z', '+00:00'))
+                    else:
+                        last_dt = datetime.fromisoformat(last_update).replace(tzinfo=timezone.utc)
+                        
+                    now_dt = datetime.now(timezone.utc)
+                    diff = (now_dt - last_dt).total_seconds()
+                    
+                    # If updated via log in the last 2 minutes, ignore heartbeat battery data
+                    # This prevents stale heartbeat data from overwriting fresh log data
+                    if diff < 120:
+                        should_update_battery = False
+                        logger.info(f"Ignoring heartbeat battery data for {sensor_id} (log update was {diff:.1f}s ago)")
+        except Exception as e:
+            logger.warning(f"Error checking battery update source: {e}")
+
+    if should_update_battery:
+        if battery_pct is not None:
+            update_fields['last_battery_pct'] = battery_pct
+            update_fields['last_battery_update_source'] = 'heartbeat'
+        if battery_voltage is not None:
+            update_fields['last_battery_voltage'] = battery_voltage
+            update_fields['last_battery_update_source'] = 'heartbeat'
+    
+    set_clause = ', '.join([f"{k} = ?" for k in update_fields.keys()])
+    values = list(update_fields.values()) + [sensor_id]
+    
+    cursor.execute(f'''
+        UPDATE SensorRegistration
+        SET {set_clause}
+        WHERE sensor_id = ?
+    ''', values)
+    
+    if cursor.rowcount == 0:
+        return False
+        
+    # Store telemetry data if metrics are provided
+    if 'metrics' in data:
+        try:
+            cursor.execute('''
+                INSERT INTO SensorTelemetry (sensor_id, data, timestamp)
+                VALUES (?, ?, ?)
+            ''', (sensor_id, json.dumps(data['metrics']), timestamp))
+        except pymysql.OperationalError:
+            # Table might not exist if migration wasn't run
+            logger.warning("SensorTelemetry table not found. Skipping telemetry storage.")
+
+    
+    # Process command results if provided
+    if 'command_results' in data:
+        for result in data['command_results']:
+            command_id = result.get('command_id')
+            if command_id:
+                cursor.execute('''
+                    UPDATE SensorCommandQueue
+                    SET status = ?,
+                        result = ?,
+                        executed_at = ?
+                    WHERE id = ? AND sensor_id = ?
+                ''', (
+                    result.get('status', 'completed'),
+                    json.dumps(result),
+                    timestamp,
+                    command_id,
+                    sensor_id
+                ))
+    
+    return True
+
+
 @sensor_master_api_bp.route('/sensor-master/register', methods=['POST'])
 def register_sensor():
     """
@@ -174,6 +483,7 @@ def register_sensor():
             logger.info(f"Updated RegisteredDevices for {sensor_id}")
 
         conn.commit()
+        device_registry.invalidate(sensor_id)
         
         # Check if there's a configuration available
         # SensorMasterConfig table has been removed, so we check if a script is assigned
@@ -271,26 +581,7 @@ def get_sensor_config(sensor_id):
             ''', (config_hash, datetime.now(timezone.utc).isoformat(), sensor_id))
         
         # Get any pending commands for this sensor
-        cursor.execute('''
-            SELECT id, command_type, command_data, priority, created_at
-            FROM SensorCommandQueue
-            WHERE sensor_id = ? 
-            AND status = 'pending'
-            AND (expires_at IS NULL OR expires_at > datetime('now'))
-            ORDER BY priority ASC, created_at ASC
-            LIMIT 10
-        ''', (sensor_id,))
-        
-        commands = [dict(row) for row in cursor.fetchall()]
-        
-        # Mark commands as delivered
-        if commands:
-            command_ids = [cmd['id'] for cmd in commands]
-            cursor.execute(f'''
-                UPDATE SensorCommandQueue
-                SET status = 'delivered', attempts = attempts + 1
-                WHERE id IN ({','.join('?' * len(command_ids))})
-            ''', command_ids)
+        commands = claim_pending_commands(cursor, sensor_id)
         
         conn.commit()
         
@@ -332,7 +623,7 @@ def sensor_heartbeat():
     }
     """
     try:
-        data = request.get_json()
+        data = get_sensor_payload()
         
         if not data or 'sensor_id' not in data:
             return jsonify({'error': 'sensor_id is required'}), 400
@@ -345,113 +636,11 @@ def sensor_heartbeat():
         # Update sensor last check-in
         timestamp = datetime.now(timezone.utc).isoformat()
         
-        # Build update query dynamically to include script version if provided
-        update_fields = {
-            'last_check_in': timestamp,
-            'status': data.get('status', 'online'),
-            'ip_address': data.get('ip_address', ''),
-            'updated_at': timestamp
-        }
-        
-        # If sensor reports current script version, update it
-        if 'current_script_version' in data:
-            update_fields['current_script_version'] = data['current_script_version']
-        
-        if 'current_script_id' in data:
-            update_fields['current_script_id'] = data['current_script_id']
-            
-        # Extract metrics for direct display if available
-        metrics = data.get('metrics', {})
-        if 'temperature' in metrics:
-            update_fields['last_temperature'] = metrics['temperature']
-        if 'relay_state' in metrics:
-            update_fields['last_relay_state'] = metrics['relay_state']
-        
-        # Extract battery info if available (check both metrics and root data)
-        # Firmware sends dynamic variables in root of /api response, but heartbeat puts them in metrics
-        battery_pct = metrics.get('battery_pct') or data.get('battery_pct')
-        battery_voltage = metrics.get('battery') or data.get('battery')
-        
-        should_update_battery = True
-        if battery_pct is not None or battery_voltage is not None:
-            # Check if we should ignore this update because a log update happened recently
-            try:
-                cursor.execute('SELECT updated_at, last_battery_update_source FROM SensorRegistration WHERE sensor_id = ?', (sensor_id,))
-                current_state = cursor.fetchone()
-                
-                if current_state and current_state['last_battery_update_source'] == 'log':
-                    last_update = current_state['updated_at']
-                    if last_update:
-                        # Handle timestamp parsing
-                        if 'Z' in last_update:
-                            last_dt = datetime.fromisoformat(last_update.replace('Z', '+00:00'))
-                        else:
-                            last_dt = datetime.fromisoformat(last_update).replace(tzinfo=timezone.utc)
-                            
-                        now_dt = datetime.now(timezone.utc)
-                        diff = (now_dt - last_dt).total_seconds()
-                        
-                        # If updated via log in the last 2 minutes, ignore heartbeat battery data
-                        # This prevents stale heartbeat data from overwriting fresh log data
-                        if diff < 120:
-                            should_update_battery = False
-                            logger.info(f"Ignoring heartbeat battery data for {sensor_id} (log update was {diff:.1f}s ago)")
-            except Exception as e:
-                logger.warning(f"Error checking battery update source: {e}")
-
-        if should_update_battery:
-            if battery_pct is not None:
-                update_fields['last_battery_pct'] = battery_pct
-                update_fields['last_battery_update_source'] = 'heartbeat'
-            if battery_voltage is not None:
-                update_fields['last_battery_voltage'] = battery_voltage
-                update_fields['last_battery_update_source'] = 'heartbeat'
-        
-        set_clause = ', '.join([f"{k} = ?" for k in update_fields.keys()])
-        values = list(update_fields.values()) + [sensor_id]
-        
-        cursor.execute(f'''
-            UPDATE SensorRegistration
-            SET {set_clause}
-            WHERE sensor_id = ?
-        ''', values)
-        
-        if cursor.rowcount == 0:
+        if not record_heartbeat(cursor, data, timestamp):
             return jsonify({
                 'error': 'Sensor not registered',
                 'action': 'register'
             }), 404
-            
-        # Store telemetry data if metrics are provided
-        if 'metrics' in data:
-            try:
-                cursor.execute('''
-                    INSERT INTO SensorTelemetry (sensor_id, data, timestamp)
-                    VALUES (?, ?, ?)
-                ''', (sensor_id, json.dumps(data['metrics']), timestamp))
-            except pymysql.OperationalError:
-                # Table might not exist if migration wasn't run
-                logger.warning("SensorTelemetry table not found. Skipping telemetry storage.")
-
-        
-        # Process command results if provided
-        if 'command_results' in data:
-            for result in data['command_results']:
-                command_id = result.get('command_id')
-                if command_id:
-                    cursor.execute('''
-                        UPDATE SensorCommandQueue
-                        SET status = ?,
-                            result = ?,
-                            executed_at = ?
-                        WHERE id = ? AND sensor_id = ?
-                    ''', (
-                        result.get('status', 'completed'),
-                        json.dumps(result),
-                        timestamp,
-                        command_id,
-                        sensor_id
-                    ))
         
         conn.commit()
         
@@ -474,7 +663,127 @@ def sensor_heartbeat():
         return jsonify({'error': 'Failed to process heartbeat'}), 500
 
 
-def calculate_sensor_status(last_check_in, timeout_minutes=10, current_status=None, hibernation_timeout_minutes=120):
+@sensor_master_api_bp.route('/sensor-master/checkin', methods=['POST'])
+def sensor_checkin():
+    """
+    Combined check-in: heartbeat, config, commands and script version in one
+    round trip (replaces heartbeat + config + script polling).
+    
+    Expected payload - the heartbeat payload plus what the sensor is running:
+    {
+        "sensor_id": "esp32_unique_id",
+        "status": "online",
+        "metrics": {...},
+        "command_results": [...],
+        "config_hash": "abc123...",
+        "script_id": 12,
+        "script_version": "1.0.3"
+    }
+    
+    Returns:
+    {
+        "status": "acknowledged",
+        "timestamp": "...",
+        "config_changed": false,
+        "config_hash": "abc123...",
+        "config": null,               (only sent when config_hash differs)
+        "commands": [...],
+        "script": {"script_id": 12, "version": "1.0.3", "hash": "...", "changed": false},
+        "wake_token": "..."           (required on the node's POST /command wake-up)
+    }
+    """
+    try:
+        data = get_sensor_payload()
+        
+        if not data or 'sensor_id' not in data:
+            return jsonify({'error': 'sensor_id is required'}), 400
+        
+        sensor_id = data['sensor_id']
+        
+        conn = get_db()
+        cursor = conn.cursor()
+        
+        cursor.execute('''
+            SELECT * FROM SensorRegistration
+            WHERE sensor_id = ?
+        ''', (sensor_id,))
+        
+        sensor = cursor.fetchone()
+        
+        if not sensor:
+            return jsonify({
+                'error': 'Sensor not registered',
+                'action': 'register'
+            }), 404
+        
+        timestamp = datetime.now(timezone.utc).isoformat()
+        
+        # Report the running script through the heartbeat fields
+        if 'script_id' in data:
+            data.setdefault('current_script_id', data['script_id'])
+        if 'script_version' in data:
+            data.setdefault('current_script_version', data['script_version'])
+        
+        record_heartbeat(cursor, data, timestamp, sensor=sensor)
+        
+        # Config delta - unchanged config costs only the hash
+        config_data = build_sensor_config(sensor)
+        config_hash = generate_config_hash(config_data)
+        config_changed = data.get('config_hash') != config_hash
+        
+        if sensor['config_hash'] != config_hash:
+            cursor.execute('''
+                UPDATE SensorRegistration
+                SET config_hash = ?, last_config_update = ?
+                WHERE sensor_id = ?
+            ''', (config_hash, timestamp, sensor_id))
+        
+        commands = claim_pending_commands(cursor, sensor_id)
+        
+        cursor.execute('''
+            SELECT id, script_version, updated_at
+            FROM SensorScripts
+            WHERE sensor_id = ? AND is_active = 1
+            ORDER BY updated_at DESC
+            LIMIT 1
+        ''', (sensor_id,))
+        
+        script_row = cursor.fetchone()
+        script_info = None
+        if script_row:
+            script_hash = generate_script_hash(script_row, sensor)
+            if data.get('script_hash'):
+                script_changed = data['script_hash'] != script_hash
+            else:
+                script_changed = (str(data.get('script_id')) != str(script_row['id'])
+                                  or data.get('script_version') != script_row['script_version'])
+            script_info = {
+                'script_id': script_row['id'],
+                'version': script_row['script_version'],
+                'hash': script_hash,
+                'changed': script_changed
+            }
+        
+        conn.commit()
+        
+        return jsonify({
+            'status': 'acknowledged',
+            'timestamp': timestamp,
+            'config_changed': config_changed,
+            'config_hash': config_hash,
+            'config': config_data if config_changed else None,
+            'commands': commands,
+            'script': script_info,
+            'wake_token': command_push.wake_token(sensor_id)
+        }), 200
+        
+    except Exception as e:
+        logger.error(f"Error processing check-in: {e}", exc_info=True)
+        return jsonify({'error': 'Failed to process check-in'}), 500
+
+
+def calculate_sensor_status(last_check_in, timeout_minutes=10, current_status=None,
+                            hibernation_timeout_minutes=HIBERNATION_TIMEOUT_MINUTES):
     """
     Calculate sensor online/offline status based on last heartbeat
     
@@ -482,7 +791,7 @@ def calculate_sensor_status(last_check_in, timeout_minutes=10, current_status=No
         last_check_in: ISO timestamp string or None
         timeout_minutes: Number of minutes before considering sensor offline (default: 10)
         current_status: Current status of the sensor (e.g. 'online', 'hibernating')
-        hibernation_timeout_minutes: Timeout for hibernating sensors (default: 120)
+        hibernation_timeout_minutes: Timeout for hibernating sensors (default: HIBERNATION_TIMEOUT_MINUTES)
     
     Returns:
         'online', 'offline', 'hibernating', or 'pending'
@@ -708,6 +1017,7 @@ def update_sensor(sensor_id):
             return jsonify({'error': 'Sensor not found'}), 404
         
         conn.commit()
+        device_registry.invalidate(sensor_id)
         
         return jsonify({'message': 'Sensor updated successfully'}), 200
         
@@ -812,6 +1122,7 @@ def delete_sensor(sensor_id):
             return jsonify({'error': 'Sensor not found'}), 404
         
         conn.commit()
+        device_registry.invalidate(sensor_id)
         
         return jsonify({'message': 'Sensor deleted successfully'}), 200
         
@@ -870,6 +1181,25 @@ def transform_script_for_firmware(script_content):
         return script_content
 
 
+def compile_script_for_firmware(script_content):
+    """
+    Compile script content into the bytecode program run by generated firmware.
+
+    Returns the compiler result dict (see script_compiler.compile_script), or
+    None if the script cannot be compiled - the JSON copy is still served so
+    older firmware keeps working.
+    """
+    from ..services.script_compiler import compile_script, ScriptCompileError
+
+    try:
+        if not script_content:
+            return None
+        return compile_script(transform_script_for_firmware(script_content))
+    except (ScriptCompileError, ValueError) as e:
+        logger.warning(f"Script could not be compiled for firmware: {e}")
+        return None
+
+
 @sensor_master_api_bp.route('/sensor-master/sensors/<sensor_id>/script', methods=['GET'])
 def get_sensor_assigned_script(sensor_id):
     """Get the assigned script for a sensor from the database"""
@@ -894,10 +1224,14 @@ def get_sensor_assigned_script(sensor_id):
         if sensor['script_content']:
             # Transform script for firmware compatibility (e.g. set_pump -> gpio_write)
             transformed_script = transform_script_for_firmware(sensor['script_content'])
+            compiled = compile_script_for_firmware(sensor['script_content'])
             
             return jsonify({
                 'sensor_id': sensor_id,
                 'script': transformed_script,
+                'bytecode': compiled['bytecode'] if compiled else None,
+                'bytecode_size': compiled['size'] if compiled else 0,
+                'compile_warnings': compiled['warnings'] if compiled else [],
                 'name': sensor['name'],
                 'version': sensor['script_version']
             }), 200
@@ -990,9 +1324,10 @@ def queue_sensor_command():
         cursor = conn.cursor()
         
         # Check if sensor exists
-        cursor.execute('SELECT id FROM SensorRegistration WHERE sensor_id = ?', 
+        cursor.execute('SELECT id, ip_address FROM SensorRegistration WHERE sensor_id = ?', 
                       (data['sensor_id'],))
-        if not cursor.fetchone():
+        sensor = cursor.fetchone()
+        if not sensor:
             return jsonify({'error': 'Sensor not registered'}), 404
         
         cursor.execute('''
@@ -1010,6 +1345,7 @@ def queue_sensor_command():
         
         command_id = cursor.lastrowid
         conn.commit()
+        command_push.notify(data['sensor_id'], sensor['ip_address'])
         
         return jsonify({
             'message': 'Command queued successfully',
@@ -1041,12 +1377,21 @@ def control_sensor_pin():
         action_type = data['action_type']
         value = data['value']
         
+        # Generated firmware only runs pin writes from execute_script commands
+        if action_type not in PIN_CONTROL_ACTIONS:
+            return jsonify({
+                'error': f'Unsupported action_type: {action_type}',
+                'supported': sorted(PIN_CONTROL_ACTIONS)
+            }), 400
+        if not isinstance(pin, int) or isinstance(pin, bool) or pin < 0:
+            return jsonify({'error': 'pin must be a GPIO number'}), 400
+        
         conn = get_db()
         cursor = conn.cursor()
         
         # Check if sensor exists and is online
         cursor.execute('''
-            SELECT id, status, last_heartbeat 
+            SELECT id, status, last_heartbeat, ip_address
             FROM SensorRegistration 
             WHERE sensor_id = ?
         ''', (sensor_id,))
@@ -1064,13 +1409,9 @@ def control_sensor_pin():
         
         # Transform high-level device commands to low-level GPIO commands
         # This avoids needing to update firmware to support new device types
-        real_action_type = action_type
-        real_value = value
-        
-        if action_type in ['set_pump', 'set_solenoid']:
-            real_action_type = 'gpio_write'
-            # value is boolean (true/false) for these types
-            real_value = 'HIGH' if value else 'LOW'
+        real_action_type = PIN_CONTROL_ACTIONS[action_type]
+        # The firmware reads the level as 1/0
+        real_value = 1 if pin_level(value) else 0
         
         # Create a single-action script for immediate execution
         pin_command_script = {
@@ -1078,7 +1419,7 @@ def control_sensor_pin():
             'actions': [{
                 'type': real_action_type,
                 'pin': pin,
-                'value': real_value if real_action_type in ['gpio_write', 'pwm_write', 'analog_write'] else None,
+                'value': real_value if real_action_type == 'gpio_write' else None,
                 'state': real_value if real_action_type == 'set_relay' else None
             }]
         }
@@ -1087,17 +1428,19 @@ def control_sensor_pin():
         cursor.execute('''
             INSERT INTO SensorCommandQueue
             (sensor_id, command_type, command_data, priority, max_attempts, expires_at)
-            VALUES (?, ?, ?, ?, ?, datetime('now', '+1 minute'))
+            VALUES (?, ?, ?, ?, ?, ?)
         ''', (
             sensor_id,
             'execute_script',
             json.dumps(pin_command_script),
             1,  # Highest priority
-            1   # Only try once
+            1,  # Only try once
+            db_timestamp(datetime.now(timezone.utc) + timedelta(minutes=1))
         ))
         
         command_id = cursor.lastrowid
         conn.commit()
+        command_push.notify(sensor_id, sensor['ip_address'])
         
         # Log the pin control action
         cursor.execute('''
@@ -1169,12 +1512,62 @@ def get_sensor_commands():
         return jsonify({'error': 'Failed to fetch commands'}), 500
 
 
+# Long-polls re-read the queue this often, for commands queued by another process
+COMMAND_WAIT_RECHECK_SECONDS = 5
+
+
+@sensor_master_api_bp.route('/sensor-master/commands/<sensor_id>/wait', methods=['GET'])
+def wait_for_sensor_commands(sensor_id):
+    """
+    Long-poll for a sensor's commands
+    
+    Returns pending commands (marked delivered, as on check-in) as soon as
+    there are any, or an empty list after ``timeout`` seconds (default 25).
+    No database connection is held while waiting.
+    """
+    try:
+        max_wait = current_app.config.get('COMMAND_WAIT_MAX_SECONDS', 30)
+        timeout = max(0.0, min(request.args.get('timeout', 25, type=float), max_wait))
+        deadline = time.monotonic() + timeout
+        
+        while True:
+            # Version first: a command queued during the claim still wakes us
+            version = command_push.version(sensor_id)
+            commands = _claim_commands(sensor_id)
+            remaining = deadline - time.monotonic()
+            if commands or remaining <= 0:
+                break
+            command_push.wait(sensor_id, version, min(remaining, COMMAND_WAIT_RECHECK_SECONDS))
+        
+        return jsonify({
+            'sensor_id': sensor_id,
+            'commands': commands
+        }), 200
+        
+    except Exception as e:
+        logger.error(f"Error waiting for commands: {e}", exc_info=True)
+        return jsonify({'error': 'Failed to fetch commands'}), 500
+
+
+def _claim_commands(sensor_id):
+    conn = get_dedicated_connection()
+    try:
+        cursor = conn.cursor()
+        commands = claim_pending_commands(cursor, sensor_id)
+        conn.commit()
+        return commands
+    finally:
+        conn.close()
+
+
 @sensor_master_api_bp.route('/sensor-master/script/<sensor_id>', methods=['GET'])
 def get_sensor_script(sensor_id):
     """
     Get the current script/instructions for a sensor
     
-    This endpoint is polled by the ESP32 to check for script updates
+    This endpoint is polled by the ESP32 to check for script updates. Send the
+    current build's hash as If-None-Match (or ?hash=) to get a bodiless 304
+    when nothing changed.
     """
     try:
         conn = get_db()
@@ -1194,7 +1587,7 @@ def get_sensor_script(sensor_id):
         
         # Check for sensor-specific script
         cursor.execute('''
-            SELECT script_content, script_version, script_type, updated_at
+            SELECT id, script_version, script_type, updated_at
             FROM SensorScripts
             WHERE sensor_id = ? AND is_active = 1
             ORDER BY updated_at DESC
@@ -1204,46 +1597,25 @@ def get_sensor_script(sensor_id):
         script_row = cursor.fetchone()
         
         if script_row:
-            # Parse script content
-            script_content = script_row['script_content']
+            # The sensor already runs this build - skip the download entirely
+            script_hash = generate_script_hash(script_row, sensor)
+            etag = f'"{script_hash}"'
+            if etag in request.headers.get('If-None-Match', '') or request.args.get('hash') == script_hash:
+                response = make_response('', 304)
+                response.headers['ETag'] = etag
+                return response
             
-            # If script is JSON, inject calibration data into battery actions
-            if script_row['script_type'] == 'json':
-                try:
-                    script_data = json.loads(script_content) if isinstance(script_content, str) else script_content
-                    
-                    # Check if sensor has calibration data
-                    if sensor['battery_r1'] and sensor['battery_r2']:
-                        # Recursively update battery actions with calibration data
-                        def update_battery_actions(actions):
-                            if not isinstance(actions, list):
-                                return
-                            for action in actions:
-                                if isinstance(action, dict):
-                                    if action.get('type') == 'read_battery':
-                                        # Inject calibrated R1/R2 values
-                                        action['r1'] = sensor['battery_r1']
-                                        action['r2'] = sensor['battery_r2']
-                                        logger.info(f"Injected battery calibration into script for {sensor_id}: R1={sensor['battery_r1']}, R2={sensor['battery_r2']}")
-                                    
-                                    # Recurse into conditional blocks
-                                    if 'then' in action and isinstance(action['then'], list):
-                                        update_battery_actions(action['then'])
-                                    if 'else' in action and isinstance(action['else'], list):
-                                        update_battery_actions(action['else'])
-                        
-                        if 'actions' in script_data:
-                            update_battery_actions(script_data['actions'])
-                        
-                        # Convert back to string if needed
-                        script_content = json.dumps(script_data) if isinstance(script_content, str) else script_data
-                
-                except Exception as e:
-                    logger.warning(f"Failed to inject calibration data into script for {sensor_id}: {e}")
+            build = get_firmware_script(cursor, script_row, sensor)
+            script_content = build['script']
+            compiled = build['compiled']
             
-            return jsonify({
+            response = jsonify({
                 'script_available': True,
+                'script_id': script_row['id'],
+                'script_hash': script_hash,
                 'script': script_content,
+                'bytecode': compiled['bytecode'] if compiled else None,
+                'bytecode_size': compiled['size'] if compiled else 0,
                 'version': script_row['script_version'],
                 'type': script_row['script_type'],
                 'updated_at': script_row['updated_at'],
@@ -1252,7 +1624,9 @@ def get_sensor_script(sensor_id):
                     'battery_r2': sensor['battery_r2'],
                     'battery_calibrated_voltage': sensor['battery_calibrated_voltage']
                 } if sensor['battery_r1'] else None
-            }), 200
+            })
+            response.headers['ETag'] = etag
+            return response, 200
         
         return jsonify({
             'script_available': False,
@@ -1671,17 +2045,26 @@ def export_esp32_code():
         "language": "arduino" or "micropython",
         "wifi_ssid": "MyWiFi",
         "wifi_password": "MyPassword",
-        "custom_config": {} (optional)
+        "custom_config": {} (optional),
+        "power_profile": "always_on" or "deep_sleep" (optional, arduino only),
+        "log_level": "none", "error", "warn", "info" or "debug" (optional, arduino only),
+        "output": "sketch" (default), "split" or "header" (optional)
     }
     
     Returns:
     {
         "success": true,
         "code": "... generated code ...",
+        "config_file": "sensor_config.h",
+        "config_header": "... per-device settings ...",
+        "core_hash": "3f9a...",
         "language": "arduino",
         "sensor_id": "esp32_001",
         "filename": "esp32_001.ino"
     }
+    
+    "header" leaves out ``code`` - re-flashing a fleet only needs each
+    device's config file next to a cached core (``core`` with "split").
     """
     try:
         data = request.get_json()
@@ -1698,6 +2081,9 @@ def export_esp32_code():
         wifi_ssid = data.get('wifi_ssid', '')
         wifi_password = data.get('wifi_password', '')
         custom_config = data.get('custom_config')
+        power_profile = data.get('power_profile')
+        log_level = data.get('log_level')
+        output = data.get('output', 'sketch')
         
         # Import the code generator service
         from ..services.esp32_code_generator import ESP32CodeGenerator
@@ -1711,13 +2097,18 @@ def export_esp32_code():
             language=language,
             wifi_ssid=wifi_ssid,
             wifi_password=wifi_password,
-            custom_config=custom_config
+            custom_config=custom_config,
+            power_profile=power_profile,
+            log_level=log_level,
+            output=output
         )
         
         if result.get('success'):
             # Determine filename
             sensor_id_str = result.get('sensor_id', 'esp32_sensor')
-            if language == 'arduino':
+            if output == 'header':
+                filename = result['config_file']
+            elif language == 'arduino':
                 filename = f"{sensor_id_str}.ino"
             else:
                 filename = f"{sensor_id_str}.py"
@@ -1732,6 +2123,46 @@ def export_esp32_code():
         return jsonify({'error': 'Failed to export code', 'details': str(e)}), 500
 
 
+@sensor_master_api_bp.route('/sensor-master/export-firmware', methods=['POST'])
+def export_esp32_firmware():
+    """
+    Re-target a prebuilt firmware image for one sensor
+    
+    Multipart form:
+    - firmware: .bin built from generated Arduino code (any device's)
+    - sensor_id: sensor to write into the image
+    - wifi_ssid, wifi_password: optional
+    
+    The image's device settings block is rewritten and its checksum/hash
+    fixed up, so a fleet can be flashed from one build. The build options
+    (power profile, log level) are those the image was compiled with.
+    """
+    try:
+        firmware = request.files.get('firmware')
+        sensor_id = request.form.get('sensor_id')
+        if not firmware or not sensor_id:
+            return jsonify({'error': 'firmware and sensor_id are required'}), 400
+        
+        from ..services.esp32_code_generator import ESP32CodeGenerator
+        
+        generator = ESP32CodeGenerator(get_db())
+        values = generator.registered_device_values(
+            sensor_id, request.form.get('wifi_ssid', ''), request.form.get('wifi_password', ''))
+        if values is None:
+            return jsonify({'error': 'Sensor not registered'}), 404
+        
+        image = patch_firmware(firmware.read(), values)
+        
+        return send_file(io.BytesIO(image), mimetype='application/octet-stream',
+                         as_attachment=True, download_name=f"{sensor_id}.bin")
+        
+    except FirmwarePatchError as e:
+        return jsonify({'error': str(e)}), 400
+    except Exception as e:
+        logger.error(f"Error patching firmware: {e}", exc_info=True)
+        return jsonify({'error': 'Failed to export firmware'}), 500
+
+
 @sensor_master_api_bp.route('/sensor-master/script-executed', methods=['POST'])
 def report_script_execution():
     """
@@ -1837,43 +2268,66 @@ def report_script_version():
 @sensor_master_api_bp.route('/sensor-master/telemetry/<sensor_id>', methods=['GET'])
 def get_sensor_telemetry(sensor_id):
     """
-    Get telemetry data for a sensor
-    
+    Get telemetry data for a sensor, newest first
+
     Query params:
-    - limit: Number of records to return (default: 100)
+    - limit: Number of records to return (default: 100, max: 1000)
+    - cursor: next_cursor from the previous page (keyset pagination)
+    - format: 'ndjson' to stream the rows, 'sse' to tail new records
+      (starting after min_id, or Last-Event-ID on reconnect)
     """
     try:
-        limit = request.args.get('limit', 100, type=int)
-        
+        limit = max(1, min(request.args.get('limit', 100, type=int), STREAM_PAGE_MAX))
+        mode = stream_format()
+
+        if mode == 'sse':
+            def poll(after_id):
+                return [(row['id'], _telemetry_item(row)) for row in _read_rows(
+                    'SELECT id, data, timestamp FROM SensorTelemetry '
+                    'WHERE sensor_id = ? AND id > ? ORDER BY id LIMIT ?',
+                    (sensor_id, after_id, STREAM_PAGE_MAX))]
+            after_id = last_event_id(request.args.get('min_id', 0, type=int))
+            return sse_tail(poll, after_id or _latest_id('SensorTelemetry', sensor_id), 'telemetry')
+
+        query = '''
+            SELECT id, data, timestamp
+            FROM SensorTelemetry
+            WHERE sensor_id = ?
+        '''
+        params = [sensor_id]
+        if request.args.get('cursor'):
+            query += keyset_clause('timestamp')
+            try:
+                params += keyset_params(request.args['cursor'])
+            except ValueError as e:
+                return jsonify({'error': str(e)}), 400
+        query += ' ORDER BY timestamp DESC, id DESC LIMIT ?'
+
+        if mode == 'ndjson':
+            return ndjson_response(_telemetry_item(row) for row in _stream_rows(query, params + [limit]))
+
         conn = get_db()
         cursor = conn.cursor()
-        
+
         try:
-            cursor.execute('''
-                SELECT data, timestamp 
-                FROM SensorTelemetry
-                WHERE sensor_id = ?
-                ORDER BY timestamp DESC
-                LIMIT ?
-            ''', (sensor_id, limit))
-            
+            cursor.execute(query, params + [limit + 1])
             rows = cursor.fetchall()
-            
-            telemetry = []
-            for row in rows:
-                telemetry.append({
-                    'timestamp': row['timestamp'],
-                    'data': json.loads(row['data'])
-                })
-                
+
+            telemetry = [_telemetry_item(row) for row in rows[:limit]]
+            next_cursor = None
+            if len(rows) > limit:
+                last = rows[limit - 1]
+                next_cursor = encode_cursor(last['timestamp'], last['id'])
+
             return jsonify({
                 'sensor_id': sensor_id,
-                'telemetry': telemetry
+                'telemetry': telemetry,
+                'next_cursor': next_cursor
             }), 200
-            
+
         except pymysql.OperationalError:
             return jsonify({'error': 'Telemetry data not available'}), 404
-            
+
     except Exception as e:
         logger.error(f"Error getting telemetry: {e}", exc_info=True)
         return jsonify({'error': 'Failed to get telemetry'}), 500
@@ -1916,7 +2370,7 @@ def report_sensor_log():
     }
     """
     try:
-        data = request.get_json()
+        data = get_sensor_payload()
         # logger.info(f"Received log request from sensor: {data}") # Reduce noise
         
         if not data or 'sensor_id' not in data or 'message' not in data:
@@ -2028,53 +2482,377 @@ def report_sensor_log():
 @sensor_master_api_bp.route('/sensor-master/logs/<sensor_id>', methods=['GET'])
 def get_sensor_logs(sensor_id):
     """
-    Get logs for a sensor
-    
+    Get logs for a sensor, newest first
+
     Query params:
-    - limit: Number of records to return (default: 100)
+    - limit: Number of records to return (default: 100, max: 1000)
     - min_id: Only return logs with ID greater than this value
+    - cursor: next_cursor from the previous page (keyset pagination on
+      the (sensor_id, created_at) index)
+    - format: 'ndjson' to stream the rows, 'sse' to tail new logs live
+      (starting after min_id, or Last-Event-ID on reconnect)
     """
     try:
-        limit = request.args.get('limit', 100, type=int)
+        limit = max(1, min(request.args.get('limit', 100, type=int), STREAM_PAGE_MAX))
         min_id = request.args.get('min_id', 0, type=int)
-        
-        conn = get_db()
-        cursor = conn.cursor()
-        
+        mode = stream_format()
+
+        if mode == 'sse':
+            def poll(after_id):
+                return [(row['id'], _log_item(row)) for row in _read_rows(
+                    'SELECT id, message, log_level, created_at FROM SensorLogs '
+                    'WHERE sensor_id = ? AND id > ? ORDER BY id LIMIT ?',
+                    (sensor_id, after_id, STREAM_PAGE_MAX))]
+            after_id = last_event_id(min_id)
+            return sse_tail(poll, after_id or _latest_id('SensorLogs', sensor_id), 'log')
+
         query = '''
             SELECT id, message, log_level, created_at
             FROM SensorLogs
             WHERE sensor_id = ?
         '''
         params = [sensor_id]
-        
+
         if min_id > 0:
             query += ' AND id > ?'
             params.append(min_id)
-            
-        query += ' ORDER BY created_at DESC LIMIT ?'
-        params.append(limit)
-        
-        cursor.execute(query, params)
-        
-        logs = []
-        for row in cursor.fetchall():
-            log = dict(row)
-            # Ensure timestamp is treated as UTC if it lacks timezone info (e.g. from CURRENT_TIMESTAMP)
-            if log['created_at'] and not ('+' in log['created_at'] or 'Z' in log['created_at']):
-                 log['created_at'] += 'Z'
-            logs.append(log)
-        
+        if request.args.get('cursor'):
+            query += keyset_clause('created_at')
+            try:
+                params += keyset_params(request.args['cursor'])
+            except ValueError as e:
+                return jsonify({'error': str(e)}), 400
+
+        query += ' ORDER BY created_at DESC, id DESC LIMIT ?'
+
+        if mode == 'ndjson':
+            return ndjson_response(_log_item(row) for row in _stream_rows(query, params + [limit]))
+
+        conn = get_db()
+        cursor = conn.cursor()
+        cursor.execute(query, params + [limit + 1])
+        rows = cursor.fetchall()
+
+        logs = [_log_item(row) for row in rows[:limit]]
+        next_cursor = None
+        if len(rows) > limit:
+            last = rows[limit - 1]
+            next_cursor = encode_cursor(last['created_at'], last['id'])
+
         return jsonify({
             'sensor_id': sensor_id,
-            'logs': logs
+            'logs': logs,
+            'next_cursor': next_cursor
         }), 200
-        
+
     except Exception as e:
         logger.error(f"Error fetching sensor logs: {e}", exc_info=True)
         return jsonify({'error': 'Failed to fetch logs'}), 500
 
 
+# Largest page for log/telemetry reads, and per poll of a live tail
+STREAM_PAGE_MAX = 1000
+
+
+def _log_item(row):
+    log = dict(row)
+    created_at = log['created_at']
+    if isinstance(created_at, datetime):
+        created_at = created_at.isoformat()
+    # Ensure timestamp is treated as UTC if it lacks timezone info (e.g. from CURRENT_TIMESTAMP)
+    if created_at and not ('+' in created_at or 'Z' in created_at):
+        created_at += 'Z'
+    log['created_at'] = created_at
+    return log
+
+
+def _telemetry_item(row):
+    return {
+        'id': row['id'],
+        'timestamp': row['timestamp'],
+        'data': json.loads(row['data'])
+    }
+
+
+def _read_rows(query, params):
+    """
+    Run one short query on a pooled connection of its own.
+
+    Live tails poll for minutes; they must not pin the request's shared
+    connection while they sleep.
+    """
+    conn = get_dedicated_connection()
+    try:
+        cursor = conn.cursor()
+        cursor.execute(query, params)
+        return cursor.fetchall()
+    finally:
+        conn.close()
+
+
+def _latest_id(table, sensor_id):
+    """Newest row id for a sensor, where a tail without a position starts"""
+    rows = _read_rows(f'SELECT MAX(id) AS last_id FROM {table} WHERE sensor_id = ?', (sensor_id,))
+    return (rows[0]['last_id'] if rows else None) or 0
+
+
+def _stream_rows(query, params):
+    """Rows of a query read from the server as they are consumed (NDJSON export)"""
+    conn = get_dedicated_connection()
+    try:
+        cursor = conn.cursor(unbuffered=True)
+        cursor.execute(query, params)
+        for row in cursor:
+            yield row
+        cursor.close()
+    finally:
+        conn.close()
+
+
+# Upper bound on samples accepted in one batch upload
+MAX_BATCH_SAMPLES = 500
+
+
+def sample_recorded_at(sample, received_at):
+    """
+    When a buffered sample was taken.
+    
+    Firmware sends epoch seconds once NTP has synced, otherwise the sample's
+    age in milliseconds at upload time. Anything else is treated as "now".
+    """
+    ts = sample.get('timestamp')
+    if isinstance(ts, (int, float)) and ts > 1e9:
+        return datetime.fromtimestamp(ts, timezone.utc)
+    age_ms = sample.get('age_ms')
+    if isinstance(age_ms, (int, float)) and age_ms >= 0:
+        return received_at - timedelta(milliseconds=age_ms)
+    return received_at
+
+
+def expand_samples(data, received_at):
+    """
+    Turn a data payload into a time-ordered list of (recorded_at, payload).
+    
+    A batch upload carries a "samples" array; each sample inherits the
+    top-level fields (sensor_id, mode, ...) so it has the same shape as a
+    single push and the existing sensor mappings apply unchanged.
+    """
+    samples = data.get('samples')
+    if not isinstance(samples, list):
+        return [(received_at, data)]
+    
+    base = {k: v for k, v in data.items() if k != 'samples'}
+    timeline = []
+    for sample in samples[:MAX_BATCH_SAMPLES]:
+        if isinstance(sample, dict):
+            merged = {**base, **sample}
+            timeline.append((sample_recorded_at(sample, received_at), merged))
+    timeline.sort(key=lambda item: item[0])
+    return timeline
+
+
+def is_known_sensor(cursor, sensor_id):
+    """True when the sensor is registered in Device Management or Sensor Master Control"""
+    return device_registry.get(cursor, sensor_id) is not None
+
+
+class SensorUploadBatch:
+    """
+    Work collected while storing uploads in one transaction: SensorData rows
+    for a single executemany, the newest points to check notification rules
+    against after commit, and the last stored sample time per sensor (applied
+    to the device registry only once the commit succeeds).
+    """
+    
+    def __init__(self):
+        self.rows = []
+        self.alerts = []
+        self.last_stored = {}
+
+
+def store_sensor_samples(cursor, sensor_id, timeline, received_at, batch):
+    """
+    Apply one data upload to the database without committing.
+    
+    Returns the per-upload result, or None if the sensor is not registered.
+    """
+    registration = device_registry.get(cursor, sensor_id)
+    
+    if registration is None:
+        return None
+        
+    timestamp = received_at.isoformat()
+    
+    # The newest sample reflects the sensor's current state
+    latest = timeline[-1][1]
+
+    # Update SensorRegistration (Sensor Master Control)
+    if registration['has_registration']:
+        try:
+            # Extract battery info
+            battery_pct = latest.get('battery_pct')
+            battery_voltage = latest.get('battery')
+            
+            update_fields = {}
+            if battery_pct is not None:
+                update_fields['last_battery_pct'] = battery_pct
+            if battery_voltage is not None:
+                update_fields['last_battery_voltage'] = battery_voltage
+                
+            # Also update temperature/relay if present
+            if 'temperature' in latest:
+                update_fields['last_temperature'] = latest['temperature']
+            if 'relay_state' in latest:
+                update_fields['last_relay_state'] = latest['relay_state']
+                
+            if update_fields:
+                update_fields['last_check_in'] = timestamp
+                update_fields['status'] = 'online'
+                
+                set_clause = ', '.join([f"{k} = ?" for k in update_fields.keys()])
+                values = list(update_fields.values()) + [sensor_id]
+                
+                cursor.execute(f'''
+                    UPDATE SensorRegistration
+                    SET {set_clause}
+                    WHERE sensor_id = ?
+                ''', values)
+        except Exception as e:
+            logger.warning(f"Failed to update SensorRegistration in receive_sensor_data: {e}")
+
+    # If not in RegisteredDevices, we are done (return success to keep firmware online)
+    device_id = registration['device_id']
+    if device_id is None:
+        return {'message': 'Data received (Sensor Master only)'}
+
+    # Proceed with Device Management logic
+    polling_interval = registration['polling_interval']
+    
+    # Update last seen status; a device that pushes its own data is not
+    # polled again until a full interval after the push
+    cursor.execute('''
+        UPDATE RegisteredDevices 
+        SET last_seen = ?, status = 'online', last_poll_success = ?, next_poll_at = ?
+        WHERE id = ?
+    ''', (timestamp, timestamp, next_poll_time(registration['configured_interval'], received_at), device_id))
+    
+    # Check if polling (storage) is enabled
+    if not registration['polling_enabled']:
+        return {'message': 'Data received (storage disabled)'}
+
+    # Rate limit per sample: keep samples at least polling_interval apart,
+    # measured on their recording times so buffered history is thinned
+    # the same way live pushes are
+    last_stored_dt = batch.last_stored.get(sensor_id, registration['last_stored'])
+    
+    to_store = []
+    for recorded_at, sample in timeline:
+        if last_stored_dt is not None:
+            elapsed = (recorded_at - last_stored_dt).total_seconds()
+            if elapsed < polling_interval:
+                logger.debug(f"Skipping storage for device {device_id}: elapsed {elapsed}s < interval {polling_interval}s")
+                continue
+        to_store.append((recorded_at, sample))
+        last_stored_dt = recorded_at
+    
+    if not to_store:
+        return {'message': 'Data received (storage skipped due to rate limit)'}
+
+    if not registration['has_links']:
+        return {'message': 'Data received (no active linked entries)'}
+        
+    # Import helper from device_api to reuse mapping logic
+    # Import inside function to avoid circular imports
+    from .device_api import extract_sensor_data_using_mappings
+    
+    record_links = registration['record_links']
+    
+    first_row, first_alert = len(batch.rows), len(batch.alerts)
+    latest_points = []
+    for recorded_at, sample in to_store:
+        # Extract mapped data points
+        latest_points = extract_sensor_data_using_mappings(
+            device_id, sample, cursor, mappings=registration['mappings'], recorded_at=recorded_at.isoformat()
+        )
+        for entry_id in record_links:
+            for sensor_point in latest_points:
+                batch.rows.append((
+                    entry_id,
+                    sensor_point['sensor_type'],
+                    sensor_point['value'],
+                    sensor_point['recorded_at']
+                ))
+    stored_points = len(batch.rows) - first_row
+    
+    # Check sensor notification rules against the newest sample only -
+    # alerting on backfilled history would fire stale notifications
+    for entry_id in record_links:
+        for sensor_point in latest_points:
+            batch.alerts.append((entry_id, sensor_point))
+
+    # Update last_data_stored timestamp; losing the conditional UPDATE means
+    # another process stored a sample within the interval, so drop ours
+    if stored_points:
+        if not device_registry.claim_stored(cursor, device_id, to_store[0][0], to_store[-1][0],
+                                            polling_interval):
+            del batch.rows[first_row:]
+            del batch.alerts[first_alert:]
+            cursor.execute('SELECT last_data_stored FROM RegisteredDevices WHERE id = ?', (device_id,))
+            row = cursor.fetchone()
+            stored_at = parse_stored_timestamp(row['last_data_stored']) if row else None
+            if stored_at is not None:
+                batch.last_stored[sensor_id] = stored_at
+            return {'message': 'Data received (storage skipped due to rate limit)'}
+        batch.last_stored[sensor_id] = to_store[-1][0]
+
+    return {
+        'message': 'Data received and processed',
+        'stored_points': stored_points,
+        'entries_updated': len(record_links) if stored_points else 0,
+        'samples_received': len(timeline),
+        'samples_stored': len(to_store) if stored_points else 0
+    }
+
+
+def flush_sensor_uploads(conn, uploads):
+    """
+    Store a group of (sensor_id, timeline, received_at) uploads in one transaction.
+    
+    Used directly by receive_sensor_data and by the write-behind ingest queue.
+    Returns (results, stored_points) with one result per upload.
+    """
+    cursor = conn.cursor()
+    batch = SensorUploadBatch()
+    results = [
+        store_sensor_samples(cursor, sensor_id, timeline, received_at, batch)
+        for sensor_id, timeline, received_at in uploads
+    ]
+    
+    if batch.rows:
+        cursor.executemany('''
+            INSERT INTO SensorData (entry_id, sensor_type, value, recorded_at)
+            VALUES (?, ?, ?, ?)
+        ''', batch.rows)
+        record_rollups(cursor, batch.rows)
+    
+    conn.commit()
+    
+    for sensor_id, recorded_at in batch.last_stored.items():
+        device_registry.note_stored(sensor_id, recorded_at)
+    
+    if batch.alerts:
+        # One rule pass over the whole flush, committed separately so a rule
+        # failure never loses the readings stored above
+        from ..api.notifications_api import check_sensor_rules_batch_with_connection
+        check_sensor_rules_batch_with_connection(cursor, [
+            (entry_id, point['sensor_type'], point['value'], point['recorded_at'])
+            for entry_id, point in batch.alerts
+        ])
+        conn.commit()
+    
+    return results, len(batch.rows)
+
+
 @sensor_master_api_bp.route('/sensor-master/data', methods=['POST'])
 def receive_sensor_data():
     """
@@ -2088,175 +2866,66 @@ def receive_sensor_data():
         "timestamp": 1234567890,
         "mode": "online"
     }
+    
+    Batch payload (buffered samples uploaded together):
+    {
+        "sensor_id": "esp32_unique_id",
+        "samples": [
+            {"timestamp": 1700000000, "temperature": 25.1},
+            {"age_ms": 60000, "temperature": 25.3}
+        ]
+    }
+    
+    While the ingest queue is running the upload is acknowledged once it is
+    validated and queued ("queued": true); storage happens in the background.
     """
     try:
-        data = request.get_json()
+        data = get_sensor_payload()
         
         if not data or 'sensor_id' not in data:
             return jsonify({'error': 'sensor_id is required'}), 400
         
         sensor_id = data['sensor_id']
+        received_at = datetime.now(timezone.utc)
+        timeline = expand_samples(data, received_at)
         
-        conn = get_db()
-        cursor = conn.cursor()
-        
-        # Check if sensor is registered in Device Management (RegisteredDevices)
-        cursor.execute('SELECT id, device_name, polling_interval, last_data_stored, polling_enabled FROM RegisteredDevices WHERE device_id = ?', (sensor_id,))
-        device = cursor.fetchone()
+        if not timeline:
+            return jsonify({'error': 'No samples in payload'}), 400
         
-        # Check if sensor is registered in Sensor Master Control (SensorRegistration)
-        cursor.execute('SELECT id FROM SensorRegistration WHERE sensor_id = ?', (sensor_id,))
-        sensor_reg = cursor.fetchone()
+        conn = get_db()
         
-        if not device and not sensor_reg:
+        from ..sensor_ingest_queue import ingest_queue
+        if ingest_queue.running:
+            if not is_known_sensor(conn.cursor(), sensor_id):
+                return jsonify({'error': 'Sensor not registered'}), 404
+            # A full queue falls through to a synchronous write, which
+            # slows the sender down instead of dropping its samples
+            if ingest_queue.submit(sensor_id, timeline, received_at):
+                return jsonify({
+                    'message': 'Data received',
+                    'queued': True,
+                    'samples_received': len(timeline)
+                }), 200
+        
+        results, _ = flush_sensor_uploads(conn, [(sensor_id, timeline, received_at)])
+        
+        if results[0] is None:
             return jsonify({'error': 'Sensor not registered'}), 404
-            
-        timestamp = datetime.now(timezone.utc).isoformat()
-
-        # Update SensorRegistration (Sensor Master Control)
-        if sensor_reg:
-            try:
-                # Extract battery info
-                battery_pct = data.get('battery_pct')
-                battery_voltage = data.get('battery')
-                
-                update_fields = {}
-                if battery_pct is not None:
-                    update_fields['last_battery_pct'] = battery_pct
-                if battery_voltage is not None:
-                    update_fields['last_battery_voltage'] = battery_voltage
-                    
-                # Also update temperature/relay if present
-                if 'temperature' in data:
-                    update_fields['last_temperature'] = data['temperature']
-                if 'relay_state' in data:
-                    update_fields['last_relay_state'] = data['relay_state']
-                    
-                if update_fields:
-                    update_fields['last_check_in'] = timestamp
-                    update_fields['status'] = 'online'
-                    
-                    set_clause = ', '.join([f"{k} = ?" for k in update_fields.keys()])
-                    values = list(update_fields.values()) + [sensor_id]
-                    
-                    cursor.execute(f'''
-                        UPDATE SensorRegistration
-                        SET {set_clause}
-                        WHERE sensor_id = ?
-                    ''', values)
-            except Exception as e:
-                logger.warning(f"Failed to update SensorRegistration in receive_sensor_data: {e}")
-
-        # If not in RegisteredDevices, we are done (return success to keep firmware online)
-        if not device:
-            conn.commit()
-            return jsonify({'message': 'Data received (Sensor Master only)'}), 200
-
-        # Proceed with Device Management logic
-        device_id = device['id']
-        polling_interval = device['polling_interval'] or 30
-        last_data_stored = device['last_data_stored']
-        polling_enabled = device['polling_enabled']
-        
-        # Update last seen status
-        cursor.execute('''
-            UPDATE RegisteredDevices 
-            SET last_seen = ?, status = 'online', last_poll_success = ?
-            WHERE id = ?
-        ''', (timestamp, timestamp, device_id))
-        
-        # Check if polling (storage) is enabled
-        if not polling_enabled:
-             conn.commit()
-             return jsonify({'message': 'Data received (storage disabled)'}), 200
-
-        # Check rate limiting for data storage
-        should_store = True
-        if last_data_stored:
-            try:
-                last_stored_dt = datetime.fromisoformat(last_data_stored.replace('Z', '+00:00'))
-                now_dt = datetime.now(timezone.utc)
-                elapsed = (now_dt - last_stored_dt).total_seconds()
-                
-                if elapsed < polling_interval:
-                    should_store = False
-                    logger.debug(f"Skipping storage for device {device_id}: elapsed {elapsed}s < interval {polling_interval}s")
-            except Exception as e:
-                logger.warning(f"Error parsing last_data_stored: {e}")
-        
-        if not should_store:
-            conn.commit()
-            return jsonify({'message': 'Data received (storage skipped due to rate limit)'}), 200
-
-        # Get linked entries that are active
-        cursor.execute('''
-            SELECT del.entry_id, del.auto_record 
-            FROM DeviceEntryLinks del
-            JOIN Entry e ON del.entry_id = e.id
-            WHERE del.device_id = ? AND e.status != 'inactive'
-        ''', (device_id,))
-        
-        links = cursor.fetchall()
-        
-        if not links:
-            conn.commit()
-            return jsonify({'message': 'Data received (no active linked entries)'}), 200
-            
-        # Import helper from device_api to reuse mapping logic
-        # Import inside function to avoid circular imports
-        from .device_api import extract_sensor_data_using_mappings
-        
-        # Extract mapped data points
-        sensor_data_points = extract_sensor_data_using_mappings(device_id, data, cursor)
-        
-        stored_count = 0
-        entries_updated = 0
-        
-        for link in links:
-            entry_id = link['entry_id']
-            auto_record = link['auto_record']
-            
-            if not auto_record:
-                continue
-                
-            entries_updated += 1
-            for sensor_point in sensor_data_points:
-                cursor.execute('''
-                    INSERT INTO SensorData (entry_id, sensor_type, value, recorded_at)
-                    VALUES (?, ?, ?, ?)
-                ''', (
-                    entry_id,
-                    sensor_point['sensor_type'],
-                    sensor_point['value'],
-                    sensor_point['recorded_at']
-                ))
-                stored_count += 1
-                
-                # Check sensor notification rules
-                try:
-                    from ..api.notifications_api import check_sensor_rules
-                    check_sensor_rules(entry_id, sensor_point['sensor_type'], 
-                                     sensor_point['value'], sensor_point['recorded_at'])
-                except Exception as e:
-                    logger.warning(f"Error checking sensor rules for entry {entry_id}: {e}")
-
-        # Update last_data_stored timestamp
-        if stored_count > 0:
-            cursor.execute('UPDATE RegisteredDevices SET last_data_stored = ? WHERE id = ?', (timestamp, device_id))
-
-        conn.commit()
         
-        return jsonify({
-            'message': 'Data received and processed',
-            'stored_points': stored_count,
-            'entries_updated': entries_updated
-        }), 200
+        return jsonify(results[0]), 200
         
     except Exception as e:
         logger.error(f"Error receiving sensor data: {e}", exc_info=True)
         return jsonify({'error': 'Failed to process sensor data'}), 500
 
 
+@sensor_master_api_bp.route('/sensor-master/ingest/stats', methods=['GET'])
+def get_ingest_stats():
+    """Queue depth and flush latency of the sensor data write-behind queue"""
+    from ..sensor_ingest_queue import ingest_queue
+    return jsonify(ingest_queue.stats()), 200
+
+
 @sensor_master_api_bp.route('/sensor-master/scan', methods=['GET'])
 def scan_network_devices():
     """Scan for devices on the network"""
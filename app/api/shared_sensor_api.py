@@ -9,6 +9,8 @@ import logging
 from datetime import datetime, timezone
 from ..services.shared_sensor_service import SharedSensorDataService
 from ..db import get_connection
+from ..services.sensor_rollup_service import rebuild_rollups_for, entries_for_shared_reading
+from ..services.sensor_range_index import sensor_range_index
 
 # Define a Blueprint for Shared Sensor Data API
 shared_sensor_api_bp = Blueprint('shared_sensor_api', __name__)
@@ -471,6 +473,8 @@ def update_sensor_data(sensor_id):
         
         query = f"UPDATE SharedSensorData SET {', '.join(update_fields)} WHERE id = ?"
         cursor.execute(query, params)
+        if 'value' in data or 'recorded_at' in data:
+            rebuild_rollups_for(cursor, entries_for_shared_reading(cursor, sensor_id))
         conn.commit()
         
         return jsonify({'message': 'Sensor reading updated successfully', 'id': sensor_id})
@@ -494,8 +498,12 @@ def delete_sensor_data(sensor_id):
             return jsonify({'error': 'Sensor reading not found'}), 404
         
         # Delete sensor data (links will cascade delete)
+        affected = entries_for_shared_reading(cursor, sensor_id)
         cursor.execute('DELETE FROM SharedSensorData WHERE id = ?', (sensor_id,))
+        rebuild_rollups_for(cursor, affected)
         conn.commit()
+        # Ranges starting or ending at this reading were cascade deleted
+        sensor_range_index.invalidate()
         
         return jsonify({'message': 'Sensor reading deleted successfully'})
         
@@ -0,0 +1,103 @@
+# template_app/app/cache_versions.py
+"""
+Shared Cache Versions
+=====================
+
+The web workers and the background worker each keep their own in-memory
+caches (dashboard widget results, saved searches, the device registry,
+compiled notification rules). What invalidates them is kept in the
+CacheVersion table instead, so a write handled by one process is seen by
+all of them.
+
+Writers call bump(cursor, name, ...) in the transaction that changes the
+data, or bump_now() once it has committed. Readers call get(name): the
+table is read at most once per request (every VERSION_REFRESH_SECONDS
+outside a request, e.g. in the ingest and job threads), and a cache entry
+filled at an older version is treated as stale.
+"""
+
+import logging
+import threading
+import time
+
+logger = logging.getLogger(__name__)
+
+VERSION_REFRESH_SECONDS = 1.0
+
+
+class CacheVersions:
+    """Counters per cache name, stored in the database"""
+
+    def __init__(self, refresh_seconds=VERSION_REFRESH_SECONDS):
+        self.refresh_seconds = refresh_seconds
+        self._lock = threading.Lock()
+        self._snapshot = {}
+        self._read_at = None
+
+    def get(self, name):
+        return self.current().get(name, 0)
+
+    def current(self):
+        """All versions, read once per request or refresh interval"""
+        from flask import g, has_request_context
+
+        if has_request_context():
+            if '_cache_versions' not in g:
+                g._cache_versions = self._read()
+            return g._cache_versions
+
+        now = time.monotonic()
+        with self._lock:
+            if self._read_at is not None and now - self._read_at < self.refresh_seconds:
+                return self._snapshot
+        snapshot = self._read()
+        with self._lock:
+            self._snapshot = snapshot
+            self._read_at = now
+        return snapshot
+
+    def bump(self, cursor, *names):
+        """Advance versions in the caller's transaction"""
+        names = sorted(set(names))  # Same lock order in every writer
+        if not names:
+            return
+        cursor.execute(f'''
+            INSERT INTO CacheVersion (name, version) VALUES {', '.join(['(?, 1)'] * len(names))}
+            ON DUPLICATE KEY UPDATE version = version + 1
+        ''', names)
+        self._forget()
+
+    def bump_now(self, *names):
+        """Advance versions in a transaction of their own (the write has already committed)"""
+        from .db import get_dedicated_connection
+
+        conn = get_dedicated_connection()
+        try:
+            self.bump(conn.cursor(), *names)
+            conn.commit()
+        finally:
+            conn.close()
+
+    def _forget(self):
+        """Make this process read its own bump on the next get()"""
+        from flask import g, has_request_context
+
+        if has_request_context():
+            g.pop('_cache_versions', None)
+        with self._lock:
+            self._read_at = None
+
+    @staticmethod
+    def _read():
+        from .db import get_connection
+
+        conn = get_connection()
+        try:
+            cursor = conn.cursor()
+            cursor.execute('SELECT name, version FROM CacheVersion')
+            return {row['name']: row['version'] for row in cursor.fetchall()}
+        finally:
+            conn.close()
+
+
+cache_versions = CacheVersions()
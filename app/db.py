@@ -2,12 +2,16 @@
 import pymysql
 import re
 from urllib.parse import urlparse
-from flask import current_app, g
+from flask import current_app, g, has_request_context
 import os
 import json
 import logging
+import threading
+import time
 from datetime import datetime
 
+from .metrics import record_query
+
 # Get the logger for this module
 logger = logging.getLogger(__name__)
 
@@ -45,10 +49,14 @@ class _MySQLCursorWrapper:
         sql = sql.replace('?', '%s')
         sql = re.sub(r'\bINSERT\s+OR\s+REPLACE\s+INTO\b', 'REPLACE INTO', sql, flags=re.IGNORECASE)
         sql = re.sub(r'\bINSERT\s+OR\s+IGNORE\s+INTO\b', 'INSERT IGNORE INTO', sql, flags=re.IGNORECASE)
-        if params is not None:
-            self._c.execute(sql, params)
-        else:
-            self._c.execute(sql)
+        started = time.perf_counter()
+        try:
+            if params is not None:
+                self._c.execute(sql, params)
+            else:
+                self._c.execute(sql)
+        finally:
+            record_query(time.perf_counter() - started)
 
     def executemany(self, sql, params):
         if params is not None:
@@ -56,7 +64,11 @@ class _MySQLCursorWrapper:
         sql = sql.replace('?', '%s')
         sql = re.sub(r'\bINSERT\s+OR\s+REPLACE\s+INTO\b', 'REPLACE INTO', sql, flags=re.IGNORECASE)
         sql = re.sub(r'\bINSERT\s+OR\s+IGNORE\s+INTO\b', 'INSERT IGNORE INTO', sql, flags=re.IGNORECASE)
-        self._c.executemany(sql, params)
+        started = time.perf_counter()
+        try:
+            self._c.executemany(sql, params)
+        finally:
+            record_query(time.perf_counter() - started)
 
     def fetchone(self):
         return self._c.fetchone()
@@ -93,12 +105,16 @@ class _MySQLConnWrapper:
     """Wraps a PyMySQL connection to be interface-compatible with pymysql.Connection."""
     db_type = 'mysql'
 
-    def __init__(self, conn):
+    def __init__(self, conn, pool=None, created_at=None):
         self._conn = conn
+        self._pool = pool
+        self._created_at = created_at
 
-    def cursor(self):
+    def cursor(self, unbuffered=False):
         import pymysql.cursors
-        return _MySQLCursorWrapper(self._conn.cursor(pymysql.cursors.DictCursor))
+        # Unbuffered cursors stream rows from the server; read them all before the next query
+        cursor_class = pymysql.cursors.SSDictCursor if unbuffered else pymysql.cursors.DictCursor
+        return _MySQLCursorWrapper(self._conn.cursor(cursor_class))
 
     def commit(self):
         self._conn.commit()
@@ -107,7 +123,14 @@ class _MySQLConnWrapper:
         self._conn.rollback()
 
     def close(self):
-        self._conn.close()
+        # Pooled connections go back to the pool instead of being closed
+        conn, self._conn = self._conn, None
+        if conn is None:
+            return
+        if self._pool is not None:
+            self._pool.release(conn, self._created_at)
+        else:
+            conn.close()
 
     def __enter__(self):
         return self
@@ -120,6 +143,152 @@ class _MySQLConnWrapper:
         return False
 
 
+class _BorrowedConnection(_MySQLConnWrapper):
+    """The request's shared connection, handed out by get_connection() inside a request.
+
+    close() is a no-op so helpers that open and close their own connection
+    don't end the request's; it is released when the app context tears down.
+    """
+
+    def __init__(self, owner):
+        super().__init__(owner._conn)
+
+    def close(self):
+        pass
+
+
+# ---------------------------------------------------------------------------
+# Connection pool
+# ---------------------------------------------------------------------------
+
+# Idle connections older than this are checked with a ping before reuse
+_POOL_PING_AFTER_SECONDS = 30
+
+
+class _ConnectionPool:
+    """Per-process pool of idle PyMySQL connections.
+
+    Checkout never blocks: when no idle connection is available a new one is
+    opened, and connections returned to a full pool are closed. Connections
+    are rolled back on return so the next user starts a fresh transaction.
+    """
+
+    def __init__(self, connect, max_idle=10, recycle_seconds=1800):
+        self._connect = connect
+        self.max_idle = max_idle
+        self.recycle_seconds = recycle_seconds
+        self._idle = []  # (conn, created_at, returned_at), most recent last
+        self._lock = threading.Lock()
+        self._pid = os.getpid()
+        self._stats = {'created': 0, 'reused': 0, 'checked_out': 0, 'discarded': 0}
+
+    def acquire(self):
+        now = time.monotonic()
+        while True:
+            with self._lock:
+                self._check_fork()
+                if not self._idle:
+                    break
+                conn, created_at, returned_at = self._idle.pop()
+            if now - created_at >= self.recycle_seconds:
+                self._discard(conn)
+                continue
+            if now - returned_at >= _POOL_PING_AFTER_SECONDS:
+                try:
+                    conn.ping(reconnect=False)
+                except Exception:
+                    self._discard(conn)
+                    continue
+            with self._lock:
+                self._stats['reused'] += 1
+                self._stats['checked_out'] += 1
+            return conn, created_at
+
+        conn = self._connect()
+        with self._lock:
+            self._stats['created'] += 1
+            self._stats['checked_out'] += 1
+        return conn, now
+
+    def release(self, conn, created_at):
+        with self._lock:
+            self._stats['checked_out'] -= 1
+        try:
+            conn.rollback()
+        except Exception:
+            self._discard(conn)
+            return
+        now = time.monotonic()
+        with self._lock:
+            self._check_fork()
+            if len(self._idle) < self.max_idle and now - created_at < self.recycle_seconds:
+                self._idle.append((conn, created_at, now))
+                return
+        self._discard(conn)
+
+    def _discard(self, conn):
+        with self._lock:
+            self._stats['discarded'] += 1
+        try:
+            conn.close()
+        except Exception:
+            pass
+
+    def _check_fork(self):
+        # A forked worker must not share its parent's sockets; drop them unclosed
+        if self._pid != os.getpid():
+            self._pid = os.getpid()
+            self._idle = []
+
+    def stats(self):
+        with self._lock:
+            snapshot = dict(self._stats)
+            snapshot['idle'] = len(self._idle)
+        snapshot['max_idle'] = self.max_idle
+        return snapshot
+
+
+_pools = {}
+_pools_lock = threading.Lock()
+
+
+def _get_pool(db_url):
+    with _pools_lock:
+        pool = _pools.get(db_url)
+        if pool is None:
+            parsed = urlparse(db_url)
+
+            def connect():
+                import pymysql
+                conn = pymysql.connect(
+                    host=parsed.hostname,
+                    port=parsed.port or 3306,
+                    user=parsed.username,
+                    password=parsed.password,
+                    database=parsed.path.lstrip('/'),
+                    charset='utf8mb4',
+                    autocommit=False,
+                    connect_timeout=10,
+                )
+                logger.debug(f"Connected to MariaDB: {parsed.hostname}/{parsed.path.lstrip('/')}")
+                return conn
+
+            pool = _ConnectionPool(
+                connect,
+                max_idle=current_app.config.get('DB_POOL_SIZE', 10),
+                recycle_seconds=current_app.config.get('DB_POOL_RECYCLE', 1800),
+            )
+            _pools[db_url] = pool
+        return pool
+
+
+def get_pool_stats():
+    """Stats for every connection pool in this process (for health/metrics)"""
+    with _pools_lock:
+        pools = list(_pools.items())
+    return {urlparse(url).hostname or 'default': pool.stats() for url, pool in pools}
+
+
 # ---------------------------------------------------------------------------
 # Helpers
 # ---------------------------------------------------------------------------
@@ -149,27 +318,42 @@ def _get_columns(cursor, table_name):
 
 
 def get_connection():
+    """
+    Connection to the configured database.
+
+    Inside a request every call shares one pooled connection (see
+    _BorrowedConnection); elsewhere each call checks out its own, which
+    close() returns to the pool.
+    """
     db_type = get_db_type()
     if db_type == 'mysql':
-        import pymysql
-        db_url = current_app.config.get('DATABASE_URL', '')
-        parsed = urlparse(db_url)
-        try:
-            conn = pymysql.connect(
-                host=parsed.hostname,
-                port=parsed.port or 3306,
-                user=parsed.username,
-                password=parsed.password,
-                database=parsed.path.lstrip('/'),
-                charset='utf8mb4',
-                autocommit=False,
-                connect_timeout=10,
-            )
-            logger.debug(f"Connected to MariaDB: {parsed.hostname}/{parsed.path.lstrip('/')}")
-            return _MySQLConnWrapper(conn)
-        except Exception as e:
-            logger.error(f"Error connecting to MariaDB: {e}")
-            raise
+        if has_request_context():
+            if '_pooled_db' not in g:
+                g._pooled_db = _checkout()
+            return _BorrowedConnection(g._pooled_db)
+        return _checkout()
+
+
+def _checkout():
+    pool = _get_pool(current_app.config.get('DATABASE_URL', ''))
+    try:
+        conn, created_at = pool.acquire()
+    except Exception as e:
+        logger.error(f"Error connecting to MariaDB: {e}")
+        raise
+    return _MySQLConnWrapper(conn, pool, created_at)
+
+
+def get_dedicated_connection():
+    """Pooled connection of its own, even inside a request (long transactions such as backups)"""
+    return _checkout()
+
+
+def release_request_connection():
+    """Return the request's shared connection to the pool (app context teardown)"""
+    conn = g.pop('_pooled_db', None)
+    if conn is not None:
+        conn.close()
 
 def init_db():
     # This function is now called from run.py (or create_app in __init__.py for testing)
@@ -685,21 +869,124 @@ def init_db():
         except Exception as e:
             pass
         
-        # Create indexes for performance
-        try:
-            cursor.execute('CREATE INDEX IF NOT EXISTS idx_shared_sensor_data_type_time ON SharedSensorData(sensor_type, recorded_at)')
-            cursor.execute('CREATE INDEX IF NOT EXISTS idx_sensor_entry_links_entry ON SensorDataEntryLinks(entry_id)')
-            cursor.execute('CREATE INDEX IF NOT EXISTS idx_sensor_entry_links_sensor ON SensorDataEntryLinks(shared_sensor_data_id)')
+        # Create indexes for performance. Each one on its own: TEXT columns need a key
+        # length in MariaDB, and one failure must not skip the rest.
+        for index_sql in [
+            'CREATE INDEX IF NOT EXISTS idx_shared_sensor_data_type_time ON SharedSensorData(sensor_type(64), recorded_at(32))',
+            'CREATE INDEX IF NOT EXISTS idx_sensor_entry_links_entry ON SensorDataEntryLinks(entry_id)',
+            'CREATE INDEX IF NOT EXISTS idx_sensor_entry_links_sensor ON SensorDataEntryLinks(shared_sensor_data_id)',
             # Range-based indexes
-            cursor.execute('CREATE INDEX IF NOT EXISTS idx_sensor_ranges_entry ON SensorDataEntryRanges(entry_id)')
-            cursor.execute('CREATE INDEX IF NOT EXISTS idx_sensor_ranges_type ON SensorDataEntryRanges(sensor_type)')
-            cursor.execute('CREATE INDEX IF NOT EXISTS idx_sensor_ranges_start ON SensorDataEntryRanges(start_sensor_id)')
-            cursor.execute('CREATE INDEX IF NOT EXISTS idx_sensor_ranges_end ON SensorDataEntryRanges(end_sensor_id)')
-            cursor.execute('CREATE INDEX IF NOT EXISTS idx_sensor_ranges_entry_type ON SensorDataEntryRanges(entry_id, sensor_type)')
+            'CREATE INDEX IF NOT EXISTS idx_sensor_ranges_entry ON SensorDataEntryRanges(entry_id)',
+            'CREATE INDEX IF NOT EXISTS idx_sensor_ranges_type ON SensorDataEntryRanges(sensor_type(64))',
+            'CREATE INDEX IF NOT EXISTS idx_sensor_ranges_start ON SensorDataEntryRanges(start_sensor_id)',
+            'CREATE INDEX IF NOT EXISTS idx_sensor_ranges_end ON SensorDataEntryRanges(end_sensor_id)',
+            'CREATE INDEX IF NOT EXISTS idx_sensor_ranges_entry_type ON SensorDataEntryRanges(entry_id, sensor_type(64))',
+            # Composite span indexes for range membership and coalescing lookups
+            'CREATE INDEX IF NOT EXISTS idx_sensor_ranges_type_span ON SensorDataEntryRanges(sensor_type(64), start_sensor_id, end_sensor_id)',
+            'CREATE INDEX IF NOT EXISTS idx_sensor_ranges_entry_type_span ON SensorDataEntryRanges(entry_id, sensor_type(64), end_sensor_id)',
+        ]:
+            try:
+                cursor.execute(index_sql)
+            except Exception as e:
+                # Indexes might already exist, ignore errors
+                pass
+
+        # Create SensorDataRollup Table (min/max/sum/count per minute, hour and day for trend charts)
+        cursor.execute('''
+            CREATE TABLE IF NOT EXISTS SensorDataRollup (
+                entry_id INTEGER NOT NULL,
+                sensor_type VARCHAR(255) NOT NULL,
+                resolution INTEGER NOT NULL, -- bucket width in seconds
+                bucket_start DATETIME NOT NULL,
+                value_min DOUBLE NOT NULL,
+                value_max DOUBLE NOT NULL,
+                value_sum DOUBLE NOT NULL,
+                value_count INTEGER NOT NULL,
+                PRIMARY KEY (entry_id, sensor_type, resolution, bucket_start),
+                FOREIGN KEY (entry_id) REFERENCES Entry(id) ON DELETE CASCADE
+            );
+        ''')
+        try:
+            # Retention prunes expired tiers by resolution and age
+            cursor.execute('CREATE INDEX IF NOT EXISTS idx_sensor_rollup_resolution_bucket ON SensorDataRollup(resolution, bucket_start)')
+        except Exception:
+            pass
+
+        # Create SensorRetentionHorizon Table (raw readings of a type older than raw_before were pruned)
+        cursor.execute('''
+            CREATE TABLE IF NOT EXISTS SensorRetentionHorizon (
+                sensor_type VARCHAR(255) PRIMARY KEY,
+                raw_before DATETIME NOT NULL,
+                updated_at TEXT DEFAULT CURRENT_TIMESTAMP
+            );
+        ''')
+
+        # Backfill rollups once for sensor data stored before the table existed
+        try:
+            cursor.execute('SELECT 1 FROM SensorDataRollup LIMIT 1')
+            if not cursor.fetchone():
+                cursor.execute('''
+                    SELECT (SELECT COUNT(*) FROM SensorData) + (SELECT COUNT(*) FROM SharedSensorData) AS readings
+                ''')
+                if cursor.fetchone()['readings']:
+                    from .services.sensor_rollup_service import rebuild_rollups
+                    rebuild_rollups(cursor)
+                    logger.info("Backfilled SensorDataRollup from existing sensor data")
         except Exception as e:
-            # Indexes might already exist, ignore errors
+            logger.warning(f"Could not backfill sensor data rollups: {e}")
+            try:
+                # Leave the table empty so the next start tries again
+                cursor.execute('DELETE FROM SensorDataRollup')
+            except Exception:
+                pass
+
+        # Create BackgroundJob Table (slow external calls run by the background worker, see job_queue.py)
+        cursor.execute('''
+            CREATE TABLE IF NOT EXISTS BackgroundJob (
+                id INTEGER PRIMARY KEY AUTOINCREMENT,
+                kind VARCHAR(64) NOT NULL,
+                status VARCHAR(16) NOT NULL DEFAULT 'queued', -- 'queued', 'running', 'done', 'failed'
+                payload LONGTEXT, -- JSON handler arguments
+                result LONGTEXT, -- JSON handler return value
+                error TEXT,
+                worker VARCHAR(255), -- claim token (host:pid:nonce)
+                created_at DATETIME DEFAULT CURRENT_TIMESTAMP,
+                started_at DATETIME,
+                finished_at DATETIME
+            );
+        ''')
+        try:
+            # Workers claim the oldest queued job
+            cursor.execute('CREATE INDEX IF NOT EXISTS idx_background_job_status ON BackgroundJob(status, id)')
+            cursor.execute('CREATE INDEX IF NOT EXISTS idx_background_job_worker ON BackgroundJob(worker)')
+        except Exception:
             pass
 
+        # Create CacheVersion Table (invalidation counters shared by all processes, see cache_versions.py)
+        cursor.execute('''
+            CREATE TABLE IF NOT EXISTS CacheVersion (
+                name VARCHAR(191) PRIMARY KEY, -- 'entries', 'sensor:<type>', 'device_registry', ...
+                version BIGINT NOT NULL DEFAULT 0
+            );
+        ''')
+
+        # Create WorkerStatus Table (the background worker's reports for /api/health, see worker_status.py)
+        cursor.execute('''
+            CREATE TABLE IF NOT EXISTS WorkerStatus (
+                name VARCHAR(64) PRIMARY KEY,
+                report LONGTEXT NOT NULL,
+                updated_at DATETIME NOT NULL
+            );
+        ''')
+
+        # Create EntryChange Table (entry ids published to the saved-search caches, see saved_search_cache.py)
+        cursor.execute('''
+            CREATE TABLE IF NOT EXISTS EntryChange (
+                seq BIGINT AUTO_INCREMENT PRIMARY KEY,
+                entry_id INTEGER NOT NULL
+            );
+        ''')
+
         # Create Notification Table
         cursor.execute('''
             CREATE TABLE IF NOT EXISTS Notification (
@@ -779,6 +1066,16 @@ def init_db():
                 cursor.execute('ALTER TABLE RegisteredDevices ADD COLUMN last_poll_error TEXT')
         except Exception:
             pass  # Column already exists
+        try:
+            if 'next_poll_at' not in rd_cols:
+                # UTC; NULL means due now. Lets the poller select only due devices
+                cursor.execute('ALTER TABLE RegisteredDevices ADD COLUMN next_poll_at DATETIME')
+        except Exception:
+            pass  # Column already exists
+        try:
+            cursor.execute('CREATE INDEX IF NOT EXISTS idx_registered_devices_next_poll ON RegisteredDevices(polling_enabled, next_poll_at)')
+        except Exception:
+            pass  # Index already exists
         
         # Create DeviceEntryLinks table
         cursor.execute('''
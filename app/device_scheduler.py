@@ -5,23 +5,90 @@ import time
 import requests
 import pymysql
 import logging
+from concurrent.futures import ThreadPoolExecutor
 from datetime import datetime, timedelta, timezone
 from .db import get_connection
+from .job_queue import job_queue
+from .metrics import metrics
+from .services.device_registry import device_registry
+from .services.sensor_rollup_service import record_rollups
 
 logger = logging.getLogger(__name__)
 
+# Devices that keep failing are retried after BACKOFF_BASE_SECONDS * 2^(failures-1),
+# capped at MAX_BACKOFF_SECONDS, so dead IPs stop costing a timeout every cycle
+BACKOFF_BASE_SECONDS = 30
+MAX_BACKOFF_SECONDS = 900
+
+# Polling interval for devices without one configured
+DEFAULT_DEVICE_POLL_INTERVAL = 300
+
+# Devices (links) that must be polled: enabled, not disabled, linked to an active entry
+_POLLABLE_DEVICES_SQL = '''
+    FROM RegisteredDevices rd
+    WHERE rd.polling_enabled = 1
+    AND rd.status != 'disabled'
+    AND EXISTS (
+        SELECT 1 FROM DeviceEntryLinks del
+        INNER JOIN Entry e ON del.entry_id = e.id
+        WHERE del.device_id = rd.id AND e.status != 'inactive'
+    )
+'''
+
+
+def _db_time(dt):
+    """UTC 'YYYY-MM-DD HH:MM:SS' for next_poll_at"""
+    return dt.astimezone(timezone.utc).strftime('%Y-%m-%d %H:%M:%S')
+
+
+def next_poll_time(polling_interval, now=None):
+    """next_poll_at for a device that just reported (polled or pushed its own data)"""
+    now = now or datetime.now(timezone.utc)
+    return _db_time(now + timedelta(seconds=polling_interval or DEFAULT_DEVICE_POLL_INTERVAL))
+
+
+def _as_utc(value):
+    """next_poll_at as an aware datetime (drivers may return str or naive datetime)"""
+    if isinstance(value, str):
+        value = datetime.fromisoformat(value.replace('Z', '+00:00'))
+    if value.tzinfo is None:
+        value = value.replace(tzinfo=timezone.utc)
+    return value
+
+
+class PollBatch:
+    """Writes collected during one polling cycle, applied in a single transaction"""
+    
+    def __init__(self):
+        self.rows = []          # SensorData (entry_id, sensor_type, value, recorded_at)
+        self.successes = []     # (last_seen, last_poll_success, next_poll_at, device_id)
+        self.failures = []      # (last_poll_error, next_poll_at, device_id)
+        self.stored = []        # (sensor_id, device_id, stored_at) for devices that stored data
+    
+    def add_point(self, entry_id, sensor_type, value, timestamp):
+        self.rows.append((entry_id, sensor_type, value, timestamp))
+
+
 class DevicePollingScheduler:
     """Background scheduler for polling ESP32 devices"""
     
     def __init__(self):
         self.running = False
         self.thread = None
-        self.poll_interval = 30  # Check every 30 seconds for devices to poll
+        self.poll_interval = 30  # Shortest wait between cycles
+        self.max_idle = 300  # Longest sleep when nothing is due (wake() cuts it short)
+        self.max_workers = 8  # Devices fetched in parallel
+        self.request_timeout = 10
         self.app = None  # Will store the Flask app instance
+        self.failures = {}  # device id -> consecutive connection failures
+        self.last_cycle = {}
+        self._session = None
+        self._wake = threading.Event()
         
     def init_app(self, app):
         """Initialize with Flask app instance"""
         self.app = app
+        self.max_workers = app.config.get('DEVICE_POLL_WORKERS', self.max_workers)
         
     def start(self):
         """Start the polling scheduler"""
@@ -36,135 +103,204 @@ class DevicePollingScheduler:
     def stop(self):
         """Stop the polling scheduler"""
         self.running = False
+        self._wake.set()
         if self.thread:
             self.thread.join()
         logger.info("Device polling scheduler stopped")
+    
+    def wake(self):
+        """Re-check due devices now (a device was added, enabled or re-linked)"""
+        if not self.running and self.app is not None and self.app.config.get('APP_ROLE') == 'web':
+            # The polling loop runs in the background worker process
+            try:
+                job_queue.enqueue('device_poll_wake')
+            except Exception as e:
+                logger.warning(f"Could not wake the background device scheduler: {e}")
+            return
+        self._wake.set()
         
     def _polling_loop(self):
         """Main polling loop"""
         while self.running:
+            next_due = None
+            failed = False
             try:
                 if self.app:
-                    with self.app.app_context():
-                        self._poll_devices()
+                    with self.app.app_context(), metrics.timed('device_poll'):
+                        next_due = self._poll_devices()
                 else:
                     logger.error("No app context available for device polling")
             except Exception as e:
                 logger.error(f"Error in polling loop: {e}", exc_info=True)
+                failed = True
             
-            # Sleep for the poll interval
-            time.sleep(self.poll_interval)
+            # Sleep until the earliest device is due, within [poll_interval, max_idle];
+            # max_idle only when nothing is scheduled, a failed cycle retries soon
+            delay = self.max_idle
+            if failed:
+                delay = self.poll_interval
+            elif next_due is not None:
+                delay = (next_due - datetime.now(timezone.utc)).total_seconds()
+                delay = min(max(delay, self.poll_interval), self.max_idle)
+            self._wake.wait(delay)
+            self._wake.clear()
     
     def _poll_devices(self):
-        """Poll all enabled devices that are due for polling"""
+        """
+        Poll all enabled devices that are due; returns when the next one is
+        due (None if none is scheduled). Errors propagate to the polling
+        loop, which retries after poll_interval.
+        """
+        cycle_started = time.monotonic()
+        conn = get_connection()
         try:
-            conn = get_connection()
             cursor = conn.cursor()
             
-            # Get devices that need polling
-            now = datetime.now()
-            
-            # Find devices that:
-            # 1. Have polling enabled
-            # 2. Are linked to at least one ACTIVE entry (via DeviceEntryLinks table)
-            # 3. Are not disabled
-            # 4. Haven't been polled recently (based on their polling_interval)
-            cursor.execute('''
-                SELECT DISTINCT rd.* 
-                FROM RegisteredDevices rd
-                INNER JOIN DeviceEntryLinks del ON rd.id = del.device_id
-                INNER JOIN Entry e ON del.entry_id = e.id
-                WHERE rd.polling_enabled = 1 
-                AND rd.status != 'disabled'
-                AND e.status != 'inactive'
-            ''')
-            
-            all_devices = cursor.fetchall()
-            # Filter in Python: include devices never polled, or past their polling interval
+            # next_poll_at is set after every poll, so only due devices come back
             now = datetime.now(timezone.utc)
-            devices_to_poll = []
-            for device in all_devices:
-                last_poll = device['last_poll_success']
-                if last_poll is None:
-                    devices_to_poll.append(device)
-                else:
-                    if isinstance(last_poll, str):
-                        last_poll = datetime.fromisoformat(last_poll.replace('Z', '+00:00'))
-                    if last_poll.tzinfo is None:
-                        last_poll = last_poll.replace(tzinfo=timezone.utc)
-                    interval = device.get('polling_interval') or 300
-                    if (now - last_poll).total_seconds() >= interval:
-                        devices_to_poll.append(device)
-            devices_to_poll = list({d['id']: d for d in devices_to_poll}.values())
+            cursor.execute(f'''
+                SELECT rd.*
+                {_POLLABLE_DEVICES_SQL}
+                AND (rd.next_poll_at IS NULL OR rd.next_poll_at <= ?)
+            ''', (_db_time(now),))
+            devices_to_poll = cursor.fetchall()
             logger.debug(f"Found {len(devices_to_poll)} devices due for polling")
             
-            for device in devices_to_poll:
+            batch = PollBatch()
+            for device, device_data, error in self._fetch_devices(devices_to_poll):
+                retry_at = next_poll_time(device.get('polling_interval'))
+                
+                if isinstance(error, ValueError):
+                    # Reachable but sent something other than JSON - no backoff
+                    logger.error(f"Invalid data from device {device['device_name']}: {error}")
+                    batch.failures.append((f"Data processing error: {error}", retry_at, device['id']))
+                    continue
+                if error is not None:
+                    logger.error(f"Error polling device {device['device_name']}: {error}")
+                    batch.failures.append((f"Connection error: {error}", self._backoff_until(device['id']), device['id']))
+                    continue
+                
+                self.failures.pop(device['id'], None)
                 try:
-                    self._poll_device(device, cursor)
+                    self._store_device_data(device, device_data, cursor, batch, retry_at)
                 except Exception as e:
-                    logger.error(f"Error polling device {device['device_name']}: {e}")
-                    # Update device with error status
-                    cursor.execute('''
-                        UPDATE RegisteredDevices 
-                        SET status = 'offline', last_poll_error = ?
-                        WHERE id = ?
-                    ''', (str(e), device['id']))
+                    logger.error(f"Error storing data from device {device['device_name']}: {e}")
+                    batch.failures.append((f"Data processing error: {str(e)}", retry_at, device['id']))
             
+            self._write_batch(batch, cursor)
             conn.commit()
+            for sensor_id, _, stored_at in batch.stored:
+                device_registry.note_stored(sensor_id, stored_at)
+            
+            cursor.execute(f'SELECT MIN(rd.next_poll_at) AS next_due {_POLLABLE_DEVICES_SQL}')
+            row = cursor.fetchone()
             conn.close()
+            next_due = _as_utc(row['next_due']) if row and row['next_due'] else None
             
-        except Exception as e:
-            logger.error(f"Error in _poll_devices: {e}", exc_info=True)
+            self.last_cycle = {
+                'finished_at': datetime.now(timezone.utc).isoformat(),
+                'duration_ms': round((time.monotonic() - cycle_started) * 1000, 1),
+                'polled': len(devices_to_poll),
+                'succeeded': len(batch.successes),
+                'failed': len(batch.failures),
+                'failing_devices': len(self.failures),
+                'points_stored': len(batch.rows),
+                'next_due': next_due.isoformat() if next_due else None,
+            }
+            if devices_to_poll:
+                logger.info(f"Device polling cycle took {self.last_cycle['duration_ms']}ms: "
+                            f"{len(batch.successes)} ok, {len(batch.failures)} failed")
+            return next_due
+            
+        finally:
+            conn.close()
+    
+    def _backoff_until(self, device_id):
+        """Count a connection failure and return the device's backed-off next_poll_at"""
+        count = self.failures.get(device_id, 0) + 1
+        self.failures[device_id] = count
+        delay = min(BACKOFF_BASE_SECONDS * 2 ** (count - 1), MAX_BACKOFF_SECONDS)
+        return _db_time(datetime.now(timezone.utc) + timedelta(seconds=delay))
     
-    def _poll_device(self, device, cursor):
-        """Poll a single device and store the data"""
+    def _fetch_devices(self, devices):
+        """Fetch every device's data in parallel; returns (device, data, error) tuples"""
+        if not devices:
+            return []
+        
+        if self._session is None:
+            self._session = requests.Session()
+            adapter = requests.adapters.HTTPAdapter(pool_maxsize=self.max_workers)
+            self._session.mount('http://', adapter)
+        
+        workers = min(self.max_workers, len(devices))
+        with ThreadPoolExecutor(max_workers=workers, thread_name_prefix='device-poll') as pool:
+            return list(pool.map(self._fetch_device, devices))
+    
+    def _fetch_device(self, device):
+        """HTTP part of a poll - runs on a worker thread, so no database access here"""
         try:
             logger.debug(f"Polling device {device['device_name']}")
             
             # Use appropriate endpoint based on device type
             endpoint = "/api" if device['device_type'] == 'esp32_fermentation' else "/data"
-            response = requests.get(f"http://{device['ip']}{endpoint}", timeout=10)
+            response = self._session.get(f"http://{device['ip']}{endpoint}", timeout=self.request_timeout)
             response.raise_for_status()
-            device_data = response.json()
-
-            # Use UTC timestamp consistently for all sensor data
-            timestamp = datetime.now(timezone.utc).isoformat()
-            stored_count = 0
-            
-            # Extract and store sensor data based on device type
-            if device['device_type'] == 'esp32_fermentation':
-                stored_count = self._store_esp32_fermentation_data(
-                    device, device_data, timestamp, cursor
-                )
-            
-            # Update device status
-            cursor.execute('''
-                UPDATE RegisteredDevices 
-                SET last_seen = ?, status = 'online', last_poll_success = ?, last_poll_error = NULL
-                WHERE id = ?
-            ''', (timestamp, timestamp, device['id']))
-            
-            logger.debug(f"Successfully polled {device['device_name']}, stored {stored_count} sensors")
-            
-        except requests.RequestException as e:
-            # Network/HTTP error
-            cursor.execute('''
+            return device, response.json(), None
+        except (requests.RequestException, ValueError) as e:
+            return device, None, e
+    
+    def _store_device_data(self, device, device_data, cursor, batch, next_poll_at):
+        """Queue a successful poll's data and status update onto the batch"""
+        # Use UTC timestamp consistently for all sensor data
+        polled_at = datetime.now(timezone.utc)
+        timestamp = polled_at.isoformat()
+        stored_count = 0
+        
+        # Extract and store sensor data based on device type
+        if device['device_type'] == 'esp32_fermentation':
+            stored_count = self._store_esp32_fermentation_data(
+                device, device_data, timestamp, cursor, batch
+            )
+        
+        batch.successes.append((timestamp, timestamp, next_poll_at, device['id']))
+        if stored_count:
+            batch.stored.append((device['device_id'], device['id'], polled_at))
+        logger.debug(f"Successfully polled {device['device_name']}, stored {stored_count} sensors")
+    
+    def _write_batch(self, batch, cursor):
+        """Apply a cycle's data and status updates, then check notification rules"""
+        if batch.rows:
+            cursor.executemany('''
+                INSERT INTO SensorData (entry_id, sensor_type, value, recorded_at)
+                VALUES (?, ?, ?, ?)
+            ''', batch.rows)
+            record_rollups(cursor, batch.rows)
+        
+        if batch.successes:
+            cursor.executemany('''
                 UPDATE RegisteredDevices 
-                SET status = 'offline', last_poll_error = ?
+                SET last_seen = ?, status = 'online', last_poll_success = ?, last_poll_error = NULL,
+                    next_poll_at = ?
                 WHERE id = ?
-            ''', (f"Connection error: {str(e)}", device['id']))
-            raise
+            ''', batch.successes)
         
-        except Exception as e:
-            # Other errors
-            cursor.execute('''
+        # Push rate limiting spaces samples from last_data_stored
+        for _, device_id, stored_at in batch.stored:
+            device_registry.claim_stored(cursor, device_id, stored_at, stored_at)
+        
+        if batch.failures:
+            cursor.executemany('''
                 UPDATE RegisteredDevices 
-                SET last_poll_error = ?
+                SET status = 'offline', last_poll_error = ?, next_poll_at = ?
                 WHERE id = ?
-            ''', (f"Data processing error: {str(e)}", device['id']))
-            raise
+            ''', batch.failures)
+        
+        # Rules are evaluated over the whole cycle's readings at once; failures
+        # are logged there and never fail the data collection
+        from .api.notifications_api import check_sensor_rules_batch_with_connection
+        check_sensor_rules_batch_with_connection(cursor, batch.rows)
     
-    def _store_esp32_fermentation_data(self, device, device_data, timestamp, cursor):
+    def _store_esp32_fermentation_data(self, device, device_data, timestamp, cursor, batch):
         """Store data from ESP32 fermentation controller for all linked entries"""
         stored_count = 0
         
@@ -192,7 +328,7 @@ class DevicePollingScheduler:
             
             # If no specific mappings exist, use default behavior for backward compatibility
             if not sensor_mappings:
-                return self._store_default_esp32_data(device, device_data, timestamp, cursor, linked_entries)
+                return self._store_default_esp32_data(device, device_data, timestamp, cursor, linked_entries, batch)
             
             entry_ids = [row['entry_id'] for row in linked_entries]
             logger.debug(f"Storing data for device {device['device_name']} to entries: {entry_ids} using {len(sensor_mappings)} sensor mappings")
@@ -231,19 +367,8 @@ class DevicePollingScheduler:
                     value = self._extract_sensor_value(device_data, sensor_name, unit)
                     
                     if value is not None:
-                        cursor.execute('''
-                            INSERT INTO SensorData (entry_id, sensor_type, value, recorded_at)
-                            VALUES (?, ?, ?, ?)
-                        ''', (entry_id, sensor_type, value, timestamp))
+                        batch.add_point(entry_id, sensor_type, value, timestamp)
                         stored_count += 1
-                        
-                        # Check sensor notification rules for each data point
-                        try:
-                            from .api.notifications_api import check_sensor_rules_with_connection
-                            check_sensor_rules_with_connection(cursor, entry_id, sensor_type, value, timestamp)
-                        except Exception as e:
-                            logger.warning(f"Error checking sensor rules for entry {entry_id}: {e}")
-                            # Don't fail the data collection if notification checking fails
             
             return stored_count
             
@@ -251,7 +376,7 @@ class DevicePollingScheduler:
             logger.error(f"Error storing ESP32 data: {e}", exc_info=True)
             return stored_count
     
-    def _store_default_esp32_data(self, device, device_data, timestamp, cursor, linked_entries):
+    def _store_default_esp32_data(self, device, device_data, timestamp, cursor, linked_entries, batch):
         """Store default ESP32 data when no sensor mappings are configured"""
         stored_count = 0
         entry_ids = [row['entry_id'] for row in linked_entries]
@@ -284,23 +409,8 @@ class DevicePollingScheduler:
                     
                     temp_value = device_data['sensor']['temperature']
                     temp_formatted = f"{temp_value}°C"
-                    cursor.execute('''
-                        INSERT INTO SensorData (entry_id, sensor_type, value, recorded_at)
-                        VALUES (?, ?, ?, ?)
-                    ''', (
-                        entry_id,
-                        'Temperature',
-                        temp_formatted,
-                        timestamp
-                    ))
+                    batch.add_point(entry_id, 'Temperature', temp_formatted, timestamp)
                     stored_count += 1
-                    
-                    # Check sensor notification rules
-                    try:
-                        from .api.notifications_api import check_sensor_rules_with_connection
-                        check_sensor_rules_with_connection(cursor, entry_id, 'Temperature', temp_formatted, timestamp)
-                    except Exception as e:
-                        logger.warning(f"Error checking sensor rules for Temperature: {e}")
                 
                 # Target temperature (if different from current)
                 if ('sensor' in device_data and 
@@ -309,46 +419,16 @@ class DevicePollingScheduler:
                     
                     target_temp = device_data['sensor']['target']
                     target_formatted = f"{target_temp}°C"
-                    cursor.execute('''
-                        INSERT INTO SensorData (entry_id, sensor_type, value, recorded_at)
-                        VALUES (?, ?, ?, ?)
-                    ''', (
-                        entry_id,
-                        'Target Temperature',
-                        target_formatted,
-                        timestamp
-                    ))
+                    batch.add_point(entry_id, 'Target Temperature', target_formatted, timestamp)
                     stored_count += 1
-                    
-                    # Check sensor notification rules
-                    try:
-                        from .api.notifications_api import check_sensor_rules_with_connection
-                        check_sensor_rules_with_connection(cursor, entry_id, 'Target Temperature', target_formatted, timestamp)
-                    except Exception as e:
-                        logger.warning(f"Error checking sensor rules for Target Temperature: {e}")
                 
                 # Relay/Heating status
                 if ('relay' in device_data and 
                     'state' in device_data['relay'] and
                     'Heating Status' in enabled_types):
                     relay_state = device_data['relay']['state']
-                    cursor.execute('''
-                        INSERT INTO SensorData (entry_id, sensor_type, value, recorded_at)
-                        VALUES (?, ?, ?, ?)
-                    ''', (
-                        entry_id,
-                        'Heating Status',
-                        relay_state,
-                        timestamp
-                    ))
+                    batch.add_point(entry_id, 'Heating Status', relay_state, timestamp)
                     stored_count += 1
-                    
-                    # Check sensor notification rules
-                    try:
-                        from .api.notifications_api import check_sensor_rules_with_connection
-                        check_sensor_rules_with_connection(cursor, entry_id, 'Heating Status', relay_state, timestamp)
-                    except Exception as e:
-                        logger.warning(f"Error checking sensor rules for Heating Status: {e}")
                 
                 # System information (less frequent - only store every 10th poll)
                 if 'system' in device_data:
@@ -359,67 +439,22 @@ class DevicePollingScheduler:
                         'WiFi Signal' in enabled_types):
                         wifi_rssi = system_data['wifi_rssi']
                         wifi_formatted = f"{wifi_rssi} dBm"
-                        cursor.execute('''
-                            INSERT INTO SensorData (entry_id, sensor_type, value, recorded_at)
-                            VALUES (?, ?, ?, ?)
-                        ''', (
-                            entry_id,
-                            'WiFi Signal',
-                            wifi_formatted,
-                            timestamp
-                        ))
+                        batch.add_point(entry_id, 'WiFi Signal', wifi_formatted, timestamp)
                         stored_count += 1
                         
-                        # Check sensor notification rules
-                        try:
-                            from .api.notifications_api import check_sensor_rules_with_connection
-                            check_sensor_rules_with_connection(cursor, entry_id, 'WiFi Signal', wifi_formatted, timestamp)
-                        except Exception as e:
-                            logger.warning(f"Error checking sensor rules for WiFi Signal: {e}")
-                        
                         # Free heap (memory)
                         if ('free_heap' in system_data and
                             'Free Memory' in enabled_types):
                             free_heap = system_data['free_heap']
                             heap_formatted = f"{free_heap} bytes"
-                            cursor.execute('''
-                                INSERT INTO SensorData (entry_id, sensor_type, value, recorded_at)
-                                VALUES (?, ?, ?, ?)
-                            ''', (
-                                entry_id,
-                                'Free Memory',
-                                heap_formatted,
-                                timestamp
-                            ))
+                            batch.add_point(entry_id, 'Free Memory', heap_formatted, timestamp)
                             stored_count += 1
-                            
-                            # Check sensor notification rules
-                            try:
-                                from .api.notifications_api import check_sensor_rules_with_connection
-                                check_sensor_rules_with_connection(cursor, entry_id, 'Free Memory', heap_formatted, timestamp)
-                            except Exception as e:
-                                logger.warning(f"Error checking sensor rules for Free Memory: {e}")
                     
                     # Store device status
                     if 'Device Status' in enabled_types:
                         device_status = device_data.get('device_status', 'unknown')
-                        cursor.execute('''
-                            INSERT INTO SensorData (entry_id, sensor_type, value, recorded_at)
-                            VALUES (?, ?, ?, ?)
-                        ''', (
-                            entry_id,
-                            'Device Status',
-                            device_status,
-                            timestamp
-                        ))
+                        batch.add_point(entry_id, 'Device Status', device_status, timestamp)
                         stored_count += 1
-                    
-                    # Check sensor notification rules
-                    try:
-                        from .api.notifications_api import check_sensor_rules_with_connection
-                        check_sensor_rules_with_connection(cursor, entry_id, 'Device Status', device_status, timestamp)
-                    except Exception as e:
-                        logger.warning(f"Error checking sensor rules for Device Status: {e}")
             
             logger.info(f"Stored {stored_count} sensor readings for device {device['device_name']} across {len(entry_ids)} entries")
             return stored_count
@@ -480,6 +515,11 @@ class DevicePollingScheduler:
 # Global scheduler instance
 device_scheduler = DevicePollingScheduler()
 
+@job_queue.register('device_poll_wake')
+def _wake_device_polling(payload):
+    """Web workers forward wake() here, to the process running the loop"""
+    device_scheduler.wake()
+
 def start_device_polling(app=None):
     """Start the device polling scheduler"""
     if app:
@@ -0,0 +1,308 @@
+# app/job_queue.py
+
+import functools
+import json
+import logging
+import os
+import socket
+import threading
+import time
+import uuid
+
+from .metrics import metrics
+
+logger = logging.getLogger(__name__)
+
+class JobQueue:
+    """
+    Database-backed queue for slow external calls.
+
+    AI requests, git fetches and Garmin/Strava syncs can take tens of
+    seconds; run inline they hold a web worker thread that sensor uploads
+    and page loads are waiting for. Views marked @job_queue.deferrable are
+    instead stored as a BackgroundJob row when the client sends
+    ``Prefer: respond-async`` (or ``?async=1``) and answered with 202 and
+    the job's status URL (/api/jobs/<id>). The background worker process
+    claims queued rows, replays the request against the same view and
+    keeps its status code and body as the job result.
+
+    Other code queues work by name: enqueue('strava_sync') runs the handler
+    registered with @job_queue.register('strava_sync').
+
+    Jobs run where start() was called: the background worker (APP_ROLE
+    "worker") or the single dev server process ("all"). A job still
+    running when its worker dies is marked failed after JOB_TIMEOUT.
+    """
+
+    def __init__(self):
+        self.running = False
+        self.threads = []
+        self.app = None  # Will store the Flask app instance
+        self.workers = 2
+        self.poll_interval = 2.0  # Idle wait between claims; enqueue() in this process cuts it short
+        self.timeout = 900  # Running jobs older than this are given up on
+        self.result_ttl = 86400  # Finished jobs are deleted after this
+        self.handlers = {'deferred_request': self._replay_request}
+        self._wake = threading.Event()
+        self._stats_lock = threading.Lock()
+        self._stats = {'processed': 0, 'failed': 0, 'active': 0, 'last_job_ms': 0.0}
+        self._last_housekeeping = 0.0
+
+    def init_app(self, app):
+        """Initialize with Flask app instance"""
+        self.app = app
+        self.workers = app.config.get('JOB_WORKERS', self.workers)
+        self.poll_interval = app.config.get('JOB_POLL_SECONDS', self.poll_interval)
+        self.timeout = app.config.get('JOB_TIMEOUT', self.timeout)
+        self.result_ttl = app.config.get('JOB_RESULT_TTL', self.result_ttl)
+
+    def register(self, kind):
+        """Decorator naming a handler; it is called with the job's payload dict"""
+        def decorator(handler):
+            self.handlers[kind] = handler
+            return handler
+        return decorator
+
+    def deferrable(self, view):
+        """Let a slow view run on the background worker when the client asks for it"""
+        @functools.wraps(view)
+        def wrapper(*args, **kwargs):
+            from flask import g, request
+
+            if g.get('_job_replay') or not _prefers_async(request):
+                return view(*args, **kwargs)
+            job_id = self.enqueue('deferred_request', {
+                'method': request.method,
+                'path': request.path,
+                'query_string': request.query_string.decode('latin-1'),
+                'content_type': request.content_type,
+                'body': request.get_data(as_text=True),
+            })
+            return accepted(job_id)
+        return wrapper
+
+    def start(self):
+        """Start the worker threads"""
+        if self.running:
+            return
+
+        self.running = True
+        self.threads = []
+        for i in range(max(self.workers, 1)):
+            thread = threading.Thread(target=self._work_loop, name=f'job-worker-{i}', daemon=True)
+            thread.start()
+            self.threads.append(thread)
+        logger.info(f"Job queue started with {len(self.threads)} worker(s)")
+
+    def stop(self):
+        """Stop claiming jobs; jobs already running finish first"""
+        if not self.running:
+            return
+        self.running = False
+        self._wake.set()
+        for thread in self.threads:
+            thread.join()
+        logger.info("Job queue stopped")
+
+    def enqueue(self, kind, payload=None):
+        """Store a job for the background worker; returns its id"""
+        from .db import get_dedicated_connection
+
+        conn = get_dedicated_connection()
+        try:
+            cursor = conn.cursor()
+            cursor.execute(
+                "INSERT INTO BackgroundJob (kind, status, payload) VALUES (?, 'queued', ?)",
+                (kind, json.dumps(payload or {}))
+            )
+            job_id = cursor.lastrowid
+            conn.commit()
+        finally:
+            conn.close()
+        self._wake.set()
+        return job_id
+
+    def get(self, job_id):
+        """The job as a dict (result decoded), or None"""
+        from .db import get_connection
+
+        conn = get_connection()
+        try:
+            cursor = conn.cursor()
+            cursor.execute('''
+                SELECT id, kind, status, result, error, created_at, started_at, finished_at
+                FROM BackgroundJob WHERE id = ?
+            ''', (job_id,))
+            row = cursor.fetchone()
+        finally:
+            conn.close()
+        if not row:
+            return None
+        job = dict(row)
+        job['result'] = json.loads(job['result']) if job.get('result') else None
+        for key in ('created_at', 'started_at', 'finished_at'):
+            if job.get(key) is not None:
+                job[key] = str(job[key])
+        return job
+
+    def counts(self):
+        """Jobs per status across all processes"""
+        from .db import get_connection
+
+        conn = get_connection()
+        try:
+            cursor = conn.cursor()
+            cursor.execute('SELECT status, COUNT(*) AS jobs FROM BackgroundJob GROUP BY status')
+            counts = {status: 0 for status in ('queued', 'running', 'done', 'failed')}
+            counts.update({row['status']: row['jobs'] for row in cursor.fetchall()})
+            return counts
+        finally:
+            conn.close()
+
+    def stats(self):
+        """Snapshot of this process's worker counters"""
+        with self._stats_lock:
+            snapshot = dict(self._stats)
+        snapshot.update({'running': self.running, 'workers': len(self.threads) if self.running else 0})
+        return snapshot
+
+    def _work_loop(self):
+        """Claim and run jobs until stopped"""
+        while self.running:
+            job = None
+            try:
+                with self.app.app_context():
+                    self._housekeep()
+                    job = self._claim()
+                    if job:
+                        self._run(job)
+            except Exception as e:
+                logger.error(f"Error in job queue: {e}", exc_info=True)
+            if not job:
+                self._wake.wait(self.poll_interval)
+                self._wake.clear()
+
+    def _claim(self):
+        """Mark the oldest queued job running for this thread; returns it or None"""
+        from .db import get_connection
+
+        token = f"{socket.gethostname()}:{os.getpid()}:{uuid.uuid4().hex[:12]}"
+        conn = get_connection()
+        try:
+            cursor = conn.cursor()
+            # A single UPDATE so two workers can never claim the same row
+            cursor.execute('''
+                UPDATE BackgroundJob SET status = 'running', worker = ?, started_at = NOW()
+                WHERE status = 'queued' ORDER BY id LIMIT 1
+            ''', (token,))
+            conn.commit()
+            if not cursor.rowcount:
+                return None
+            cursor.execute(
+                "SELECT id, kind, payload FROM BackgroundJob WHERE worker = ? AND status = 'running'",
+                (token,)
+            )
+            return cursor.fetchone()
+        finally:
+            conn.close()
+
+    def _run(self, job):
+        """Run the job's handler and store what it returned (or why it failed)"""
+        from .db import get_connection
+
+        began = time.perf_counter()
+        status, result, error = 'done', None, None
+        with self._stats_lock:
+            self._stats['active'] += 1
+        try:
+            handler = self.handlers.get(job['kind'])
+            if handler is None:
+                raise LookupError(f"No handler registered for job kind '{job['kind']}'")
+            with metrics.timed(f"job_{job['kind']}"):
+                result = handler(json.loads(job['payload'] or '{}'))
+        except Exception as e:
+            logger.error(f"Job {job['id']} ({job['kind']}) failed: {e}", exc_info=True)
+            status, error = 'failed', str(e)
+        finally:
+            elapsed_ms = (time.perf_counter() - began) * 1000
+            with self._stats_lock:
+                self._stats['active'] -= 1
+                self._stats['processed'] += 1
+                if status == 'failed':
+                    self._stats['failed'] += 1
+                self._stats['last_job_ms'] = round(elapsed_ms, 2)
+
+        conn = get_connection()
+        try:
+            cursor = conn.cursor()
+            cursor.execute('''
+                UPDATE BackgroundJob SET status = ?, result = ?, error = ?, finished_at = NOW()
+                WHERE id = ?
+            ''', (status, json.dumps(result, default=str) if result is not None else None, error, job['id']))
+            conn.commit()
+        finally:
+            conn.close()
+        logger.info(f"Job {job['id']} ({job['kind']}) {status} in {elapsed_ms:.0f} ms")
+
+    def _housekeep(self):
+        """Fail jobs orphaned by a dead worker and drop old results (about once a minute)"""
+        with self._stats_lock:
+            if time.monotonic() - self._last_housekeeping < 60:
+                return
+            self._last_housekeeping = time.monotonic()
+
+        from .db import get_connection
+
+        conn = get_connection()
+        try:
+            cursor = conn.cursor()
+            cursor.execute('''
+                UPDATE BackgroundJob
+                SET status = 'failed', error = 'Worker stopped before the job finished', finished_at = NOW()
+                WHERE status = 'running' AND started_at < NOW() - INTERVAL ? SECOND
+            ''', (self.timeout,))
+            cursor.execute('''
+                DELETE FROM BackgroundJob
+                WHERE status IN ('done', 'failed') AND finished_at < NOW() - INTERVAL ? SECOND
+            ''', (self.result_ttl,))
+            conn.commit()
+        finally:
+            conn.close()
+
+    def _replay_request(self, payload):
+        """Run a deferred request through the app again, this time inline"""
+        from flask import g
+
+        with self.app.test_request_context(
+            payload['path'],
+            method=payload['method'],
+            query_string=payload.get('query_string') or None,
+            content_type=payload.get('content_type'),
+            data=payload.get('body') or None,
+        ):
+            g._job_replay = True
+            response = self.app.full_dispatch_request()
+            body = response.get_json(silent=True) if response.is_json else response.get_data(as_text=True)
+            response.close()
+        return {'status_code': response.status_code, 'body': body}
+
+
+def _prefers_async(request):
+    """Prefer: respond-async (RFC 7240) or ?async=1"""
+    if 'respond-async' in request.headers.get('Prefer', '').lower():
+        return True
+    return request.args.get('async', '').lower() in ('1', 'true', 'yes')
+
+
+def accepted(job_id):
+    """202 response pointing at the job's status URL"""
+    from flask import jsonify, url_for
+
+    status_url = url_for('jobs_api.get_job', job_id=job_id)
+    response = jsonify({'job_id': job_id, 'status': 'queued', 'status_url': status_url})
+    response.status_code = 202
+    response.headers['Location'] = status_url
+    return response
+
+
+job_queue = JobQueue()
@@ -0,0 +1,343 @@
+# template_app/app/metrics.py
+"""
+Process Metrics
+===============
+
+In-memory latency histograms and counters for request and background hot
+paths, served in the Prometheus text format at /api/metrics:
+
+- template_http_request_duration_seconds{endpoint,method} - per Flask
+  endpoint (the view name, so label sets stay small)
+- template_http_requests_total{endpoint,method,status}
+- template_http_request_db_queries{endpoint} and
+  template_http_request_db_seconds{endpoint} - database work per request
+- template_background_cycle_duration_seconds{job} and
+  template_background_cycle_db_queries{job} - device polling cycles,
+  ingest flushes and task scheduler passes
+
+Queue depths, cache hit rates and pool counters are read from the existing
+stats() snapshots when the endpoint is scraped. For streamed responses the
+request time is the time to the first byte.
+
+Every process (each gunicorn web worker and the background worker) records
+into its own registry. With METRICS_DIR set (gunicorn.conf.py does), each
+one also writes its registry to <pid>.json in that directory about once a
+second, and a scrape answered by any process merges the histograms and
+counters of all of them, so one scrape of the web port covers the whole
+server. Series carry the recording process's role (APP_ROLE) but no pid.
+Files of processes that have exited are kept, so counters never go
+backwards when a worker is replaced; the directory is emptied when the
+gunicorn master starts. Gauges are sampled by the process answering the
+scrape. Without METRICS_DIR (python run.py, or worker.py on its own with
+WORKER_PORT) a scrape shows only the answering process.
+"""
+
+import glob
+import json
+import logging
+import os
+import threading
+import time
+from contextlib import contextmanager
+
+logger = logging.getLogger(__name__)
+
+LATENCY_BUCKETS = (0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1.0, 2.5, 5.0, 10.0, 30.0)
+QUERY_COUNT_BUCKETS = (0, 1, 2, 5, 10, 20, 50, 100, 250)
+
+PREFIX = 'template_'
+
+METRICS_FLUSH_SECONDS = 1.0
+
+
+class _QueryTally(threading.local):
+    """Database statements run on this thread (read as deltas, never reset)"""
+    count = 0
+    seconds = 0.0
+
+
+_queries = _QueryTally()
+
+
+def record_query(seconds):
+    """Called by the database cursor wrapper after every statement"""
+    tally = _queries
+    tally.count += 1
+    tally.seconds += seconds
+
+
+class Histogram:
+    """Cumulative-bucket histogram per label set"""
+
+    def __init__(self, buckets):
+        self.buckets = buckets
+        self.series = {}
+
+    def observe(self, labels, value):
+        series = self.series.get(labels)
+        if series is None:
+            series = self.series[labels] = [[0] * len(self.buckets), 0.0, 0]
+        counts = series[0]
+        for i, bound in enumerate(self.buckets):
+            if value <= bound:
+                counts[i] += 1
+                break
+        series[1] += value
+        series[2] += 1
+
+
+class Metrics:
+    """Registry of the process's histograms and counters"""
+
+    def __init__(self):
+        self.enabled = True
+        self.role = 'all'
+        self.directory = None  # METRICS_DIR, shared by the processes of one server
+        self._lock = threading.Lock()
+        self._histograms = {}
+        self._counters = {}
+        self._help = {}
+        self._pid = os.getpid()
+        self._dirty = False
+        self._flusher_pid = None
+
+    def init_app(self, app):
+        self.enabled = app.config.get('METRICS_ENABLED', True)
+        self.role = app.config.get('APP_ROLE', self.role)
+        self.directory = app.config.get('METRICS_DIR') or None
+        if not self.enabled:
+            return
+
+        from flask import g, request
+
+        @app.before_request
+        def _start_request_metrics():
+            g._metrics_started = (time.perf_counter(), _queries.count, _queries.seconds)
+
+        @app.after_request
+        def _record_request_metrics(response):
+            started = g.pop('_metrics_started', None)
+            if started is not None:
+                self._observe_request(request, response.status_code, started)
+            return response
+
+        @app.teardown_request
+        def _record_failed_request(error=None):
+            # after_request is skipped when a view raises
+            started = g.pop('_metrics_started', None)
+            if started is not None and error is not None:
+                self._observe_request(request, 500, started)
+
+    def _observe_request(self, request, status, started):
+        began, queries, query_seconds = started
+        endpoint = request.endpoint or 'unmatched'
+        labels = (('endpoint', endpoint), ('method', request.method))
+        with self._lock:
+            self._recording()
+            self._histogram('http_request_duration_seconds', LATENCY_BUCKETS,
+                            'Request latency by Flask endpoint').observe(labels, time.perf_counter() - began)
+            self._histogram('http_request_db_queries', QUERY_COUNT_BUCKETS,
+                            'Database statements per request').observe(labels[:1], _queries.count - queries)
+            self._histogram('http_request_db_seconds', LATENCY_BUCKETS,
+                            'Database time per request').observe(labels[:1], _queries.seconds - query_seconds)
+            self._count('http_requests_total', labels + (('status', str(status)),), 'Requests served')
+
+    @contextmanager
+    def timed(self, job):
+        """Record one background cycle (duration and database statements)"""
+        began, queries = time.perf_counter(), _queries.count
+        try:
+            yield
+        finally:
+            if self.enabled:
+                labels = (('job', job),)
+                with self._lock:
+                    self._recording()
+                    self._histogram('background_cycle_duration_seconds', LATENCY_BUCKETS,
+                                    'Background cycle duration').observe(labels, time.perf_counter() - began)
+                    self._histogram('background_cycle_db_queries', QUERY_COUNT_BUCKETS,
+                                    'Database statements per background cycle').observe(
+                                        labels, _queries.count - queries)
+
+    def _histogram(self, name, buckets, help_text):
+        histogram = self._histograms.get(name)
+        if histogram is None:
+            histogram = self._histograms[name] = Histogram(buckets)
+            self._help[name] = help_text
+        return histogram
+
+    def _count(self, name, labels, help_text, amount=1):
+        series = self._counters.setdefault(name, {})
+        series[labels] = series.get(labels, 0) + amount
+        self._help.setdefault(name, help_text)
+
+    def _this_process(self):
+        """Called with the lock held before the registry is used"""
+        if self._pid != os.getpid():
+            # Forked: the parent reports what it recorded itself
+            self._pid = os.getpid()
+            self._histograms, self._counters = {}, {}
+
+    def _recording(self):
+        """Called with the lock held before recording"""
+        self._this_process()
+        self._dirty = True
+        if self.directory and self._flusher_pid != self._pid:
+            self._flusher_pid = self._pid
+            threading.Thread(target=self._flush_loop, name='metrics-flush', daemon=True).start()
+
+    # -- shared directory --------------------------------------------------
+
+    def _flush_loop(self):
+        while True:
+            time.sleep(METRICS_FLUSH_SECONDS)
+            try:
+                self.flush()
+            except Exception as e:
+                logger.warning(f"Could not write metrics to {self.directory}: {e}")
+
+    def flush(self, force=False):
+        """Write this process's registry to its file in METRICS_DIR"""
+        if not self.directory:
+            return
+        with self._lock:
+            if not (self._dirty or force) or self._pid != os.getpid():
+                return
+            self._dirty = False
+            snapshot = {
+                'role': self.role,
+                'help': dict(self._help),
+                'histograms': {
+                    name: {
+                        'buckets': list(histogram.buckets),
+                        'series': [[labels, counts, total, count]
+                                   for labels, (counts, total, count) in histogram.series.items()],
+                    }
+                    for name, histogram in self._histograms.items()
+                },
+                'counters': {name: [[labels, value] for labels, value in series.items()]
+                             for name, series in self._counters.items()},
+            }
+        path = os.path.join(self.directory, f'{os.getpid()}.json')
+        with open(path + '.tmp', 'w') as f:
+            json.dump(snapshot, f)
+        os.replace(path + '.tmp', path)  # Readers never see a partial file
+
+    def _merged(self):
+        """(help, histograms, counters) of every process sharing METRICS_DIR, or just this one"""
+        if not self.directory:
+            process = (('role', self.role),)
+            with self._lock:
+                self._this_process()
+                histograms = {
+                    name: (histogram.buckets, {process + labels: [list(counts), total, count]
+                                               for labels, (counts, total, count) in histogram.series.items()})
+                    for name, histogram in self._histograms.items()
+                }
+                counters = {name: {process + labels: value for labels, value in series.items()}
+                            for name, series in self._counters.items()}
+                return dict(self._help), histograms, counters
+
+        self.flush(force=True)  # This process's latest observations
+        help_texts, histograms, counters = {}, {}, {}
+        for path in glob.glob(os.path.join(self.directory, '*.json')):
+            try:
+                with open(path) as f:
+                    snapshot = json.load(f)
+            except (OSError, ValueError):
+                continue  # Removed or replaced while listing
+            process = (('role', snapshot['role']),)
+            help_texts.update(snapshot['help'])
+            for name, histogram in snapshot['histograms'].items():
+                buckets = tuple(histogram['buckets'])
+                merged_buckets, merged = histograms.setdefault(name, (buckets, {}))
+                if merged_buckets != buckets:
+                    continue  # Written by a version with other buckets
+                for labels, counts, total, count in histogram['series']:
+                    key = process + tuple(tuple(label) for label in labels)
+                    series = merged.setdefault(key, [[0] * len(buckets), 0.0, 0])
+                    series[0] = [a + b for a, b in zip(series[0], counts)]
+                    series[1] += total
+                    series[2] += count
+            for name, series in snapshot['counters'].items():
+                merged = counters.setdefault(name, {})
+                for labels, value in series:
+                    key = process + tuple(tuple(label) for label in labels)
+                    merged[key] = merged.get(key, 0) + value
+        return help_texts, histograms, counters
+
+    def render(self, gauges=()):
+        """
+        Prometheus text exposition of everything recorded, plus ``gauges``:
+        (name, help, [(labels, value)]) tuples sampled by the caller. Gauges
+        sharing a name are merged into one metric. Every series is labelled
+        with the role of the process that recorded or sampled it.
+        """
+        help_texts, histograms, counters = self._merged()
+        lines = []
+        for name, (buckets, series) in sorted(histograms.items()):
+            full = PREFIX + name
+            lines += [f'# HELP {full} {help_texts[name]}', f'# TYPE {full} histogram']
+            for labels, (counts, total, count) in sorted(series.items()):
+                cumulative = 0
+                for bound, bucket_count in zip(buckets, counts):
+                    cumulative += bucket_count
+                    lines.append(f'{full}_bucket{_labels(labels + (("le", _number(bound)),))} {cumulative}')
+                lines.append(f'{full}_bucket{_labels(labels + (("le", "+Inf"),))} {count}')
+                lines.append(f'{full}_sum{_labels(labels)} {_number(total)}')
+                lines.append(f'{full}_count{_labels(labels)} {count}')
+        for name, series in sorted(counters.items()):
+            full = PREFIX + name
+            lines += [f'# HELP {full} {help_texts[name]}', f'# TYPE {full} counter']
+            for labels, value in sorted(series.items()):
+                lines.append(f'{full}{_labels(labels)} {value}')
+
+        process = (('role', self.role),)
+        merged = {}
+        for name, help_text, samples in gauges:
+            merged.setdefault(name, (help_text, []))[1].extend(samples)
+        for name, (help_text, samples) in merged.items():
+            full = PREFIX + name
+            lines += [f'# HELP {full} {help_text}', f'# TYPE {full} gauge']
+            for labels, value in samples:
+                lines.append(f'{full}{_labels(process + tuple(labels))} {_number(value)}')
+        return '\n'.join(lines) + '\n'
+
+
+def clear_metrics_dir(directory):
+    """Create METRICS_DIR, removing files left by an earlier server"""
+    os.makedirs(directory, exist_ok=True)
+    for path in glob.glob(os.path.join(directory, '*.json*')):
+        os.remove(path)
+
+
+def snapshot_gauges(name, help_text, snapshot, labels=()):
+    """
+    Gauges for the numeric fields of a stats() snapshot, one metric per
+    field: snapshot_gauges('ingest_queue', ..., {'depth': 3}) gives
+    template_ingest_queue_depth 3. Non-numeric fields are skipped.
+    """
+    gauges = []
+    for key, value in sorted((snapshot or {}).items()):
+        if isinstance(value, bool):
+            value = int(value)
+        if isinstance(value, (int, float)):
+            gauges.append((f'{name}_{key}', f'{help_text} ({key})', [(labels, value)]))
+    return gauges
+
+
+def _labels(labels):
+    if not labels:
+        return ''
+    escaped = (str(value).replace('\\', '\\\\').replace('"', '\\"').replace('\n', '\\n')
+               for _, value in labels)
+    return '{' + ','.join(f'{key}="{value}"' for (key, _), value in zip(labels, escaped)) + '}'
+
+
+def _number(value):
+    if isinstance(value, float):
+        return repr(round(value, 6))
+    return str(value)
+
+
+metrics = Metrics()
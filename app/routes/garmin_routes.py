@@ -3,6 +3,7 @@ import logging
 from flask import Blueprint, jsonify, request
 
 from ..db import get_connection
+from ..job_queue import job_queue
 from ..services.garmin_service import sync_garmin_data
 
 garmin_routes_bp = Blueprint("garmin_routes", __name__)
@@ -26,6 +27,7 @@ def _set_system_param(conn, param_name, param_value):
 
 
 @garmin_routes_bp.route("/garmin/sync", methods=["POST"])
+@job_queue.deferrable
 def garmin_sync():
     try:
         data = request.get_json(silent=True) or {}
@@ -4,6 +4,7 @@ import time
 import logging
 import json
 from ..db import get_connection
+from ..job_queue import job_queue
 from ..services.strava_service import sync_strava_activities
 
 strava_routes_bp = Blueprint('strava_routes', __name__)
@@ -184,6 +185,7 @@ def strava_clear_last_sync():
 
 
 @strava_routes_bp.route('/strava/sync', methods=['POST'])
+@job_queue.deferrable
 def strava_sync():
     try:
         result = sync_strava_activities()
@@ -5,6 +5,8 @@ import logging
 from datetime import datetime, timedelta
 from flask import current_app
 from app.db import get_connection
+from app.job_queue import job_queue
+from app.metrics import metrics
 import pymysql
 
 logger = logging.getLogger(__name__)
@@ -42,10 +44,11 @@ class TaskScheduler:
         last_strava_sync = None
         last_garmin_sync = None
         last_scheduled_check = None
+        last_retention_run = None
         
         while self.running:
             try:
-                with self.app.app_context():
+                with self.app.app_context(), metrics.timed('task_scheduler'):
                     # Check if overdue checking is enabled
                     if self._should_run_overdue_check(last_overdue_check):
                         logger.info("Running overdue check...")
@@ -67,6 +70,11 @@ class TaskScheduler:
                         logger.info("Running scheduled notifications check...")
                         self._process_scheduled_notifications()
                         last_scheduled_check = datetime.now()
+
+                    if self._should_run_sensor_retention(last_retention_run):
+                        logger.info("Running sensor data retention...")
+                        self._run_sensor_retention()
+                        last_retention_run = datetime.now()
                         
             except Exception as e:
                 logger.error(f"Error in scheduler: {e}", exc_info=True)
@@ -207,25 +215,44 @@ class TaskScheduler:
             logger.error(f"Error in scheduler overdue check: {e}", exc_info=True)
 
     def _run_strava_sync(self):
-        """Run Strava sync as a scheduled job."""
+        """Queue a Strava sync so it does not hold up the other scheduled checks."""
         try:
-            from app.services.strava_service import sync_strava_activities
-
-            result = sync_strava_activities()
-            logger.info(f"Scheduled Strava sync result: {result}")
+            job_id = job_queue.enqueue('strava_sync')
+            logger.info(f"Scheduled Strava sync queued as job {job_id}")
         except Exception as e:
             logger.error(f"Error in scheduled Strava sync: {e}", exc_info=True)
 
     def _run_garmin_sync(self):
-        """Run Garmin Connect sync as a scheduled job."""
+        """Queue a Garmin Connect sync so it does not hold up the other scheduled checks."""
         try:
-            from app.services.garmin_service import sync_garmin_data
-
-            result = sync_garmin_data()
-            logger.info(f"Scheduled Garmin sync result: {result}")
+            job_id = job_queue.enqueue('garmin_sync')
+            logger.info(f"Scheduled Garmin sync queued as job {job_id}")
         except Exception as e:
             logger.error(f"Error in scheduled Garmin sync: {e}", exc_info=True)
 
+    def _should_run_sensor_retention(self, last_check):
+        """Check if sensor data retention is configured and due"""
+        from app.services.sensor_retention_service import sensor_retention
+
+        if not sensor_retention.enabled:
+            return False
+        if last_check is None:
+            return True
+        return (datetime.now() - last_check).total_seconds() >= sensor_retention.interval_seconds
+
+    def _run_sensor_retention(self):
+        """Prune sensor readings, logs and rollups past their retention period"""
+        try:
+            from app.services.sensor_retention_service import sensor_retention
+
+            conn = get_connection()
+            try:
+                sensor_retention.run(conn)
+            finally:
+                conn.close()
+        except Exception as e:
+            logger.error(f"Error in sensor data retention: {e}", exc_info=True)
+
     def _should_run_scheduled_check(self, last_check):
         """Check if scheduled notifications should be processed (every minute)"""
         if last_check is None:
@@ -294,5 +321,25 @@ class TaskScheduler:
         except Exception as e:
             logger.error(f"Error processing scheduled notifications: {e}", exc_info=True)
 
+@job_queue.register('strava_sync')
+def _strava_sync_job(payload):
+    """Scheduled Strava sync, run by the job queue"""
+    from app.services.strava_service import sync_strava_activities
+
+    result = sync_strava_activities()
+    logger.info(f"Scheduled Strava sync result: {result}")
+    return result
+
+
+@job_queue.register('garmin_sync')
+def _garmin_sync_job(payload):
+    """Scheduled Garmin Connect sync, run by the job queue"""
+    from app.services.garmin_service import sync_garmin_data
+
+    result = sync_garmin_data()
+    logger.info(f"Scheduled Garmin sync result: {result}")
+    return result
+
+
 # Global scheduler instance
 scheduler = TaskScheduler()
@@ -0,0 +1,173 @@
+# app/sensor_ingest_queue.py
+
+import atexit
+import queue
+import threading
+import time
+import logging
+
+from .metrics import metrics
+
+logger = logging.getLogger(__name__)
+
+class SensorIngestQueue:
+    """
+    Write-behind queue for sensor data uploads.
+
+    /sensor-master/data validates an upload, queues it and answers straight
+    away. A background thread drains the queue and stores each group of
+    uploads in one transaction with a single executemany for SensorData, so
+    a burst of nodes waking together costs a handful of commits instead of
+    one per request.
+
+    Queued uploads live in memory only: samples acknowledged but not yet
+    flushed are lost if the process is killed. stop() (also run at exit)
+    drains the queue first.
+    """
+
+    def __init__(self):
+        self.running = False
+        self.thread = None
+        self.app = None  # Will store the Flask app instance
+        self.max_size = 1000
+        self.batch_size = 50
+        self.flush_interval = 0.2  # Seconds to wait for a batch to fill
+        self.queue = queue.Queue(maxsize=self.max_size)
+        self._stats_lock = threading.Lock()
+        self._reset_stats()
+
+    def init_app(self, app):
+        """Initialize with Flask app instance"""
+        self.app = app
+        self.max_size = app.config.get('SENSOR_INGEST_QUEUE_SIZE', self.max_size)
+        self.batch_size = app.config.get('SENSOR_INGEST_BATCH_SIZE', self.batch_size)
+        self.flush_interval = app.config.get('SENSOR_INGEST_FLUSH_MS', self.flush_interval * 1000) / 1000.0
+        self.queue = queue.Queue(maxsize=self.max_size)
+
+    def start(self):
+        """Start the flush thread"""
+        if self.running:
+            return
+
+        self.running = True
+        self.thread = threading.Thread(target=self._flush_loop, daemon=True)
+        self.thread.start()
+        atexit.register(self.stop)
+        logger.info("Sensor ingest queue started")
+
+    def stop(self):
+        """Stop accepting uploads and flush whatever is still queued"""
+        if not self.running:
+            return
+        self.running = False
+        if self.thread:
+            self.thread.join()
+        logger.info("Sensor ingest queue stopped")
+
+    def submit(self, sensor_id, timeline, received_at):
+        """Queue an upload; returns False if the queue is stopped or full"""
+        if not self.running:
+            return False
+        try:
+            self.queue.put_nowait((sensor_id, timeline, received_at))
+        except queue.Full:
+            with self._stats_lock:
+                self._stats['rejected_full'] += 1
+            return False
+        with self._stats_lock:
+            self._stats['enqueued'] += 1
+        return True
+
+    def stats(self):
+        """Snapshot of queue depth and flush counters"""
+        with self._stats_lock:
+            snapshot = dict(self._stats)
+        flushes = snapshot['flushes']
+        total_ms = snapshot.pop('flush_ms_total')
+        snapshot.update({
+            'running': self.running,
+            'depth': self.queue.qsize(),
+            'capacity': self.max_size,
+            'batch_size': self.batch_size,
+            'avg_flush_ms': round(total_ms / flushes, 2) if flushes else 0.0,
+        })
+        return snapshot
+
+    def _reset_stats(self):
+        self._stats = {
+            'enqueued': 0,
+            'rejected_full': 0,
+            'flushes': 0,
+            'flushed_uploads': 0,
+            'flushed_points': 0,
+            'failed_uploads': 0,
+            'last_batch_size': 0,
+            'last_flush_ms': 0.0,
+            'max_flush_ms': 0.0,
+            'flush_ms_total': 0.0,
+        }
+
+    def _flush_loop(self):
+        """Main flush loop; keeps going after stop() until the queue is empty"""
+        while self.running or not self.queue.empty():
+            try:
+                batch = [self.queue.get(timeout=0.5)]
+            except queue.Empty:
+                continue
+
+            # Let the batch fill for a moment so a burst shares one commit
+            deadline = time.monotonic() + self.flush_interval
+            while len(batch) < self.batch_size:
+                remaining = deadline - time.monotonic()
+                if remaining <= 0:
+                    break
+                try:
+                    batch.append(self.queue.get(timeout=remaining))
+                except queue.Empty:
+                    break
+
+            try:
+                with metrics.timed('ingest_flush'):
+                    self._flush(batch)
+            except Exception as e:
+                logger.error(f"Error in sensor ingest flush: {e}", exc_info=True)
+
+    def _flush(self, batch):
+        """Store a batch in one transaction, retrying uploads singly if it fails"""
+        from .api.sensor_master_api import get_db, flush_sensor_uploads
+
+        started = time.monotonic()
+        stored_points = 0
+        failed = 0
+
+        with self.app.app_context():
+            conn = get_db()
+            try:
+                _, stored_points = flush_sensor_uploads(conn, batch)
+            except Exception as e:
+                # One bad upload must not discard everyone else's samples
+                logger.warning(f"Batched ingest of {len(batch)} uploads failed, retrying singly: {e}")
+                conn.rollback()
+                for upload in batch:
+                    try:
+                        _, points = flush_sensor_uploads(conn, [upload])
+                        stored_points += points
+                    except Exception as e:
+                        conn.rollback()
+                        failed += 1
+                        logger.error(f"Dropping sensor upload from {upload[0]}: {e}")
+
+        elapsed_ms = (time.monotonic() - started) * 1000
+        with self._stats_lock:
+            stats = self._stats
+            stats['flushes'] += 1
+            stats['flushed_uploads'] += len(batch) - failed
+            stats['flushed_points'] += stored_points
+            stats['failed_uploads'] += failed
+            stats['last_batch_size'] = len(batch)
+            stats['last_flush_ms'] = round(elapsed_ms, 2)
+            stats['max_flush_ms'] = max(stats['max_flush_ms'], round(elapsed_ms, 2))
+            stats['flush_ms_total'] += elapsed_ms
+
+
+ingest_queue = SensorIngestQueue()
@@ -0,0 +1,192 @@
+# app/services/backup_service.py
+"""
+Database Backups
+================
+
+Logical backups of the MariaDB database as gzip-compressed SQL.
+
+A dump runs inside one ``START TRANSACTION WITH CONSISTENT SNAPSHOT``
+(InnoDB MVCC, the same approach as ``mysqldump --single-transaction``), so
+it sees a single point in time without taking table locks and sensor ingest
+keeps writing while a backup runs. Rows are streamed from the server with
+an unbuffered cursor and written straight into the gzip file as multi-row
+INSERTs, so memory use stays flat however large SharedSensorData and
+SensorLogs grow.
+
+Every backup records its duration, row count and sizes in a ``.json``
+sidecar next to the dump.
+"""
+
+import gzip
+import json
+import os
+import time
+import logging
+from datetime import datetime, timezone
+
+import pymysql.cursors
+
+from ..db import get_dedicated_connection
+
+logger = logging.getLogger(__name__)
+
+DUMP_SUFFIX = '.sql.gz'
+
+# Target size of one multi-row INSERT (well below MariaDB's max_allowed_packet)
+INSERT_BATCH_BYTES = 1024 * 1024
+
+# Rows fetched from the server per round trip while streaming a table
+FETCH_ROWS = 1000
+
+_HEADER = """-- Backup of {database} taken {taken_at}
+SET NAMES utf8mb4;
+SET time_zone = '+00:00';
+SET FOREIGN_KEY_CHECKS = 0;
+SET UNIQUE_CHECKS = 0;
+"""
+
+_FOOTER = """
+SET FOREIGN_KEY_CHECKS = 1;
+SET UNIQUE_CHECKS = 1;
+"""
+
+
+def _quote_ident(name):
+    return '`' + name.replace('`', '``') + '`'
+
+
+def _dump_table(raw, table, write):
+    """Write DROP/CREATE and the rows of one table, returns the row count"""
+    quoted = _quote_ident(table)
+    cursor = raw.cursor()
+    cursor.execute(f"SHOW CREATE TABLE {quoted}")
+    create_sql = cursor.fetchone()[1]
+    cursor.close()
+    write(f"\n--\n-- Table {quoted}\n--\n\nDROP TABLE IF EXISTS {quoted};\n{create_sql};\n\n")
+
+    stream = raw.cursor(pymysql.cursors.SSCursor)
+    count = 0
+    try:
+        stream.execute(f"SELECT * FROM {quoted}")
+        columns = ', '.join(_quote_ident(column[0]) for column in stream.description)
+        prefix = f"INSERT INTO {quoted} ({columns}) VALUES\n"
+        batch, batch_bytes = [], 0
+        while True:
+            rows = stream.fetchmany(FETCH_ROWS)
+            if not rows:
+                break
+            for row in rows:
+                # literal() escapes newlines, so every row stays on one line
+                value = raw.literal(row)
+                batch.append(value)
+                batch_bytes += len(value)
+                if batch_bytes >= INSERT_BATCH_BYTES:
+                    write(prefix + ',\n'.join(batch) + ';\n')
+                    batch, batch_bytes = [], 0
+            count += len(rows)
+        if batch:
+            write(prefix + ',\n'.join(batch) + ';\n')
+    finally:
+        stream.close()
+    return count
+
+
+def create_dump(path, compresslevel=6):
+    """
+    Write a consistent, compressed dump of the whole database to ``path``.
+
+    Returns stats for the backup (also saved as its sidecar).
+    """
+    started = time.monotonic()
+    partial = path + '.partial'
+    stats = {'tables': 0, 'rows': 0, 'uncompressed_bytes': 0}
+
+    conn = get_dedicated_connection()
+    raw = conn._conn  # escaping and server-side cursors need the PyMySQL connection
+    try:
+        cursor = raw.cursor()
+        cursor.execute("SET time_zone = '+00:00'")
+        cursor.execute("SET TRANSACTION ISOLATION LEVEL REPEATABLE READ")
+        cursor.execute("START TRANSACTION WITH CONSISTENT SNAPSHOT")
+        cursor.execute("SELECT DATABASE()")
+        database = cursor.fetchone()[0]
+        cursor.execute("SHOW FULL TABLES WHERE Table_type = 'BASE TABLE'")
+        tables = [row[0] for row in cursor.fetchall()]
+        cursor.close()
+
+        with gzip.open(partial, 'wb', compresslevel=compresslevel) as out:
+            def write(text):
+                data = text.encode('utf-8')
+                out.write(data)
+                stats['uncompressed_bytes'] += len(data)
+
+            write(_HEADER.format(database=database, taken_at=datetime.now(timezone.utc).isoformat()))
+            for table in tables:
+                stats['rows'] += _dump_table(raw, table, write)
+                stats['tables'] += 1
+            write(_FOOTER)
+        os.replace(partial, path)
+    except BaseException:
+        if os.path.exists(partial):
+            os.remove(partial)
+        raise
+    finally:
+        try:
+            raw.cursor().execute("SET time_zone = @@GLOBAL.time_zone")
+        except Exception:
+            pass
+        conn.close()  # rolls back the snapshot transaction
+
+    stats['size_bytes'] = os.path.getsize(path)
+    stats['duration_seconds'] = round(time.monotonic() - started, 3)
+    write_metadata(path, stats)
+    logger.info(f"Backup {os.path.basename(path)}: {stats['tables']} tables, {stats['rows']} rows, "
+                f"{stats['size_bytes']} bytes in {stats['duration_seconds']}s")
+    return stats
+
+
+def restore_dump(path):
+    """Replay a dump made by create_dump() into the live database"""
+    started = time.monotonic()
+    statements = 0
+
+    conn = get_dedicated_connection()
+    raw = conn._conn
+    cursor = raw.cursor()
+    try:
+        with gzip.open(path, 'rt', encoding='utf-8') as dump:
+            pending = []
+            for line in dump:
+                if not pending and (line.startswith('--') or not line.strip()):
+                    continue
+                pending.append(line)
+                # Only statement ends finish a line with ';' (row lines end in ')' or '),')
+                if line.rstrip().endswith(';'):
+                    cursor.execute(''.join(pending))
+                    pending = []
+                    statements += 1
+        raw.commit()
+    finally:
+        try:
+            cursor.execute("SET FOREIGN_KEY_CHECKS = 1, UNIQUE_CHECKS = 1, time_zone = @@GLOBAL.time_zone")
+        except Exception:
+            pass
+        conn.close()
+
+    stats = {'statements': statements, 'duration_seconds': round(time.monotonic() - started, 3)}
+    logger.info(f"Restored {os.path.basename(path)}: {statements} statements in {stats['duration_seconds']}s")
+    return stats
+
+
+def write_metadata(path, stats):
+    with open(path + '.json', 'w') as f:
+        json.dump(stats, f)
+
+
+def read_metadata(path):
+    """Stats saved for a backup, or {} for backups taken without them"""
+    try:
+        with open(path + '.json') as f:
+            return json.load(f)
+    except (OSError, ValueError):
+        return {}
@@ -0,0 +1,96 @@
+# app/services/command_push.py
+"""
+Command Push
+============
+
+Gets queued sensor commands to a node without waiting for its next
+check-in. Two channels, both optional for the node:
+
+- Long-poll: a client holding GET /sensor-master/commands/<id>/wait is
+  woken as soon as a command is queued for that sensor.
+- Device wake-up: generated firmware listens for POST /command on its
+  discovery web server. The push carries no command data; the node just
+  checks in early and claims its commands the usual way. It must carry
+  the node's wake token (X-Wake-Token), an HMAC of the sensor id that the
+  node learns from its check-in response, so other LAN hosts cannot make
+  it check in; the firmware also spaces pushed check-ins a few seconds
+  apart.
+
+Waiters are woken in-process only. Long-polls also re-read the queue every
+few seconds, which covers commands queued by another worker process.
+"""
+
+import hashlib
+import hmac
+import threading
+import logging
+from concurrent.futures import ThreadPoolExecutor
+
+import requests
+
+logger = logging.getLogger(__name__)
+
+DEVICE_PUSH_TIMEOUT = 2.0
+DEVICE_PUSH_WORKERS = 4
+WAKE_TOKEN_LENGTH = 32  # Hex characters; the firmware buffer holds 32 + NUL
+
+
+class CommandPush:
+    """Per-sensor queue versions that long-polls wait on, plus device wake-ups"""
+
+    def __init__(self):
+        self.device_push = True
+        self.device_timeout = DEVICE_PUSH_TIMEOUT
+        self._versions = {}
+        self._cond = threading.Condition()
+        self._executor = None
+        self._executor_lock = threading.Lock()
+        self._secret = b''
+
+    def init_app(self, app):
+        self.device_push = app.config.get('COMMAND_PUSH_TO_DEVICE', True)
+        self.device_timeout = app.config.get('COMMAND_PUSH_TIMEOUT', DEVICE_PUSH_TIMEOUT)
+        self._secret = str(app.config.get('SECRET_KEY') or '').encode()
+
+    def wake_token(self, sensor_id):
+        """Token the node requires on POST /command (sent in its check-in response)"""
+        digest = hmac.new(self._secret, f'command-wake:{sensor_id}'.encode(), hashlib.sha256)
+        return digest.hexdigest()[:WAKE_TOKEN_LENGTH]
+
+    def version(self, sensor_id):
+        """Read before claiming commands, then pass to wait()"""
+        with self._cond:
+            return self._versions.get(sensor_id, 0)
+
+    def wait(self, sensor_id, since_version, timeout):
+        """Block until a command is queued for the sensor after since_version"""
+        with self._cond:
+            return self._cond.wait_for(
+                lambda: self._versions.get(sensor_id, 0) != since_version, timeout)
+
+    def notify(self, sensor_id, ip_address=None):
+        """A command was committed for sensor_id; wake its waiters and the node"""
+        with self._cond:
+            self._versions[sensor_id] = self._versions.get(sensor_id, 0) + 1
+            self._cond.notify_all()
+
+        if self.device_push and ip_address:
+            self._get_executor().submit(self._wake_device, sensor_id, ip_address)
+
+    def _get_executor(self):
+        with self._executor_lock:
+            if self._executor is None:
+                self._executor = ThreadPoolExecutor(max_workers=DEVICE_PUSH_WORKERS,
+                                                    thread_name_prefix='command-push')
+            return self._executor
+
+    def _wake_device(self, sensor_id, ip_address):
+        try:
+            requests.post(f'http://{ip_address}/command', timeout=self.device_timeout,
+                          headers={'X-Wake-Token': self.wake_token(sensor_id)})
+        except requests.RequestException as e:
+            # Older firmware or an unreachable node: the next check-in delivers it
+            logger.debug(f"Command wake-up for {sensor_id} at {ip_address} failed: {e}")
+
+
+command_push = CommandPush()
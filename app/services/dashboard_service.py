@@ -10,6 +10,14 @@ from datetime import datetime, timezone, timedelta
 from typing import Dict, List, Any, Optional
 from flask import current_app
 from app.db import get_connection
+from app.services.sensor_rollup_service import RESOLUTIONS, choose_resolution
+from app.services.sensor_retention_service import sensor_retention
+from app.utils.downsample import decimate_rows, fetch_series
+from app.services.widget_cache import widget_cache
+from app.services.saved_search_cache import saved_search_cache, MaterializedSearch
+from app.services.sensor_range_index import (
+    sensor_range_index, merge_spans, span_contains, spans_sql, MAX_SPANS_PER_QUERY
+)
 
 logger = logging.getLogger(__name__)
 
@@ -30,6 +38,19 @@ def _serialize_datetime(value):
     dt = _coerce_datetime(value)
     return dt.isoformat() if dt else None
 
+
+def series_count_query(metric_id, entry_ids, tf):
+    """COUNT matching a recorded_at metric series query, for fetch_series()"""
+    query = f'''
+        SELECT COUNT(*) AS total FROM EntryDataPoint
+        WHERE metric_id = ? AND entry_id IN ({','.join('?' * len(entry_ids))})
+    '''
+    params = [metric_id] + entry_ids
+    if tf:
+        query += ' AND recorded_at >= ?'
+        params.append(tf)
+    return query, params
+
 class DashboardService:
     """Service for aggregating dashboard data from various sources"""
     
@@ -43,6 +64,9 @@ class DashboardService:
         """
         Get entries matching a saved search
         
+        Results are memoized for the current request and kept up to date
+        incrementally between requests (see saved_search_cache).
+        
         Args:
             search_id: ID of the saved search
             ignore_limit: If True, return all matching entries regardless of result_limit setting
@@ -51,6 +75,17 @@ class DashboardService:
         Returns:
             Dict with entries and metadata
         """
+        key = (search_id, ignore_limit)
+        result = saved_search_cache.request_get(key)
+        if result is None:
+            result = DashboardService._evaluate_saved_search(search_id, ignore_limit)
+            if not result.get('error'):
+                saved_search_cache.request_put(key, result)
+        return result
+
+    @staticmethod
+    def _evaluate_saved_search(search_id: int, ignore_limit: bool) -> Dict[str, Any]:
+        """Serve a saved search from its cached match set, re-running it only when needed"""
         try:
             conn = DashboardService.get_db()
             cursor = conn.cursor()
@@ -64,163 +99,62 @@ class DashboardService:
             if not search:
                 return {'error': 'Saved search not found', 'entries': []}
             
-            # Check if this is a SQL mode search with custom SQL query
+            # Any edit to the search itself changes the signature and forces a reload
+            signature = tuple(sorted(dict(search).items()))
+            
             use_sql_mode = 'use_sql_mode' in search.keys() and search['use_sql_mode']
             custom_sql_query = search['custom_sql_query'].strip() if 'custom_sql_query' in search.keys() and search['custom_sql_query'] else ''
             
-            if use_sql_mode and custom_sql_query:
-                # Execute custom SQL query to get entry IDs
-                logger.info(f"Saved search {search_id} using custom SQL mode")
-                try:
-                    # Check if it's a full query or a WHERE clause fragment
-                    if 'SELECT' in custom_sql_query.upper():
-                        # Full query - execute as-is
-                        cursor.execute(custom_sql_query)
-                        id_rows = cursor.fetchall()
-                        entry_ids = [row[0] if isinstance(row, tuple) else row['id'] for row in id_rows]
-                    else:
-                        # WHERE clause fragment - build query
-                        id_query = f"""
-                            SELECT DISTINCT e.id 
-                            FROM Entry e
-                            LEFT JOIN EntryType et ON e.entry_type_id = et.id
-                            LEFT JOIN EntryRelationship er_from ON e.id = er_from.source_entry_id
-                            LEFT JOIN EntryRelationship er_to ON e.id = er_to.target_entry_id
-                            WHERE ({custom_sql_query})
-                        """
-                        cursor.execute(id_query)
-                        id_rows = cursor.fetchall()
-                        entry_ids = [row[0] for row in id_rows]
-                    
-                    logger.info(f"Custom SQL query returned {len(entry_ids)} entry IDs")
-                    
-                    if not entry_ids:
-                        return {
-                            'search_name': search['name'],
-                            'entries': [],
-                            'total_count': 0
-                        }
-                    
-                    # Now fetch full entry details for these IDs
-                    placeholders = ','.join(['?' for _ in entry_ids])
-                    detail_query = f"""
-                        SELECT e.*, et.singular_label as entry_type_label 
-                        FROM Entry e 
-                        JOIN EntryType et ON e.entry_type_id = et.id 
-                        WHERE e.id IN ({placeholders})
-                    """
-                    
-                    # Apply sorting
-                    sort_by = search['sort_by'] or 'created_desc'
-                    if sort_by == 'created_desc':
-                        detail_query += " ORDER BY e.created_at DESC"
-                    elif sort_by == 'created_asc':
-                        detail_query += " ORDER BY e.created_at ASC"
-                    elif sort_by == 'title_asc':
-                        detail_query += " ORDER BY e.title ASC"
-                    elif sort_by == 'title_desc':
-                        detail_query += " ORDER BY e.title DESC"
-                    
-                    # Apply result limit (unless ignore_limit is True)
-                    if not ignore_limit:
-                        limit = int(search['result_limit'] or 50)
-                        detail_query += f" LIMIT {limit}"
-                    
-                    cursor.execute(detail_query, entry_ids)
-                    rows = cursor.fetchall()
-                    
-                except Exception as sql_error:
-                    logger.error(f"Error executing custom SQL query: {sql_error}", exc_info=True)
-                    return {'error': f'SQL query error: {str(sql_error)}', 'entries': []}
-            else:
-                # Standard filter-based search
-                # Build the query based on search parameters
-                query = "SELECT e.*, et.singular_label as entry_type_label FROM Entry e JOIN EntryType et ON e.entry_type_id = et.id WHERE 1=1"
-                params = []
-                
-                # Apply filters
-                if search['search_term']:
-                    query += " AND (e.title LIKE ? OR e.description LIKE ?)"
-                    search_term = f"%{search['search_term']}%"
-                    params.extend([search_term, search_term])
-                
-                if search['type_filter']:
-                    query += " AND e.entry_type_id = ?"
-                    params.append(int(search['type_filter']))
-                
-                # Specific states filter (comma-separated list of states)
-                # mariadb3.Row objects don't have .get(), check for key existence
-                if 'specific_states' in search.keys() and search['specific_states']:
-                    states = [s.strip() for s in search['specific_states'].split(',') if s.strip()]
-                    if states:
-                        # Use case-insensitive comparison for state names
-                        state_conditions = ' OR '.join(['LOWER(e.status) = LOWER(?)' for _ in states])
-                        query += f" AND ({state_conditions})"
-                        params.extend(states)
-                elif search['status_filter']:
-                    # Only apply status_filter if specific_states is not set
-                    # status_filter is a category (active/inactive), not a state name
-                    # Need to join with EntryState to filter by category
-                    query += " AND EXISTS (SELECT 1 FROM EntryState es WHERE es.entry_type_id = e.entry_type_id AND LOWER(es.name) = LOWER(e.status) AND es.category = ?)"
-                    params.append(search['status_filter'])
-                
-                # Date range filter
-                if search['date_range']:
-                    now = datetime.now()
-                    if search['date_range'] == 'today':
-                        start_date = now.replace(hour=0, minute=0, second=0, microsecond=0)
-                        query += " AND e.created_at >= ?"
-                        params.append(start_date.isoformat())
-                    elif search['date_range'] == 'week':
-                        start_date = now - timedelta(days=7)
-                        query += " AND e.created_at >= ?"
-                        params.append(start_date.isoformat())
-                    elif search['date_range'] == 'month':
-                        start_date = now - timedelta(days=30)
-                        query += " AND e.created_at >= ?"
-                        params.append(start_date.isoformat())
-                
-                # Sorting
-                sort_by = search['sort_by'] or 'created_desc'
-                if sort_by == 'created_desc':
-                    query += " ORDER BY e.created_at DESC"
-                elif sort_by == 'created_asc':
-                    query += " ORDER BY e.created_at ASC"
-                elif sort_by == 'title_asc':
-                    query += " ORDER BY e.title ASC"
-                elif sort_by == 'title_desc':
-                    query += " ORDER BY e.title DESC"
-                
-                # Result limit (unless ignore_limit is True)
-                if not ignore_limit:
-                    limit = int(search['result_limit'] or 50)
-                    query += f" LIMIT {limit}"
-                
-                # Debug logging
-                logger.info(f"Saved search {search_id} query: {query}")
-                logger.info(f"Saved search {search_id} params: {params}")
-                
-                cursor.execute(query, params)
-                rows = cursor.fetchall()
+            if (use_sql_mode and custom_sql_query) or search['date_range']:
+                # Arbitrary SQL and "now"-relative filters can't be maintained per entry
+                cache_key = (search_id, ignore_limit, signature)
+                result = saved_search_cache.get_result(cache_key)
+                if result is None:
+                    result = DashboardService._run_saved_search(cursor, search, search_id, ignore_limit)
+                    if not result.get('error'):
+                        saved_search_cache.put_result(cache_key, result)
+                conn.close()
+                return result
             
-            entries = []
-            for row in rows:
-                entries.append({
-                    'id': row['id'],
-                    'title': row['title'],
-                    'description': row['description'],
-                    'status': row['status'],
-                    'entry_type_label': row['entry_type_label'],
-                    'created_at': row['created_at'],
-                    'intended_end_date': row['intended_end_date'],
-                    'actual_end_date': row['actual_end_date']
-                })
+            query, params = DashboardService._saved_search_filter(search)
+            materialized = saved_search_cache.get_materialized(search_id, signature)
+            if materialized is None:
+                token = saved_search_cache.load_token()
+                cursor.execute(query, params)
+                materialized = MaterializedSearch(
+                    signature, search['name'],
+                    [DashboardService._saved_search_entry(row) for row in cursor.fetchall()]
+                )
+                saved_search_cache.put_materialized(search_id, materialized, token)
+            else:
+                changed_ids = saved_search_cache.take_pending(materialized)
+                if changed_ids:
+                    # Re-check only the entries written since the last read
+                    ids = sorted(changed_ids)
+                    try:
+                        cursor.execute(
+                            query + f" AND e.id IN ({','.join('?' * len(ids))})",
+                            params + ids
+                        )
+                    except Exception:
+                        saved_search_cache.invalidate()
+                        raise
+                    saved_search_cache.apply_changes(
+                        materialized, changed_ids,
+                        [DashboardService._saved_search_entry(row) for row in cursor.fetchall()]
+                    )
+                    logger.debug(f"Saved search {search_id} re-checked {len(ids)} changed entries")
+            
+            sort_key, reverse = DashboardService._saved_search_sort(search)
+            entries = saved_search_cache.ordered_entries(materialized, sort_key, reverse)
+            if not ignore_limit:
+                entries = entries[:int(search['result_limit'] or 50)]
             
             conn.close()
             
             return {
                 'search_name': search['name'],
-                'entries': entries,
+                'entries': list(entries),
                 'total_count': len(entries)
             }
             
@@ -228,6 +162,182 @@ class DashboardService:
             logger.error(f"Error getting saved search entries: {e}", exc_info=True)
             return {'error': str(e), 'entries': []}
 
+    @staticmethod
+    def _saved_search_filter(search) -> tuple:
+        """Unsorted, unlimited query and params for a filter-based saved search"""
+        query = "SELECT e.*, et.singular_label as entry_type_label FROM Entry e JOIN EntryType et ON e.entry_type_id = et.id WHERE 1=1"
+        params = []
+        
+        # Apply filters
+        if search['search_term']:
+            query += " AND (e.title LIKE ? OR e.description LIKE ?)"
+            search_term = f"%{search['search_term']}%"
+            params.extend([search_term, search_term])
+        
+        if search['type_filter']:
+            query += " AND e.entry_type_id = ?"
+            params.append(int(search['type_filter']))
+        
+        # Specific states filter (comma-separated list of states)
+        # mariadb3.Row objects don't have .get(), check for key existence
+        if 'specific_states' in search.keys() and search['specific_states']:
+            states = [s.strip() for s in search['specific_states'].split(',') if s.strip()]
+            if states:
+                # Use case-insensitive comparison for state names
+                state_conditions = ' OR '.join(['LOWER(e.status) = LOWER(?)' for _ in states])
+                query += f" AND ({state_conditions})"
+                params.extend(states)
+        elif search['status_filter']:
+            # Only apply status_filter if specific_states is not set
+            # status_filter is a category (active/inactive), not a state name
+            # Need to join with EntryState to filter by category
+            query += " AND EXISTS (SELECT 1 FROM EntryState es WHERE es.entry_type_id = e.entry_type_id AND LOWER(es.name) = LOWER(e.status) AND es.category = ?)"
+            params.append(search['status_filter'])
+        
+        # Date range filter
+        if search['date_range']:
+            now = datetime.now()
+            if search['date_range'] == 'today':
+                start_date = now.replace(hour=0, minute=0, second=0, microsecond=0)
+                query += " AND e.created_at >= ?"
+                params.append(start_date.isoformat())
+            elif search['date_range'] == 'week':
+                start_date = now - timedelta(days=7)
+                query += " AND e.created_at >= ?"
+                params.append(start_date.isoformat())
+            elif search['date_range'] == 'month':
+                start_date = now - timedelta(days=30)
+                query += " AND e.created_at >= ?"
+                params.append(start_date.isoformat())
+        
+        return query, params
+
+    @staticmethod
+    def _saved_search_order(search) -> str:
+        """ORDER BY clause for a saved search's sort_by setting"""
+        sort_by = search['sort_by'] or 'created_desc'
+        if sort_by == 'created_desc':
+            return " ORDER BY e.created_at DESC"
+        elif sort_by == 'created_asc':
+            return " ORDER BY e.created_at ASC"
+        elif sort_by == 'title_asc':
+            return " ORDER BY e.title ASC"
+        elif sort_by == 'title_desc':
+            return " ORDER BY e.title DESC"
+        return ""
+
+    @staticmethod
+    def _saved_search_sort(search) -> tuple:
+        """(key, reverse) sorting cached entries the way _saved_search_order() does in SQL"""
+        sort_by = search['sort_by'] or 'created_desc'
+        if sort_by in ('created_desc', 'created_asc'):
+            return (lambda entry: str(entry['created_at'] or '')), sort_by == 'created_desc'
+        if sort_by in ('title_asc', 'title_desc'):
+            # MariaDB's default collation compares case-insensitively
+            return (lambda entry: (entry['title'] or '').lower()), sort_by == 'title_desc'
+        return (lambda entry: entry['id']), False
+
+    @staticmethod
+    def _saved_search_entry(row) -> Dict[str, Any]:
+        return {
+            'id': row['id'],
+            'title': row['title'],
+            'description': row['description'],
+            'status': row['status'],
+            'entry_type_label': row['entry_type_label'],
+            'created_at': row['created_at'],
+            'intended_end_date': row['intended_end_date'],
+            'actual_end_date': row['actual_end_date']
+        }
+
+    @staticmethod
+    def _run_saved_search(cursor, search, search_id: int, ignore_limit: bool) -> Dict[str, Any]:
+        """Run a saved search against the database (custom SQL or filters)"""
+        # Check if this is a SQL mode search with custom SQL query
+        use_sql_mode = 'use_sql_mode' in search.keys() and search['use_sql_mode']
+        custom_sql_query = search['custom_sql_query'].strip() if 'custom_sql_query' in search.keys() and search['custom_sql_query'] else ''
+        
+        if use_sql_mode and custom_sql_query:
+            # Execute custom SQL query to get entry IDs
+            logger.info(f"Saved search {search_id} using custom SQL mode")
+            try:
+                # Check if it's a full query or a WHERE clause fragment
+                if 'SELECT' in custom_sql_query.upper():
+                    # Full query - execute as-is
+                    cursor.execute(custom_sql_query)
+                    id_rows = cursor.fetchall()
+                    entry_ids = [row[0] if isinstance(row, tuple) else row['id'] for row in id_rows]
+                else:
+                    # WHERE clause fragment - build query
+                    id_query = f"""
+                        SELECT DISTINCT e.id 
+                        FROM Entry e
+                        LEFT JOIN EntryType et ON e.entry_type_id = et.id
+                        LEFT JOIN EntryRelationship er_from ON e.id = er_from.source_entry_id
+                        LEFT JOIN EntryRelationship er_to ON e.id = er_to.target_entry_id
+                        WHERE ({custom_sql_query})
+                    """
+                    cursor.execute(id_query)
+                    id_rows = cursor.fetchall()
+                    entry_ids = [row[0] for row in id_rows]
+                
+                logger.info(f"Custom SQL query returned {len(entry_ids)} entry IDs")
+                
+                if not entry_ids:
+                    return {
+                        'search_name': search['name'],
+                        'entries': [],
+                        'total_count': 0
+                    }
+                
+                # Now fetch full entry details for these IDs
+                placeholders = ','.join(['?' for _ in entry_ids])
+                detail_query = f"""
+                    SELECT e.*, et.singular_label as entry_type_label 
+                    FROM Entry e 
+                    JOIN EntryType et ON e.entry_type_id = et.id 
+                    WHERE e.id IN ({placeholders})
+                """
+                
+                # Apply sorting
+                detail_query += DashboardService._saved_search_order(search)
+                
+                # Apply result limit (unless ignore_limit is True)
+                if not ignore_limit:
+                    limit = int(search['result_limit'] or 50)
+                    detail_query += f" LIMIT {limit}"
+                
+                cursor.execute(detail_query, entry_ids)
+                rows = cursor.fetchall()
+                
+            except Exception as sql_error:
+                logger.error(f"Error executing custom SQL query: {sql_error}", exc_info=True)
+                return {'error': f'SQL query error: {str(sql_error)}', 'entries': []}
+        else:
+            # Standard filter-based search
+            query, params = DashboardService._saved_search_filter(search)
+            query += DashboardService._saved_search_order(search)
+            
+            # Result limit (unless ignore_limit is True)
+            if not ignore_limit:
+                limit = int(search['result_limit'] or 50)
+                query += f" LIMIT {limit}"
+            
+            # Debug logging
+            logger.info(f"Saved search {search_id} query: {query}")
+            logger.info(f"Saved search {search_id} params: {params}")
+            
+            cursor.execute(query, params)
+            rows = cursor.fetchall()
+        
+        entries = [DashboardService._saved_search_entry(row) for row in rows]
+        
+        return {
+            'search_name': search['name'],
+            'entries': entries,
+            'total_count': len(entries)
+        }
+
     @staticmethod
     def get_timeline_distribution(search_id: int, date_field: str, grouping: str = 'month') -> Dict[str, Any]:
         """
@@ -536,14 +646,20 @@ class DashboardService:
             return {'error': str(e), 'states': [], 'total': 0}
 
     @staticmethod
-    def get_sensor_data_trends(entry_ids: List[int], sensor_type: str, time_range: str = '7d') -> Dict[str, Any]:
+    def get_sensor_data_trends(entry_ids: List[int], sensor_type: str, time_range: str = '7d',
+                               max_points: int = 500) -> Dict[str, Any]:
         """
         Get sensor data trends for specified entries
         
+        Ranges long enough to fill the point budget are read from
+        SensorDataRollup (per-bucket min/max/avg/count); shorter ones, or
+        entries with no rollups yet, fall back to the raw readings.
+        
         Args:
             entry_ids: List of entry IDs to get sensor data for
             sensor_type: Type of sensor to retrieve
             time_range: Time range (1d, 7d, 30d, 90d, all)
+            max_points: Rough number of points the chart has room for
             
         Returns:
             Dict with sensor data time series
@@ -568,34 +684,68 @@ class DashboardService:
             elif time_range == '90d':
                 time_filter = (now - timedelta(days=90)).isoformat()
             
-            # Query sensor data (supporting both legacy and shared sensor data)
             placeholders = ','.join(['?' for _ in entry_ids])
+            
+            rollup = DashboardService._get_sensor_rollup_trends(
+                cursor, entry_ids, sensor_type, time_filter, now, max_points
+            )
+            if rollup is not None:
+                conn.close()
+                return rollup
+            
+            # Query sensor data (supporting both legacy and shared sensor data)
             rows = []
             
             # Try SensorDataEntryRanges first (for range-based sensor data)
-            query = f"""
-                SELECT ssd.sensor_type, ssd.value, ssd.recorded_at, sder.entry_id
-                FROM SharedSensorData ssd
-                JOIN SensorDataEntryRanges sder ON 
-                    ssd.sensor_type = sder.sensor_type 
-                    AND ssd.id BETWEEN sder.start_sensor_id AND sder.end_sensor_id
-                WHERE sder.entry_id IN ({placeholders})
-                AND ssd.sensor_type = ?
-            """
-            params = entry_ids + [sensor_type]
-            
-            if time_filter:
-                query += " AND ssd.recorded_at >= ?"
-                params.append(time_filter)
-            
-            query += " ORDER BY ssd.recorded_at ASC"
-            
-            logger.info(f"Sensor data query (ranges) for entries {entry_ids}, sensor {sensor_type}: {query}")
-            logger.info(f"Sensor data params: {params}")
-            
-            cursor.execute(query, params)
-            rows = cursor.fetchall()
-            logger.info(f"Sensor data ranges returned {len(rows)} rows")
+            entry_spans = sensor_range_index.entry_spans(cursor, entry_ids, sensor_type)
+            all_spans = merge_spans([span for spans in entry_spans.values() for span in spans])
+            if entry_spans and len(all_spans) <= MAX_SPANS_PER_QUERY:
+                # Primary key range scans over the cached spans, then attribute rows to entries
+                span_clause, params = spans_sql(all_spans)
+                query = f"""
+                    SELECT ssd.id, ssd.sensor_type, ssd.value, ssd.recorded_at
+                    FROM SharedSensorData ssd
+                    WHERE {span_clause}
+                    AND ssd.sensor_type = ?
+                """
+                params.append(sensor_type)
+                
+                if time_filter:
+                    query += " AND ssd.recorded_at >= ?"
+                    params.append(time_filter)
+                
+                query += " ORDER BY ssd.recorded_at ASC"
+                
+                cursor.execute(query, params)
+                for row in cursor.fetchall():
+                    for entry_id, spans in entry_spans.items():
+                        if span_contains(spans, row['id']):
+                            rows.append({**row, 'entry_id': entry_id})
+                logger.info(f"Sensor data ranges ({len(all_spans)} spans) returned {len(rows)} rows")
+            elif entry_spans:
+                query = f"""
+                    SELECT ssd.sensor_type, ssd.value, ssd.recorded_at, sder.entry_id
+                    FROM SharedSensorData ssd
+                    JOIN SensorDataEntryRanges sder ON 
+                        ssd.sensor_type = sder.sensor_type 
+                        AND ssd.id BETWEEN sder.start_sensor_id AND sder.end_sensor_id
+                    WHERE sder.entry_id IN ({placeholders})
+                    AND ssd.sensor_type = ?
+                """
+                params = entry_ids + [sensor_type]
+                
+                if time_filter:
+                    query += " AND ssd.recorded_at >= ?"
+                    params.append(time_filter)
+                
+                query += " ORDER BY ssd.recorded_at ASC"
+                
+                logger.info(f"Sensor data query (ranges) for entries {entry_ids}, sensor {sensor_type}: {query}")
+                logger.info(f"Sensor data params: {params}")
+                
+                cursor.execute(query, params)
+                rows = cursor.fetchall()
+                logger.info(f"Sensor data ranges returned {len(rows)} rows")
             
             # If no range data, try direct links (SensorDataEntryLinks)
             if not rows:
@@ -665,6 +815,9 @@ class DashboardService:
             
             conn.close()
             
+            if max_points and len(data_points) > max_points:
+                data_points = list(decimate_rows(data_points, len(data_points), max_points, 'timestamp', 'value'))
+            
             return {
                 'data_points': data_points,
                 'sensor_type': sensor_type,
@@ -675,6 +828,87 @@ class DashboardService:
             logger.error(f"Error getting sensor data trends: {e}", exc_info=True)
             return {'error': str(e), 'data_points': [], 'sensor_type': sensor_type}
 
+    @staticmethod
+    def _get_sensor_rollup_trends(cursor, entry_ids: List[int], sensor_type: str, time_filter: Optional[str],
+                                  now: datetime, max_points: int) -> Optional[Dict[str, Any]]:
+        """
+        Trend points from SensorDataRollup, or None to use the raw readings
+        
+        The resolution is the coarsest one that still gives the chart roughly
+        max_points / 4 points or more for the requested span.
+        """
+        placeholders = ','.join(['?' for _ in entry_ids])
+        
+        if time_filter:
+            since = datetime.fromisoformat(time_filter).strftime('%Y-%m-%d %H:%M:%S')
+            span_seconds = (now - datetime.fromisoformat(time_filter)).total_seconds()
+        else:
+            # 'all': measure the span from the oldest daily bucket
+            cursor.execute(f"""
+                SELECT MIN(bucket_start) AS first_bucket
+                FROM SensorDataRollup
+                WHERE entry_id IN ({placeholders}) AND sensor_type = ? AND resolution = ?
+            """, entry_ids + [sensor_type, RESOLUTIONS[-1]])
+            row = cursor.fetchone()
+            if not row or not row['first_bucket']:
+                return None
+            since = None
+            first_bucket = row['first_bucket']
+            if not isinstance(first_bucket, datetime):
+                first_bucket = datetime.fromisoformat(str(first_bucket))
+            span_seconds = (now.replace(tzinfo=None) - first_bucket).total_seconds()
+        
+        resolution = choose_resolution(span_seconds, max_points)
+        if resolution is None:
+            return None
+        # Finer tiers may have been pruned for older data
+        oldest = now.replace(tzinfo=None) - timedelta(seconds=span_seconds)
+        resolution = sensor_retention.covering_resolution(resolution, oldest, now.replace(tzinfo=None))
+        
+        query = f"""
+            SELECT entry_id, bucket_start, value_min, value_max, value_sum, value_count
+            FROM SensorDataRollup
+            WHERE entry_id IN ({placeholders}) AND sensor_type = ? AND resolution = ?
+        """
+        params = entry_ids + [sensor_type, resolution]
+        if since:
+            query += " AND bucket_start >= ?"
+            params.append(since)
+        query += " ORDER BY bucket_start ASC, entry_id ASC"
+        
+        cursor.execute(query, params)
+        rows = cursor.fetchall()
+        if not rows:
+            return None
+        
+        data_points = []
+        for row in rows:
+            bucket = row['bucket_start']
+            if not isinstance(bucket, datetime):
+                bucket = datetime.fromisoformat(str(bucket))
+            average = row['value_sum'] / row['value_count']
+            data_points.append({
+                'timestamp': bucket.replace(tzinfo=timezone.utc).isoformat(),
+                'value': round(average, 4),
+                'min': row['value_min'],
+                'max': row['value_max'],
+                'count': row['value_count'],
+                'value_str': f"{average:g}",
+                'entry_id': row['entry_id']
+            })
+        
+        logger.info(f"Sensor data rollups ({resolution}s) returned {len(data_points)} points for entries {entry_ids}")
+        
+        if len(data_points) > max_points:
+            data_points = list(decimate_rows(data_points, len(data_points), max_points, 'timestamp', 'value'))
+        
+        return {
+            'data_points': data_points,
+            'sensor_type': sensor_type,
+            'count': len(data_points),
+            'resolution': resolution
+        }
+
     @staticmethod
     def generate_ai_summary(search_id: int, widget_config: Dict[str, Any] = None, widget_id: int = None, force_refresh: bool = False) -> Dict[str, Any]:
         """
@@ -1212,11 +1446,13 @@ Please incorporate these specific instructions into your analysis and summary.""
         time_range: str = '30d',
         x_axis_type: str = 'recorded_at',
         x_axis_field: str = 'commenced_at',
+        max_points: Optional[int] = None,
     ) -> Dict[str, Any]:
         """
         Return multi-series chart data from EntryDataPoint for the given metrics
         and entry scope.  Response shape matches the /api/entry-metrics/chart-data
-        endpoint so the same JS renderer handles both.
+        endpoint so the same JS renderer handles both.  Time series longer than
+        max_points are LTTB-downsampled.
         """
         try:
             conn = DashboardService.get_db()
@@ -1274,8 +1510,8 @@ Please incorporate these specific instructions into your analysis and summary.""
                         q += ' AND edp.recorded_at >= ?'
                         params.append(tf)
                     q += ' ORDER BY edp.recorded_at ASC'
-                    cursor.execute(q, params)
-                    rows = cursor.fetchall()
+                    rows = fetch_series(conn, cursor, q, params,
+                                        series_count_query(mid, entry_ids, tf), max_points)
                     data_points = [
                         {'x': r['recorded_at'], 'y': r['value'],
                          'entry_id': r['entry_id'], 'entry_title': r['entry_title'],
@@ -1336,16 +1572,29 @@ Please incorporate these specific instructions into your analysis and summary.""
             return {'error': str(e), 'series': []}
 
     @staticmethod
-    def get_widget_data(widget: Dict[str, Any]) -> Dict[str, Any]:
+    def get_widget_data(widget: Dict[str, Any], use_cache: bool = True) -> Dict[str, Any]:
         """
         Get data for a specific widget based on its configuration
         
+        Results are served from the widget cache until the entries or sensor
+        types the widget reads from receive writes (see widget_cache).
+        
         Args:
             widget: Widget configuration dict or mariadb3.Row object
+            use_cache: Set False to recompute (the fresh result is still stored)
             
         Returns:
             Dict with widget data
         """
+        config = json.loads(widget['config'] if widget['config'] else '{}')
+        return widget_cache.get_or_compute(
+            widget, config, lambda: DashboardService._compute_widget_data(widget),
+            refresh=not use_cache
+        )
+
+    @staticmethod
+    def _compute_widget_data(widget: Dict[str, Any]) -> Dict[str, Any]:
+        """Compute a widget's data without consulting the cache"""
         # Handle both dict and mariadb3.Row objects
         widget_type = widget['widget_type']
         data_source_type = widget['data_source_type']
@@ -1406,7 +1655,8 @@ Please incorporate these specific instructions into your analysis and summary.""
                     entry_ids = config.get('entry_ids', [])
                     logger.info(f"Widget ID {widget.get('id')} - Line chart using {len(entry_ids)} entry IDs from config")
                 
-                result = DashboardService.get_sensor_data_trends(entry_ids, sensor_type, time_range)
+                max_points = int(config.get('max_points') or 500)
+                result = DashboardService.get_sensor_data_trends(entry_ids, sensor_type, time_range, max_points)
                 logger.info(f"Widget ID {widget.get('id')} - Sensor data returned {result.get('count', 0)} data points")
                 return result
             
@@ -1459,6 +1709,7 @@ Please incorporate these specific instructions into your analysis and summary.""
                     time_range=time_range,
                     x_axis_type=x_axis_type,
                     x_axis_field=x_axis_field,
+                    max_points=int(config.get('max_points') or 500),
                 )
 
             elif widget_type == 'entry_data_chart' and data_source_type == 'entry_relationship':
@@ -1584,6 +1835,7 @@ Please incorporate these specific instructions into your analysis and summary.""
                     time_range=time_range,
                     x_axis_type=x_axis_type,
                     x_axis_field=x_axis_field,
+                    max_points=int(config.get('max_points') or 500),
                 )
 
             return {'error': 'Unsupported widget type or data source'}
@@ -0,0 +1,184 @@
+# app/services/device_registry.py
+"""
+Device Registry Cache
+=====================
+
+Process-wide cache of what the sensor data hot path needs to know about a
+sensor_id: its RegisteredDevices settings, whether it has a
+SensorRegistration, its active auto-record entry links and its sensor
+mappings. These only change when someone edits a device, so the endpoints
+that do so call invalidate() / invalidate_device(), which bumps the shared
+'device_registry' version (app/cache_versions.py) so every process reloads.
+Entries also expire after a TTL to pick up changes made elsewhere (e.g. an
+entry going inactive).
+
+The time of the last stored sample is kept in memory too, so a push that is
+rate limited away costs no further reads. Storing is decided by
+claim_stored(), a conditional UPDATE of last_data_stored, so pushes handled
+by different processes can't both store within one polling interval.
+"""
+
+import threading
+import time
+import logging
+from collections import OrderedDict
+from datetime import datetime, timedelta, timezone
+
+from app.cache_versions import cache_versions
+
+logger = logging.getLogger(__name__)
+
+REGISTRY_TTL_SECONDS = 300
+REGISTRY_MAX_ENTRIES = 4096
+
+
+def parse_stored_timestamp(value):
+    """Parse a last_data_stored value into an aware datetime, or None"""
+    if not value:
+        return None
+    if isinstance(value, datetime):
+        parsed = value
+    else:
+        try:
+            parsed = datetime.fromisoformat(str(value).replace('Z', '+00:00'))
+        except ValueError as e:
+            logger.warning(f"Error parsing last_data_stored: {e}")
+            return None
+    if parsed.tzinfo is None:
+        parsed = parsed.replace(tzinfo=timezone.utc)
+    return parsed
+
+
+def _db_time(dt):
+    """UTC 'YYYY-MM-DD HH:MM:SS' for last_data_stored"""
+    return dt.astimezone(timezone.utc).strftime('%Y-%m-%d %H:%M:%S')
+
+
+class DeviceRegistry:
+    """LRU of sensor_id -> ingest settings, with last-stored times in memory"""
+
+    def __init__(self, ttl_seconds=REGISTRY_TTL_SECONDS, max_entries=REGISTRY_MAX_ENTRIES):
+        self.ttl_seconds = ttl_seconds
+        self.max_entries = max_entries
+        self._entries = OrderedDict()
+        self._lock = threading.Lock()
+
+    def get(self, cursor, sensor_id):
+        """
+        Cached registry entry for a sensor, loading it with ``cursor`` on a miss.
+
+        Returns None if the sensor is in neither RegisteredDevices nor
+        SensorRegistration (that answer is cached as well).
+        """
+        now = time.monotonic()
+        version = cache_versions.get('device_registry')
+        with self._lock:
+            cached = self._entries.get(sensor_id)
+            if cached is not None and cached[2] == version and now - cached[0] < self.ttl_seconds:
+                self._entries.move_to_end(sensor_id)
+                return cached[1]
+
+        entry = self._load(cursor, sensor_id)
+
+        with self._lock:
+            self._entries[sensor_id] = (now, entry, version)
+            self._entries.move_to_end(sensor_id)
+            while len(self._entries) > self.max_entries:
+                self._entries.popitem(last=False)
+        return entry
+
+    @staticmethod
+    def claim_stored(cursor, device_id, first_at, last_at, min_interval=0):
+        """
+        Move last_data_stored to last_at if it is at least min_interval seconds
+        before first_at, in the caller's transaction; returns whether it did.
+
+        The check is part of the UPDATE, so of two processes storing the same
+        device's samples only one wins. Call note_stored() after the commit.
+        """
+        cursor.execute('''
+            UPDATE RegisteredDevices SET last_data_stored = ?
+            WHERE id = ? AND (last_data_stored IS NULL OR last_data_stored <= ?)
+        ''', (_db_time(last_at), device_id, _db_time(first_at - timedelta(seconds=min_interval))))
+        return cursor.rowcount > 0
+
+    def note_stored(self, sensor_id, recorded_at):
+        """Record a committed last_data_stored without a reload"""
+        with self._lock:
+            cached = self._entries.get(sensor_id)
+            if cached is not None and cached[1] is not None and cached[1]['device_id'] is not None:
+                last = cached[1]['last_stored']
+                if last is None or recorded_at > last:
+                    cached[1]['last_stored'] = recorded_at
+
+    def invalidate(self, sensor_id):
+        """Drop one sensor after its registration or device record changed"""
+        with self._lock:
+            self._entries.pop(sensor_id, None)
+        cache_versions.bump_now('device_registry')
+
+    def invalidate_device(self, device_id):
+        """Drop the sensor backed by a RegisteredDevices row (device_api uses row ids)"""
+        with self._lock:
+            for sensor_id, (_, entry, _) in list(self._entries.items()):
+                if entry is not None and entry['device_id'] == device_id:
+                    del self._entries[sensor_id]
+        cache_versions.bump_now('device_registry')
+
+    def clear(self):
+        with self._lock:
+            self._entries.clear()
+
+    def _load(self, cursor, sensor_id):
+        cursor.execute('SELECT id, polling_interval, last_data_stored, polling_enabled FROM RegisteredDevices WHERE device_id = ?', (sensor_id,))
+        device = cursor.fetchone()
+
+        cursor.execute('SELECT id FROM SensorRegistration WHERE sensor_id = ?', (sensor_id,))
+        sensor_reg = cursor.fetchone()
+
+        if not device and not sensor_reg:
+            return None
+
+        entry = {
+            'sensor_id': sensor_id,
+            'has_registration': sensor_reg is not None,
+            'device_id': None,
+            'polling_interval': None,
+            'configured_interval': None,  # RegisteredDevices.polling_interval as stored (None = scheduler default)
+            'polling_enabled': False,
+            'last_stored': None,
+            'has_links': False,
+            'record_links': [],
+            'mappings': [],
+        }
+        if not device:
+            return entry
+
+        entry.update({
+            'device_id': device['id'],
+            'polling_interval': device['polling_interval'] or 30,
+            'configured_interval': device['polling_interval'],
+            'polling_enabled': bool(device['polling_enabled']),
+            'last_stored': parse_stored_timestamp(device['last_data_stored']),
+        })
+
+        # Get linked entries that are active
+        cursor.execute('''
+            SELECT del.entry_id, del.auto_record
+            FROM DeviceEntryLinks del
+            JOIN Entry e ON del.entry_id = e.id
+            WHERE del.device_id = ? AND e.status != 'inactive'
+        ''', (device['id'],))
+        links = cursor.fetchall()
+        entry['has_links'] = bool(links)
+        entry['record_links'] = [link['entry_id'] for link in links if link['auto_record']]
+
+        if links:
+            # Import inside function to avoid circular imports
+            from ..api.device_api import get_device_sensor_mappings
+            entry['mappings'] = get_device_sensor_mappings(device['id'], cursor)
+
+        return entry
+
+
+device_registry = DeviceRegistry()
@@ -11,19 +11,70 @@ with the Sensor Master Control system. The generated code includes:
 
 The code clearly separates these two modes so developers can customize each section
 based on their needs.
+
+Battery nodes can use the "deep_sleep" power profile instead: each wake samples,
+uploads a batch only when due, and goes back to deep sleep.
 """
 
+import hashlib
 import json
 import logging
+import time
 from datetime import datetime
+from functools import lru_cache
 from typing import Dict, List, Optional
 
+from .script_compiler import (
+    BYTECODE_VERSION, MAX_CONSTS, MAX_LOOP_REGISTERS, MAX_PROGRAM_BYTES,
+    MAX_STRINGS, firmware_opcode_enum, firmware_symbol_enum
+)
+from ..utils.firmware_patch import DEVICE_CONFIG_FIELDS, DEVICE_CONFIG_MAGIC, check_device_values
+
 logger = logging.getLogger(__name__)
 
+# "always_on" keeps Wi-Fi up and loops forever; "deep_sleep" duty-cycles
+POWER_PROFILES = ("always_on", "deep_sleep")
+
+# Samples a sleeping node collects before waking the radio early
+DEEP_SLEEP_UPLOAD_BATCH = 32
+
+# Firmware LOG_LEVEL values; anything above the chosen level compiles out
+LOG_LEVELS = {"none": 0, "error": 1, "warn": 2, "info": 3, "debug": 4}
+
+# Generated firmware is a static core, built once per process, plus a small
+# per-device config file the core includes. Single-file output inlines the
+# config file in place of the include line.
+CONFIG_FILES = {"arduino": "sensor_config.h", "micropython": "sensor_config.py"}
+CONFIG_INCLUDES = {
+    "arduino": '#include "sensor_config.h"\n',
+    "micropython": "from sensor_config import *\n",
+}
+CODE_OUTPUTS = ("sketch", "split", "header")
+
+# The host address lookup behind the default master URL is cached this long
+MASTER_URL_TTL_SECONDS = 300
+
+_FIELD_SIZES = dict(DEVICE_CONFIG_FIELDS)
+_MAGIC_LITERAL = DEVICE_CONFIG_MAGIC.rstrip(b'\x00').decode('ascii')
+
+
+def _string_literal(value: str) -> str:
+    """Quoted, escaped literal that is valid C++ and Python source alike"""
+    return json.dumps(value)
+
+
+@lru_cache(maxsize=None)
+def _core_hash(language: str, core: str) -> str:
+    return hashlib.sha256(core.encode('utf-8')).hexdigest()[:16]
+
 
 class ESP32CodeGenerator:
     """Generate ESP32 firmware code for sensor integration"""
     
+    # Shared by all instances - a generator is created per request
+    _master_url = None
+    _master_url_at = 0.0
+    
     def __init__(self, db_connection):
         """
         Initialize the code generator with database connection
@@ -36,7 +87,9 @@ class ESP32CodeGenerator:
     
     def generate_code(self, sensor_id: str = None, sensor_type: str = None, 
                      language: str = "arduino", wifi_ssid: str = "", 
-                     wifi_password: str = "", custom_config: Dict = None) -> Dict:
+                     wifi_password: str = "", custom_config: Dict = None,
+                     power_profile: str = None, log_level: str = None,
+                     output: str = "sketch") -> Dict:
         """
         Generate ESP32 code based on sensor configuration
         
@@ -47,34 +100,65 @@ class ESP32CodeGenerator:
             wifi_ssid: WiFi SSID for the code
             wifi_password: WiFi password for the code
             custom_config: Optional custom configuration
+            power_profile: "always_on" (default) or "deep_sleep" for battery nodes
+            log_level: Serial log level baked into Arduino builds (default "info",
+                       use "warn" or lower for production)
+            output: "sketch" (one file, config inlined), "split" (also the shared
+                    core on its own) or "header" (only the per-device config file,
+                    for a device whose core is already built or cached)
             
         Returns:
-            Dictionary with generated code and metadata
+            Dictionary with generated code and metadata. ``core_hash`` identifies
+            the core the config file belongs to.
         """
         try:
             # Get sensor configuration
-            config = self._get_sensor_config(sensor_id, sensor_type, custom_config)
+            config = dict(self._get_sensor_config(sensor_id, sensor_type, custom_config))
+            if power_profile:
+                config["power_profile"] = power_profile
+            config.setdefault("power_profile", "always_on")
+            if config["power_profile"] not in POWER_PROFILES:
+                return {"success": False, "error": f"Unsupported power profile: {config['power_profile']}"}
+            if config["power_profile"] != "always_on" and language.lower() != "arduino":
+                return {"success": False, "error": "The deep_sleep power profile is only available for Arduino"}
+            if log_level:
+                config["log_level"] = log_level
+            config.setdefault("log_level", "info")
+            if config["log_level"] not in LOG_LEVELS:
+                return {"success": False, "error": f"Unsupported log level: {config['log_level']}"}
+            if output not in CODE_OUTPUTS:
+                return {"success": False, "error": f"Unsupported output: {output}"}
             
             # Get master control URL
             master_url = self._get_master_url()
             
             # Generate code based on language
-            if language.lower() == "arduino":
-                code = self._generate_arduino_code(config, master_url, wifi_ssid, wifi_password)
-            elif language.lower() == "micropython":
-                code = self._generate_micropython_code(config, master_url, wifi_ssid, wifi_password)
+            language = language.lower()
+            if language == "arduino":
+                core = self._arduino_core()
+                header = self._arduino_config_header(config, master_url, wifi_ssid, wifi_password)
+            elif language == "micropython":
+                core = self._micropython_core()
+                header = self._micropython_config_module(config, master_url, wifi_ssid, wifi_password)
             else:
                 return {"error": f"Unsupported language: {language}"}
             
-            return {
+            result = {
                 "success": True,
-                "code": code,
                 "language": language,
                 "sensor_id": config.get("sensor_id"),
                 "sensor_type": config.get("sensor_type"),
                 "generated_at": datetime.now().isoformat(),
-                "configuration": config
+                "configuration": config,
+                "config_file": CONFIG_FILES[language],
+                "config_header": header,
+                "core_hash": _core_hash(language, core)
             }
+            if output != "header":
+                result["code"] = core.replace(CONFIG_INCLUDES[language], header, 1)
+            if output == "split":
+                result["core"] = core
+            return result
             
         except Exception as e:
             logger.error(f"Error generating ESP32 code: {e}", exc_info=True)
@@ -116,8 +200,43 @@ class ESP32CodeGenerator:
             "firmware_version": "1.1.0"
         }
     
+    def device_values(self, config: Dict, master_url: str, wifi_ssid: str,
+                      wifi_password: str) -> Dict:
+        """
+        Per-device settings, keyed like DEVICE_CONFIG_FIELDS
+
+        Raises FirmwarePatchError (a ValueError) if a value does not fit the
+        firmware's fixed-size device block.
+        """
+        values = {
+            "wifi_ssid": wifi_ssid or "YOUR_WIFI_SSID",
+            "wifi_password": wifi_password or "YOUR_WIFI_PASSWORD",
+            "master_url": master_url,
+            "sensor_id": config.get("sensor_id") or "esp32_sensor_001",
+            "sensor_type": config.get("sensor_type") or "esp32_generic",
+            "sensor_name": config.get("sensor_name") or "ESP32 Sensor",
+        }
+        check_device_values(values)
+        return values
+    
+    def registered_device_values(self, sensor_id: str, wifi_ssid: str = "",
+                                 wifi_password: str = "") -> Optional[Dict]:
+        """device_values() for a registered sensor, or None if it is not registered"""
+        config = self._get_sensor_config(sensor_id=sensor_id)
+        if config.get("sensor_id") != sensor_id:
+            return None
+        return self.device_values(config, self._get_master_url(), wifi_ssid, wifi_password)
+    
     def _get_master_url(self) -> str:
-        """Get the active master control URL"""
+        """Get the active master control URL (cached for MASTER_URL_TTL_SECONDS)"""
+        now = time.monotonic()
+        cls = type(self)
+        if cls._master_url is None or now - cls._master_url_at >= MASTER_URL_TTL_SECONDS:
+            cls._master_url = self._detect_master_url()
+            cls._master_url_at = now
+        return cls._master_url
+    
+    def _detect_master_url(self) -> str:
         try:
             # Try to detect the host IP address
             import socket
@@ -137,22 +256,64 @@ class ESP32CodeGenerator:
     
     def _generate_arduino_code(self, config: Dict, master_url: str, 
                                wifi_ssid: str, wifi_password: str) -> str:
-        """Generate Arduino C++ code"""
-        
-        sensor_id = config.get("sensor_id", "esp32_sensor_001")
-        sensor_type = config.get("sensor_type", "esp32_generic")
-        sensor_name = config.get("sensor_name", "ESP32 Sensor")
+        """Generate Arduino C++ code as a single sketch"""
+        header = self._arduino_config_header(config, master_url, wifi_ssid, wifi_password)
+        return self._arduino_core().replace(CONFIG_INCLUDES["arduino"], header, 1)
+    
+    def _arduino_config_header(self, config: Dict, master_url: str,
+                               wifi_ssid: str, wifi_password: str) -> str:
+        """sensor_config.h - everything in an Arduino build that differs per device"""
+        values = self.device_values(config, master_url, wifi_ssid, wifi_password)
+        power_profile = config.get("power_profile", "always_on")
+        deep_sleep = power_profile == "deep_sleep"
+        upload_batch = DEEP_SLEEP_UPLOAD_BATCH if deep_sleep else 1
+        log_level = LOG_LEVELS.get(config.get("log_level"), LOG_LEVELS["info"])
         
         return f'''/*
- * ESP32 Sensor with Master Control Integration
+ * sensor_config.h - per-device settings
  * Generated: {datetime.now().strftime('%Y-%m-%d %H:%M:%S')}
- * 
- * Sensor ID: {sensor_id}
- * Sensor Type: {sensor_type}
+ *
+ * Sensor ID: {values["sensor_id"]}
+ * Sensor Type: {values["sensor_type"]}
+ * Power profile: {power_profile}
+ *
+ * A prebuilt core binary must have the same build options. Its device
+ * settings can be rewritten without recompiling (app/utils/firmware_patch.py).
+ */
+#ifndef SENSOR_CONFIG_H
+#define SENSOR_CONFIG_H
+
+// Build options
+#define POWER_PROFILE_DEEP_SLEEP {1 if deep_sleep else 0}
+#define TELEMETRY_UPLOAD_BATCH {upload_batch}
+#ifndef LOG_LEVEL
+#define LOG_LEVEL {log_level}
+#endif
+
+// Device settings
+#define CFG_WIFI_SSID {_string_literal(values["wifi_ssid"])}
+#define CFG_WIFI_PASSWORD {_string_literal(values["wifi_password"])}
+#define CFG_MASTER_CONTROL_URL {_string_literal(values["master_url"])}
+#define CFG_SENSOR_ID {_string_literal(values["sensor_id"])}
+#define CFG_SENSOR_TYPE {_string_literal(values["sensor_type"])}
+#define CFG_SENSOR_NAME {_string_literal(values["sensor_name"])}
+
+#endif
+'''
+    
+    @staticmethod
+    @lru_cache(maxsize=None)
+    def _arduino_core() -> str:
+        """Arduino C++ firmware shared by every device; includes sensor_config.h"""
+        return f'''/*
+ * ESP32 Sensor with Master Control Integration
  * 
  * This code includes two distinct operating modes:
  * 1. OFFLINE MODE - Runs when master control is unavailable
  * 2. ONLINE MODE - Runs when connected to master control
+ *
+ * Device settings and build options (power profile, log level) are in
+ * sensor_config.h, so one build of this file serves a whole fleet.
  */
 
 #include <WiFi.h>
@@ -161,20 +322,43 @@ class ESP32CodeGenerator:
 #include <Preferences.h>
 #include <WebServer.h>
 #include "time.h"
+#include "mbedtls/base64.h"
+#include <LittleFS.h>
+#include "esp_sleep.h"
 
 // Web Server for Discovery
 WebServer server(80);
 
 // ============================================================================
-// CONFIGURATION - Modify these values for your setup
+// CONFIGURATION - Modify sensor_config.h for your setup
 // ============================================================================
 
-const char* WIFI_SSID = "{wifi_ssid or 'YOUR_WIFI_SSID'}";
-const char* WIFI_PASSWORD = "{wifi_password or 'YOUR_WIFI_PASSWORD'}";
-const char* MASTER_CONTROL_URL = "{master_url}";
-const char* SENSOR_ID = "{sensor_id}";
-const char* SENSOR_TYPE = "{sensor_type}";
-const char* SENSOR_NAME = "{sensor_name}";
+#include "sensor_config.h"
+
+// Device settings sit in one fixed-size block that starts with a marker, so
+// a built image can be re-targeted by rewriting it. The block is writable
+// on purpose: the compiler cannot fold values it does not know are fixed.
+struct DeviceConfig {{
+  char magic[{len(DEVICE_CONFIG_MAGIC)}];
+  char wifiSsid[{_FIELD_SIZES["wifi_ssid"]}];
+  char wifiPassword[{_FIELD_SIZES["wifi_password"]}];
+  char masterUrl[{_FIELD_SIZES["master_url"]}];
+  char sensorId[{_FIELD_SIZES["sensor_id"]}];
+  char sensorType[{_FIELD_SIZES["sensor_type"]}];
+  char sensorName[{_FIELD_SIZES["sensor_name"]}];
+}};
+
+__attribute__((used)) DeviceConfig deviceConfig = {{
+  "{_MAGIC_LITERAL}", CFG_WIFI_SSID, CFG_WIFI_PASSWORD, CFG_MASTER_CONTROL_URL,
+  CFG_SENSOR_ID, CFG_SENSOR_TYPE, CFG_SENSOR_NAME
+}};
+
+const char* const WIFI_SSID = deviceConfig.wifiSsid;
+const char* const WIFI_PASSWORD = deviceConfig.wifiPassword;
+const char* const MASTER_CONTROL_URL = deviceConfig.masterUrl;
+const char* const SENSOR_ID = deviceConfig.sensorId;
+const char* const SENSOR_TYPE = deviceConfig.sensorType;
+const char* const SENSOR_NAME = deviceConfig.sensorName;
 const char* FIRMWARE_VERSION = "1.1.0";
 
 // NTP Configuration
@@ -184,9 +368,77 @@ const int   daylightOffset_sec = 3600;
 
 // Timing configuration
 const unsigned long CHECK_IN_INTERVAL = 300000;     // 5 minutes
+const unsigned long MIN_WAKE_CHECK_IN_MS = 5000;    // Floor between pushed check-ins
 const unsigned long DATA_SEND_INTERVAL = 60000;     // 1 minute (default)
 const unsigned long CONNECTION_TIMEOUT = 10000;     // 10 seconds
 const unsigned long MASTER_RETRY_INTERVAL = 600000; // 10 minutes
+const unsigned long SCRIPT_RUN_INTERVAL = 1000;     // 1 second between script passes
+const unsigned long RESTART_DELAY = 1000;           // Grace period before a commanded restart
+const unsigned long HIBERNATION_TIMEOUT = 7200000;  // 2 hours - master marks sleepers offline after this
+
+// Power profile: 0 = always on, 1 = deep-sleep duty cycle (see SECTION 7)
+#ifndef POWER_PROFILE_DEEP_SLEEP
+#define POWER_PROFILE_DEEP_SLEEP 0
+#endif
+#define NTP_RESYNC_INTERVAL 86400      // Seconds between NTP syncs while duty-cycling
+#define SLEEP_SCRIPT_BUDGET 5000       // Max ms a script pass may keep the node awake
+
+// Telemetry buffering (see SECTION 6)
+#define TELEMETRY_RTC_CAPACITY 64      // Samples held in RTC RAM
+#ifndef TELEMETRY_UPLOAD_BATCH
+#define TELEMETRY_UPLOAD_BATCH 1       // Samples to collect before uploading (raise to save radio time)
+#endif
+#define TELEMETRY_CHUNK 8              // Samples per POST
+#define TELEMETRY_SPILL_MAX 32768      // Bytes per spill file - two files are kept
+#define PAYLOAD_MSGPACK 1              // Send telemetry, check-ins and logs as MessagePack (0 = JSON)
+
+// Serial logging: 0 = none, 1 = errors, 2 = warnings, 3 = info, 4 = debug
+// (per-instruction script traces). Use 2 or lower for production builds.
+#ifndef LOG_LEVEL
+#define LOG_LEVEL 3
+#endif
+
+// ============================================================================
+// LOGGING
+// ============================================================================
+// printf-style macros that format straight to the UART - no String
+// temporaries, so long uptimes do not fragment the heap. Messages above
+// LOG_LEVEL compile out together with their arguments and literals. The
+// literals already live in flash on ESP32, where F()/PROGMEM would only
+// change the pointer type.
+// ============================================================================
+
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARN 2
+#define LOG_LEVEL_INFO 3
+#define LOG_LEVEL_DEBUG 4
+
+// Disabled levels still type-check their format strings, then fold away
+#define LOG_DISCARD(fmt, ...) do {{ if (false) Serial.printf(fmt, ##__VA_ARGS__); }} while (0)
+
+#if LOG_LEVEL >= LOG_LEVEL_ERROR
+#define LOG_ERROR(fmt, ...) Serial.printf(fmt "\\n", ##__VA_ARGS__)
+#else
+#define LOG_ERROR(...) LOG_DISCARD(__VA_ARGS__)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_WARN
+#define LOG_WARN(fmt, ...) Serial.printf(fmt "\\n", ##__VA_ARGS__)
+#else
+#define LOG_WARN(...) LOG_DISCARD(__VA_ARGS__)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_INFO
+#define LOG_INFO(fmt, ...) Serial.printf(fmt "\\n", ##__VA_ARGS__)
+#else
+#define LOG_INFO(...) LOG_DISCARD(__VA_ARGS__)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(fmt, ...) Serial.printf(fmt "\\n", ##__VA_ARGS__)
+#else
+#define LOG_DEBUG(...) LOG_DISCARD(__VA_ARGS__)
+#endif
 
 // ============================================================================
 // GLOBAL STATE VARIABLES
@@ -197,17 +449,114 @@ enum OperatingMode {{
   MODE_ONLINE     // Operating with master control
 }};
 
+// Values the master configures are kept in RTC RAM while duty-cycling, so a
+// wake does not need a full config. They reset on power-on.
+#if POWER_PROFILE_DEEP_SLEEP
+#define SLEEP_RETAINED RTC_DATA_ATTR
+#else
+#define SLEEP_RETAINED
+#endif
+
 OperatingMode currentMode = MODE_OFFLINE;
 bool masterControlAvailable = false;
-String dataEndpoint = "";
-unsigned long pollingInterval = 60000;  // milliseconds
+char dataEndpoint[128] = "";           // Empty = no fallback endpoint
+SLEEP_RETAINED unsigned long pollingInterval = 60000;  // milliseconds
 unsigned long lastCheckIn = 0;
 unsigned long lastDataSend = 0;
 unsigned long lastMasterRetry = 0;
-unsigned long lastScriptCheck = 0;      // For script update checks
+SLEEP_RETAINED unsigned long checkInInterval = CHECK_IN_INTERVAL;  // Master can override
+SLEEP_RETAINED unsigned long hibernationTimeout = HIBERNATION_TIMEOUT;
+SLEEP_RETAINED char configHash[65] = "";  // Config applied (empty = send full config)
+unsigned long lastScriptRun = 0;
+bool scriptLoaded = false;              // Valid bytecode program in memory
+bool restartPending = false;
+unsigned long restartRequestedAt = 0;
+bool checkInRequested = false;           // Master pushed a command wake-up
+char wakeToken[33] = "";                // From check-in; required on POST /command
 
 Preferences preferences;
 
+// ============================================================================
+// HTTP CONNECTION MANAGER
+// ============================================================================
+// Every request shares one keep-alive connection, so a check-in reuses a
+// single TCP session instead of handshaking once per call. URLs and request
+// bodies are built in fixed buffers rather than with String concatenation.
+// Always read the response and call endRequest() before starting another.
+// ============================================================================
+
+WiFiClient httpSocket;
+HTTPClient http;
+char urlBuffer[192];
+char payloadBuffer[1536];
+char currentOrigin[96] = "";
+
+// Build "<MASTER_CONTROL_URL><path><suffix>" into the shared URL buffer
+const char* masterUrl(const char* path, const char* suffix = "") {{
+  snprintf(urlBuffer, sizeof(urlBuffer), "%s%s%s", MASTER_CONTROL_URL, path, suffix);
+  return urlBuffer;
+}}
+
+HTTPClient& beginRequest(const char* url, uint16_t timeoutMs = CONNECTION_TIMEOUT) {{
+  // The socket is only reusable for the same scheme://host:port - a custom
+  // data endpoint may live elsewhere
+  const char* hostStart = strstr(url, "://");
+  const char* pathStart = hostStart ? strchr(hostStart + 3, '/') : nullptr;
+  size_t originLen = pathStart ? (size_t)(pathStart - url) : strlen(url);
+  if (originLen >= sizeof(currentOrigin)) originLen = sizeof(currentOrigin) - 1;
+
+  if (strncmp(currentOrigin, url, originLen) != 0 || currentOrigin[originLen] != 0) {{
+    httpSocket.stop();
+    memcpy(currentOrigin, url, originLen);
+    currentOrigin[originLen] = 0;
+  }}
+
+  http.setReuse(true);
+  http.begin(httpSocket, url);
+  http.setTimeout(timeoutMs);
+  return http;
+}}
+
+// Serialize a document into the shared payload buffer and POST it
+int postJson(JsonDocument& doc) {{
+  if (measureJson(doc) >= sizeof(payloadBuffer)) return -1;  // Would be truncated
+  size_t len = serializeJson(doc, payloadBuffer, sizeof(payloadBuffer));
+  http.addHeader("Content-Type", "application/json");
+  return http.POST((uint8_t*)payloadBuffer, len);
+}}
+
+// Telemetry, check-ins and logs: the same document as MessagePack, which is
+// smaller on the wire and cheaper to produce. Registration stays JSON.
+int postSensorPayload(JsonDocument& doc) {{
+#if PAYLOAD_MSGPACK
+  if (measureMsgPack(doc) > sizeof(payloadBuffer)) return -1;  // Would be truncated
+  size_t len = serializeMsgPack(doc, payloadBuffer, sizeof(payloadBuffer));
+  http.addHeader("Content-Type", "application/msgpack");
+  return http.POST((uint8_t*)payloadBuffer, len);
+#else
+  return postJson(doc);
+#endif
+}}
+
+// Parse a JSON response straight off the socket rather than copying the body
+// into a String first. A chunked body (no Content-Length) still goes through
+// getString(), which strips the chunk framing.
+DeserializationError readJsonResponse(JsonDocument& doc, JsonDocument* filter = nullptr) {{
+  if (http.getSize() < 0) {{
+    String body = http.getString();
+    return filter ? deserializeJson(doc, body, DeserializationOption::Filter(*filter))
+                  : deserializeJson(doc, body);
+  }}
+  Stream& body = http.getStream();
+  return filter ? deserializeJson(doc, body, DeserializationOption::Filter(*filter))
+                : deserializeJson(doc, body);
+}}
+
+// Release the request; the socket stays open if the server allowed keep-alive
+void endRequest() {{
+  http.end();
+}}
+
 // ============================================================================
 // WEB SERVER HANDLERS (FOR DISCOVERY)
 // ============================================================================
@@ -219,8 +568,8 @@ void handleRoot() {{
   doc["type"] = SENSOR_TYPE;
   doc["uptime"] = millis() / 1000;
   
-  String response;
-  serializeJson(doc, response);
+  char response[200];
+  serializeJson(doc, response, sizeof(response));
   server.send(200, "application/json", response);
 }}
 
@@ -228,23 +577,36 @@ void handleApi() {{
   handleRoot(); // Same response for /api
 }}
 
+// The master POSTs here when it queues a command. The request carries no
+// command data: we check in early and claim commands the usual way. Only
+// requests with the wake token from our last check-in count.
+void handleCommandWake() {{
+  if (!wakeToken[0] || server.header("X-Wake-Token") != wakeToken) {{
+    server.send(403, "application/json", "{{\\"error\\":\\"invalid wake token\\"}}");
+    return;
+  }}
+  checkInRequested = true;
+  server.send(202, "application/json", "{{\\"status\\":\\"checking_in\\"}}");
+}}
+
 // ============================================================================
 // SETUP - INITIALIZATION
 // ============================================================================
 
 void setup() {{
   Serial.begin(115200);
-  Serial.println("\\n\\n===========================================");
-  Serial.println("ESP32 Sensor with Master Control");
-  Serial.println("===========================================");
-  Serial.println("Sensor ID: " + String(SENSOR_ID));
-  Serial.println("Sensor Type: " + String(SENSOR_TYPE));
-  Serial.println("Firmware: v" + String(FIRMWARE_VERSION));
-  Serial.println("===========================================\\n");
+  LOG_INFO("\\n\\n===========================================");
+  LOG_INFO("ESP32 Sensor with Master Control");
+  LOG_INFO("===========================================");
+  LOG_INFO("Sensor ID: %s", SENSOR_ID);
+  LOG_INFO("Sensor Type: %s", SENSOR_TYPE);
+  LOG_INFO("Firmware: v%s", FIRMWARE_VERSION);
+  LOG_INFO("===========================================\\n");
   
   // Initialize preferences (for persistent storage)
   preferences.begin("sensor", false);
   
+#if !POWER_PROFILE_DEEP_SLEEP
   // Connect to WiFi
   connectToWiFi();
   
@@ -254,41 +616,52 @@ void setup() {{
   // Initialize Web Server for Discovery
   server.on("/", handleRoot);
   server.on("/api", handleApi);
+  server.on("/command", HTTP_POST, handleCommandWake);
+  const char* wakeHeaders[] = {{"X-Wake-Token"}};
+  server.collectHeaders(wakeHeaders, 1);
   server.begin();
-  Serial.println("[WEB] Discovery server started on port 80");
+  LOG_INFO("[WEB] Discovery server started on port 80");
+#endif
   
   // Initialize sensor hardware
   initializeSensors();
   
+  // Buffered samples survive deep sleep in RTC RAM and outages on flash
+  initTelemetryBuffer();
+  
   // Load any saved configuration
   loadSavedConfiguration();
   
-  // Load saved script if available
-  String savedScript = preferences.getString("current_script", "");
-  if (savedScript.length() > 0) {{
-    String scriptVersion = preferences.getString("script_version", "unknown");
-    int scriptId = preferences.getInt("script_id", -1);
-    Serial.println("[STARTUP] 📜 Found saved script:");
-    Serial.println("  Version: " + scriptVersion);
-    Serial.println("  Script ID: " + String(scriptId));
+  // Load saved script program if available
+  if (loadSavedScript()) {{
+    char scriptVersion[32] = "";
+    preferences.getString("script_version", scriptVersion, sizeof(scriptVersion));
+    LOG_INFO("[STARTUP] 📜 Found saved script:");
+    LOG_INFO("  Version: %s", scriptVersion[0] ? scriptVersion : "unknown");
+    LOG_INFO("  Script ID: %d", preferences.getInt("script_id", -1));
   }}
   
+#if POWER_PROFILE_DEEP_SLEEP
+  // Battery profile: one duty cycle per wake, then back to sleep
+  runDutyCycle();
+#endif
+  
   // Attempt to register with master control
-  Serial.println("\\n[STARTUP] Attempting to connect to master control...");
+  LOG_INFO("\\n[STARTUP] Attempting to connect to master control...");
   if (registerWithMaster()) {{
     currentMode = MODE_ONLINE;
-    Serial.println("[STARTUP] Master control connected - Running in ONLINE mode");
-    getConfigFromMaster();
+    LOG_INFO("[STARTUP] Master control connected - Running in ONLINE mode");
     
-    // Check for script updates immediately after connecting
-    checkForScriptUpdates();
+    // Config, commands and script version in one round trip
+    performCheckIn();
+    lastCheckIn = millis();
   }} else {{
     currentMode = MODE_OFFLINE;
-    Serial.println("[STARTUP] Master control unavailable - Running in OFFLINE mode");
+    LOG_WARN("[STARTUP] Master control unavailable - Running in OFFLINE mode");
     useOfflineConfiguration();
   }}
   
-  Serial.println("\\n[STARTUP] Initialization complete\\n");
+  LOG_INFO("\\n[STARTUP] Initialization complete\\n");
 }}
 
 // ============================================================================
@@ -301,23 +674,25 @@ void loop() {{
 
   unsigned long currentTime = millis();
   
-  // Read sensor data
-  SensorData data = readSensorData();
-  
   // ========================================================================
   // DATA TRANSMISSION
   // ========================================================================
   if (currentTime - lastDataSend >= pollingInterval) {{
+    // Only sample sensors when the data is actually going somewhere
+    SensorData data = readSensorData();
+    
+    // Every sample is buffered first, so a failed send loses nothing
+    bufferSample(data);
     
     if (currentMode == MODE_ONLINE) {{
       // ====================================================================
-      // ONLINE MODE: Send data to master control endpoint
+      // ONLINE MODE: Upload buffered samples to master control
       // ====================================================================
-      if (dataEndpoint.length() > 0) {{
-        if (sendDataToMaster(data)) {{
-          Serial.println("[ONLINE] Data sent to master successfully");
+      if (telemetryPending() >= TELEMETRY_UPLOAD_BATCH) {{
+        if (uploadBufferedTelemetry()) {{
+          LOG_INFO("[ONLINE] Data sent to master successfully");
         }} else {{
-          Serial.println("[ONLINE] Failed to send data to master");
+          LOG_WARN("[ONLINE] Failed to send data to master - samples kept for retry");
           // Optionally fall back to offline mode on repeated failures
         }}
       }}
@@ -335,24 +710,17 @@ void loop() {{
   // ========================================================================
   // MASTER CONTROL CHECK-IN (ONLINE MODE ONLY)
   // ========================================================================
-  if (currentMode == MODE_ONLINE && currentTime - lastCheckIn >= CHECK_IN_INTERVAL) {{
-    Serial.println("\\n[ONLINE] Performing check-in with master control...");
-    
-    // Send heartbeat
-    if (sendHeartbeat()) {{
-      Serial.println("[ONLINE] Heartbeat sent successfully");
-      
-      // Check for configuration updates
-      getConfigFromMaster();
-      
-      // Check for script updates (every 30 seconds)
-      if (currentTime - lastScriptCheck >= 30000) {{
-        checkForScriptUpdates();
-        lastScriptCheck = currentTime;
-      }}
-      
+  // A pushed wake-up checks in at once (at most every MIN_WAKE_CHECK_IN_MS)
+  bool wakeDue = checkInRequested && currentTime - lastCheckIn >= MIN_WAKE_CHECK_IN_MS;
+  if (currentMode == MODE_ONLINE && (wakeDue || currentTime - lastCheckIn >= checkInInterval)) {{
+    LOG_INFO("\\n[ONLINE] Performing check-in with master control...");
+    checkInRequested = false;
+    
+    // Heartbeat out; config delta, commands and script version back
+    if (performCheckIn()) {{
+      LOG_INFO("[ONLINE] Check-in complete");
     }} else {{
-      Serial.println("[ONLINE] Heartbeat failed - master may be unavailable");
+      LOG_WARN("[ONLINE] Check-in failed - master may be unavailable");
       // Consider switching to offline mode after multiple failures
     }}
     
@@ -363,19 +731,31 @@ void loop() {{
   // MASTER CONTROL RETRY (OFFLINE MODE ONLY)
   // ========================================================================
   if (currentMode == MODE_OFFLINE && currentTime - lastMasterRetry >= MASTER_RETRY_INTERVAL) {{
-    Serial.println("\\n[OFFLINE] Retrying connection to master control...");
+    LOG_INFO("\\n[OFFLINE] Retrying connection to master control...");
     
     if (registerWithMaster()) {{
       currentMode = MODE_ONLINE;
-      Serial.println("[OFFLINE->ONLINE] Successfully connected to master control!");
-      getConfigFromMaster();
+      LOG_INFO("[OFFLINE->ONLINE] Successfully connected to master control!");
+      performCheckIn();
+      lastCheckIn = millis();
     }} else {{
-      Serial.println("[OFFLINE] Master still unavailable, continuing in offline mode");
+      LOG_WARN("[OFFLINE] Master still unavailable, continuing in offline mode");
     }}
     
     lastMasterRetry = currentTime;
   }}
   
+  // ========================================================================
+  // SCRIPT EXECUTION
+  // ========================================================================
+  // Scripts run cooperatively: each call advances until the next wait
+  stepScriptProgram();
+  
+  // Deferred restart, so the command is acknowledged before rebooting
+  if (restartPending && currentTime - restartRequestedAt >= RESTART_DELAY) {{
+    ESP.restart();
+  }}
+  
   // Small delay to prevent overwhelming the system
   delay(100);
 }}
@@ -388,70 +768,68 @@ void loop() {{
 // ============================================================================
 
 void useOfflineConfiguration() {{
-  Serial.println("\\n[OFFLINE MODE] Loading default configuration...");
+  LOG_INFO("\\n[OFFLINE MODE] Loading default configuration...");
   
   // Set default polling interval
   pollingInterval = 60000;  // 1 minute
   
   // Set fallback data endpoint (optional - can be empty for local-only operation)
-  dataEndpoint = String(MASTER_CONTROL_URL) + "/api/devices/data";
+  snprintf(dataEndpoint, sizeof(dataEndpoint), "%s/api/devices/data", MASTER_CONTROL_URL);
   
   // Load any saved configuration from previous online session
-  String savedEndpoint = preferences.getString("dataEndpoint", "");
-  if (savedEndpoint.length() > 0) {{
-    dataEndpoint = savedEndpoint;
-    Serial.println("[OFFLINE MODE] Using saved endpoint: " + dataEndpoint);
+  char savedEndpoint[sizeof(dataEndpoint)];
+  if (preferences.getString("dataEndpoint", savedEndpoint, sizeof(savedEndpoint)) > 0) {{
+    strlcpy(dataEndpoint, savedEndpoint, sizeof(dataEndpoint));
+    LOG_INFO("[OFFLINE MODE] Using saved endpoint: %s", dataEndpoint);
   }}
   
   unsigned long savedInterval = preferences.getULong("pollingInterval", 0);
   if (savedInterval > 0) {{
     pollingInterval = savedInterval;
-    Serial.println("[OFFLINE MODE] Using saved interval: " + String(pollingInterval/1000) + "s");
+    LOG_INFO("[OFFLINE MODE] Using saved interval: %lus", pollingInterval / 1000);
   }}
   
-  Serial.println("[OFFLINE MODE] Configuration loaded");
-  Serial.println("  - Polling Interval: " + String(pollingInterval/1000) + " seconds");
-  Serial.println("  - Data Endpoint: " + (dataEndpoint.length() > 0 ? dataEndpoint : "None (local only)"));
+  LOG_INFO("[OFFLINE MODE] Configuration loaded");
+  LOG_INFO("  - Polling Interval: %lu seconds", pollingInterval / 1000);
+  LOG_INFO("  - Data Endpoint: %s", dataEndpoint[0] ? dataEndpoint : "None (local only)");
 }}
 
 void handleDataOffline(SensorData data) {{
-  Serial.println("\\n[OFFLINE MODE] Processing sensor data...");
+  LOG_INFO("\\n[OFFLINE MODE] Processing sensor data...");
   
   // ====================================================================
   // CUSTOMIZE THIS SECTION FOR YOUR OFFLINE BEHAVIOR
   // ====================================================================
   
-  // Option 1: Log data locally to SD card or SPIFFS
-  // saveDataLocally(data);
+  // Option 1: Samples are already buffered (RTC RAM + LittleFS) by
+  // bufferSample() and uploaded once master control is reachable again
   
-  // Option 2: Send to a hardcoded fallback endpoint
-  if (dataEndpoint.length() > 0) {{
+  // Option 2: Send to a hardcoded fallback endpoint; a sample it accepts
+  // leaves the buffer so it is not uploaded again on reconnect
+  if (dataEndpoint[0]) {{
     if (sendDataToFallbackEndpoint(data)) {{
-      Serial.println("[OFFLINE MODE] Data sent to fallback endpoint");
+      dropNewestSample();
+      LOG_INFO("[OFFLINE MODE] Data sent to fallback endpoint");
     }} else {{
-      Serial.println("[OFFLINE MODE] Failed to send to fallback, storing locally");
-      // Store for later transmission
+      LOG_WARN("[OFFLINE MODE] Failed to send to fallback, kept in local buffer");
     }}
   }} else {{
-    Serial.println("[OFFLINE MODE] No endpoint configured, data logged only");
+    LOG_INFO("[OFFLINE MODE] No endpoint configured, data logged only");
   }}
   
   // Option 3: Display on local screen or indicator
   // displayDataLocally(data);
   
   // Print data for debugging
-  Serial.println("[OFFLINE MODE] Temperature: " + String(data.temperature) + "°C");
-  Serial.println("[OFFLINE MODE] Target: " + String(data.targetTemp) + "°C");
-  Serial.println("[OFFLINE MODE] Relay: " + String(data.relayState ? "ON" : "OFF"));
+  LOG_DEBUG("[OFFLINE MODE] Temperature: %.2f°C", data.temperature);
+  LOG_DEBUG("[OFFLINE MODE] Target: %.2f°C", data.targetTemp);
+  LOG_DEBUG("[OFFLINE MODE] Relay: %s", data.relayState ? "ON" : "OFF");
 }}
 
 bool sendDataToFallbackEndpoint(SensorData data) {{
-  if (dataEndpoint.length() == 0) return false;
+  if (!dataEndpoint[0]) return false;
   
-  HTTPClient http;
-  http.begin(dataEndpoint);
-  http.addHeader("Content-Type", "application/json");
-  http.setTimeout(CONNECTION_TIMEOUT);
+  beginRequest(dataEndpoint);
   
   StaticJsonDocument<512> doc;
   doc["device_id"] = SENSOR_ID;
@@ -466,11 +844,8 @@ bool sendDataToFallbackEndpoint(SensorData data) {{
   JsonObject relay = doc.createNestedObject("relay");
   relay["state"] = data.relayState ? "on" : "off";
   
-  String payload;
-  serializeJson(doc, payload);
-  
-  int httpCode = http.POST(payload);
-  http.end();
+  int httpCode = postJson(doc);
+  endRequest();
   
   return (httpCode == 200 || httpCode == 201);
 }}
@@ -483,18 +858,12 @@ bool sendDataToFallbackEndpoint(SensorData data) {{
 // ============================================================================
 
 bool registerWithMaster() {{
-  if (String(MASTER_CONTROL_URL).length() == 0 || 
-      String(MASTER_CONTROL_URL) == "YOUR_MASTER_URL") {{
-    Serial.println("[REGISTRATION] No master control URL configured");
+  if (MASTER_CONTROL_URL[0] == '\\0' || strcmp(MASTER_CONTROL_URL, "YOUR_MASTER_URL") == 0) {{
+    LOG_WARN("[REGISTRATION] No master control URL configured");
     return false;
   }}
   
-  HTTPClient http;
-  String url = String(MASTER_CONTROL_URL) + "/api/sensor-master/register";
-  
-  http.begin(url);
-  http.addHeader("Content-Type", "application/json");
-  http.setTimeout(CONNECTION_TIMEOUT);
+  beginRequest(masterUrl("/api/sensor-master/register"));
   
   StaticJsonDocument<768> doc;
   doc["sensor_id"] = SENSOR_ID;
@@ -502,212 +871,213 @@ bool registerWithMaster() {{
   doc["sensor_type"] = SENSOR_TYPE;
   doc["hardware_info"] = "ESP32-WROOM-32";
   doc["firmware_version"] = FIRMWARE_VERSION;
-  doc["ip_address"] = WiFi.localIP().toString();
-  doc["mac_address"] = WiFi.macAddress();
+  doc["ip_address"] = localIpString();
+  doc["mac_address"] = macAddressString();
   
   JsonArray capabilities = doc.createNestedArray("capabilities");
   capabilities.add("temperature");
   capabilities.add("relay_control");
   capabilities.add("target_temperature");
   
-  String payload;
-  serializeJson(doc, payload);
-  
-  int httpCode = http.POST(payload);
+  int httpCode = postJson(doc);
   
   if (httpCode == 200 || httpCode == 201) {{
-    String response = http.getString();
     StaticJsonDocument<512> responseDoc;
-    DeserializationError error = deserializeJson(responseDoc, response);
+    DeserializationError error = readJsonResponse(responseDoc);
+    endRequest();
     
     if (!error && responseDoc["status"] == "registered") {{
       masterControlAvailable = true;
-      Serial.println("[REGISTRATION] Successfully registered with: " + 
-                    String(responseDoc["assigned_master"].as<const char*>()));
-      http.end();
+      LOG_INFO("[REGISTRATION] Successfully registered with: %s",
+               responseDoc["assigned_master"] | "unknown");
       return true;
     }}
+  }} else {{
+    endRequest();
   }}
   
-  Serial.println("[REGISTRATION] Failed with HTTP code: " + String(httpCode));
+  LOG_WARN("[REGISTRATION] Failed with HTTP code: %d", httpCode);
   masterControlAvailable = false;
-  http.end();
   return false;
 }}
 
-bool getConfigFromMaster() {{
-  if (!masterControlAvailable) return false;
-  
-  HTTPClient http;
-  String url = String(MASTER_CONTROL_URL) + "/api/sensor-master/config/" + String(SENSOR_ID);
+void applyMasterConfig(JsonObject config) {{
+  if (config.containsKey("check_in_interval")) {{
+    checkInInterval = (config["check_in_interval"] | 5) * 60000UL;  // Minutes
+  }}
   
-  http.begin(url);
-  http.setTimeout(CONNECTION_TIMEOUT);
+  if (config.containsKey("hibernation_timeout_minutes")) {{
+    hibernationTimeout = (config["hibernation_timeout_minutes"] | 120) * 60000UL;
+  }}
   
-  int httpCode = http.GET();
+  if (config.containsKey("polling_interval")) {{
+    unsigned long newInterval = config["polling_interval"] | 60;
+    pollingInterval = newInterval * 1000;  // Convert to milliseconds
+    preferences.putULong("pollingInterval", pollingInterval);
+  }}
   
-  if (httpCode == 200) {{
-    String response = http.getString();
-    StaticJsonDocument<2048> doc;
-    DeserializationError error = deserializeJson(doc, response);
+  const char* endpoint = config["data_endpoint"];
+  if (endpoint) {{
+    strlcpy(dataEndpoint, endpoint, sizeof(dataEndpoint));
     
-    if (!error && doc["config_available"]) {{
-      // Update configuration from master
-      JsonObject config = doc["config"];
-      
-      unsigned long newInterval = config["polling_interval"] | 60;
-      pollingInterval = newInterval * 1000;  // Convert to milliseconds
-      
-      const char* endpoint = config["data_endpoint"];
-      if (endpoint) {{
-        dataEndpoint = String(endpoint);
-        
-        // Save configuration for offline mode
-        preferences.putString("dataEndpoint", dataEndpoint);
-        preferences.putULong("pollingInterval", pollingInterval);
-      }}
-      
-      Serial.println("[ONLINE MODE] Configuration updated:");
-      Serial.println("  - Polling Interval: " + String(pollingInterval/1000) + "s");
-      Serial.println("  - Data Endpoint: " + dataEndpoint);
-      
-      // Check for configuration changes
-      if (doc["config_changed"]) {{
-        Serial.println("[ONLINE MODE] Configuration has changed - applying updates");
-        // Apply any sensor-specific configuration here
-      }}
-      
-      // Process pending commands
-      JsonArray commands = doc["commands"];
-      if (commands.size() > 0) {{
-        processCommands(commands);
-      }}
-      
-      http.end();
-      return true;
-    }}
-  }} else {{
-    Serial.println("[ONLINE MODE] Failed to get config, HTTP code: " + String(httpCode));
+    // Save configuration for offline mode
+    preferences.putString("dataEndpoint", dataEndpoint);
   }}
   
-  http.end();
-  return false;
+  LOG_INFO("[ONLINE MODE] Configuration updated:");
+  LOG_INFO("  - Check-in Interval: %lumin", checkInInterval / 60000);
+  LOG_INFO("  - Polling Interval: %lus", pollingInterval / 1000);
+  LOG_INFO("  - Data Endpoint: %s", dataEndpoint);
 }}
 
-bool sendHeartbeat() {{
+bool performCheckIn() {{
   if (!masterControlAvailable) return false;
   
-  HTTPClient http;
-  String url = String(MASTER_CONTROL_URL) + "/api/sensor-master/heartbeat";
-  
-  http.begin(url);
-  http.addHeader("Content-Type", "application/json");
-  http.setTimeout(CONNECTION_TIMEOUT);
+  beginRequest(masterUrl("/api/sensor-master/checkin"));
   
   StaticJsonDocument<512> doc;
   doc["sensor_id"] = SENSOR_ID;
   doc["status"] = "online";
-  doc["ip_address"] = WiFi.localIP().toString();
+  doc["ip_address"] = localIpString();
+  doc["config_hash"] = configHash;
+  char scriptVersion[32] = "";
+  char scriptHash[24] = "";
+  if (scriptLoaded) {{
+    preferences.getString("script_version", scriptVersion, sizeof(scriptVersion));
+    preferences.getString("script_hash", scriptHash, sizeof(scriptHash));
+    doc["script_id"] = preferences.getInt("script_id", -1);
+    doc["script_version"] = scriptVersion;
+    if (scriptHash[0]) doc["script_hash"] = scriptHash;
+  }}
   
   JsonObject metrics = doc.createNestedObject("metrics");
   metrics["uptime"] = millis() / 1000;
   metrics["free_memory"] = ESP.getFreeHeap();
   metrics["wifi_rssi"] = WiFi.RSSI();
   
-  String payload;
-  serializeJson(doc, payload);
-  
-  int httpCode = http.POST(payload);
-  http.end();
-  
-  return (httpCode == 200);
-}}
-
-bool sendDataToMaster(SensorData data) {{
-  if (dataEndpoint.length() == 0) return false;
+  int httpCode = postSensorPayload(doc);
   
-  HTTPClient http;
-  http.begin(dataEndpoint);
-  http.addHeader("Content-Type", "application/json");
-  http.setTimeout(CONNECTION_TIMEOUT);
+  if (httpCode != 200) {{
+    endRequest();
+    LOG_WARN("[ONLINE MODE] Check-in failed, HTTP code: %d", httpCode);
+    if (httpCode == 404) {{
+      // Master no longer knows us - re-register on the offline retry path
+      masterControlAvailable = false;
+      currentMode = MODE_OFFLINE;
+    }}
+    return false;
+  }}
   
-  StaticJsonDocument<512> doc;
-  doc["device_id"] = SENSOR_ID;
-  doc["timestamp"] = millis();
-  doc["mode"] = "online";  // Indicate this is from online mode
+  StaticJsonDocument<2048> response;
+  DeserializationError error = readJsonResponse(response);
+  // Release the connection first - commands may issue requests of their own
+  endRequest();
+  if (error) return false;
   
-  JsonObject sensor = doc.createNestedObject("sensor");
-  sensor["temperature"] = data.temperature;
-  sensor["target"] = data.targetTemp;
-  sensor["valid"] = data.valid;
+  if (response["config_changed"] && !response["config"].isNull()) {{
+    applyMasterConfig(response["config"]);
+    strlcpy(configHash, response["config_hash"] | "", sizeof(configHash));
+  }}
   
-  JsonObject relay = doc.createNestedObject("relay");
-  relay["state"] = data.relayState ? "on" : "off";
+  if (response.containsKey("wake_token")) {{
+    strlcpy(wakeToken, response["wake_token"] | "", sizeof(wakeToken));
+  }}
   
-  String payload;
-  serializeJson(doc, payload);
+  JsonArray commands = response["commands"];
+  if (commands.size() > 0) {{
+    processCommands(commands);
+  }}
   
-  int httpCode = http.POST(payload);
-  http.end();
+  // Only download the script when the master says ours is stale
+  if (response["script"]["changed"]) {{
+    checkForScriptUpdates();
+  }}
   
-  return (httpCode == 200 || httpCode == 201);
+  return true;
+}}
+
+// Shared by the script VM and execute_script commands
+void writeOutputPin(uint8_t pin, bool high) {{
+  pinMode(pin, OUTPUT);
+  digitalWrite(pin, high ? HIGH : LOW);
+}}
+
+// Run the actions of an execute_script command (pin control from the
+// dashboard). Only the pin writes the script VM supports are accepted.
+void runCommandActions(JsonArray actions) {{
+  for (JsonObject action : actions) {{
+    const char* type = action["type"] | "";
+    int pin = action["pin"] | -1;
+    if (pin < 0) {{
+      LOG_WARN("[ONLINE MODE] Script action %s has no pin", type);
+      continue;
+    }}
+
+    if (strcmp(type, "gpio_write") == 0) {{
+      bool high = action["value"] | 0;
+      writeOutputPin(pin, high);
+      LOG_INFO("[ONLINE MODE] GPIO Write: Pin %d = %s", pin, high ? "HIGH" : "LOW");
+    }} else if (strcmp(type, "set_relay") == 0) {{
+      bool on = action["state"] | 0;
+      writeOutputPin(pin, on);
+      LOG_INFO("[ONLINE MODE] Relay: Pin %d %s", pin, on ? "ON" : "OFF");
+    }} else {{
+      LOG_WARN("[ONLINE MODE] Unsupported script action: %s", type);
+    }}
+  }}
 }}
 
 void processCommands(JsonArray commands) {{
-  Serial.println("\\n[ONLINE MODE] Processing " + String(commands.size()) + " command(s)...");
+  LOG_INFO("\\n[ONLINE MODE] Processing %u command(s)...", (unsigned)commands.size());
   
   for (JsonObject cmd : commands) {{
-    String commandType = cmd["command_type"];
+    const char* commandType = cmd["command_type"] | "";
     int commandId = cmd["id"];
     
-    Serial.println("[ONLINE MODE] Executing: " + commandType + " (ID: " + String(commandId) + ")");
+    LOG_INFO("[ONLINE MODE] Executing: %s (ID: %d)", commandType, commandId);
     
-    if (commandType == "update_config") {{
-      // Re-fetch configuration
-      getConfigFromMaster();
+    if (strcmp(commandType, "update_config") == 0) {{
+      // Force a full config on the next check-in
+      configHash[0] = '\\0';
+      lastCheckIn = millis() - checkInInterval;
       
-    }} else if (commandType == "restart") {{
-      Serial.println("[ONLINE MODE] Restarting ESP32...");
-      delay(1000);
-      ESP.restart();
+    }} else if (strcmp(commandType, "restart") == 0) {{
+      LOG_INFO("[ONLINE MODE] Restarting ESP32...");
+      restartPending = true;
+      restartRequestedAt = millis();
       
-    }} else if (commandType == "set_target_temp") {{
+    }} else if (strcmp(commandType, "set_target_temp") == 0) {{
       float newTarget = cmd["command_data"]["target"];
       setTargetTemperature(newTarget);
-      Serial.println("[ONLINE MODE] Target temperature set to: " + String(newTarget));
+      LOG_INFO("[ONLINE MODE] Target temperature set to: %.2f", newTarget);
       
-    }} else if (commandType == "switch_to_offline") {{
+    }} else if (strcmp(commandType, "switch_to_offline") == 0) {{
       // Force offline mode for testing or maintenance
       currentMode = MODE_OFFLINE;
       masterControlAvailable = false;
-      Serial.println("[ONLINE MODE] Switching to offline mode by command");
+      LOG_INFO("[ONLINE MODE] Switching to offline mode by command");
+      
+    }} else if (strcmp(commandType, "execute_script") == 0) {{
+      runCommandActions(cmd["command_data"]["actions"]);
       
     }} else {{
-      Serial.println("[ONLINE MODE] Unknown command type: " + commandType);
+      LOG_WARN("[ONLINE MODE] Unknown command type: %s", commandType);
     }}
   }}
 }}
 
-void sendRemoteLog(String message, String level) {{
-  if (currentMode != MODE_ONLINE || String(MASTER_CONTROL_URL).length() == 0) return;
-  
-  HTTPClient http;
-  String url = String(MASTER_CONTROL_URL) + "/api/sensor-master/logs";
+void sendRemoteLog(const char* message, const char* level) {{
+  if (currentMode != MODE_ONLINE || MASTER_CONTROL_URL[0] == '\\0') return;
   
-  http.begin(url);
-  http.addHeader("Content-Type", "application/json");
-  http.setTimeout(1000); // Short timeout
+  beginRequest(masterUrl("/api/sensor-master/logs"), 1000); // Short timeout
   
   StaticJsonDocument<256> doc;
   doc["sensor_id"] = SENSOR_ID;
   doc["message"] = message;
   doc["level"] = level;
   
-  String payload;
-  serializeJson(doc, payload);
-  
-  http.POST(payload);
-  http.end();
+  postSensorPayload(doc);
+  endRequest();
 }}
 
 // ============================================================================
@@ -724,7 +1094,7 @@ struct SensorData {{
 }};
 
 void initializeSensors() {{
-  Serial.println("[HARDWARE] Initializing sensors...");
+  LOG_INFO("[HARDWARE] Initializing sensors...");
   
   // ====================================================================
   // CUSTOMIZE THIS SECTION FOR YOUR HARDWARE
@@ -739,7 +1109,7 @@ void initializeSensors() {{
   
   // Initialize any other sensors or actuators
   
-  Serial.println("[HARDWARE] Sensors initialized");
+  LOG_INFO("[HARDWARE] Sensors initialized");
 }}
 
 SensorData readSensorData() {{
@@ -769,7 +1139,7 @@ void setTargetTemperature(float temp) {{
   // CUSTOMIZE THIS SECTION FOR YOUR CONTROL LOGIC
   // ====================================================================
   
-  Serial.println("[HARDWARE] Setting target temperature to: " + String(temp));
+  LOG_INFO("[HARDWARE] Setting target temperature to: %.2f", temp);
   // Implement your target temperature control logic here
 }}
 
@@ -778,7 +1148,7 @@ void setTargetTemperature(float temp) {{
 // ============================================================================
 
 void connectToWiFi() {{
-  Serial.println("[WIFI] Connecting to: " + String(WIFI_SSID));
+  LOG_INFO("[WIFI] Connecting to: %s", WIFI_SSID);
   
   WiFi.mode(WIFI_STA);
   WiFi.begin(WIFI_SSID, WIFI_PASSWORD);
@@ -786,383 +1156,837 @@ void connectToWiFi() {{
   int attempts = 0;
   while (WiFi.status() != WL_CONNECTED && attempts < 30) {{
     delay(500);
-    Serial.print(".");
     attempts++;
   }}
   
   if (WiFi.status() == WL_CONNECTED) {{
-    Serial.println("\\n[WIFI] Connected!");
-    Serial.println("[WIFI] IP Address: " + WiFi.localIP().toString());
-    Serial.println("[WIFI] MAC Address: " + WiFi.macAddress());
-    Serial.println("[WIFI] RSSI: " + String(WiFi.RSSI()) + " dBm");
+    LOG_INFO("[WIFI] Connected after %d attempt(s)!", attempts);
+    LOG_INFO("[WIFI] IP Address: %s", localIpString());
+    LOG_INFO("[WIFI] MAC Address: %s", macAddressString());
+    LOG_INFO("[WIFI] RSSI: %d dBm", WiFi.RSSI());
   }} else {{
-    Serial.println("\\n[WIFI] Connection failed! Running in offline mode.");
+    LOG_WARN("[WIFI] Connection failed! Running in offline mode.");
   }}
 }}
 
+// Dotted-quad local IP in a static buffer, instead of an IPAddress::toString() String
+const char* localIpString() {{
+  static char ip[16];
+  IPAddress addr = WiFi.localIP();
+  snprintf(ip, sizeof(ip), "%u.%u.%u.%u", addr[0], addr[1], addr[2], addr[3]);
+  return ip;
+}}
+
+const char* macAddressString() {{
+  static char mac[18];
+  uint8_t raw[6];
+  WiFi.macAddress(raw);
+  snprintf(mac, sizeof(mac), "%02X:%02X:%02X:%02X:%02X:%02X",
+           raw[0], raw[1], raw[2], raw[3], raw[4], raw[5]);
+  return mac;
+}}
+
 void loadSavedConfiguration() {{
   // Load any configuration saved from previous sessions
-  Serial.println("[CONFIG] Loading saved configuration...");
+  LOG_INFO("[CONFIG] Loading saved configuration...");
   
-  String savedEndpoint = preferences.getString("dataEndpoint", "");
-  if (savedEndpoint.length() > 0) {{
-    Serial.println("[CONFIG] Found saved endpoint: " + savedEndpoint);
+  char savedEndpoint[sizeof(dataEndpoint)];
+  if (preferences.getString("dataEndpoint", savedEndpoint, sizeof(savedEndpoint)) > 0) {{
+    LOG_INFO("[CONFIG] Found saved endpoint: %s", savedEndpoint);
   }}
   
   unsigned long savedInterval = preferences.getULong("pollingInterval", 0);
   if (savedInterval > 0) {{
-    Serial.println("[CONFIG] Found saved interval: " + String(savedInterval/1000) + "s");
+    LOG_INFO("[CONFIG] Found saved interval: %lus", savedInterval / 1000);
   }}
 }}
 
 // ============================================================================
-// SECTION 5: JSON SCRIPT INTERPRETER
+// SECTION 5: SCRIPT BYTECODE INTERPRETER
 // ============================================================================
-// Executes JSON command scripts downloaded from master control
+// Master control compiles JSON scripts into a compact opcode stream with every
+// operand pre-resolved (see app/services/script_compiler.py). The interpreter
+// runs that stream directly - no JSON parsing and no String allocation.
 // ============================================================================
 
-// Forward declarations
-void executeActions(JsonArray actions);
-
-float resolveValue(String key) {{
-  // Check if it's a number
-  if (key.length() == 0) return 0;
-  if (isdigit(key[0]) || key[0] == '-') return key.toFloat();
-  
-  // Check for sensor variables
-  if (key == "sensor.temp") {{
-    return readSensorData().temperature;
-  }} else if (key == "sensor.target") {{
-    return readSensorData().targetTemp;
-  }} else if (key == "sensor.relay") {{
-    return readSensorData().relayState ? 1.0 : 0.0;
-  }} else if (key == "current_time") {{
-    struct tm timeinfo;
-    if(!getLocalTime(&timeinfo)){{
-        return -1.0;
-    }}
-    return (timeinfo.tm_hour * 100) + timeinfo.tm_min;
-  }} else if (key == "wifi_rssi") {{
-    return (float)WiFi.RSSI();
-  }} else if (key == "free_heap") {{
-    return (float)ESP.getFreeHeap();
-  }} else if (key == "uptime") {{
-    return (float)(millis() / 1000);
-  }} else if (key == "millis") {{
-    return (float)millis();
+#define SCRIPT_BC_VERSION {BYTECODE_VERSION}
+#define SCRIPT_MAX_BYTES {MAX_PROGRAM_BYTES}
+#define SCRIPT_MAX_CONSTS {MAX_CONSTS}
+#define SCRIPT_MAX_STRINGS {MAX_STRINGS}
+#define SCRIPT_LOOP_REGS {MAX_LOOP_REGISTERS}
+#define SCRIPT_STEP_BUDGET 64       // Instructions per loop() slice before yielding
+#define SCRIPT_LOG_BUFFER 192
+
+enum ScriptOp : uint8_t {{
+{firmware_opcode_enum()}
+}};
+
+enum OperandTag : uint8_t {{
+  TAG_CONST = 0,
+  TAG_SYM = 1
+}};
+
+// Runtime values, resolved from key names by the server-side compiler
+enum ScriptSymbol : uint8_t {{
+{firmware_symbol_enum()}
+}};
+
+uint8_t scriptProgram[SCRIPT_MAX_BYTES];
+float scriptConsts[SCRIPT_MAX_CONSTS];
+uint8_t scriptConstCount = 0;
+const char* scriptStrings[SCRIPT_MAX_STRINGS];
+uint8_t scriptStringCount = 0;
+const uint8_t* scriptCode = nullptr;
+uint16_t scriptCodeLen = 0;
+uint16_t scriptLoopCounters[SCRIPT_LOOP_REGS];
+
+// Sensor snapshot shared by every operand until the script next waits
+SensorData scriptSensors;
+bool scriptSensorsValid = false;
+
+// Cooperative execution state - one pass spans many loop() iterations
+uint16_t scriptPc = 0;
+bool scriptRunning = false;
+unsigned long scriptWaitStart = 0;
+unsigned long scriptWaitMs = 0;
+
+static inline uint16_t readU16(const uint8_t* p) {{
+  return (uint16_t)p[0] | ((uint16_t)p[1] << 8);
+}}
+
+static inline uint32_t readU32(const uint8_t* p) {{
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}}
+
+// Validate a compiled program and index its constant and string pools.
+// The program lives in scriptProgram so the string pointers stay valid.
+bool loadScriptProgram(const uint8_t* data, size_t len) {{
+  scriptLoaded = false;
+  scriptRunning = false;
+  if (len < 8 || len > SCRIPT_MAX_BYTES) return false;
+  if (data[0] != 'S' || data[1] != 'B' || data[2] != SCRIPT_BC_VERSION) {{
+    LOG_ERROR("[SCRIPT] ❌ Unsupported bytecode format");
+    return false;
   }}
-  
-  // Check for GPIO (format: gpio.12)
-  if (key.startsWith("gpio.")) {{
-    int pin = key.substring(5).toInt();
-    pinMode(pin, INPUT);
-    return digitalRead(pin);
+
+  if (data != scriptProgram) memcpy(scriptProgram, data, len);
+
+  size_t pos = 4;
+  scriptConstCount = scriptProgram[pos++];
+  if (scriptConstCount > SCRIPT_MAX_CONSTS || pos + scriptConstCount * 4 > len) return false;
+  for (uint8_t i = 0; i < scriptConstCount; i++) {{
+    memcpy(&scriptConsts[i], &scriptProgram[pos], sizeof(float));
+    pos += 4;
+  }}
+
+  if (pos >= len) return false;
+  scriptStringCount = scriptProgram[pos++];
+  if (scriptStringCount > SCRIPT_MAX_STRINGS) return false;
+  for (uint8_t i = 0; i < scriptStringCount; i++) {{
+    if (pos >= len) return false;
+    uint8_t strLen = scriptProgram[pos++];
+    if (pos + strLen + 1 > len || scriptProgram[pos + strLen] != 0) return false;
+    scriptStrings[i] = (const char*)&scriptProgram[pos];
+    pos += strLen + 1;
+  }}
+
+  if (pos + 2 > len) return false;
+  scriptCodeLen = readU16(&scriptProgram[pos]);
+  pos += 2;
+  // Every program ends with OP_END, so instruction reads never run past the code
+  if (scriptCodeLen == 0 || pos + scriptCodeLen > len || scriptProgram[pos + scriptCodeLen - 1] != OP_END) return false;
+  scriptCode = &scriptProgram[pos];
+
+  scriptLoaded = true;
+  return true;
+}}
+
+bool loadSavedScript() {{
+  size_t len = preferences.getBytesLength("script_bc");
+  if (len == 0 || len > SCRIPT_MAX_BYTES) return false;
+  preferences.getBytes("script_bc", scriptProgram, len);
+  return loadScriptProgram(scriptProgram, len);
+}}
+
+const SensorData& scriptSensorSnapshot() {{
+  if (!scriptSensorsValid) {{
+    scriptSensors = readSensorData();
+    scriptSensorsValid = true;
+  }}
+  return scriptSensors;
+}}
+
+float resolveSymbol(uint8_t symbol, uint8_t arg) {{
+  switch (symbol) {{
+    case SYM_SENSOR_TEMP: return scriptSensorSnapshot().temperature;
+    case SYM_SENSOR_TARGET: return scriptSensorSnapshot().targetTemp;
+    case SYM_SENSOR_RELAY: return scriptSensorSnapshot().relayState ? 1.0 : 0.0;
+    case SYM_CURRENT_TIME: {{
+      struct tm timeinfo;
+      if (!getLocalTime(&timeinfo, 0)) return -1.0;
+      return (timeinfo.tm_hour * 100) + timeinfo.tm_min;
+    }}
+    case SYM_WIFI_RSSI: return (float)WiFi.RSSI();
+    case SYM_FREE_HEAP: return (float)ESP.getFreeHeap();
+    case SYM_UPTIME: return (float)(millis() / 1000);
+    case SYM_MILLIS: return (float)millis();
+    case SYM_GPIO:
+      pinMode(arg, INPUT);
+      return digitalRead(arg);
   }}
-  
   return 0; // Default
 }}
 
-bool evaluateCondition(String leftStr, String op, String rightStr) {{
-  float left = resolveValue(leftStr);
-  float right = resolveValue(rightStr);
-  
-  if (op == "==") return left == right;
-  if (op == "!=") return left != right;
-  if (op == ">") return left > right;
-  if (op == "<") return left < right;
-  if (op == ">=") return left >= right;
-  if (op == "<=") return left <= right;
-  
+float readOperand(const uint8_t* op) {{
+  switch (op[0]) {{
+    case TAG_CONST: return op[1] < scriptConstCount ? scriptConsts[op[1]] : 0;
+    case TAG_SYM: return resolveSymbol(op[1], op[2]);
+  }}
+  return 0;
+}}
+
+bool compareValues(uint8_t cmp, float left, float right) {{
+  switch (cmp) {{
+    case 0: return left == right;
+    case 1: return left != right;
+    case 2: return left > right;
+    case 3: return left < right;
+    case 4: return left >= right;
+    case 5: return left <= right;
+  }}
   return false;
 }}
 
-void executeActions(JsonArray actions) {{
-  for (JsonObject action : actions) {{
-    String type = action["type"] | "";
-    
-    if (type == "if") {{
-      JsonObject condition = action["condition"];
-      String left = condition["left"] | "0";
-      String op = condition["operator"] | "==";
-      String right = condition["right"] | "0";
-      
-      bool result = evaluateCondition(left, op, right);
-      Serial.println("  ❓ IF " + left + " " + op + " " + right + " (" + String(resolveValue(left)) + " vs " + String(resolveValue(right)) + ") -> " + String(result ? "TRUE" : "FALSE"));
-      
-      if (result) {{
-        if (action.containsKey("then")) {{
-            Serial.println("  ➡️ Executing THEN block");
-            executeActions(action["then"]);
-        }}
-      }} else {{
-        if (action.containsKey("else")) {{
-            Serial.println("  ➡️ Executing ELSE block");
-            executeActions(action["else"]);
+// Append a number the way the JSON interpreter printed it (no trailing ".00")
+size_t appendValue(char* buf, size_t pos, size_t size, float value) {{
+  if (pos >= size - 1) return pos;
+  int written;
+  if (value == (float)(long)value) written = snprintf(buf + pos, size - pos, "%ld", (long)value);
+  else written = snprintf(buf + pos, size - pos, "%.2f", value);
+  if (written < 0) return pos;
+  pos += written;
+  return pos < size - 1 ? pos : size - 1;
+}}
+
+size_t appendText(char* buf, size_t pos, size_t size, const char* text) {{
+  while (*text && pos < size - 1) buf[pos++] = *text++;
+  buf[pos] = 0;
+  return pos;
+}}
+
+const char* scriptStringVar(uint8_t id) {{
+  static char scratch[24];
+  switch (id) {{
+    case 0: return FIRMWARE_VERSION;
+    case 1: return SENSOR_ID;
+    case 2: return SENSOR_TYPE;
+    case 3: {{
+      IPAddress addr = WiFi.localIP();
+      snprintf(scratch, sizeof(scratch), "%u.%u.%u.%u", addr[0], addr[1], addr[2], addr[3]);
+      return scratch;
+    }}
+    case 4: {{
+      uint8_t mac[6];
+      WiFi.macAddress(mac);
+      snprintf(scratch, sizeof(scratch), "%02X:%02X:%02X:%02X:%02X:%02X",
+               mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+      return scratch;
+    }}
+  }}
+  return "";
+}}
+
+void endScriptPass() {{
+  scriptRunning = false;
+  lastScriptRun = millis();
+}}
+
+// Advance the loaded program by one slice. Called on every loop() iteration
+// and never blocks: a delay parks the program until its millis() deadline,
+// and long loops yield after SCRIPT_STEP_BUDGET instructions.
+void stepScriptProgram() {{
+  if (!scriptLoaded) return;
+
+  unsigned long now = millis();
+
+  if (!scriptRunning) {{
+    if (now - lastScriptRun < SCRIPT_RUN_INTERVAL) return;
+    scriptPc = 0;
+    scriptWaitMs = 0;
+    scriptRunning = true;
+    scriptSensorsValid = false;
+  }}
+
+  if (scriptWaitMs > 0) {{
+    if (now - scriptWaitStart < scriptWaitMs) return;
+    scriptWaitMs = 0;
+    scriptSensorsValid = false;  // Sensors may have changed while parked
+  }}
+
+  static char logBuf[SCRIPT_LOG_BUFFER];
+
+  for (uint16_t budget = SCRIPT_STEP_BUDGET; budget > 0; budget--) {{
+    if (scriptPc >= scriptCodeLen) {{
+      endScriptPass();
+      return;
+    }}
+
+    const uint8_t* ip = &scriptCode[scriptPc];
+
+    switch (ip[0]) {{
+      case OP_END:
+        endScriptPass();
+        return;
+
+      case OP_JMP:
+        scriptPc = readU16(ip + 1);
+        break;
+
+      case OP_JMP_IF_NOT: {{
+        float left = readOperand(ip + 2);
+        float right = readOperand(ip + 5);
+        bool result = compareValues(ip[1], left, right);
+        LOG_DEBUG("  ❓ IF %.2f vs %.2f -> %s", left, right, result ? "TRUE" : "FALSE");
+        scriptPc = result ? scriptPc + 10 : readU16(ip + 8);
+        break;
+      }}
+
+      case OP_LOOP_INIT:
+        if (ip[1] < SCRIPT_LOOP_REGS) scriptLoopCounters[ip[1]] = readU16(ip + 2);
+        scriptPc += 4;
+        break;
+
+      case OP_LOOP_NEXT:
+        if (ip[1] < SCRIPT_LOOP_REGS && scriptLoopCounters[ip[1]] > 1) {{
+          scriptLoopCounters[ip[1]]--;
+          scriptPc = readU16(ip + 2);
+        }} else {{
+          scriptPc += 4;
         }}
+        break;
+
+      case OP_GPIO_WRITE:
+        writeOutputPin(ip[1], ip[2]);
+        LOG_DEBUG("  ✓ GPIO Write: Pin %u = %s", ip[1], ip[2] ? "HIGH" : "LOW");
+        scriptPc += 3;
+        break;
+
+      case OP_GPIO_READ: {{
+        pinMode(ip[1], INPUT);
+        int level = digitalRead(ip[1]);
+        LOG_DEBUG("  ✓ GPIO Read: Pin %u = %d", ip[1], level);
+        scriptPc += 2;
+        break;
       }}
-      
-    }} else if (type == "gpio_write") {{
-      // GPIO Write: Set digital pin HIGH or LOW
-      int pin = action["pin"] | 2;
-      String value = action["value"] | "LOW";
-      
-      pinMode(pin, OUTPUT);
-      digitalWrite(pin, value == "HIGH" ? HIGH : LOW);
-      Serial.println("  ✓ GPIO Write: Pin " + String(pin) + " = " + value);
-      
-    }} else if (type == "gpio_read") {{
-      // GPIO Read: Read digital pin state
-      int pin = action["pin"] | 15;
-      pinMode(pin, INPUT);
-      int value = digitalRead(pin);
-      Serial.println("  ✓ GPIO Read: Pin " + String(pin) + " = " + String(value));
-      
-    }} else if (type == "analog_read") {{
-      // Analog Read: Read ADC value (0-4095 on ESP32)
-      int pin = action["pin"] | 34;
-      int value = analogRead(pin);
-      Serial.println("  ✓ Analog Read: Pin " + String(pin) + " = " + String(value));
-      
-    }} else if (type == "read_temperature") {{
-      // Read Temperature: Read from sensor
-      SensorData data = readSensorData();
-      Serial.println("  ✓ Temperature: " + String(data.temperature) + "°C");
-      
-    }} else if (type == "set_relay") {{
-      // Set Relay: Control relay state
-      bool state = action["state"] | false;
-      // Implement your relay control here
-      Serial.println("  ✓ Relay: " + String(state ? "ON" : "OFF"));
-      
-    }} else if (type == "set_pump") {{
-      // Set Pump: Control pump state
-      int pin = action["pin"] | 2;
-      bool state = action["state"] | false;
-      pinMode(pin, OUTPUT);
-      digitalWrite(pin, state ? HIGH : LOW);
-      Serial.println("  ✓ Pump (Pin " + String(pin) + "): " + String(state ? "ON" : "OFF"));
-      
-    }} else if (type == "set_solenoid") {{
-      // Set Solenoid: Control solenoid state
-      int pin = action["pin"] | 2;
-      bool state = action["state"] | false;
-      pinMode(pin, OUTPUT);
-      digitalWrite(pin, state ? HIGH : LOW);
-      Serial.println("  ✓ Solenoid (Pin " + String(pin) + "): " + String(state ? "ON" : "OFF"));
-      
-    }} else if (type == "delay") {{
-      // Delay: Wait for specified milliseconds
-      int ms = action["ms"] | 1000;
-      Serial.println("  ⏱️ Delay: " + String(ms) + "ms");
-      delay(ms);
-      
-    }} else if (type == "log") {{
-      // Log: Print message to serial
-      String message = action["message"] | "Log message";
-      
-    }} else if (type == "log") {{
-      // Log: Print message to serial
-      String message = action["message"] | "Log message";
-      
-      // Support for {{variable}} syntax in message
-      int startIndex = message.indexOf("{{");
-      while (startIndex >= 0) {{
-          int endIndex = message.indexOf("}}", startIndex);
-          if (endIndex > startIndex) {{
-              String key = message.substring(startIndex + 1, endIndex);
-              String valStr = "";
-              
-              // Check for string variables first
-              if (key == "firmware_version") valStr = String(FIRMWARE_VERSION);
-              else if (key == "sensor_id") valStr = String(SENSOR_ID);
-              else if (key == "sensor_type") valStr = String(SENSOR_TYPE);
-              else if (key == "ip_address") valStr = WiFi.localIP().toString();
-              else if (key == "mac_address") valStr = WiFi.macAddress();
-              else if (key == "wifi_rssi") valStr = String(WiFi.RSSI());
-              else if (key == "free_heap") valStr = String(ESP.getFreeHeap());
-              else if (key == "uptime") valStr = String(millis() / 1000);
-              else {{
-                  // Fallback to float resolution
-                  float val = resolveValue(key);
-                  valStr = String(val);
-                  // Clean up float formatting (remove .00)
-                  if (valStr.endsWith(".00")) valStr.remove(valStr.length() - 3);
-              }}
-              
-              message = message.substring(0, startIndex) + valStr + message.substring(endIndex + 1);
-              
-              // Search for next placeholder
-              startIndex = message.indexOf("{{", startIndex + valStr.length());
+
+      case OP_ANALOG_READ: {{
+        int reading = analogRead(ip[1]);
+        LOG_DEBUG("  ✓ Analog Read: Pin %u = %d", ip[1], reading);
+        scriptPc += 2;
+        break;
+      }}
+
+      case OP_READ_TEMP:
+        LOG_DEBUG("  ✓ Temperature: %.2f°C", scriptSensorSnapshot().temperature);
+        scriptPc += 1;
+        break;
+
+      case OP_SET_RELAY:
+        if (ip[1] != 0xFF) writeOutputPin(ip[1], ip[2]);
+        LOG_DEBUG("  ✓ Relay: %s", ip[2] ? "ON" : "OFF");
+        scriptPc += 3;
+        break;
+
+      case OP_DELAY:
+        scriptWaitMs = readU32(ip + 1);
+        scriptWaitStart = now;
+        LOG_DEBUG("  ⏱️ Delay: %lums", scriptWaitMs);
+        scriptPc += 5;
+        if (scriptWaitMs > 0) return;
+        break;
+
+      case OP_LOG: {{
+        // Parts: 0 = literal (string index), 1 = value (operand), 2 = string variable
+        uint8_t partCount = ip[1];
+        uint16_t cursor = scriptPc + 2;
+        size_t len = 0;
+        logBuf[0] = 0;
+        for (uint8_t i = 0; i < partCount; i++) {{
+          uint8_t kind = scriptCode[cursor];
+          if (kind == 1) {{
+            len = appendValue(logBuf, len, sizeof(logBuf), readOperand(&scriptCode[cursor + 1]));
+            cursor += 4;
           }} else {{
-              break;
+            uint8_t arg = scriptCode[cursor + 1];
+            if (kind == 0 && arg < scriptStringCount) len = appendText(logBuf, len, sizeof(logBuf), scriptStrings[arg]);
+            else if (kind == 2) len = appendText(logBuf, len, sizeof(logBuf), scriptStringVar(arg));
+            cursor += 2;
           }}
+        }}
+        LOG_INFO("  📝 Log: %s", logBuf);
+        sendRemoteLog(logBuf, "info");
+        scriptPc = cursor;
+        break;
       }}
 
-      // Check if there is a value to append
-      if (action.containsKey("value")) {{
-         String valKey = action["value"];
-         float val = resolveValue(valKey);
-         message += " [" + valKey + "=" + String(val) + "]";
-      }}
-      
-      Serial.println("  📝 Log: " + message);
-      sendRemoteLog(message, "info");
-      
-    }} else {{
-      Serial.println("  ⚠️ Unknown action type: " + type);
+      default:
+        LOG_ERROR("[SCRIPT] ❌ Bad opcode 0x%02X at %u - script disabled", ip[0], scriptPc);
+        scriptLoaded = false;
+        scriptRunning = false;
+        return;
     }}
   }}
-}}
 
-void executeLocalScript(String jsonScript) {{
-  Serial.println("[SCRIPT] 🚀 Executing JSON script...");
-  
-  if (jsonScript.length() == 0) {{
-    Serial.println("[SCRIPT] ⚠️ No script content to execute");
-    return;
-  }}
-  
-  // Parse JSON
-  StaticJsonDocument<4096> doc;
-  DeserializationError error = deserializeJson(doc, jsonScript);
-  
-  if (error) {{
-    Serial.println("[SCRIPT] ❌ Failed to parse JSON: " + String(error.c_str()));
-    return;
-  }}
-  
-  // Get script metadata
-  String scriptName = doc["name"] | "Unnamed Script";
-  String version = doc["version"] | "unknown";
-  
-  Serial.println("[SCRIPT] Name: " + scriptName);
-  Serial.println("[SCRIPT] Version: " + version);
-  
-  // Get actions array
-  JsonArray actions = doc["actions"];
-  if (!actions) {{
-    Serial.println("[SCRIPT] ⚠️ No actions found in script");
-    return;
-  }}
-  
-  Serial.println("[SCRIPT] Executing " + String(actions.size()) + " action(s)...");
-  
-  // Execute actions recursively
-  executeActions(actions);
-  
-  Serial.println("[SCRIPT] ✅ Script execution complete\\n");
+  // Budget used up (e.g. a while() without a delay) - resume on the next loop()
 }}
 
 bool checkForScriptUpdates() {{
-  if (String(MASTER_CONTROL_URL).length() == 0) return false;
-  
-  HTTPClient http;
-  String url = String(MASTER_CONTROL_URL) + "/api/sensor-master/script/" + String(SENSOR_ID);
-  
-  Serial.println("[SCRIPT] Checking for script updates...");
-  http.begin(url);
+  if (MASTER_CONTROL_URL[0] == '\\0') return false;
+  
+  LOG_INFO("[SCRIPT] Checking for script updates...");
+  beginRequest(masterUrl("/api/sensor-master/script/", SENSOR_ID));
+  
+  // The master answers 304 with no body while our build is current
+  char etag[28] = "";
+  if (scriptLoaded) {{
+    char scriptHash[24] = "";
+    if (preferences.getString("script_hash", scriptHash, sizeof(scriptHash)) > 0) {{
+      snprintf(etag, sizeof(etag), "\\"%s\\"", scriptHash);
+      http.addHeader("If-None-Match", etag);
+    }}
+  }}
   int httpCode = http.GET();
   
+  if (httpCode == 304) {{
+    endRequest();
+    LOG_INFO("[SCRIPT] Script unchanged");
+    return false;
+  }}
+  
   if (httpCode == 200) {{
-    String response = http.getString();
-    StaticJsonDocument<4096> doc;
-    DeserializationError error = deserializeJson(doc, response);
+    // Only keep the fields we need - the JSON copy of the script is skipped
+    StaticJsonDocument<128> filter;
+    filter["script_available"] = true;
+    filter["bytecode"] = true;
+    filter["version"] = true;
+    filter["script_id"] = true;
+    filter["script_hash"] = true;
+    
+    // Static: too big for the loop task's stack, and filled from the socket
+    // so the whole response never sits in a String as well
+    static StaticJsonDocument<4096> doc;
+    DeserializationError error = readJsonResponse(doc, &filter);
+    endRequest();
     
     if (!error && doc["script_available"]) {{
-      String newScript = doc["script"] | "";
-      String scriptVersion = doc["version"] | "unknown";
+      const char* encoded = doc["bytecode"] | "";
+      const char* scriptVersion = doc["version"] | "unknown";
       int scriptId = doc["script_id"] | -1;
       
-      Serial.println("[SCRIPT] 📥 New script available:");
-      Serial.println("  Version: " + scriptVersion);
-      Serial.println("  Script ID: " + String(scriptId));
+      size_t programLen = 0;
+      size_t encodedLen = strlen(encoded);
+      if (encodedLen == 0 ||
+          mbedtls_base64_decode(scriptProgram, SCRIPT_MAX_BYTES, &programLen,
+                                (const unsigned char*)encoded, encodedLen) != 0 ||
+          !loadScriptProgram(scriptProgram, programLen)) {{
+        LOG_ERROR("[SCRIPT] ❌ Script has no usable bytecode, keeping previous script");
+        loadSavedScript();
+        return false;
+      }}
+      
+      LOG_INFO("[SCRIPT] 📥 New script available:");
+      LOG_INFO("  Version: %s", scriptVersion);
+      LOG_INFO("  Script ID: %d", scriptId);
+      LOG_INFO("  Bytecode: %u bytes", (unsigned)programLen);
       
       // Save to preferences for persistence
-      preferences.putString("current_script", newScript);
+      preferences.putBytes("script_bc", scriptProgram, programLen);
       preferences.putString("script_version", scriptVersion);
       preferences.putInt("script_id", scriptId);
+      preferences.putString("script_hash", doc["script_hash"] | "");
       
       // Report version to master
       reportRunningVersion(scriptVersion, scriptId);
       
-      Serial.println("[SCRIPT] ✅ Script downloaded and saved\\n");
+      LOG_INFO("[SCRIPT] ✅ Script downloaded and saved\\n");
       
-      // Execute immediately
-      executeLocalScript(newScript);
+      // Start a fresh pass on the next loop()
+      lastScriptRun = millis() - SCRIPT_RUN_INTERVAL;
       
-      http.end();
       return true;
     }}
+    return false;
   }}
   
-  http.end();
+  endRequest();
   return false;
 }}
 
-void reportRunningVersion(String version, int scriptId) {{
-  if (String(MASTER_CONTROL_URL).length() == 0) return;
+void reportRunningVersion(const char* version, int scriptId) {{
+  if (MASTER_CONTROL_URL[0] == '\\0') return;
   
-  HTTPClient http;
-  String url = String(MASTER_CONTROL_URL) + "/api/sensor-master/report-version";
-  
-  http.begin(url);
-  http.addHeader("Content-Type", "application/json");
+  beginRequest(masterUrl("/api/sensor-master/report-version"));
   
   StaticJsonDocument<256> doc;
   doc["sensor_id"] = SENSOR_ID;
-  doc["version"] = version;
+  doc["script_version"] = version;
   if (scriptId > 0) doc["script_id"] = scriptId;
   
-  String payload;
-  serializeJson(doc, payload);
-  
-  int httpCode = http.POST(payload);
+  int httpCode = postJson(doc);
+  endRequest();
   if (httpCode == 200) {{
-    Serial.println("[VERSION] ✅ Reported version to master: " + version);
+    LOG_INFO("[VERSION] ✅ Reported version to master: %s", version);
   }}
-  
-  http.end();
 }}
 
 void reportScriptExecution(int scriptId) {{
-  if (String(MASTER_CONTROL_URL).length() == 0) return;
-  
-  HTTPClient http;
-  String url = String(MASTER_CONTROL_URL) + "/api/sensor-master/script-executed";
+  if (MASTER_CONTROL_URL[0] == '\\0') return;
   
-  http.begin(url);
-  http.addHeader("Content-Type", "application/json");
+  beginRequest(masterUrl("/api/sensor-master/script-executed"));
   
   StaticJsonDocument<256> doc;
   doc["sensor_id"] = SENSOR_ID;
   if (scriptId > 0) doc["script_id"] = scriptId;
   
-  String payload;
-  serializeJson(doc, payload);
-  
-  http.POST(payload);
-  http.end();
+  postJson(doc);
+  endRequest();
+}}
+
+// ============================================================================
+// SECTION 6: TELEMETRY BUFFER
+// ============================================================================
+// Every sample is buffered before upload, so nothing is lost while Wi-Fi or
+// master control is down. Samples live in RTC RAM (survives deep sleep); when
+// the ring fills it spills to LittleFS. Uploads go oldest-first in chunks to
+// /api/sensor-master/data as a "samples" batch.
+// ============================================================================
+
+#define TELEMETRY_SPILL_FILE "/telemetry.bin"
+#define TELEMETRY_SPILL_OLD "/telemetry.old"
+
+struct TelemetrySample {{
+  uint32_t epoch;        // Unix time, 0 if NTP had not synced yet
+  uint32_t takenAt;      // millis() when taken (only meaningful for bootId)
+  uint16_t bootId;
+  uint8_t flags;         // bit 0 = relay on, bit 1 = reading valid
+  uint8_t reserved;
+  float temperature;
+  float targetTemp;
+}};
+
+RTC_DATA_ATTR TelemetrySample telemetryRing[TELEMETRY_RTC_CAPACITY];
+RTC_DATA_ATTR uint16_t telemetryHead = 0;    // Oldest sample
+RTC_DATA_ATTR uint16_t telemetryCount = 0;
+RTC_DATA_ATTR uint16_t bootId = 0;
+bool telemetryFsReady = false;
+
+void initTelemetryBuffer() {{
+  bootId++;
+  if (telemetryCount > TELEMETRY_RTC_CAPACITY || telemetryHead >= TELEMETRY_RTC_CAPACITY) {{
+    telemetryHead = 0;
+    telemetryCount = 0;
+  }}
+  telemetryFsReady = LittleFS.begin(true);
+  if (!telemetryFsReady) {{
+    LOG_WARN("[TELEMETRY] ⚠️ LittleFS unavailable - buffering in RTC RAM only");
+  }}
 }}
+
+size_t spilledSampleCount() {{
+  if (!telemetryFsReady) return 0;
+  size_t bytes = 0;
+  const char* paths[] = {{TELEMETRY_SPILL_OLD, TELEMETRY_SPILL_FILE}};
+  for (const char* path : paths) {{
+    if (!LittleFS.exists(path)) continue;
+    File f = LittleFS.open(path, "r");
+    bytes += f.size();
+    f.close();
+  }}
+  return bytes / sizeof(TelemetrySample);
+}}
+
+size_t telemetryPending() {{
+  return telemetryCount + spilledSampleCount();
+}}
+
+// Move the whole RTC ring to flash. Rotating two files bounds flash use and
+// drops the oldest history first when an outage outlasts both.
+void spillTelemetryRing() {{
+  if (!telemetryFsReady) {{
+    // No flash - drop the oldest sample to make room
+    telemetryHead = (telemetryHead + 1) % TELEMETRY_RTC_CAPACITY;
+    telemetryCount--;
+    return;
+  }}
+
+  File f = LittleFS.open(TELEMETRY_SPILL_FILE, "a");
+  if (f && f.size() + telemetryCount * sizeof(TelemetrySample) > TELEMETRY_SPILL_MAX) {{
+    f.close();
+    LittleFS.remove(TELEMETRY_SPILL_OLD);
+    LittleFS.rename(TELEMETRY_SPILL_FILE, TELEMETRY_SPILL_OLD);
+    f = LittleFS.open(TELEMETRY_SPILL_FILE, "a");
+  }}
+  if (!f) {{
+    telemetryHead = (telemetryHead + 1) % TELEMETRY_RTC_CAPACITY;
+    telemetryCount--;
+    return;
+  }}
+
+  for (uint16_t i = 0; i < telemetryCount; i++) {{
+    f.write((const uint8_t*)&telemetryRing[(telemetryHead + i) % TELEMETRY_RTC_CAPACITY], sizeof(TelemetrySample));
+  }}
+  f.close();
+  telemetryHead = 0;
+  telemetryCount = 0;
+}}
+
+void bufferSample(const SensorData& data) {{
+  if (telemetryCount >= TELEMETRY_RTC_CAPACITY) spillTelemetryRing();
+
+  TelemetrySample& sample = telemetryRing[(telemetryHead + telemetryCount) % TELEMETRY_RTC_CAPACITY];
+  time_t now = time(nullptr);
+  sample.epoch = now > 1600000000 ? (uint32_t)now : 0;
+  sample.takenAt = millis();
+  sample.bootId = bootId;
+  sample.flags = (data.relayState ? 0x01 : 0) | (data.valid ? 0x02 : 0);
+  sample.reserved = 0;
+  sample.temperature = data.temperature;
+  sample.targetTemp = data.targetTemp;
+  telemetryCount++;
+}}
+
+// Forget the sample bufferSample() just added (it was delivered elsewhere).
+// It is always still in the ring: spills happen before a sample is added.
+void dropNewestSample() {{
+  if (telemetryCount > 0) telemetryCount--;
+}}
+
+bool postTelemetryChunk(const TelemetrySample* samples, size_t count) {{
+  beginRequest(masterUrl("/api/sensor-master/data"));
+
+  StaticJsonDocument<1536> doc;
+  doc["sensor_id"] = SENSOR_ID;
+  doc["mode"] = currentMode == MODE_ONLINE ? "online" : "offline";
+
+  JsonArray batch = doc.createNestedArray("samples");
+  unsigned long now = millis();
+  for (size_t i = 0; i < count; i++) {{
+    JsonObject s = batch.createNestedObject();
+    if (samples[i].epoch) {{
+      s["timestamp"] = samples[i].epoch;
+    }} else if (samples[i].bootId == bootId) {{
+      s["age_ms"] = now - samples[i].takenAt;
+    }}
+    s["temperature"] = samples[i].temperature;
+    s["target"] = samples[i].targetTemp;
+    s["relay_state"] = samples[i].flags & 0x01;
+    s["valid"] = (samples[i].flags & 0x02) != 0;
+  }}
+
+  int httpCode = postSensorPayload(doc);
+  endRequest();
+  return httpCode == 200;
+}}
+
+// A file is removed only after all of it uploaded. A retry resends the
+// chunks that already made it - the server drops samples closer together
+// than the polling interval, which discards those duplicates.
+bool uploadSpillFile(const char* path) {{
+  if (!telemetryFsReady || !LittleFS.exists(path)) return true;
+
+  File f = LittleFS.open(path, "r");
+  TelemetrySample chunk[TELEMETRY_CHUNK];
+  bool ok = true;
+  while (ok) {{
+    size_t got = f.read((uint8_t*)chunk, sizeof(chunk)) / sizeof(TelemetrySample);
+    if (got == 0) break;
+    ok = postTelemetryChunk(chunk, got);
+  }}
+  f.close();
+
+  if (ok) LittleFS.remove(path);
+  return ok;
+}}
+
+bool uploadBufferedTelemetry() {{
+  // Oldest first: rotated spill file, current spill file, then the RTC ring
+  if (!uploadSpillFile(TELEMETRY_SPILL_OLD)) return false;
+  if (!uploadSpillFile(TELEMETRY_SPILL_FILE)) return false;
+
+  TelemetrySample chunk[TELEMETRY_CHUNK];
+  while (telemetryCount > 0) {{
+    uint16_t count = telemetryCount < TELEMETRY_CHUNK ? telemetryCount : TELEMETRY_CHUNK;
+    for (uint16_t i = 0; i < count; i++) {{
+      chunk[i] = telemetryRing[(telemetryHead + i) % TELEMETRY_RTC_CAPACITY];
+    }}
+    if (!postTelemetryChunk(chunk, count)) return false;
+    telemetryHead = (telemetryHead + count) % TELEMETRY_RTC_CAPACITY;
+    telemetryCount -= count;
+  }}
+
+  return true;
+}}
+
+// ============================================================================
+// SECTION 7: DEEP-SLEEP DUTY CYCLE (POWER_PROFILE_DEEP_SLEEP)
+// ============================================================================
+// Battery profile: every wake takes one sample with the radio off, brings
+// Wi-Fi up only when a check-in is due or the buffer has a full batch, then
+// goes back to deep sleep. Registration and NTP state live in RTC RAM, so a
+// timer wake skips both. Check-ins are spaced within the master's
+// hibernation timeout so the node shows as hibernating, not offline.
+// ============================================================================
+
+#if POWER_PROFILE_DEEP_SLEEP
+
+RTC_DATA_ATTR bool sleepRegistered = false;   // Registered with master this power cycle
+RTC_DATA_ATTR uint32_t lastNtpSync = 0;       // Epoch of the last NTP sync (RTC keeps time in sleep)
+RTC_DATA_ATTR uint32_t sinceCheckInMs = 0;    // Time elapsed since the last check-in attempt
+RTC_DATA_ATTR bool uploadBackoff = false;     // Last upload failed - wait for the next check-in
+
+void syncClockIfNeeded() {{
+  time_t now = time(nullptr);
+  if (lastNtpSync != 0 && now > 1600000000 && (uint32_t)now - lastNtpSync < NTP_RESYNC_INTERVAL) return;
+
+  configTime(gmtOffset_sec, daylightOffset_sec, ntpServer);
+  struct tm timeinfo;
+  if (getLocalTime(&timeinfo, 5000)) {{
+    lastNtpSync = (uint32_t)time(nullptr);
+    LOG_INFO("[SLEEP] Clock synced via NTP");
+  }}
+}}
+
+// Check in often enough that the master never times the node out
+unsigned long dutyCheckInInterval() {{
+  unsigned long limit = hibernationTimeout - hibernationTimeout / 4;
+  return checkInInterval < limit ? checkInInterval : limit;
+}}
+
+void runScriptPassBeforeSleep() {{
+  if (!scriptLoaded) return;
+
+  lastScriptRun = millis() - SCRIPT_RUN_INTERVAL;  // Start a pass now
+  unsigned long start = millis();
+  do {{
+    stepScriptProgram();
+    delay(1);
+  }} while (scriptRunning && millis() - start < SLEEP_SCRIPT_BUDGET);
+}}
+
+void enterDeepSleep(unsigned long sleepMs) {{
+  if (currentMode == MODE_ONLINE && WiFi.status() == WL_CONNECTED) {{
+    // The master switches us to "hibernating" when it sees this message
+    char message[64];
+    snprintf(message, sizeof(message), "Entering deep sleep for %lus", sleepMs / 1000);
+    sendRemoteLog(message, "INFO");
+  }}
+
+  httpSocket.stop();
+  WiFi.disconnect(true);
+  WiFi.mode(WIFI_OFF);
+
+  sinceCheckInMs += sleepMs + millis();  // Time asleep plus time awake this cycle
+  LOG_INFO("[SLEEP] Sleeping for %lus", sleepMs / 1000);
+  Serial.flush();
+
+  esp_sleep_enable_timer_wakeup((uint64_t)sleepMs * 1000ULL);
+  esp_deep_sleep_start();
+}}
+
+void runDutyCycle() {{
+  bool coldBoot = esp_sleep_get_wakeup_cause() != ESP_SLEEP_WAKEUP_TIMER;
+
+  // Sample first, before the radio adds noise and current draw
+  SensorData data = readSensorData();
+  bufferSample(data);
+
+  unsigned long checkInEvery = dutyCheckInInterval();
+  bool checkInDue = coldBoot || sinceCheckInMs >= checkInEvery;
+  bool uploadDue = sleepRegistered && !uploadBackoff && telemetryPending() >= TELEMETRY_UPLOAD_BATCH;
+
+  if (checkInDue || uploadDue) {{
+    connectToWiFi();
+
+    if (WiFi.status() == WL_CONNECTED) {{
+      syncClockIfNeeded();
+
+      if (!sleepRegistered) {{
+        sleepRegistered = registerWithMaster();
+      }}
+      masterControlAvailable = sleepRegistered;
+      currentMode = sleepRegistered ? MODE_ONLINE : MODE_OFFLINE;
+
+      if (sleepRegistered) {{
+        uploadBackoff = !uploadBufferedTelemetry();
+        if (uploadBackoff) {{
+          LOG_WARN("[SLEEP] Upload failed - samples kept until the next check-in");
+        }}
+        if (checkInDue) {{
+          performCheckIn();
+          // A 404 means the master forgot us - register again next time
+          sleepRegistered = masterControlAvailable;
+          checkInEvery = dutyCheckInInterval();  // Config may have changed
+        }}
+      }}
+    }}
+
+    // Failed attempts also wait a full interval, so an outage does not
+    // keep the radio on every wake
+    if (checkInDue) sinceCheckInMs = 0;
+    if (WiFi.status() != WL_CONNECTED) uploadBackoff = true;
+  }}
+
+  runScriptPassBeforeSleep();
+
+  if (restartPending) {{
+    ESP.restart();
+  }}
+
+  unsigned long untilCheckIn = sinceCheckInMs < checkInEvery ? checkInEvery - sinceCheckInMs : 0;
+  unsigned long sleepMs = pollingInterval < untilCheckIn ? pollingInterval : untilCheckIn;
+  if (sleepMs < 1000) sleepMs = 1000;
+  enterDeepSleep(sleepMs);
+}}
+
+#endif
 '''
     
     def _generate_micropython_code(self, config: Dict, master_url: str, 
                                    wifi_ssid: str, wifi_password: str) -> str:
-        """Generate MicroPython code"""
-        
-        sensor_id = config.get("sensor_id", "esp32_sensor_001")
-        sensor_type = config.get("sensor_type", "esp32_generic")
-        sensor_name = config.get("sensor_name", "ESP32 Sensor")
+        """Generate MicroPython code as a single file"""
+        module = self._micropython_config_module(config, master_url, wifi_ssid, wifi_password)
+        return self._micropython_core().replace(CONFIG_INCLUDES["micropython"], module, 1)
+    
+    def _micropython_config_module(self, config: Dict, master_url: str,
+                                   wifi_ssid: str, wifi_password: str) -> str:
+        """sensor_config.py - the per-device part of a MicroPython build"""
+        values = self.device_values(config, master_url, wifi_ssid, wifi_password)
         
+        return f'''# sensor_config.py - per-device settings
+# Generated: {datetime.now().strftime('%Y-%m-%d %H:%M:%S')}
+# Sensor ID: {values["sensor_id"]}
+# Sensor Type: {values["sensor_type"]}
+
+WIFI_SSID = {_string_literal(values["wifi_ssid"])}
+WIFI_PASSWORD = {_string_literal(values["wifi_password"])}
+MASTER_CONTROL_URL = {_string_literal(values["master_url"])}
+SENSOR_ID = {_string_literal(values["sensor_id"])}
+SENSOR_TYPE = {_string_literal(values["sensor_type"])}
+SENSOR_NAME = {_string_literal(values["sensor_name"])}
+'''
+    
+    @staticmethod
+    @lru_cache(maxsize=None)
+    def _micropython_core() -> str:
+        """MicroPython firmware shared by every device; imports sensor_config"""
         return f'''"""
 ESP32 Sensor with Master Control Integration (MicroPython)
-Generated: {datetime.now().strftime('%Y-%m-%d %H:%M:%S')}
-
-Sensor ID: {sensor_id}
-Sensor Type: {sensor_type}
 
 This code includes two distinct operating modes:
 1. OFFLINE MODE - Runs when master control is unavailable
 2. ONLINE MODE - Runs when connected to master control
+
+Device settings are in sensor_config.py.
 """
 
 import network
@@ -1173,15 +1997,10 @@ import machine
 from machine import Pin
 
 # ============================================================================
-# CONFIGURATION - Modify these values for your setup
+# CONFIGURATION - Modify sensor_config.py for your setup
 # ============================================================================
 
-WIFI_SSID = "{wifi_ssid or 'YOUR_WIFI_SSID'}"
-WIFI_PASSWORD = "{wifi_password or 'YOUR_WIFI_PASSWORD'}"
-MASTER_CONTROL_URL = "{master_url}"
-SENSOR_ID = "{sensor_id}"
-SENSOR_TYPE = "{sensor_type}"
-SENSOR_NAME = "{sensor_name}"
+from sensor_config import *
 
 # Timing configuration (in milliseconds)
 CHECK_IN_INTERVAL = 300000      # 5 minutes
@@ -1617,9 +2436,32 @@ def process_commands(commands):
             master_control_available = False
             print("[ONLINE MODE] Switching to offline mode by command")
             
+        elif command_type == 'execute_script':
+            run_command_actions(cmd.get('command_data', {{}}).get('actions', []))
+            
         else:
             print(f"[ONLINE MODE] Unknown command type: {{command_type}}")
 
+def run_command_actions(actions):
+    """Run the pin writes of an execute_script command (dashboard pin control)"""
+    for action in actions:
+        action_type = action.get('type')
+        pin = action.get('pin')
+        if pin is None:
+            print(f"[ONLINE MODE] Script action {{action_type}} has no pin")
+            continue
+        
+        if action_type == 'gpio_write':
+            high = bool(action.get('value'))
+            Pin(pin, Pin.OUT).value(1 if high else 0)
+            print(f"[ONLINE MODE] GPIO Write: Pin {{pin}} = {{'HIGH' if high else 'LOW'}}")
+        elif action_type == 'set_relay':
+            on = bool(action.get('state'))
+            Pin(pin, Pin.OUT).value(1 if on else 0)
+            print(f"[ONLINE MODE] Relay: Pin {{pin}} {{'ON' if on else 'OFF'}}")
+        else:
+            print(f"[ONLINE MODE] Unsupported script action: {{action_type}}")
+
 # ============================================================================
 # SECTION 3: HARDWARE & SENSOR FUNCTIONS
 # ============================================================================
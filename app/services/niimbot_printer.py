@@ -8,11 +8,11 @@ Based on the niimprint library protocol
 import asyncio
 import logging
 import struct
-import math
 import socket
 from enum import IntEnum
 from typing import Optional, List, Dict
 from PIL import Image, ImageOps
+from .niimbot_raster import encode_rows
 
 logger = logging.getLogger(__name__)
 
@@ -91,6 +91,9 @@ def packet_to_int(packet: NiimbotPacket) -> int:
 class NiimbotPrinter:
     """Niimbot printer client for Bluetooth RFCOMM communication"""
 
+    # Row packets per acknowledged write, see print_image()
+    ROW_WINDOW = 16
+
     def __init__(self, address: str, model: str = "d110"):
         """
         Initialize Niimbot printer client
@@ -247,9 +250,9 @@ class NiimbotPrinter:
             logger.warning(f"Timeout waiting for response to command {request_code}")
             return None
 
-    async def _write_raw(self, packet: NiimbotPacket):
-        """Write raw packet without waiting for response"""
-        await self.client.write_gatt_char(self.char_uuid, packet.to_bytes())
+    async def _write_raw(self, packet: NiimbotPacket, response: bool = False):
+        """Write raw packet without waiting for a reply packet"""
+        await self.client.write_gatt_char(self.char_uuid, packet.to_bytes(), response=response)
 
     async def get_info(self, key: InfoEnum) -> Optional[any]:
         """Get printer information"""
@@ -352,15 +355,9 @@ class NiimbotPrinter:
         if vertical_offset > 0:
             img = ImageOps.expand(img, border=(0, vertical_offset, 0, 0), fill=1)
 
-        # Yield packets for each line
-        for y in range(img.height):
-            line_data = [img.getpixel((x, y)) for x in range(img.width)]
-            line_data = "".join("0" if pix == 0 else "1" for pix in line_data)
-            line_data = int(line_data, 2).to_bytes(math.ceil(img.width / 8), "big")
-            
-            counts = (0, 0, 0)
-            header = struct.pack(">H3BB", y, *counts, 1)
-            yield NiimbotPacket(0x85, header + line_data)
+        # Yield packets for each run of identical lines (white is printed after the invert)
+        for packet_type, payload in encode_rows(img, ink="white", counts=False):
+            yield NiimbotPacket(packet_type, payload)
 
     async def print_image(self, image: Image, density: int = 3, quantity: int = 1, 
                          vertical_offset: int = 0, horizontal_offset: int = 0) -> bool:
@@ -387,10 +384,11 @@ class NiimbotPrinter:
             await self.set_dimension(image.height, image.width)
             await self.set_quantity(quantity)
 
-            # Send image data
-            for packet in self._encode_image(image, vertical_offset, horizontal_offset):
-                await self._write_raw(packet)
-                await asyncio.sleep(0.01)  # Small delay to prevent buffer overflow
+            # Send image data; an acknowledged write every ROW_WINDOW packets
+            # keeps the printer's buffer from overflowing
+            packets = list(self._encode_image(image, vertical_offset, horizontal_offset))
+            for i, packet in enumerate(packets, start=1):
+                await self._write_raw(packet, response=i % self.ROW_WINDOW == 0 or i == len(packets))
 
             # Wait for page print to complete
             while not await self.end_page_print():
@@ -12,6 +12,7 @@ from enum import IntEnum
 from typing import Optional, List, Dict, Callable
 from PIL import Image, ImageOps
 from bleak import BleakScanner, BleakClient
+from .niimbot_raster import encode_rows
 
 logger = logging.getLogger(__name__)
 
@@ -103,6 +104,10 @@ class NiimbotPrinterBLE:
     # Working characteristic UUID for both B1 and D110
     # This UUID supports read, write, and notify operations
     CHAR_UUID = "bef8d6c9-9c21-4c9e-b632-bd58c1009f9f"
+
+    # Bitmap rows are written without response; every ROW_WINDOW rows one
+    # acknowledged write makes us wait until the printer has taken them
+    ROW_WINDOW = 16
     
     # Known printer models and their addresses (can be configured)
     KNOWN_PRINTERS = {
@@ -483,6 +488,24 @@ class NiimbotPrinterBLE:
             logger.error(f"Print failed: {e}")
             return False
 
+    async def print_images(self, images: List[Image.Image], density: int = 3, quantity: int = 1) -> int:
+        """
+        Print several labels over the current connection
+        
+        Args:
+            images: PIL Image objects, printed in order
+            density: Print density (1-5)
+            quantity: Number of copies of each label
+            
+        Returns:
+            int: Number of labels printed before the first failure
+        """
+        for printed, image in enumerate(images):
+            if not await self.print_image(image, density, quantity):
+                logger.error(f"Batch stopped at label {printed + 1}/{len(images)}")
+                return printed
+        return len(images)
+
     async def _print_page_b1(self, image: Image.Image, width: int, height: int, bytes_per_line: int, quantity: int) -> bool:
         """Print page using B1 protocol"""
         try:
@@ -548,37 +571,29 @@ class NiimbotPrinterBLE:
             return False
 
     async def _send_bitmap_data(self, image: Image.Image, width: int, height: int, bytes_per_line: int):
-        """Send bitmap data line by line"""
-        logger.info(f"Sending {height} bitmap rows...")
-        
-        for y in range(height):
-            # Convert line to bytes
-            line_bytes = bytearray()
-            for x in range(width):
-                if x % 8 == 0:
-                    line_bytes.append(0)
-                pixel = image.getpixel((x, y))
-                if pixel == 0:  # Black pixel
-                    line_bytes[-1] |= (1 << (7 - (x % 8)))
-            
-            # Calculate bit counts for 3 segments
-            seg_size = bytes_per_line // 3
-            count1 = int.from_bytes(bytes(line_bytes[0:seg_size]), 'big').bit_count()
-            count2 = int.from_bytes(bytes(line_bytes[seg_size:seg_size*2]), 'big').bit_count()
-            count3 = int.from_bytes(bytes(line_bytes[seg_size*2:]), 'big').bit_count()
-            
-            # Build header: pos(u16), count1(u8), count2(u8), count3(u8), repeats(u8)
-            header = struct.pack(">H3BB", y, count1, count2, count3, 1)
-            
-            # Send (0x85 = PrintBitmapRow)
-            packet = NiimbotPacket(0x85, header + bytes(line_bytes))
-            await self._send_packet(packet, wait_response=False)
-            
-            if y % 20 == 0:
-                logger.info(f"Progress: {y}/{height} lines ({100*y//height}%)")
-        
+        """Send bitmap data, merging repeated rows and sending blank rows as PrintEmptyRow"""
+        packets = [NiimbotPacket(packet_type, payload) for packet_type, payload in encode_rows(image, ink="black")]
+        logger.info(f"Sending {height} bitmap rows in {len(packets)} packets...")
+        await self._stream_packets(packets)
         logger.info(f"Progress: {height}/{height} lines (100%)")
 
+    async def _stream_packets(self, packets: List[NiimbotPacket]):
+        """
+        Write packets that get no reply, pacing on the BLE link instead of a fixed sleep.
+
+        The printer sends no notification per row, so each window ends with a
+        write-with-response: its ATT acknowledgement only arrives once the
+        printer has drained the writes queued before it.
+        """
+        if not self.client or not self.connected:
+            raise RuntimeError("Printer not connected")
+
+        for i, packet in enumerate(packets, start=1):
+            acknowledged = i % self.ROW_WINDOW == 0 or i == len(packets)
+            await self.client.write_gatt_char(self.CHAR_UUID, packet.to_bytes(), response=acknowledged)
+            if acknowledged and i % (self.ROW_WINDOW * 8) == 0:
+                logger.info(f"Progress: {i}/{len(packets)} packets ({100*i//len(packets)}%)")
+
     async def _wait_finished_b1(self, total_pages: int, timeout: float = 10.0, poll_interval: float = 0.3) -> bool:
         """Wait for B1 print to finish using status polling"""
         polls = int(timeout / poll_interval)
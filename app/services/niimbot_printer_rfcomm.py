@@ -7,12 +7,12 @@ Based on the niimprint library protocol
 
 import logging
 import struct
-import math
 import socket
 import time
 from enum import IntEnum
 from typing import Optional, List, Dict
 from PIL import Image, ImageOps
+from .niimbot_raster import encode_rows
 
 logger = logging.getLogger(__name__)
 
@@ -297,15 +297,9 @@ class NiimbotPrinter:
         # Convert to monochrome
         img = ImageOps.invert(image.convert("L")).convert("1")
 
-        # Yield packets for each line
-        for y in range(img.height):
-            line_data = [img.getpixel((x, y)) for x in range(img.width)]
-            line_data = "".join("0" if pix == 0 else "1" for pix in line_data)
-            line_data = int(line_data, 2).to_bytes(math.ceil(img.width / 8), "big")
-            
-            counts = (0, 0, 0)
-            header = struct.pack(">H3BB", y, *counts, 1)
-            yield NiimbotPacket(0x85, header + line_data)
+        # Yield packets for each run of identical lines (white is printed after the invert)
+        for packet_type, payload in encode_rows(img, ink="white", counts=False):
+            yield NiimbotPacket(packet_type, payload)
 
     def print_image(self, image: Image, density: int = 3, quantity: int = 1) -> bool:
         """
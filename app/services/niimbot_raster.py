@@ -0,0 +1,91 @@
+"""
+Niimbot Raster Encoding
+Packs 1-bit label images into Niimbot row packets (shared by the BLE and RFCOMM clients)
+
+Rows come straight from Image.tobytes() (8 pixels per byte, MSB first), so
+there is no per-pixel work in Python. Consecutive identical rows are sent
+once with the packet's repeat count, and blank rows use the shorter
+PrintEmptyRow packet.
+"""
+
+import struct
+from typing import Iterator, Tuple
+from PIL import Image
+
+PRINT_EMPTY_ROW = 0x84   # pos(u16), repeats(u8)
+PRINT_BITMAP_ROW = 0x85  # pos(u16), count1(u8), count2(u8), count3(u8), repeats(u8), row bytes
+
+MAX_REPEAT = 255  # repeats is a single byte
+
+_INVERT = bytes(255 - i for i in range(256))
+
+
+def pack_rows(image: Image.Image, ink: str = "black") -> Iterator[bytes]:
+    """
+    Yield each row of an image as packed bytes with a bit set wherever the
+    printer should burn a dot.
+
+    Args:
+        image: Image to pack (converted to mode '1' if needed)
+        ink: Which pixel colour is printed - "black" (value 0) or "white" (value 255)
+    """
+    if image.mode != "1":
+        image = image.convert("1")
+    width, height = image.size
+    stride = (width + 7) // 8
+    data = image.tobytes()  # white pixels are 1 bits, rows padded with 0 bits
+
+    if ink == "black":
+        data = data.translate(_INVERT)
+        pad_bits = stride * 8 - width
+        if pad_bits:
+            # Inverting turned the row padding into dots; clear it again
+            keep = (0xFF << pad_bits) & 0xFF
+            rows = bytearray(data)
+            for end in range(stride - 1, len(rows), stride):
+                rows[end] &= keep
+            data = bytes(rows)
+
+    for y in range(height):
+        yield data[y * stride:(y + 1) * stride]
+
+
+def _segment_counts(row: bytes) -> Tuple[int, int, int]:
+    """Dots in each third of a row, as carried in the PrintBitmapRow header"""
+    seg_size = len(row) // 3
+    return (
+        int.from_bytes(row[:seg_size], "big").bit_count(),
+        int.from_bytes(row[seg_size:seg_size * 2], "big").bit_count(),
+        int.from_bytes(row[seg_size * 2:], "big").bit_count(),
+    )
+
+
+def encode_rows(image: Image.Image, ink: str = "black", counts: bool = True) -> Iterator[Tuple[int, bytes]]:
+    """
+    Yield (packet_type, payload) pairs for an image, one per run of identical rows.
+
+    Args:
+        image: Image to print
+        ink: Pixel colour that is printed, see pack_rows()
+        counts: Fill in the per-segment dot counts (some firmwares accept zeros)
+    """
+    run_start = 0
+    run_row = None
+    run_length = 0
+
+    def flush():
+        if not any(run_row):
+            return PRINT_EMPTY_ROW, struct.pack(">HB", run_start, run_length)
+        segment_counts = _segment_counts(run_row) if counts else (0, 0, 0)
+        return PRINT_BITMAP_ROW, struct.pack(">H3BB", run_start, *segment_counts, run_length) + run_row
+
+    for y, row in enumerate(pack_rows(image, ink)):
+        if row == run_row and run_length < MAX_REPEAT:
+            run_length += 1
+            continue
+        if run_row is not None:
+            yield flush()
+        run_start, run_row, run_length = y, row, 1
+
+    if run_row is not None:
+        yield flush()
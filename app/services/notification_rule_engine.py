@@ -0,0 +1,260 @@
+# app/services/notification_rule_engine.py
+"""
+Sensor Notification Rule Engine
+===============================
+
+Evaluates NotificationRule rows against batches of stored sensor readings.
+
+Active rules are loaded once and compiled into predicates, indexed by
+sensor type and then by entry, so a reading only meets the rules that can
+apply to it and readings of types without rules cost nothing. Each batch
+does at most one Entry lookup (status and type for the entries involved)
+and one cooldown lookup for entries seen for the first time; after that
+the last notification time per entry is kept in memory.
+
+The in-memory time only lets a reading skip rules that are known to be in
+cooldown. Other processes store readings too, so a matching rule re-reads
+the entry's latest sensor notification before inserting another one, and
+the memory is only updated by committed() once the caller's transaction
+has committed.
+
+Rules are reloaded when the rule API calls invalidate(), which bumps the
+shared 'notification_rules' version (app/cache_versions.py) so the other
+processes reload as well, and after a short TTL, which also re-seeds the
+cooldown state from Notification.
+"""
+
+import re
+import threading
+import time
+import logging
+from datetime import datetime, timedelta
+
+from app.cache_versions import cache_versions
+
+logger = logging.getLogger(__name__)
+
+RULE_ENGINE_TTL_SECONDS = 300
+
+_NUMERIC_PREFIX = re.compile(r'^(-?\d+(?:\.\d+)?)')
+
+
+def parse_sensor_value(value):
+    """Numeric part of a reading such as "232724 bytes"; None if there is none"""
+    numeric_match = _NUMERIC_PREFIX.match(str(value).strip())
+    try:
+        return float(numeric_match.group(1)) if numeric_match else float(value)
+    except (ValueError, TypeError):
+        return None
+
+
+def compile_condition(condition_type, threshold, threshold_secondary=None):
+    """Predicate over a numeric reading, or None if the rule can never fire"""
+    if threshold is None:
+        return None
+    threshold = float(threshold)
+    if condition_type == 'greater_than':
+        return lambda value: value > threshold
+    if condition_type == 'less_than':
+        return lambda value: value < threshold
+    if condition_type == 'equals':
+        return lambda value: abs(value - threshold) < 0.01  # Allow small floating point differences
+    if condition_type == 'between':
+        if threshold_secondary is None:
+            return None
+        low, high = sorted((threshold, float(threshold_secondary)))
+        return lambda value: low <= value <= high
+    # change_rate has never been evaluated for single readings
+    return None
+
+
+class CompiledRule:
+    """A NotificationRule row with its condition compiled"""
+
+    __slots__ = ('id', 'entry_id', 'entry_type_id', 'matches', 'cooldown',
+                 'title', 'message', 'priority')
+
+    def __init__(self, row, matches):
+        self.id = row['id']
+        self.entry_id = row['entry_id']
+        self.entry_type_id = row['entry_type_id']
+        self.matches = matches
+        self.cooldown = timedelta(minutes=row['cooldown_minutes'] or 0)
+        self.title = row['notification_title']
+        self.message = row['notification_message']
+        self.priority = row['priority']
+
+
+def _parse_time(value):
+    if isinstance(value, datetime):
+        return value
+    try:
+        return datetime.fromisoformat(str(value))
+    except ValueError:
+        return None
+
+
+class NotificationRuleEngine:
+    """Process-wide compiled rule index plus per-entry cooldown state"""
+
+    def __init__(self, ttl_seconds=RULE_ENGINE_TTL_SECONDS):
+        self.ttl_seconds = ttl_seconds
+        self._lock = threading.Lock()
+        self._loaded_at = None
+        self._loaded_version = None
+        # sensor_type -> {'entries': {entry_id: [rules]}, 'all': [rules]}
+        self._index = {}
+        self._last_notified = {}  # entry_id -> datetime of the last sensor notification
+
+    def invalidate(self):
+        """Reload the rules in every process (call after the rule change has committed)"""
+        with self._lock:
+            self._loaded_at = None
+        cache_versions.bump_now('notification_rules')
+
+    def evaluate(self, cursor, readings):
+        """
+        Check (entry_id, sensor_type, value, recorded_at) readings against the
+        rules and insert a Notification for each match, in the caller's
+        transaction. Returns the created notifications for delivery.
+        """
+        self._ensure_loaded(cursor)
+        with self._lock:
+            index = self._index
+        candidates = [reading for reading in readings if reading[1] in index]
+        if not candidates:
+            return []
+
+        entry_ids = sorted({reading[0] for reading in candidates})
+        cursor.execute(
+            f"SELECT id, status, entry_type_id FROM Entry WHERE id IN ({','.join('?' * len(entry_ids))})",
+            entry_ids
+        )
+        entries = {row['id']: row for row in cursor.fetchall()}
+        self._seed_cooldowns(cursor, entry_ids)
+
+        created = []
+        pending = {}  # entry_id -> time of a notification inserted by this batch
+        for entry_id, sensor_type, value, recorded_at in candidates:
+            entry = entries.get(entry_id)
+            # don't create notifications for inactive entries
+            if not entry or entry['status'] == 'inactive':
+                continue
+            rules = self._rules_for(index[sensor_type], entry_id, entry['entry_type_id'])
+            if not rules:
+                continue
+            sensor_value = parse_sensor_value(value)
+            if sensor_value is None:
+                continue  # non-numeric readings never match numeric comparisons
+
+            for rule in rules:
+                now = datetime.now()
+                with self._lock:
+                    last = pending.get(entry_id) or self._last_notified.get(entry_id)
+                if last is not None and now < last + rule.cooldown:
+                    continue  # Still in cooldown period
+                if not rule.matches(sensor_value):
+                    continue
+                if rule.cooldown and entry_id not in pending:
+                    last = self._latest_notification(cursor, entry_id)
+                    if last is not None and now < last + rule.cooldown:
+                        continue  # Another process notified since the memory was seeded
+
+                # Sensor notifications should show immediately
+                cursor.execute('''
+                    INSERT INTO Notification
+                    (title, message, notification_type, priority, entry_id, scheduled_for)
+                    VALUES (?, ?, ?, ?, ?, ?)
+                ''', (rule.title, rule.message, 'sensor_based', rule.priority, entry_id, now.isoformat()))
+                pending[entry_id] = now
+                logger.info(f"Created sensor-based notification for rule {rule.id}")
+                created.append({
+                    'title': rule.title,
+                    'message': rule.message,
+                    'type': 'sensor_based',
+                    'priority': rule.priority,
+                    'entry_id': entry_id,
+                    'notification_id': cursor.lastrowid,
+                    'rule_id': rule.id,
+                    'created_at': now,
+                })
+        return created
+
+    def committed(self, created):
+        """Remember notifications from evaluate() once their transaction has committed"""
+        with self._lock:
+            for notification in created:
+                entry_id = notification['entry_id']
+                last = self._last_notified.get(entry_id)
+                if last is None or last < notification['created_at']:
+                    self._last_notified[entry_id] = notification['created_at']
+
+    @staticmethod
+    def _latest_notification(cursor, entry_id):
+        """Creation time of the entry's latest sensor notification, or None"""
+        cursor.execute('''
+            SELECT MAX(created_at) AS last_created FROM Notification
+            WHERE notification_type = 'sensor_based' AND entry_id = ?
+        ''', (entry_id,))
+        row = cursor.fetchone()
+        return _parse_time(row['last_created']) if row and row['last_created'] is not None else None
+
+    @staticmethod
+    def _rules_for(bucket, entry_id, entry_type_id):
+        rules = bucket['entries'].get(entry_id, []) + bucket['all']
+        return [rule for rule in rules if rule.entry_type_id is None or rule.entry_type_id == entry_type_id]
+
+    def _seed_cooldowns(self, cursor, entry_ids):
+        """Load the last sensor notification time for entries not seen yet"""
+        with self._lock:
+            unseen = [entry_id for entry_id in entry_ids if entry_id not in self._last_notified]
+        if not unseen:
+            return
+        cursor.execute(f'''
+            SELECT entry_id, MAX(created_at) AS last_created
+            FROM Notification
+            WHERE notification_type = 'sensor_based'
+            AND entry_id IN ({','.join('?' * len(unseen))})
+            GROUP BY entry_id
+        ''', unseen)
+        found = {row['entry_id']: _parse_time(row['last_created']) for row in cursor.fetchall()}
+        with self._lock:
+            for entry_id in unseen:
+                self._last_notified.setdefault(entry_id, found.get(entry_id))
+
+    def _ensure_loaded(self, cursor):
+        now = time.monotonic()
+        version = cache_versions.get('notification_rules')
+        with self._lock:
+            if (self._loaded_at is not None and self._loaded_version == version
+                    and now - self._loaded_at < self.ttl_seconds):
+                return
+
+        cursor.execute('SELECT * FROM NotificationRule WHERE is_active = 1 ORDER BY id')
+        index = {}
+        compiled = 0
+        for row in cursor.fetchall():
+            try:
+                matches = compile_condition(row['condition_type'], row['threshold_value'],
+                                            row['threshold_value_secondary'])
+            except (ValueError, TypeError):
+                matches = None
+            if matches is None:
+                continue
+            bucket = index.setdefault(row['sensor_type'], {'entries': {}, 'all': []})
+            rule = CompiledRule(row, matches)
+            if rule.entry_id is None:
+                bucket['all'].append(rule)
+            else:
+                bucket['entries'].setdefault(rule.entry_id, []).append(rule)
+            compiled += 1
+
+        with self._lock:
+            self._index = index
+            self._last_notified = {}
+            self._loaded_at = now
+            self._loaded_version = version
+        logger.debug(f"Compiled {compiled} notification rules for {len(index)} sensor types")
+
+
+rule_engine = NotificationRuleEngine()
@@ -9,6 +9,8 @@ import logging
 from datetime import datetime
 from typing import List, Dict, Tuple, Optional, Union
 from app.db import get_connection
+from app.services.sensor_rollup_service import record_rollups, rebuild_rollups
+from app.services.sensor_range_index import sensor_range_index, spans_sql, MAX_SPANS_PER_QUERY
 
 logger = logging.getLogger(__name__)
 
@@ -40,7 +42,9 @@ class RangeBasedSensorService:
         try:
             # Add sensor data records
             sensor_ids = []
+            readings = []
             for value_data in values:
+                recorded_at = value_data.get('recorded_at', datetime.now().isoformat())
                 cursor.execute('''
                     INSERT INTO SharedSensorData 
                     (sensor_type, value, recorded_at, source_type, source_id, metadata)
@@ -48,12 +52,13 @@ class RangeBasedSensorService:
                 ''', (
                     sensor_type,
                     value_data.get('value'),
-                    value_data.get('recorded_at', datetime.now().isoformat()),
+                    recorded_at,
                     value_data.get('source_type', 'manual'),
                     value_data.get('source_id'),
                     json.dumps(value_data.get('metadata', {}))
                 ))
                 sensor_ids.append(cursor.lastrowid)
+                readings.append((value_data.get('value'), recorded_at))
             
             # Create ranges for each entry
             ranges_created = []
@@ -62,24 +67,44 @@ class RangeBasedSensorService:
                     start_sensor_id = min(sensor_ids)
                     end_sensor_id = max(sensor_ids)
                     
-                    cursor.execute('''
-                        INSERT INTO SensorDataEntryRanges 
-                        (entry_id, sensor_type, start_sensor_id, end_sensor_id, link_type, metadata)
-                        VALUES (?, ?, ?, ?, ?, ?)
-                    ''', (
-                        entry_id, sensor_type, start_sensor_id, end_sensor_id, 
-                        link_type, json.dumps(metadata or {})
-                    ))
+                    # Extend the entry's previous range instead of adding another one
+                    previous = RangeBasedSensorService._coalescible_range(
+                        cursor, entry_id, sensor_type, link_type, metadata or {}, start_sensor_id
+                    )
+                    if previous:
+                        cursor.execute('''
+                            UPDATE SensorDataEntryRanges 
+                            SET end_sensor_id = ?, updated_at = ?
+                            WHERE id = ?
+                        ''', (end_sensor_id, datetime.now().isoformat(), previous['id']))
+                        range_id = previous['id']
+                        start_sensor_id = previous['start_sensor_id']
+                    else:
+                        cursor.execute('''
+                            INSERT INTO SensorDataEntryRanges 
+                            (entry_id, sensor_type, start_sensor_id, end_sensor_id, link_type, metadata)
+                            VALUES (?, ?, ?, ?, ?, ?)
+                        ''', (
+                            entry_id, sensor_type, start_sensor_id, end_sensor_id, 
+                            link_type, json.dumps(metadata or {})
+                        ))
+                        range_id = cursor.lastrowid
                     
                     ranges_created.append({
-                        'range_id': cursor.lastrowid,
+                        'range_id': range_id,
                         'entry_id': entry_id,
                         'start_sensor_id': start_sensor_id,
                         'end_sensor_id': end_sensor_id,
-                        'sensor_count': len(sensor_ids)
+                        'sensor_count': len(sensor_ids),
+                        'coalesced': previous is not None
                     })
             
+            record_rollups(cursor, [
+                (entry_id, sensor_type, value, recorded_at)
+                for entry_id in entry_ids for value, recorded_at in readings
+            ])
             conn.commit()
+            sensor_range_index.invalidate()
             
             return {
                 'success': True,
@@ -96,6 +121,42 @@ class RangeBasedSensorService:
         finally:
             conn.close()
     
+    @staticmethod
+    def _coalescible_range(cursor, entry_id: int, sensor_type: str, link_type: str,
+                           metadata: Dict, start_sensor_id: int) -> Optional[Dict]:
+        """
+        The entry's latest range that a new range starting at start_sensor_id can extend
+        
+        Only when link type and metadata match, and no reading of the same sensor
+        type sits in the id gap between them (extending over it would claim that
+        reading for this entry).
+        """
+        cursor.execute('''
+            SELECT id, start_sensor_id, end_sensor_id, link_type, metadata
+            FROM SensorDataEntryRanges
+            WHERE entry_id = ? AND sensor_type = ? AND end_sensor_id < ?
+            ORDER BY end_sensor_id DESC
+            LIMIT 1
+        ''', (entry_id, sensor_type, start_sensor_id))
+        previous = cursor.fetchone()
+        if not previous or previous['link_type'] != link_type:
+            return None
+        try:
+            if json.loads(previous['metadata'] or '{}') != metadata:
+                return None
+        except ValueError:
+            return None
+        
+        if start_sensor_id > previous['end_sensor_id'] + 1:
+            cursor.execute('''
+                SELECT 1 FROM SharedSensorData
+                WHERE id > ? AND id < ? AND sensor_type = ?
+                LIMIT 1
+            ''', (previous['end_sensor_id'], start_sensor_id, sensor_type))
+            if cursor.fetchone():
+                return None
+        return previous
+    
     @staticmethod
     def get_sensor_data_for_entry(entry_id: int, sensor_type: str = None, 
                                   limit: int = None, offset: int = 0) -> List[Dict]:
@@ -116,18 +177,30 @@ class RangeBasedSensorService:
         cursor = conn.cursor()
         
         try:
-            # Build query with range-based joins
-            query = '''
-                SELECT DISTINCT ssd.* 
-                FROM SharedSensorData ssd
-                JOIN SensorDataEntryRanges sder ON ssd.id BETWEEN sder.start_sensor_id AND sder.end_sensor_id
-                WHERE sder.entry_id = ?
-            '''
-            params = [entry_id]
-            
-            if sensor_type:
-                query += ' AND sder.sensor_type = ? AND ssd.sensor_type = ?'
-                params.extend([sensor_type, sensor_type])
+            spans = sensor_range_index.spans_for_entries(cursor, [entry_id], sensor_type or None)
+            if not spans:
+                return []
+            
+            if len(spans) <= MAX_SPANS_PER_QUERY:
+                # Primary key range scans over the entry's coalesced spans
+                span_clause, params = spans_sql(spans)
+                query = f'SELECT ssd.* FROM SharedSensorData ssd WHERE {span_clause}'
+                if sensor_type:
+                    query += ' AND ssd.sensor_type = ?'
+                    params.append(sensor_type)
+            else:
+                # Build query with range-based joins
+                query = '''
+                    SELECT DISTINCT ssd.* 
+                    FROM SharedSensorData ssd
+                    JOIN SensorDataEntryRanges sder ON ssd.id BETWEEN sder.start_sensor_id AND sder.end_sensor_id
+                    WHERE sder.entry_id = ?
+                '''
+                params = [entry_id]
+                
+                if sensor_type:
+                    query += ' AND sder.sensor_type = ? AND ssd.sensor_type = ?'
+                    params.extend([sensor_type, sensor_type])
             
             query += ' ORDER BY ssd.recorded_at DESC'
             
@@ -178,19 +251,35 @@ class RangeBasedSensorService:
             range_stats = cursor.fetchall()
             
             # Get actual sensor data statistics
-            cursor.execute('''
-                SELECT 
-                    ssd.sensor_type,
-                    COUNT(*) as actual_readings,
-                    MIN(ssd.recorded_at) as earliest_reading,
-                    MAX(ssd.recorded_at) as latest_reading
-                FROM SharedSensorData ssd
-                JOIN SensorDataEntryRanges sder ON ssd.id BETWEEN sder.start_sensor_id AND sder.end_sensor_id
-                WHERE sder.entry_id = ?
-                GROUP BY ssd.sensor_type
-            ''', (entry_id,))
-            
-            actual_stats = cursor.fetchall()
+            spans = sensor_range_index.spans_for_entries(cursor, [entry_id])
+            if not spans:
+                actual_stats = []
+            elif len(spans) <= MAX_SPANS_PER_QUERY:
+                span_clause, params = spans_sql(spans)
+                cursor.execute(f'''
+                    SELECT 
+                        ssd.sensor_type,
+                        COUNT(*) as actual_readings,
+                        MIN(ssd.recorded_at) as earliest_reading,
+                        MAX(ssd.recorded_at) as latest_reading
+                    FROM SharedSensorData ssd
+                    WHERE {span_clause}
+                    GROUP BY ssd.sensor_type
+                ''', params)
+                actual_stats = cursor.fetchall()
+            else:
+                cursor.execute('''
+                    SELECT 
+                        ssd.sensor_type,
+                        COUNT(DISTINCT ssd.id) as actual_readings,
+                        MIN(ssd.recorded_at) as earliest_reading,
+                        MAX(ssd.recorded_at) as latest_reading
+                    FROM SharedSensorData ssd
+                    JOIN SensorDataEntryRanges sder ON ssd.id BETWEEN sder.start_sensor_id AND sder.end_sensor_id
+                    WHERE sder.entry_id = ?
+                    GROUP BY ssd.sensor_type
+                ''', (entry_id,))
+                actual_stats = cursor.fetchall()
             
             # Combine statistics
             summary = {
@@ -275,6 +364,7 @@ class RangeBasedSensorService:
                     })
             
             conn.commit()
+            sensor_range_index.invalidate()
             
             return {
                 'success': True,
@@ -343,7 +433,11 @@ class RangeBasedSensorService:
         cursor = conn.cursor()
         
         try:
-            cursor.execute('''
+            range_ids = sensor_range_index.ranges_overlapping(cursor, start_sensor_id, end_sensor_id)
+            if not range_ids:
+                return []
+            
+            cursor.execute(f'''
                 SELECT 
                     e.id as entry_id,
                     e.title,
@@ -355,9 +449,9 @@ class RangeBasedSensorService:
                     sder.metadata
                 FROM Entry e
                 JOIN SensorDataEntryRanges sder ON e.id = sder.entry_id
-                WHERE sder.start_sensor_id <= ? AND sder.end_sensor_id >= ?
+                WHERE sder.id IN ({','.join('?' * len(range_ids))})
                 ORDER BY e.id, sder.sensor_type
-            ''', (end_sensor_id, start_sensor_id))
+            ''', range_ids)
             
             results = cursor.fetchall()
             return [dict(row) for row in results]
@@ -396,7 +490,10 @@ class RangeBasedSensorService:
                 ''', (entry_id,))
             
             deleted_count = cursor.rowcount
+            if deleted_count:
+                rebuild_rollups(cursor, [entry_id], sensor_type)
             conn.commit()
+            sensor_range_index.invalidate()
             
             return {
                 'success': True,
@@ -0,0 +1,320 @@
+# app/services/saved_search_cache.py
+"""
+Saved Search Cache
+==================
+
+Memoizes saved-search results so dashboards (timeline, attribute and state
+distributions, metric charts) don't re-run the same search repeatedly.
+
+Three layers, checked in order by DashboardService.get_saved_search_entries:
+
+* Per request - results are kept on ``flask.g``, so one page load runs each
+  search once no matter how many widgets use it.
+* Materialized filter searches - for searches without custom SQL or a
+  relative date range, the full (unlimited) match set is kept in memory.
+  Entry writes report the ids they touched through entries_changed(); the
+  next read re-checks only those ids against the search filter instead of
+  rescanning Entry.
+* Short TTL - everything else (custom SQL, date ranges) is cached for a few
+  seconds, and dropped whenever entries change.
+
+Each process keeps its own copy of these caches, so changes go through the
+database: entries_changed() appends the ids to the EntryChange log and
+bumps the shared 'entry_changes' version (app/cache_versions.py), and
+before a read every process fetches the log rows it hasn't applied yet
+(only when that version moved). Write requests that don't report entry
+changes may have edited states or entry types the filters depend on, so
+they bump 'saved_searches' instead (see init_app), which makes every
+process drop its materialized searches and results. The TTL bounds
+staleness from writers that do neither (background integrations).
+"""
+
+import threading
+import time
+import logging
+from collections import deque
+
+from app.cache_versions import cache_versions
+
+logger = logging.getLogger(__name__)
+
+SAVED_SEARCH_TTL_SECONDS = 30
+
+# Above this many pending ids a full reload is cheaper than re-checking them
+MAX_PENDING_CHANGES = 500
+
+# EntryChange rows kept; a process further behind than that reloads anyway
+ENTRY_CHANGE_KEEP = 10000
+
+# Blueprints whose writes never touch Entry, EntryType or EntryState
+NON_ENTRY_BLUEPRINTS = {
+    'sensor_master_api', 'device_api', 'health_api', 'dashboard_api',
+    'notes_api', 'note_bindings', 'user_preferences_api', 'theme_api',
+    'shared_sensor_api', 'range_sensor_api', 'notifications_api', 'ntfy_api',
+}
+
+
+class MaterializedSearch:
+    """Full match set of one filter-based saved search"""
+
+    def __init__(self, signature, search_name, entries):
+        self.signature = signature
+        self.search_name = search_name
+        self.entries = {entry['id']: entry for entry in entries}
+        self.loaded_at = time.monotonic()
+        self.pending = set()
+        self.ordered = None  # sorted view, rebuilt after changes
+
+
+class SavedSearchCache:
+    """Per-process store behind get_saved_search_entries()"""
+
+    def __init__(self, ttl_seconds=SAVED_SEARCH_TTL_SECONDS, max_pending=MAX_PENDING_CHANGES):
+        self.ttl_seconds = ttl_seconds
+        self.max_pending = max_pending
+        self._lock = threading.Lock()
+        self._materialized = {}
+        self._results = {}
+        self._change_seq = 0  # last EntryChange seq applied in this process
+        self._changes_version = None  # 'entry_changes' version at the last fetch
+        self._invalidation_version = None  # 'saved_searches' version last acted on
+        self._generation = 0  # advanced by invalidate(), see load_token()
+        self._change_log = deque()  # (seq, entry_ids) applied, for loads in flight
+        self._log_floor = 0  # the log holds every change after this seq
+        self._stats = {'request_hits': 0, 'hits': 0, 'incremental': 0, 'misses': 0}
+
+    def init_app(self, app):
+        """Drop materialized searches everywhere after writes that didn't report entry changes"""
+        from flask import request, g
+
+        self.ttl_seconds = app.config.get('SAVED_SEARCH_CACHE_TTL', self.ttl_seconds)
+
+        @app.after_request
+        def invalidate_saved_searches(response):
+            if (request.method not in ('GET', 'HEAD', 'OPTIONS')
+                    and response.status_code < 400
+                    and request.blueprint not in NON_ENTRY_BLUEPRINTS
+                    and not g.get('_entry_changes_reported')):
+                cache_versions.bump_now('saved_searches')
+                self.invalidate()
+            return response
+
+    # -- per request -------------------------------------------------------
+
+    def request_get(self, key):
+        from flask import g, has_app_context
+        if not has_app_context():
+            return None
+        result = g.get('_saved_search_results', {}).get(key)
+        if result is not None:
+            self._count('request_hits')
+        return result
+
+    def request_put(self, key, result):
+        from flask import g, has_app_context
+        if has_app_context():
+            if '_saved_search_results' not in g:
+                g._saved_search_results = {}
+            g._saved_search_results[key] = result
+
+    # -- short TTL results -------------------------------------------------
+
+    def get_result(self, key):
+        self.sync()
+        with self._lock:
+            cached = self._results.get(key)
+            if cached is not None and time.monotonic() - cached[0] < self.ttl_seconds:
+                self._stats['hits'] += 1
+                return cached[1]
+            self._results.pop(key, None)
+            self._stats['misses'] += 1
+            return None
+
+    def put_result(self, key, result):
+        with self._lock:
+            self._results[key] = (time.monotonic(), result)
+
+    # -- materialized filter searches --------------------------------------
+
+    def get_materialized(self, search_id, signature):
+        """Usable match set for a search, or None when it must be reloaded"""
+        self.sync()
+        with self._lock:
+            materialized = self._materialized.get(search_id)
+            if (materialized is None
+                    or materialized.signature != signature
+                    or time.monotonic() - materialized.loaded_at >= self.ttl_seconds
+                    or len(materialized.pending) > self.max_pending):
+                self._materialized.pop(search_id, None)
+                self._stats['misses'] += 1
+                return None
+            self._stats['incremental' if materialized.pending else 'hits'] += 1
+            return materialized
+
+    def load_token(self):
+        """Token to pass to put_materialized() for a load starting now"""
+        self.sync()
+        with self._lock:
+            return (self._generation, self._change_seq)
+
+    def put_materialized(self, search_id, materialized, token):
+        """Store a freshly loaded match set, queueing changes applied while it loaded"""
+        generation, since_seq = token
+        with self._lock:
+            if generation != self._generation or since_seq < self._log_floor:
+                return  # invalidated, or the log no longer reaches back to the load
+            for seq, ids in self._change_log:
+                if seq > since_seq:
+                    materialized.pending |= ids
+            self._materialized[search_id] = materialized
+
+    def take_pending(self, materialized):
+        """Changed ids still to be re-checked for a match set (clears them)"""
+        with self._lock:
+            pending, materialized.pending = materialized.pending, set()
+            return pending
+
+    def apply_changes(self, materialized, changed_ids, matching_entries):
+        """Replace changed ids with the ones that still match the search"""
+        with self._lock:
+            for entry_id in changed_ids:
+                materialized.entries.pop(entry_id, None)
+            for entry in matching_entries:
+                materialized.entries[entry['id']] = entry
+            materialized.ordered = None
+
+    def ordered_entries(self, materialized, sort_key, reverse):
+        with self._lock:
+            if materialized.ordered is None:
+                materialized.ordered = sorted(materialized.entries.values(), key=sort_key, reverse=reverse)
+            return materialized.ordered
+
+    # -- change events -----------------------------------------------------
+
+    def entries_changed(self, entry_ids):
+        """
+        Report entries that were created, updated or deleted. Call after the
+        write is committed so the re-check sees it.
+        """
+        entry_ids = sorted({int(entry_id) for entry_id in entry_ids if entry_id is not None})
+        if not entry_ids:
+            return
+        try:
+            self._publish_changes(entry_ids)
+        except Exception as e:
+            # Other processes only have the TTL to go on
+            logger.warning(f"Could not publish entry changes {entry_ids}: {e}")
+            self.invalidate()
+
+        from flask import g, has_app_context
+        if has_app_context():
+            g._entry_changes_reported = True
+            g.pop('_saved_search_results', None)
+
+    def sync(self):
+        """Apply the invalidations and entry changes published since the last read"""
+        versions = cache_versions.current()
+        invalidation_version = versions.get('saved_searches', 0)
+        changes_version = versions.get('entry_changes', 0)
+
+        with self._lock:
+            invalidated = self._invalidation_version not in (None, invalidation_version)
+            self._invalidation_version = invalidation_version
+            if changes_version == self._changes_version and not invalidated:
+                return
+            since_seq = self._change_seq
+        if invalidated:
+            self.invalidate()
+
+        changes = self._read_changes(since_seq, self.max_pending + 1)
+        if len(changes) > self.max_pending:
+            # Too far behind to replay (or the first read): continue from the latest change
+            latest = self._latest_seq()
+            self.invalidate()
+            with self._lock:
+                self._change_seq = self._log_floor = max(self._change_seq, latest)
+                self._changes_version = changes_version
+            return
+
+        with self._lock:
+            changed = {entry_id for seq, entry_id in changes if seq > self._change_seq}
+            if changed:
+                self._change_seq = max(seq for seq, entry_id in changes)
+                self._change_log.append((self._change_seq, changed))
+                while len(self._change_log) > self.max_pending:
+                    self._log_floor = self._change_log.popleft()[0]
+                for materialized in self._materialized.values():
+                    materialized.pending |= changed
+                self._results.clear()
+            self._changes_version = changes_version
+
+    def invalidate(self):
+        """Drop this process's materialized searches and results"""
+        with self._lock:
+            self._materialized.clear()
+            self._results.clear()
+            # Loads already running may have read the old state
+            self._generation += 1
+            self._change_log.clear()
+            self._log_floor = self._change_seq
+
+    @staticmethod
+    def _publish_changes(entry_ids):
+        from app.db import get_dedicated_connection
+
+        conn = get_dedicated_connection()
+        try:
+            cursor = conn.cursor()
+            # Bump first: the version row lock makes writers take and commit seqs in order
+            cache_versions.bump(cursor, 'entry_changes')
+            cursor.execute(
+                f"INSERT INTO EntryChange (entry_id) VALUES {', '.join(['(?)'] * len(entry_ids))}",
+                entry_ids
+            )
+            cursor.execute('DELETE FROM EntryChange WHERE seq <= LAST_INSERT_ID() - ?', (ENTRY_CHANGE_KEEP,))
+            conn.commit()
+        finally:
+            conn.close()
+
+    @staticmethod
+    def _read_changes(after_seq, limit):
+        """(seq, entry_id) pairs published after a seq, oldest first"""
+        from app.db import get_connection
+
+        conn = get_connection()
+        try:
+            cursor = conn.cursor()
+            cursor.execute(
+                'SELECT seq, entry_id FROM EntryChange WHERE seq > ? ORDER BY seq LIMIT ?',
+                (after_seq, limit)
+            )
+            return [(row['seq'], row['entry_id']) for row in cursor.fetchall()]
+        finally:
+            conn.close()
+
+    @staticmethod
+    def _latest_seq():
+        from app.db import get_connection
+
+        conn = get_connection()
+        try:
+            cursor = conn.cursor()
+            cursor.execute('SELECT MAX(seq) AS seq FROM EntryChange')
+            row = cursor.fetchone()
+            return (row['seq'] if row else None) or 0
+        finally:
+            conn.close()
+
+    def _count(self, name):
+        with self._lock:
+            self._stats[name] += 1
+
+    def stats(self):
+        with self._lock:
+            snapshot = dict(self._stats)
+            snapshot['materialized'] = len(self._materialized)
+            snapshot['results'] = len(self._results)
+        return snapshot
+
+
+saved_search_cache = SavedSearchCache()
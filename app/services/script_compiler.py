@@ -0,0 +1,456 @@
+# app/services/script_compiler.py
+"""
+Sensor Script Compiler
+======================
+
+Compiles JSON sensor scripts (the format produced by the Sensor Master Control
+script builder) into a compact bytecode program that the generated ESP32
+firmware runs directly. The firmware never parses JSON or builds Strings while
+executing a script - every operand is resolved here, on the server, into a
+constant-pool slot or a symbol id.
+
+Program layout (all multi-byte values little-endian):
+-----------------------------------------------------
+    'S' 'B'                 magic
+    u8  version             BYTECODE_VERSION
+    u8  flags               reserved (0)
+    u8  n_consts            followed by n_consts * f32
+    u8  n_strings           followed by n_strings * (u8 len, bytes, 0x00)
+    u16 code_len            followed by code_len bytes of code
+
+Operands are always 3 bytes: (u8 tag, u8 a, u8 b)
+    TAG_CONST   consts[a]
+    TAG_SYM     runtime value of symbol a with argument b (see SYMBOLS)
+
+Jump targets are absolute u16 offsets into the code section.
+"""
+
+import base64
+import json
+import logging
+import struct
+from typing import Dict, List, Optional, Tuple
+
+logger = logging.getLogger(__name__)
+
+
+BYTECODE_MAGIC = b'SB'
+BYTECODE_VERSION = 2
+
+# Must match SCRIPT_MAX_* in the generated firmware
+MAX_PROGRAM_BYTES = 2048
+MAX_CONSTS = 64
+MAX_STRINGS = 32
+MAX_LOOP_REGISTERS = 8
+MAX_LOG_PARTS = 16
+
+# Operand tags
+TAG_CONST = 0
+TAG_SYM = 1
+
+# Runtime values a script can read. Ids are shared with the firmware's
+# ScriptSymbol enum (generated from this table); 'gpio' takes the pin as arg.
+SYMBOLS = {
+    'sensor.temp': 0,
+    'sensor.target': 1,
+    'sensor.relay': 2,
+    'current_time': 3,
+    'wifi_rssi': 4,
+    'free_heap': 5,
+    'uptime': 6,
+    'millis': 7,
+    'gpio': 8,
+}
+
+# Opcodes - the firmware enum is generated from this table so both sides
+# always agree on the numbering.
+OPCODES = {
+    'END': 0x00,
+    'JMP': 0x01,          # u16 target
+    'JMP_IF_NOT': 0x02,   # u8 cmp, operand lhs, operand rhs, u16 target
+    'LOOP_INIT': 0x03,    # u8 reg, u16 count
+    'LOOP_NEXT': 0x04,    # u8 reg, u16 target (jump while --reg > 0)
+    'GPIO_WRITE': 0x10,   # u8 pin, u8 level
+    'GPIO_READ': 0x11,    # u8 pin
+    'ANALOG_READ': 0x12,  # u8 pin
+    'READ_TEMP': 0x13,
+    'SET_RELAY': 0x14,    # u8 pin (0xFF = none), u8 state
+    'DELAY': 0x20,        # u32 ms
+    'LOG': 0x30,          # u8 n_parts, parts...
+}
+
+# Comparison operators for JMP_IF_NOT
+COMPARATORS = {'==': 0, '!=': 1, '>': 2, '<': 3, '>=': 4, '<=': 5}
+
+# LOG part kinds
+LOG_PART_LITERAL = 0   # u8 string index
+LOG_PART_VALUE = 1     # operand (3 bytes)
+LOG_PART_STRVAR = 2    # u8 string variable id
+
+# String-valued placeholders understood by the firmware's log action
+LOG_STRING_VARS = {
+    'firmware_version': 0,
+    'sensor_id': 1,
+    'sensor_type': 2,
+    'ip_address': 3,
+    'mac_address': 4,
+}
+
+NO_PIN = 0xFF
+
+
+class ScriptCompileError(ValueError):
+    """Raised when a script cannot be represented as firmware bytecode"""
+
+
+class ScriptCompiler:
+    """Compile a JSON action list into firmware bytecode"""
+
+    def __init__(self, max_program_bytes: int = MAX_PROGRAM_BYTES):
+        self.max_program_bytes = max_program_bytes
+        self.consts: List[float] = []
+        self.strings: List[str] = []
+        self.code = bytearray()
+        self.warnings: List[str] = []
+        self._loop_depth = 0
+
+    # ------------------------------------------------------------------
+    # Public API
+    # ------------------------------------------------------------------
+
+    def compile(self, actions: List[Dict]) -> bytes:
+        """Compile a list of actions into a complete program"""
+        if not isinstance(actions, list):
+            raise ScriptCompileError('Script actions must be a list')
+
+        self._emit_block(actions)
+        self._emit_op('END')
+
+        program = bytearray(BYTECODE_MAGIC)
+        program += struct.pack('<BB', BYTECODE_VERSION, 0)
+
+        program += struct.pack('<B', len(self.consts))
+        for value in self.consts:
+            program += struct.pack('<f', value)
+
+        program += struct.pack('<B', len(self.strings))
+        for text in self.strings:
+            encoded = text.encode('utf-8')
+            program += struct.pack('<B', len(encoded)) + encoded + b'\x00'
+
+        program += struct.pack('<H', len(self.code))
+        program += self.code
+
+        if len(program) > self.max_program_bytes:
+            raise ScriptCompileError(
+                f'Compiled script is {len(program)} bytes, firmware limit is {self.max_program_bytes}'
+            )
+
+        return bytes(program)
+
+    # ------------------------------------------------------------------
+    # Pools
+    # ------------------------------------------------------------------
+
+    def _const(self, value: float) -> int:
+        value = float(value)
+        # Compare on the f32 representation so 0.1 and 0.1000000001 share a slot
+        try:
+            packed = struct.pack('<f', value)
+        except OverflowError:
+            raise ScriptCompileError(f'Constant {value} is out of range for firmware (32-bit float)')
+        for index, existing in enumerate(self.consts):
+            if struct.pack('<f', existing) == packed:
+                return index
+        if len(self.consts) >= MAX_CONSTS:
+            raise ScriptCompileError(f'Script uses more than {MAX_CONSTS} constants')
+        self.consts.append(value)
+        return len(self.consts) - 1
+
+    def _string(self, text: str) -> int:
+        text = str(text)
+        if len(text.encode('utf-8')) > 255:
+            raise ScriptCompileError(f'String too long for firmware (max 255 bytes): {text[:32]}...')
+        if text in self.strings:
+            return self.strings.index(text)
+        if len(self.strings) >= MAX_STRINGS:
+            raise ScriptCompileError(f'Script uses more than {MAX_STRINGS} strings')
+        self.strings.append(text)
+        return len(self.strings) - 1
+
+    # ------------------------------------------------------------------
+    # Emitters
+    # ------------------------------------------------------------------
+
+    def _emit_op(self, name: str):
+        self.code.append(OPCODES[name])
+
+    def _emit_u8(self, value: int):
+        self.code += struct.pack('<B', int(value) & 0xFF)
+
+    def _emit_u16(self, value: int) -> int:
+        """Emit a u16 and return its offset (for later patching)"""
+        offset = len(self.code)
+        self.code += struct.pack('<H', int(value) & 0xFFFF)
+        return offset
+
+    def _patch_u16(self, offset: int, value: int):
+        if value > 0xFFFF:
+            raise ScriptCompileError('Script code section exceeds 64KB')
+        struct.pack_into('<H', self.code, offset, value)
+
+    def _emit_operand(self, raw):
+        tag, a, b = self._operand(raw)
+        self.code += struct.pack('<BBB', tag, a, b)
+
+    def _operand(self, raw) -> Tuple[int, int, int]:
+        """Resolve a script value (number, literal, or key) into an operand"""
+        if isinstance(raw, bool):
+            return TAG_CONST, self._const(1.0 if raw else 0.0), 0
+        if isinstance(raw, (int, float)):
+            return TAG_CONST, self._const(raw), 0
+
+        text = str(raw if raw is not None else '').strip()
+        if text == '':
+            return TAG_CONST, self._const(0.0), 0
+
+        literal = {'HIGH': 1.0, 'LOW': 0.0, 'true': 1.0, 'false': 0.0, 'ON': 1.0, 'OFF': 0.0}
+        if text in literal:
+            return TAG_CONST, self._const(literal[text]), 0
+
+        try:
+            return TAG_CONST, self._const(float(text)), 0
+        except ValueError:
+            pass
+
+        return self._symbol(text)
+
+    def _symbol(self, key: str) -> Tuple[int, int, int]:
+        if key in SYMBOLS and key != 'gpio':
+            return TAG_SYM, SYMBOLS[key], 0
+        if key.startswith('gpio.'):
+            try:
+                pin = int(key[5:])
+            except ValueError:
+                pin = -1
+            if 0 <= pin < NO_PIN:
+                return TAG_SYM, SYMBOLS['gpio'], pin
+        # The JSON interpreter treated unknown keys as 0 - keep that, but say so
+        self.warnings.append(f"Unknown value '{key}' resolves to 0")
+        return TAG_CONST, self._const(0.0), 0
+
+    def _pin(self, action: Dict, default: Optional[int]) -> int:
+        pin = action.get('pin', default)
+        if pin in (None, ''):
+            if default is None:
+                return NO_PIN
+            pin = default
+        try:
+            pin = int(pin)
+        except (TypeError, ValueError):
+            raise ScriptCompileError(f"Invalid pin '{pin}' in {action.get('type')} action")
+        if pin < 0 or pin >= NO_PIN:
+            raise ScriptCompileError(f'Pin {pin} out of range')
+        return pin
+
+    @staticmethod
+    def _truthy(value) -> bool:
+        if isinstance(value, str):
+            return value.strip().lower() in ('1', 'true', 'high', 'on')
+        return bool(value)
+
+    def _emit_block(self, actions):
+        for action in actions or []:
+            if not isinstance(action, dict):
+                self.warnings.append(f'Skipping non-object action: {action!r}')
+                continue
+            self._emit_action(action)
+
+    def _emit_condition_jump(self, condition: Dict) -> int:
+        """Emit JMP_IF_NOT for a condition and return the target offset to patch"""
+        condition = condition or {}
+        operator = condition.get('operator', '==')
+        if operator not in COMPARATORS:
+            raise ScriptCompileError(f"Unsupported comparison operator '{operator}'")
+
+        self._emit_op('JMP_IF_NOT')
+        self._emit_u8(COMPARATORS[operator])
+        self._emit_operand(condition.get('left', '0'))
+        self._emit_operand(condition.get('right', '0'))
+        return self._emit_u16(0)
+
+    def _emit_action(self, action: Dict):
+        action_type = action.get('type', '')
+
+        if action_type == 'if':
+            else_patch = self._emit_condition_jump(action.get('condition'))
+            self._emit_block(action.get('then'))
+            if action.get('else'):
+                self._emit_op('JMP')
+                end_patch = self._emit_u16(0)
+                self._patch_u16(else_patch, len(self.code))
+                self._emit_block(action.get('else'))
+                self._patch_u16(end_patch, len(self.code))
+            else:
+                self._patch_u16(else_patch, len(self.code))
+
+        elif action_type == 'while':
+            loop_start = len(self.code)
+            exit_patch = self._emit_condition_jump(action.get('condition'))
+            self._emit_block(action.get('do'))
+            self._emit_op('JMP')
+            self._emit_u16(loop_start)
+            self._patch_u16(exit_patch, len(self.code))
+
+        elif action_type == 'loop':
+            try:
+                count = int(action.get('count', 1))
+            except (TypeError, ValueError):
+                raise ScriptCompileError(f"Invalid loop count '{action.get('count')}'")
+            if count <= 0:
+                return
+            if self._loop_depth >= MAX_LOOP_REGISTERS:
+                raise ScriptCompileError(f'Loops nested deeper than {MAX_LOOP_REGISTERS}')
+            register = self._loop_depth
+            self._loop_depth += 1
+            self._emit_op('LOOP_INIT')
+            self._emit_u8(register)
+            self._emit_u16(min(count, 0xFFFF))
+            body_start = len(self.code)
+            self._emit_block(action.get('do'))
+            self._emit_op('LOOP_NEXT')
+            self._emit_u8(register)
+            self._emit_u16(body_start)
+            self._loop_depth -= 1
+
+        elif action_type == 'gpio_write':
+            self._emit_op('GPIO_WRITE')
+            self._emit_u8(self._pin(action, 2))
+            self._emit_u8(1 if self._truthy(action.get('value', 'LOW')) else 0)
+
+        elif action_type in ('set_pump', 'set_solenoid', 'set_led', 'set_fan'):
+            self._emit_op('GPIO_WRITE')
+            self._emit_u8(self._pin(action, 2))
+            self._emit_u8(1 if self._truthy(action.get('state', False)) else 0)
+
+        elif action_type == 'gpio_read':
+            self._emit_op('GPIO_READ')
+            self._emit_u8(self._pin(action, 15))
+
+        elif action_type in ('analog_read', 'read_soil_moisture'):
+            self._emit_op('ANALOG_READ')
+            self._emit_u8(self._pin(action, 34))
+
+        elif action_type == 'read_temperature':
+            self._emit_op('READ_TEMP')
+
+        elif action_type == 'set_relay':
+            self._emit_op('SET_RELAY')
+            self._emit_u8(self._pin(action, None))
+            self._emit_u8(1 if self._truthy(action.get('state', False)) else 0)
+
+        elif action_type in ('delay', 'wait'):
+            raw_ms = action.get('ms', action.get('value', 1000))
+            try:
+                ms = int(float(raw_ms))
+            except (TypeError, ValueError):
+                raise ScriptCompileError(f"Invalid delay '{raw_ms}'")
+            self._emit_op('DELAY')
+            self.code += struct.pack('<I', max(0, min(ms, 0xFFFFFFFF)))
+
+        elif action_type == 'log':
+            self._emit_log(action)
+
+        else:
+            self.warnings.append(f"Action type '{action_type}' is not supported by generated firmware; skipped")
+
+    def _emit_log(self, action: Dict):
+        """Pre-split a log message into literal and placeholder parts"""
+        message = str(action.get('message', 'Log message'))
+        parts = []
+
+        cursor = 0
+        while cursor < len(message):
+            start = message.find('{', cursor)
+            end = message.find('}', start + 1) if start >= 0 else -1
+            if start < 0 or end < 0:
+                parts.append((LOG_PART_LITERAL, message[cursor:]))
+                break
+            if start > cursor:
+                parts.append((LOG_PART_LITERAL, message[cursor:start]))
+            key = message[start + 1:end].strip()
+            if key in LOG_STRING_VARS:
+                parts.append((LOG_PART_STRVAR, key))
+            else:
+                parts.append((LOG_PART_VALUE, key))
+            cursor = end + 1
+
+        if 'value' in action and action['value'] not in (None, ''):
+            value_key = str(action['value'])
+            parts.append((LOG_PART_LITERAL, f' [{value_key}='))
+            parts.append((LOG_PART_VALUE, value_key))
+            parts.append((LOG_PART_LITERAL, ']'))
+
+        # Merge adjacent literals so they occupy a single pool slot
+        merged = []
+        for kind, payload in parts:
+            if kind == LOG_PART_LITERAL and merged and merged[-1][0] == LOG_PART_LITERAL:
+                merged[-1] = (kind, merged[-1][1] + payload)
+            elif kind != LOG_PART_LITERAL or payload:
+                merged.append((kind, payload))
+
+        if len(merged) > MAX_LOG_PARTS:
+            raise ScriptCompileError(f'Log message has more than {MAX_LOG_PARTS} parts')
+
+        self._emit_op('LOG')
+        self._emit_u8(len(merged))
+        for kind, payload in merged:
+            self._emit_u8(kind)
+            if kind == LOG_PART_LITERAL:
+                self._emit_u8(self._string(payload))
+            elif kind == LOG_PART_STRVAR:
+                self._emit_u8(LOG_STRING_VARS[payload])
+            else:
+                self._emit_operand(payload)
+
+
+def extract_actions(script_content) -> List[Dict]:
+    """Return the action list from a script in any of the accepted shapes"""
+    data = json.loads(script_content) if isinstance(script_content, str) else script_content
+    if isinstance(data, dict):
+        return data.get('actions', data.get('commands', [])) or []
+    if isinstance(data, list):
+        return data
+    raise ScriptCompileError('Script must be a JSON object or array')
+
+
+def compile_script(script_content, max_program_bytes: int = MAX_PROGRAM_BYTES) -> Dict:
+    """
+    Compile a JSON script into firmware bytecode.
+
+    Returns:
+        Dictionary with the raw program, a base64 copy for JSON transport,
+        its size and any compiler warnings.
+    """
+    compiler = ScriptCompiler(max_program_bytes=max_program_bytes)
+    program = compiler.compile(extract_actions(script_content))
+    for warning in compiler.warnings:
+        logger.warning(f"Script compiler: {warning}")
+    return {
+        'program': program,
+        'bytecode': base64.b64encode(program).decode('ascii'),
+        'size': len(program),
+        'warnings': compiler.warnings,
+    }
+
+
+def firmware_opcode_enum() -> str:
+    """C++ enum body for the generated firmware, derived from OPCODES"""
+    return ',\n'.join(f'  OP_{name} = 0x{code:02X}' for name, code in OPCODES.items())
+
+
+def firmware_symbol_enum() -> str:
+    """C++ enum body for the generated firmware, derived from SYMBOLS"""
+    return ',\n'.join(
+        f"  SYM_{key.upper().replace('.', '_')} = {symbol_id}" for key, symbol_id in SYMBOLS.items()
+    )
@@ -0,0 +1,191 @@
+# app/services/sensor_range_index.py
+"""
+Sensor Range Index
+==================
+
+In-memory index of SensorDataEntryRanges so range-based reads don't have to
+join SharedSensorData against every range row with BETWEEN.
+
+Per sensor type the ranges are kept in a static interval tree (a sorted
+array with the maximum end of each implicit subtree), which answers "which
+entry ranges touch sensor ids lo..hi" in O(log n + k). Per entry the
+coalesced id spans are kept as sorted lists, which callers turn into
+``ssd.id BETWEEN ? AND ?`` primary key range scans.
+
+The range service calls invalidate() whenever it writes ranges, which bumps
+the shared 'sensor_ranges' version (app/cache_versions.py) so every process
+reloads; the index also expires after a short TTL to pick up cascaded
+deletes.
+"""
+
+import bisect
+import threading
+import time
+import logging
+from typing import Dict, List, Optional, Tuple
+
+from app.cache_versions import cache_versions
+
+logger = logging.getLogger(__name__)
+
+RANGE_INDEX_TTL_SECONDS = 30
+
+# Above this many spans an OR of BETWEENs stops being cheaper than the join
+MAX_SPANS_PER_QUERY = 200
+
+
+class IntervalTree:
+    """Static interval tree over (start, end, payload) with inclusive bounds"""
+
+    def __init__(self, intervals):
+        self._items = sorted(intervals, key=lambda item: (item[0], item[1]))
+        self._max_end = [item[1] for item in self._items]
+        self._build(0, len(self._items) - 1)
+
+    def _build(self, lo, hi):
+        if lo > hi:
+            return None
+        mid = (lo + hi) // 2
+        best = self._items[mid][1]
+        for child in (self._build(lo, mid - 1), self._build(mid + 1, hi)):
+            if child is not None and child > best:
+                best = child
+        self._max_end[mid] = best
+        return best
+
+    def __len__(self):
+        return len(self._items)
+
+    def overlapping(self, lo, hi):
+        """Payloads of intervals intersecting [lo, hi], in start order"""
+        found = []
+        stack = [(0, len(self._items) - 1)]
+        while stack:
+            left, right = stack.pop()
+            if left > right:
+                continue
+            mid = (left + right) // 2
+            if self._max_end[mid] < lo:
+                continue  # nothing in this subtree reaches lo
+            start, end, payload = self._items[mid]
+            if start <= hi:
+                # the right subtree only starts later, so it can still match
+                stack.append((mid + 1, right))
+                if end >= lo:
+                    found.append((start, payload))
+            stack.append((left, mid - 1))
+        found.sort(key=lambda item: item[0])
+        return [payload for _, payload in found]
+
+
+def merge_spans(spans):
+    """Merge overlapping or adjacent (start, end) id spans"""
+    merged = []
+    for start, end in sorted(spans):
+        if merged and start <= merged[-1][1] + 1:
+            if end > merged[-1][1]:
+                merged[-1][1] = end
+        else:
+            merged.append([start, end])
+    return [tuple(span) for span in merged]
+
+
+def span_contains(spans, value):
+    """Whether a sorted list of merged spans covers value"""
+    i = bisect.bisect_right(spans, (value, float('inf'))) - 1
+    return i >= 0 and spans[i][0] <= value <= spans[i][1]
+
+
+def spans_sql(spans, column='ssd.id'):
+    """``(col BETWEEN ? AND ? OR ...)`` and its params for a list of spans"""
+    clause = ' OR '.join(f'{column} BETWEEN ? AND ?' for _ in spans)
+    params = [bound for span in spans for bound in span]
+    return f'({clause})', params
+
+
+class SensorRangeIndex:
+    """Process-wide cache of SensorDataEntryRanges, reloaded on invalidate() or TTL"""
+
+    def __init__(self, ttl_seconds=RANGE_INDEX_TTL_SECONDS):
+        self.ttl_seconds = ttl_seconds
+        self._lock = threading.Lock()
+        self._loaded_at = None
+        self._loaded_version = None
+        self._generation = 0
+        self._trees: Dict[str, IntervalTree] = {}
+        self._by_entry: Dict[int, Dict[str, List[Tuple[int, int]]]] = {}
+
+    def invalidate(self):
+        """Reload in every process after ranges were written (call after the commit)"""
+        with self._lock:
+            self._loaded_at = None
+            self._generation += 1
+        cache_versions.bump_now('sensor_ranges')
+
+    def spans_for_entries(self, cursor, entry_ids, sensor_type: Optional[str] = None):
+        """Merged id spans the entries' ranges cover (optionally for one sensor type)"""
+        self._ensure_loaded(cursor)
+        spans = []
+        with self._lock:
+            for entry_id in entry_ids:
+                by_type = self._by_entry.get(entry_id, {})
+                if sensor_type is not None:
+                    spans.extend(by_type.get(sensor_type, []))
+                else:
+                    for type_spans in by_type.values():
+                        spans.extend(type_spans)
+        return merge_spans(spans)
+
+    def entry_spans(self, cursor, entry_ids, sensor_type):
+        """{entry_id: merged spans} for one sensor type, entries without ranges omitted"""
+        self._ensure_loaded(cursor)
+        with self._lock:
+            return {
+                entry_id: merge_spans(self._by_entry[entry_id][sensor_type])
+                for entry_id in entry_ids
+                if sensor_type in self._by_entry.get(entry_id, {})
+            }
+
+    def ranges_overlapping(self, cursor, start_sensor_id, end_sensor_id, sensor_type: Optional[str] = None):
+        """SensorDataEntryRanges ids whose span intersects start..end"""
+        self._ensure_loaded(cursor)
+        with self._lock:
+            if sensor_type is None:
+                trees = list(self._trees.values())
+            else:
+                trees = [self._trees[sensor_type]] if sensor_type in self._trees else []
+            range_ids = []
+            for tree in trees:
+                range_ids.extend(tree.overlapping(start_sensor_id, end_sensor_id))
+        return range_ids
+
+    def _ensure_loaded(self, cursor):
+        now = time.monotonic()
+        version = cache_versions.get('sensor_ranges')
+        with self._lock:
+            if (self._loaded_at is not None and self._loaded_version == version
+                    and now - self._loaded_at < self.ttl_seconds):
+                return
+            generation = self._generation
+
+        cursor.execute('SELECT id, entry_id, sensor_type, start_sensor_id, end_sensor_id FROM SensorDataEntryRanges')
+        rows = cursor.fetchall()
+
+        intervals: Dict[str, list] = {}
+        by_entry: Dict[int, Dict[str, list]] = {}
+        for row in rows:
+            sensor_type = row['sensor_type']
+            span = (row['start_sensor_id'], row['end_sensor_id'])
+            intervals.setdefault(sensor_type, []).append(span + (row['id'],))
+            by_entry.setdefault(row['entry_id'], {}).setdefault(sensor_type, []).append(span)
+
+        with self._lock:
+            self._trees = {sensor_type: IntervalTree(items) for sensor_type, items in intervals.items()}
+            self._by_entry = by_entry
+            # An invalidate() during the load means these rows may already be stale
+            self._loaded_at = now if generation == self._generation else None
+            self._loaded_version = version
+        logger.debug(f"Loaded {len(rows)} sensor data ranges into the range index")
+
+
+sensor_range_index = SensorRangeIndex()
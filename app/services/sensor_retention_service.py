@@ -0,0 +1,250 @@
+# app/services/sensor_retention_service.py
+"""
+Sensor Data Retention
+=====================
+
+Keeps the sensor tables bounded by pruning readings past their retention
+period, so the hot indexes (idx_shared_sensor_data_type_time,
+idx_sensor_logs_sensor_id_created_at) stay small.
+
+Tiers, each with its own retention (0 keeps data forever):
+
+* raw readings (SharedSensorData, SensorData) - per sensor type, with a
+  default for types without an override
+* one-minute and one-hour rollups (SensorDataRollup)
+* daily rollups are never pruned
+
+Raw readings are already aggregated into every rollup tier as they are
+inserted (sensor_rollup_service.record_rollups), so pruning them loses
+nothing the charts use. Before pruning a type its horizon is recorded in
+SensorRetentionHorizon, which stops rebuild_rollups() from recomputing
+(and so wiping) the buckets older than it.
+
+Cut-offs are aligned to midnight, the width of the coarsest bucket, so a
+bucket is never left half-backed by raw readings. Deletes run in small
+batches, each in its own transaction, so ingest is never blocked for long.
+"""
+
+import time
+import logging
+from datetime import datetime, timedelta
+
+from app.services.sensor_rollup_service import RESOLUTIONS
+from app.services.sensor_range_index import sensor_range_index
+from app.services.widget_cache import data_versions
+
+logger = logging.getLogger(__name__)
+
+RETENTION_BATCH_SIZE = 5000
+
+# Rollup tiers that can be pruned; RESOLUTIONS[-1] (daily) is kept forever
+PRUNABLE_RESOLUTIONS = RESOLUTIONS[:-1]
+
+
+def parse_retention_overrides(text):
+    """'Temperature=90, Signal Strength=7' -> {'Temperature': 90, 'Signal Strength': 7}"""
+    overrides = {}
+    for item in (text or '').split(','):
+        if '=' not in item:
+            continue
+        sensor_type, days = item.rsplit('=', 1)
+        try:
+            overrides[sensor_type.strip()] = max(0, int(days))
+        except ValueError:
+            logger.warning(f"Ignoring invalid sensor retention override: {item.strip()}")
+    return overrides
+
+
+def retention_cutoff(days, now):
+    """Midnight on or before now - days, or None when days keeps data forever"""
+    if not days:
+        return None
+    return (now - timedelta(days=days)).replace(hour=0, minute=0, second=0, microsecond=0)
+
+
+class SensorRetention:
+    """Retention policy plus the pruning job the task scheduler runs"""
+
+    def __init__(self):
+        self.default_days = 0
+        self.by_type = {}
+        self.log_days = 0
+        self.rollup_days = {resolution: 0 for resolution in PRUNABLE_RESOLUTIONS}
+        self.batch_size = RETENTION_BATCH_SIZE
+        self.interval_seconds = 3600
+        self.last_report = None
+
+    def init_app(self, app):
+        self.default_days = app.config.get('SENSOR_RETENTION_DAYS', 0)
+        self.by_type = parse_retention_overrides(app.config.get('SENSOR_RETENTION_BY_TYPE', ''))
+        self.log_days = app.config.get('SENSOR_LOG_RETENTION_DAYS', 0)
+        self.rollup_days = {
+            60: app.config.get('ROLLUP_MINUTE_RETENTION_DAYS', 0),
+            3600: app.config.get('ROLLUP_HOUR_RETENTION_DAYS', 0),
+        }
+        self.batch_size = app.config.get('SENSOR_RETENTION_BATCH_SIZE', RETENTION_BATCH_SIZE)
+        self.interval_seconds = app.config.get('SENSOR_RETENTION_INTERVAL', self.interval_seconds)
+
+    @property
+    def enabled(self):
+        return bool(self.default_days or any(self.by_type.values())
+                    or self.log_days or any(self.rollup_days.values()))
+
+    def raw_days(self, sensor_type):
+        return self.by_type.get(sensor_type, self.default_days)
+
+    def covering_resolution(self, resolution, since, now):
+        """
+        Finest rollup tier at or above ``resolution`` that still holds data
+        back to ``since`` (naive datetimes).
+        """
+        for candidate in RESOLUTIONS:
+            if candidate < resolution:
+                continue
+            cutoff = retention_cutoff(self.rollup_days.get(candidate, 0), now)
+            if cutoff is None or since is None or since >= cutoff:
+                return candidate
+        return RESOLUTIONS[-1]
+
+    # -- pruning job -------------------------------------------------------
+
+    def run(self, conn, now=None):
+        """Prune everything past retention; commits per batch and returns a report"""
+        started = time.monotonic()
+        now = now or datetime.now()
+        cursor = conn.cursor()
+        report = {
+            'started_at': now.isoformat(),
+            'deleted': {'SharedSensorData': 0, 'SensorData': 0, 'SensorLogs': 0, 'SensorDataRollup': 0},
+            'ranges_trimmed': 0,
+            'ranges_removed': 0,
+            'sensor_types': {},
+        }
+
+        pruned_types = set()
+        for sensor_type in self._sensor_types(cursor):
+            cutoff = retention_cutoff(self.raw_days(sensor_type), now)
+            if cutoff is None:
+                continue
+            deleted = self._prune_raw(conn, cursor, sensor_type, cutoff, report)
+            if deleted:
+                report['sensor_types'][sensor_type] = deleted
+                pruned_types.add(sensor_type)
+
+        cutoff = retention_cutoff(self.log_days, now)
+        if cutoff is not None:
+            report['deleted']['SensorLogs'] = self._delete_batches(
+                conn, cursor, 'DELETE FROM SensorLogs WHERE created_at < ? ORDER BY id LIMIT ?',
+                [cutoff.strftime('%Y-%m-%d %H:%M:%S')])
+
+        for resolution, days in sorted(self.rollup_days.items()):
+            cutoff = retention_cutoff(days, now)
+            if cutoff is None:
+                continue
+            report['deleted']['SensorDataRollup'] += self._delete_batches(
+                conn, cursor,
+                'DELETE FROM SensorDataRollup WHERE resolution = ? AND bucket_start < ? LIMIT ?',
+                [resolution, cutoff.strftime('%Y-%m-%d %H:%M:%S')])
+
+        if pruned_types:
+            data_versions.bump_sensor_types(cursor, pruned_types)
+            conn.commit()
+        if report['ranges_trimmed'] or report['ranges_removed']:
+            sensor_range_index.invalidate()
+
+        report['estimated_bytes'] = self._estimate_bytes(cursor, report['deleted'])
+        report['duration_seconds'] = round(time.monotonic() - started, 3)
+        self.last_report = report
+        logger.info(f"Sensor retention: deleted {report['deleted']}, "
+                    f"~{report['estimated_bytes']} bytes in {report['duration_seconds']}s")
+        return report
+
+    def _sensor_types(self, cursor):
+        if not self.default_days:
+            return sorted(sensor_type for sensor_type, days in self.by_type.items() if days)
+        cursor.execute('''
+            SELECT DISTINCT sensor_type FROM SharedSensorData
+            UNION
+            SELECT DISTINCT sensor_type FROM SensorData
+        ''')
+        return sorted(row['sensor_type'] for row in cursor.fetchall())
+
+    def _prune_raw(self, conn, cursor, sensor_type, cutoff, report):
+        cutoff_sql = cutoff.strftime('%Y-%m-%d %H:%M:%S')
+
+        # Record the horizon first so a rebuild running meanwhile keeps the old buckets
+        cursor.execute('''
+            INSERT INTO SensorRetentionHorizon (sensor_type, raw_before, updated_at)
+            VALUES (?, ?, ?)
+            ON DUPLICATE KEY UPDATE
+                raw_before = GREATEST(raw_before, VALUES(raw_before)),
+                updated_at = VALUES(updated_at)
+        ''', (sensor_type, cutoff_sql, datetime.now().isoformat()))
+        conn.commit()
+
+        deleted = self._delete_batches(
+            conn, cursor, 'DELETE FROM SensorData WHERE sensor_type = ? AND recorded_at < ? LIMIT ?',
+            [sensor_type, cutoff_sql])
+        report['deleted']['SensorData'] += deleted
+
+        # Shared readings are pruned below the first id still inside retention, so
+        # range links (which are id ranges with cascading foreign keys on their
+        # end points) can be moved onto rows that stay
+        cursor.execute('''
+            SELECT MIN(id) AS boundary FROM SharedSensorData
+            WHERE sensor_type = ? AND recorded_at >= ?
+        ''', (sensor_type, cutoff_sql))
+        boundary = cursor.fetchone()['boundary']
+        if boundary is None:
+            cursor.execute('SELECT MAX(id) AS last_id FROM SharedSensorData WHERE sensor_type = ?', (sensor_type,))
+            last_id = cursor.fetchone()['last_id']
+            if last_id is None:
+                return deleted
+            boundary = last_id + 1
+
+        cursor.execute('''
+            DELETE FROM SensorDataEntryRanges
+            WHERE sensor_type = ? AND end_sensor_id < ?
+        ''', (sensor_type, boundary))
+        report['ranges_removed'] += cursor.rowcount
+        cursor.execute('''
+            UPDATE SensorDataEntryRanges SET start_sensor_id = ?
+            WHERE sensor_type = ? AND start_sensor_id < ? AND end_sensor_id >= ?
+        ''', (boundary, sensor_type, boundary, boundary))
+        report['ranges_trimmed'] += cursor.rowcount
+        conn.commit()
+
+        shared = self._delete_batches(
+            conn, cursor, 'DELETE FROM SharedSensorData WHERE sensor_type = ? AND id < ? ORDER BY id LIMIT ?',
+            [sensor_type, boundary])
+        report['deleted']['SharedSensorData'] += shared
+        return deleted + shared
+
+    def _delete_batches(self, conn, cursor, sql, params):
+        total = 0
+        while True:
+            cursor.execute(sql, params + [self.batch_size])
+            deleted = cursor.rowcount
+            conn.commit()
+            total += deleted
+            if deleted < self.batch_size:
+                return total
+
+    @staticmethod
+    def _estimate_bytes(cursor, deleted):
+        """Approximate space freed for reuse, from the tables' average row length"""
+        tables = [table for table, rows in deleted.items() if rows]
+        if not tables:
+            return 0
+        try:
+            cursor.execute(f'''
+                SELECT TABLE_NAME, AVG_ROW_LENGTH FROM information_schema.TABLES
+                WHERE TABLE_SCHEMA = DATABASE() AND TABLE_NAME IN ({','.join('?' * len(tables))})
+            ''', tables)
+            lengths = {row['TABLE_NAME']: row['AVG_ROW_LENGTH'] or 0 for row in cursor.fetchall()}
+        except Exception:
+            return 0
+        return sum(deleted[table] * lengths.get(table, 0) for table in tables)
+
+
+sensor_retention = SensorRetention()
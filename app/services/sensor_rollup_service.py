@@ -0,0 +1,265 @@
+# app/services/sensor_rollup_service.py
+"""
+Sensor Data Rollups
+===================
+
+SensorDataRollup keeps min/max/sum/count per (entry, sensor_type) for
+one-minute, one-hour and one-day buckets, so trend charts over long ranges
+read a few hundred pre-aggregated rows instead of every raw sample.
+
+Rollups are maintained incrementally: every code path that inserts sensor
+readings calls record_rollups() in the same transaction. Paths that delete
+or re-link readings call rebuild_rollups() for the affected entries, which
+recomputes them from SensorData, SensorDataEntryLinks and
+SensorDataEntryRanges.
+
+Once retention has pruned a sensor type's raw readings, the rollups are the
+only record of that history. SensorRetentionHorizon stores the time raw
+readings were pruned before, and rebuild_rollups() leaves buckets older
+than it untouched (see sensor_retention_service).
+
+Buckets use the stored wall-clock time of recorded_at (its first 19
+characters), the same way the raw queries compare recorded_at strings.
+Values are parsed like the dashboard does: units stripped, non-numeric
+readings skipped.
+"""
+
+import re
+import logging
+from datetime import datetime, timedelta
+
+from app.services.widget_cache import data_versions
+
+logger = logging.getLogger(__name__)
+
+# Bucket widths in seconds, finest first
+RESOLUTIONS = (60, 3600, 86400)
+
+_EPOCH = datetime(1970, 1, 1)
+_NUMERIC_RE = re.compile(r'-?(\d+\.?\d*|\.\d+)')
+
+# SQL equivalents of parse_numeric() and bucket_start()
+_SQL_NUMBER = "REGEXP_REPLACE(src.value, '[^0-9.-]', '')"
+# (no '?' quantifiers: the db wrapper turns every '?' into a placeholder)
+_SQL_NUMBER_FILTER = _SQL_NUMBER + " REGEXP '^-{0,1}([0-9]+[.]{0,1}[0-9]*|[.][0-9]+)$'"
+# (guarded so strict mode never sees STR_TO_DATE fail inside INSERT ... SELECT)
+_SQL_DATETIME = ("CASE WHEN src.recorded_at REGEXP '^[0-9][0-9][0-9][0-9]-[0-9][0-9]-[0-9][0-9][ T][0-9][0-9]:[0-9][0-9]:[0-9][0-9]' "
+                 "THEN STR_TO_DATE(LEFT(REPLACE(src.recorded_at, 'T', ' '), 19), '%Y-%m-%d %H:%i:%s') END")
+_SQL_BUCKET = ("DATE_ADD('1970-01-01', INTERVAL FLOOR(TIMESTAMPDIFF(SECOND, '1970-01-01', "
+               + _SQL_DATETIME + ") / {res}) * {res} SECOND)")
+
+_UPSERT_SQL = '''
+    INSERT INTO SensorDataRollup
+    (entry_id, sensor_type, resolution, bucket_start, value_min, value_max, value_sum, value_count)
+    VALUES (?, ?, ?, ?, ?, ?, ?, ?)
+    ON DUPLICATE KEY UPDATE
+        value_min = LEAST(value_min, VALUES(value_min)),
+        value_max = GREATEST(value_max, VALUES(value_max)),
+        value_sum = value_sum + VALUES(value_sum),
+        value_count = value_count + VALUES(value_count)
+'''
+
+
+def parse_numeric(value):
+    """Numeric part of a stored reading ('23.5°C' -> 23.5), or None"""
+    if value is None:
+        return None
+    if isinstance(value, (int, float)) and not isinstance(value, bool):
+        return float(value)
+    stripped = re.sub(r'[^\d.-]', '', str(value))
+    if not _NUMERIC_RE.fullmatch(stripped):
+        return None
+    return float(stripped)
+
+
+def bucket_start(recorded_at, resolution):
+    """Start of the bucket holding recorded_at, as 'YYYY-MM-DD HH:MM:SS', or None"""
+    if isinstance(recorded_at, datetime):
+        recorded_at = recorded_at.isoformat()
+    try:
+        moment = datetime.strptime(str(recorded_at).replace('T', ' ')[:19], '%Y-%m-%d %H:%M:%S')
+    except (TypeError, ValueError):
+        return None
+    seconds = int((moment - _EPOCH).total_seconds())
+    start = _EPOCH + timedelta(seconds=seconds - seconds % resolution)
+    return start.strftime('%Y-%m-%d %H:%M:%S')
+
+
+def aggregate_rollups(points, resolutions=RESOLUTIONS):
+    """
+    Fold (entry_id, sensor_type, value, recorded_at) readings into rollup rows.
+
+    Returns upsert parameter tuples (entry_id, sensor_type, resolution,
+    bucket_start, min, max, sum, count); unparseable readings are skipped.
+    """
+    buckets = {}
+    for entry_id, sensor_type, value, recorded_at in points:
+        number = parse_numeric(value)
+        if number is None:
+            continue
+        for resolution in resolutions:
+            start = bucket_start(recorded_at, resolution)
+            if start is None:
+                break
+            key = (entry_id, sensor_type, resolution, start)
+            bucket = buckets.get(key)
+            if bucket is None:
+                buckets[key] = [number, number, number, 1]
+            else:
+                bucket[0] = min(bucket[0], number)
+                bucket[1] = max(bucket[1], number)
+                bucket[2] += number
+                bucket[3] += 1
+    return [key + tuple(bucket) for key, bucket in buckets.items()]
+
+
+def record_rollups(cursor, points):
+    """Add freshly inserted readings to the rollups, in the caller's transaction"""
+    rows = aggregate_rollups(points)
+    if rows:
+        cursor.executemany(_UPSERT_SQL, rows)
+        data_versions.bump_sensor_types(cursor, {row[1] for row in rows})
+    return len(rows)
+
+
+def choose_resolution(span_seconds, max_points):
+    """
+    Coarsest bucket width that still draws at least a quarter of max_points.
+
+    Returns None when even one-minute buckets would be too sparse, meaning
+    the raw readings should be used.
+    """
+    if not span_seconds or span_seconds <= 0:
+        return None
+    wanted = max(1, max_points // 4)
+    for resolution in reversed(RESOLUTIONS):
+        if span_seconds / resolution >= wanted:
+            return resolution
+    return None
+
+
+def compaction_horizons(cursor, sensor_type=None):
+    """{sensor_type: datetime} before which raw readings have been pruned"""
+    query = 'SELECT sensor_type, raw_before FROM SensorRetentionHorizon'
+    params = ()
+    if sensor_type is not None:
+        query += ' WHERE sensor_type = ?'
+        params = (sensor_type,)
+    cursor.execute(query, params)
+    horizons = {}
+    for row in cursor.fetchall():
+        raw_before = row['raw_before']
+        if not isinstance(raw_before, datetime):
+            raw_before = datetime.fromisoformat(str(raw_before))
+        horizons[row['sensor_type']] = raw_before
+    return horizons
+
+
+def _horizon_filter(horizons, type_col, time_col):
+    """SQL and params excluding everything older than each type's horizon"""
+    sql = ''.join(f' AND NOT ({type_col} = ? AND {time_col} < ?)' for _ in horizons)
+    params = []
+    for sensor_type, raw_before in sorted(horizons.items()):
+        params.extend([sensor_type, raw_before.strftime('%Y-%m-%d %H:%M:%S')])
+    return sql, params
+
+
+def _source_sql(entry_filter, type_filter):
+    """Every (entry_id, sensor_type, value, recorded_at) reading an entry has, once"""
+    return f'''
+        SELECT sd.entry_id, sd.sensor_type, sd.value, sd.recorded_at
+        FROM SensorData sd
+        WHERE 1 = 1 {entry_filter.format(col='sd.entry_id')} {type_filter.format(col='sd.sensor_type', time='sd.recorded_at')}
+        UNION ALL
+        SELECT shared.entry_id, shared.sensor_type, shared.value, shared.recorded_at
+        FROM (
+            SELECT sder.entry_id, ssd.id, ssd.sensor_type, ssd.value, ssd.recorded_at
+            FROM SharedSensorData ssd
+            JOIN SensorDataEntryRanges sder ON
+                ssd.sensor_type = sder.sensor_type
+                AND ssd.id BETWEEN sder.start_sensor_id AND sder.end_sensor_id
+            WHERE 1 = 1 {entry_filter.format(col='sder.entry_id')} {type_filter.format(col='ssd.sensor_type', time='ssd.recorded_at')}
+            UNION
+            SELECT sdel.entry_id, ssd.id, ssd.sensor_type, ssd.value, ssd.recorded_at
+            FROM SharedSensorData ssd
+            JOIN SensorDataEntryLinks sdel ON ssd.id = sdel.shared_sensor_data_id
+            WHERE 1 = 1 {entry_filter.format(col='sdel.entry_id')} {type_filter.format(col='ssd.sensor_type', time='ssd.recorded_at')}
+        ) shared
+    '''
+
+
+def rebuild_rollups(cursor, entry_ids=None, sensor_type=None):
+    """
+    Recompute rollups from the raw tables, for some entries or for everything.
+
+    Used by the init_db backfill and after readings are deleted or re-linked;
+    runs in the caller's transaction. Buckets older than a type's compaction
+    horizon are kept as they are, their raw readings no longer exist.
+    """
+    entry_filter = ''
+    type_filter = ''
+    scope = []
+    if entry_ids is not None:
+        entry_ids = sorted({int(entry_id) for entry_id in entry_ids})
+        if not entry_ids:
+            return
+        entry_filter = 'AND {col} IN (' + ','.join('?' * len(entry_ids)) + ')'
+        scope.extend(entry_ids)
+    if sensor_type is not None:
+        type_filter = 'AND {col} = ?'
+        scope.append(sensor_type)
+
+    horizons = compaction_horizons(cursor, sensor_type)
+    horizon_sql, horizon_params = _horizon_filter(horizons, '{col}', '{time}')
+    type_filter += horizon_sql
+
+    delete_sql = 'DELETE FROM SensorDataRollup WHERE 1 = 1'
+    if entry_ids is not None:
+        delete_sql += ' AND entry_id IN (' + ','.join('?' * len(entry_ids)) + ')'
+    if sensor_type is not None:
+        delete_sql += ' AND sensor_type = ?'
+    delete_sql += _horizon_filter(horizons, 'sensor_type', 'bucket_start')[0]
+    cursor.execute(delete_sql, scope + horizon_params)
+    scope += horizon_params
+
+    source = _source_sql(entry_filter, type_filter)
+    for resolution in RESOLUTIONS:
+        bucket = _SQL_BUCKET.format(res=resolution)
+        cursor.execute(f'''
+            INSERT INTO SensorDataRollup
+            (entry_id, sensor_type, resolution, bucket_start, value_min, value_max, value_sum, value_count)
+            SELECT src.entry_id, src.sensor_type, {resolution}, {bucket},
+                   MIN({_SQL_NUMBER} + 0), MAX({_SQL_NUMBER} + 0), SUM({_SQL_NUMBER} + 0), COUNT(*)
+            FROM ({source}) src
+            WHERE {_SQL_NUMBER_FILTER} AND {_SQL_DATETIME} IS NOT NULL
+            GROUP BY src.entry_id, src.sensor_type, {bucket}
+        ''', scope * 3)
+
+    if sensor_type is not None:
+        data_versions.bump_sensor_types(cursor, [sensor_type])
+    else:
+        data_versions.bump_entries(cursor)  # every widget depends on the entries version
+
+
+def entries_for_shared_reading(cursor, shared_sensor_id):
+    """(entry_id, sensor_type) pairs whose rollups include a SharedSensorData row"""
+    cursor.execute('''
+        SELECT sdel.entry_id, ssd.sensor_type
+        FROM SharedSensorData ssd
+        JOIN SensorDataEntryLinks sdel ON ssd.id = sdel.shared_sensor_data_id
+        WHERE ssd.id = ?
+        UNION
+        SELECT sder.entry_id, ssd.sensor_type
+        FROM SharedSensorData ssd
+        JOIN SensorDataEntryRanges sder ON
+            ssd.sensor_type = sder.sensor_type
+            AND ssd.id BETWEEN sder.start_sensor_id AND sder.end_sensor_id
+        WHERE ssd.id = ?
+    ''', (shared_sensor_id, shared_sensor_id))
+    return [(row['entry_id'], row['sensor_type']) for row in cursor.fetchall()]
+
+
+def rebuild_rollups_for(cursor, pairs):
+    """rebuild_rollups() for each distinct (entry_id, sensor_type) pair"""
+    for entry_id, sensor_type in sorted(set(pairs)):
+        rebuild_rollups(cursor, [entry_id], sensor_type)
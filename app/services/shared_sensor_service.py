@@ -9,6 +9,9 @@ import logging
 from datetime import datetime, timezone
 from typing import List, Dict, Any, Optional
 from app.db import get_connection
+from app.services.sensor_rollup_service import (
+    record_rollups, rebuild_rollups, rebuild_rollups_for, entries_for_shared_reading
+)
 
 logger = logging.getLogger(__name__)
 
@@ -104,6 +107,7 @@ class SharedSensorDataService:
                     VALUES (?, ?, ?)
                 ''', (shared_sensor_id, entry_id, link_type))
             
+            record_rollups(cursor, [(entry_id, sensor_type, value, recorded_at) for entry_id in entry_ids])
             conn.commit()
             
             # Auto-register sensor type if needed
@@ -220,7 +224,9 @@ class SharedSensorDataService:
                 except pymysql.IntegrityError:
                     # Link already exists, skip
                     logger.debug(f"Link between sensor {shared_sensor_id} and entry {entry_id} already exists")
-                    
+            
+            if links_created:
+                rebuild_rollups_for(cursor, entries_for_shared_reading(cursor, shared_sensor_id))
             conn.commit()
             logger.info(f"Created {links_created} new sensor data links")
             return links_created
@@ -252,6 +258,12 @@ class SharedSensorDataService:
         
         removed = cursor.rowcount > 0
         
+        if removed:
+            cursor.execute('SELECT sensor_type FROM SharedSensorData WHERE id = ?', (shared_sensor_id,))
+            reading = cursor.fetchone()
+            if reading:
+                rebuild_rollups(cursor, [entry_id], reading['sensor_type'])
+        
         # If this was the last link, optionally delete the sensor data
         cursor.execute('''
             SELECT COUNT(*) FROM SensorDataEntryLinks 
@@ -0,0 +1,163 @@
+# app/services/widget_cache.py
+"""
+Dashboard Widget Cache
+======================
+
+Caches get_widget_data() results keyed by (widget config hash, data version).
+
+Data versions live in the CacheVersion table (app/cache_versions.py), so a
+write served by any web worker or the background worker invalidates the
+results cached by all of them:
+
+* ``entries`` - bumped after every successful write request outside the
+  device/sensor ingest blueprints (see init_app), so edits to entries,
+  notes, metrics, states or saved searches invalidate every widget.
+* ``sensor:<type>`` - bumped by the sensor rollup helpers, in the writing
+  transaction, whenever readings of that type are stored, deleted or
+  re-linked, so sensor pushes only invalidate the charts that plot that type.
+
+A widget's key includes the versions it depends on, so a write simply makes
+older keys unreachable; they age out of the LRU. A TTL bounds how stale a
+result can get from what the versions can't see (time relative windows
+like "last 7 days", writes made outside the app).
+"""
+
+import hashlib
+import json
+import threading
+import time
+import logging
+from collections import OrderedDict
+
+from app.cache_versions import cache_versions
+
+logger = logging.getLogger(__name__)
+
+WIDGET_CACHE_TTL_SECONDS = 300
+WIDGET_CACHE_MAX_ENTRIES = 512
+
+# Widgets whose data doesn't come from this database, or that cache themselves
+UNCACHED_WIDGET_TYPES = {'ai_summary', 'git_commits', 'git_commits_chart'}
+
+# Blueprints whose writes never touch what widgets show (sensor data is versioned per type)
+INGEST_BLUEPRINTS = {'sensor_master_api', 'device_api', 'health_api'}
+
+
+class DataVersions:
+    """Shared counters for the data widgets are computed from"""
+
+    def get(self, key):
+        return cache_versions.get(key)
+
+    def bump_entries(self, cursor=None):
+        """In the caller's transaction when given a cursor, else right away"""
+        if cursor is None:
+            cache_versions.bump_now('entries')
+        else:
+            cache_versions.bump(cursor, 'entries')
+
+    def bump_sensor_types(self, cursor, sensor_types):
+        # 'sensor:*' covers widgets that chart every sensor type
+        cache_versions.bump(cursor, 'sensor:*', *{f'sensor:{sensor_type}' for sensor_type in sensor_types})
+
+
+data_versions = DataVersions()
+
+
+def widget_dependencies(widget, config):
+    """The data version tuple a widget's result depends on"""
+    versions = [data_versions.get('entries')]
+    if widget.get('data_source_type') == 'sensor_data':
+        sensor_type = config.get('sensor_type')
+        versions.append(data_versions.get(f'sensor:{sensor_type or "*"}'))
+    return tuple(versions)
+
+
+def widget_key(widget, config):
+    """Hash of everything that determines a widget's data"""
+    payload = json.dumps({
+        'type': widget.get('widget_type'),
+        'source_type': widget.get('data_source_type'),
+        'source_id': widget.get('data_source_id'),
+        'config': config,
+    }, sort_keys=True, default=str)
+    return hashlib.sha1(payload.encode('utf-8')).hexdigest()
+
+
+class WidgetCache:
+    """LRU of widget results with hit/miss counters"""
+
+    def __init__(self, ttl_seconds=WIDGET_CACHE_TTL_SECONDS, max_entries=WIDGET_CACHE_MAX_ENTRIES):
+        self.ttl_seconds = ttl_seconds
+        self.max_entries = max_entries
+        self.enabled = True
+        self._entries = OrderedDict()
+        self._lock = threading.Lock()
+        self._stats = {'hits': 0, 'misses': 0, 'bypassed': 0, 'stores': 0}
+
+    def init_app(self, app):
+        """Read settings and bump the entries version after write requests"""
+        from flask import request
+
+        self.enabled = app.config.get('WIDGET_CACHE_ENABLED', self.enabled)
+        self.ttl_seconds = app.config.get('WIDGET_CACHE_TTL', self.ttl_seconds)
+        self.max_entries = app.config.get('WIDGET_CACHE_MAX_ENTRIES', self.max_entries)
+
+        @app.after_request
+        def bump_entries_version(response):
+            if (request.method not in ('GET', 'HEAD', 'OPTIONS')
+                    and response.status_code < 400
+                    and request.blueprint not in INGEST_BLUEPRINTS):
+                data_versions.bump_entries()
+            return response
+
+    def get_or_compute(self, widget, config, compute, refresh=False):
+        """Cached result for a widget, computing (and storing) it on a miss or refresh"""
+        if not self.enabled or widget.get('widget_type') in UNCACHED_WIDGET_TYPES:
+            with self._lock:
+                self._stats['bypassed'] += 1
+            return compute()
+
+        # Read versions before computing: a write landing mid-compute bumps
+        # them, so the possibly stale result is stored under an old key
+        key = (widget_key(widget, config), widget_dependencies(widget, config))
+        now = time.monotonic()
+        with self._lock:
+            cached = None if refresh else self._entries.get(key)
+            if cached is not None and now - cached[0] < self.ttl_seconds:
+                self._entries.move_to_end(key)
+                self._stats['hits'] += 1
+                return cached[1]
+            self._stats['misses'] += 1
+
+        result = compute()
+
+        # Errors are not cached so a fixed configuration shows up straight away
+        if isinstance(result, dict) and not result.get('error'):
+            with self._lock:
+                self._entries[key] = (now, result)
+                self._entries.move_to_end(key)
+                self._stats['stores'] += 1
+                while len(self._entries) > self.max_entries:
+                    self._entries.popitem(last=False)
+        return result
+
+    def clear(self):
+        with self._lock:
+            self._entries.clear()
+
+    def stats(self):
+        with self._lock:
+            snapshot = dict(self._stats)
+            snapshot['size'] = len(self._entries)
+        lookups = snapshot['hits'] + snapshot['misses']
+        snapshot.update({
+            'enabled': self.enabled,
+            'hit_rate': round(snapshot['hits'] / lookups, 3) if lookups else 0.0,
+            'ttl_seconds': self.ttl_seconds,
+            'capacity': self.max_entries,
+        })
+        return snapshot
+
+
+widget_cache = WidgetCache()
@@ -0,0 +1,62 @@
+/**
+ * Background jobs
+ *
+ * fetchDeferred(url, options) sends a request with "Prefer: respond-async".
+ * Views that run on the background worker answer 202 with a job status
+ * URL, which is polled until the job finishes (see app/job_queue.py).
+ * Resolves to { ok, status, data } describing the view's own response, so
+ * callers handle it the same way whether or not the request was deferred.
+ */
+(function () {
+    const POLL_INTERVAL_MS = 1000;
+    const MAX_POLL_INTERVAL_MS = 5000;
+
+    const sleep = (ms) => new Promise(resolve => setTimeout(resolve, ms));
+
+    async function readBody(response) {
+        const text = await response.text();
+        try {
+            return text ? JSON.parse(text) : {};
+        } catch (e) {
+            return { message: text };
+        }
+    }
+
+    async function waitForJob(statusUrl) {
+        let delay = POLL_INTERVAL_MS;
+        while (true) {
+            await sleep(delay);
+            delay = Math.min(delay * 1.5, MAX_POLL_INTERVAL_MS);
+
+            const response = await fetch(statusUrl, { cache: 'no-store' });
+            if (!response.ok) {
+                const data = await readBody(response);
+                throw new Error(data.error || `Job status request failed (${response.status})`);
+            }
+            const job = await response.json();
+            if (job.status === 'done') {
+                const result = job.result || {};
+                const status = result.status_code || 200;
+                return { ok: status >= 200 && status < 300, status, data: result.body || {} };
+            }
+            if (job.status === 'failed') {
+                const message = job.error || 'Background job failed';
+                return { ok: false, status: 500, data: { status: 'error', success: false, message, error: message } };
+            }
+        }
+    }
+
+    async function fetchDeferred(url, options = {}) {
+        const headers = new Headers(options.headers || {});
+        headers.set('Prefer', 'respond-async');
+        const response = await fetch(url, { ...options, headers });
+
+        if (response.status === 202) {
+            const accepted = await response.json();
+            return waitForJob(accepted.status_url || response.headers.get('Location'));
+        }
+        return { ok: response.ok, status: response.status, data: await readBody(response) };
+    }
+
+    window.fetchDeferred = fetchDeferred;
+})();
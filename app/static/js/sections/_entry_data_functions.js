@@ -689,12 +689,16 @@ async function edRefresh(sid) {
     const xAxisType = document.getElementById(`edXAxisType-${sid}`).value;
     const xAxisField = document.getElementById(`edXAxisField-${sid}`).value;
 
+    // About two points per pixel is all a line chart can show; the server downsamples the rest
+    const chartWidth = document.getElementById(`edChartContainer-${sid}`)?.clientWidth || 600;
+
     const params = new URLSearchParams({
         metric_ids: metricIds.join(','),
         entry_ids: targetEntryIds.join(','),
         time_range: timeRange,
         x_axis_type: xAxisType,
         x_axis_field: xAxisField,
+        max_points: Math.max(200, Math.round(chartWidth * 2)),
     });
 
     try {
@@ -190,13 +190,12 @@ document.addEventListener('DOMContentLoaded', function() {
                     syncNowBtn.addEventListener('click', async function() {
                         await runWithLoadingButton(syncNowBtn, '<i class="fas fa-spinner fa-spin me-1"></i>Syncing...', async () => {
                             try {
-                                const response = await fetch('/garmin/sync', { method: 'POST', headers: { 'Content-Type': 'application/json' }, body: JSON.stringify({}) });
-                                const data = await response.json();
-                                if (response.ok && data.status === 'success') {
+                                const { ok, data } = await fetchDeferred('/garmin/sync', { method: 'POST', headers: { 'Content-Type': 'application/json' }, body: JSON.stringify({}) });
+                                if (ok && data.status === 'success') {
                                     displayStatus('garminSettingsStatus', '✅ Garmin sync completed: ' + data.message, 'alert-success');
                                     const lbl = document.getElementById('garminLastSyncLabel');
                                     if (lbl) lbl.textContent = 'Last synced: just now';
-                                } else if (response.ok && data.status === 'warning') {
+                                } else if (ok && data.status === 'warning') {
                                     displayStatus('garminSettingsStatus', '⚠️ ' + data.message, 'alert-warning');
                                 } else {
                                     displayStatus('garminSettingsStatus', '❌ Garmin sync failed: ' + (data.message || 'Unknown error'), 'alert-danger');
@@ -1155,9 +1155,8 @@
             if (testStravaSyncNowBtn) {
                 testStravaSyncNowBtn.addEventListener('click', async function() {
                     try {
-                        const response = await fetch('/strava/sync', { method: 'POST' });
-                        const data = await response.json();
-                        if (response.ok) {
+                        const { ok, data } = await fetchDeferred('/strava/sync', { method: 'POST' });
+                        if (ok) {
                             const msg = data && data.message ? data.message : 'Sync completed.';
                             displayStatus('stravaSyncStatusMessage', '✅ Strava sync triggered: ' + msg, 'alert-success');
                         } else {
@@ -1218,12 +1217,11 @@
             if (testGarminSyncNowBtn) {
                 testGarminSyncNowBtn.addEventListener('click', async function() {
                     try {
-                        const response = await fetch('/garmin/sync', { method: 'POST', headers: { 'Content-Type': 'application/json' }, body: JSON.stringify({}) });
-                        const data = await response.json();
-                        if (response.ok && data.status === 'success') {
+                        const { ok, data } = await fetchDeferred('/garmin/sync', { method: 'POST', headers: { 'Content-Type': 'application/json' }, body: JSON.stringify({}) });
+                        if (ok && data.status === 'success') {
                             displayStatus('garminSyncStatusMessage', '✅ Garmin sync triggered: ' + (data.message || 'Done.'), 'alert-success');
                             setTimeout(() => location.reload(), 900);
-                        } else if (response.ok && data.status === 'warning') {
+                        } else if (ok && data.status === 'warning') {
                             displayStatus('garminSyncStatusMessage', '⚠️ ' + data.message, 'alert-warning');
                         } else {
                             displayStatus('garminSyncStatusMessage', '❌ Garmin sync failed: ' + (data.message || 'Unknown error'), 'alert-danger');
@@ -1294,10 +1292,9 @@
                     this.innerHTML = '<i class="fas fa-spinner fa-spin me-1"></i>Syncing...';
 
                     try {
-                        const response = await fetch('/strava/sync', { method: 'POST' });
-                        const data = await response.json();
+                        const { ok, data } = await fetchDeferred('/strava/sync', { method: 'POST' });
 
-                        if (response.ok && data.status === 'success') {
+                        if (ok && data.status === 'success') {
                             alert('Sync Complete: ' + data.message);
                             location.reload();
                         } else if (data.status === 'skipped') {
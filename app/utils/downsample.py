@@ -0,0 +1,155 @@
+# app/utils/downsample.py
+"""
+Server-side decimation for chart data.
+
+lttb() implements Largest-Triangle-Three-Buckets: it keeps the first and
+last point and, from each of max_points - 2 equal-count buckets in between,
+the point forming the largest triangle with the previously kept point and
+the average of the next bucket. Peaks and troughs survive, flat runs thin
+out, and a 600px chart looks the same with a few hundred points as with
+tens of thousands.
+
+It consumes its input as a stream and holds only two buckets at a time, so
+callers can feed it rows straight from an unbuffered cursor (stream_rows())
+when they know the row count up front.
+"""
+
+import calendar
+import itertools
+from datetime import datetime
+
+
+def lttb(points, max_points, total=None):
+    """
+    Downsample (x, y, item) tuples, sorted by x, to at most max_points items.
+
+    ``total`` is the number of points; it is required when ``points`` is an
+    iterator. Yields the kept items in order. If the stream turns out longer
+    than ``total`` the extra points fold into the last bucket.
+    """
+    if total is None:
+        points = list(points)
+        total = len(points)
+    max_points = max(int(max_points), 3)
+    if total <= max_points:
+        for point in points:
+            yield point[2]
+        return
+
+    it = iter(points)
+    first = next(it, None)
+    if first is None:
+        return
+    yield first[2]
+
+    every = (total - 2) / (max_points - 2)
+
+    def bucket_end(i):
+        # Bucket i holds indices [bucket_end(i - 1), bucket_end(i)); the last point stands alone
+        return min(int((i + 1) * every) + 1, total - 1)
+
+    consumed = bucket_end(0)
+    current = list(itertools.islice(it, consumed - 1))
+    anchor = first
+    last_kept = last_seen = first
+
+    for i in range(max_points - 2):
+        if not current:
+            break
+        if i < max_points - 3:
+            end = bucket_end(i + 1)
+            following = list(itertools.islice(it, end - consumed))
+            consumed = end
+        else:
+            following = list(it)
+
+        if following:
+            avg_x = sum(p[0] for p in following) / len(following)
+            avg_y = sum(p[1] for p in following) / len(following)
+        else:
+            avg_x, avg_y = current[-1][0], current[-1][1]
+
+        ax, ay = anchor[0], anchor[1]
+        anchor = max(
+            current,
+            key=lambda p: abs((ax - avg_x) * (p[1] - ay) - (ax - p[0]) * (avg_y - ay))
+        )
+        yield anchor[2]
+        last_kept = anchor
+        last_seen = current[-1]
+        current = following
+
+    # Whatever is left is the tail; always end on the final point seen
+    tail = current or list(it)
+    if tail:
+        last_seen = tail[-1]
+    if last_seen is not last_kept:
+        yield last_seen[2]
+
+
+def timestamp_seconds(value):
+    """Seconds since the epoch for a datetime or timestamp string (wall clock, no tz shift), or None"""
+    if isinstance(value, datetime):
+        moment = value
+    else:
+        try:
+            moment = datetime.fromisoformat(str(value).replace('Z', '+00:00'))
+        except (TypeError, ValueError):
+            return None
+    if moment.tzinfo is not None:
+        return moment.timestamp()
+    return calendar.timegm(moment.timetuple()) + moment.microsecond / 1e6
+
+
+def decimate_rows(rows, total, max_points, x_key, y_key):
+    """
+    LTTB over dict rows ordered by ``x_key``; yields the kept rows.
+
+    Rows whose x can't be parsed reuse the previous x, and rows whose y isn't
+    numeric sit at the previous y, so they never win a bucket on their own.
+    """
+    def as_points():
+        last_x, last_y = 0.0, 0.0
+        for row in rows:
+            x = timestamp_seconds(row[x_key])
+            if x is None:
+                x = last_x
+            try:
+                y = float(row[y_key])
+            except (TypeError, ValueError):
+                y = last_y
+            last_x, last_y = x, y
+            yield (x, y, row)
+
+    return lttb(as_points(), max_points, total)
+
+
+def stream_rows(conn, query, params, batch_size=1000):
+    """Yield rows from an unbuffered cursor so large results are never held in memory at once"""
+    cursor = conn.cursor(unbuffered=True)
+    try:
+        cursor.execute(query, params)
+        while True:
+            batch = cursor.fetchmany(batch_size)
+            if not batch:
+                break
+            yield from batch
+    finally:
+        cursor.close()
+
+
+def fetch_series(conn, cursor, query, params, count, max_points, x_key='recorded_at', y_key='value'):
+    """
+    Rows of a chart series query, LTTB-downsampled to max_points if it has more.
+
+    ``count`` is a (query, params) pair returning the series length as
+    ``total``. When decimation is needed the rows are streamed through an
+    unbuffered cursor instead of being fetched all at once.
+    """
+    if max_points:
+        cursor.execute(*count)
+        total = cursor.fetchone()['total']
+        if total > max_points:
+            return list(decimate_rows(stream_rows(conn, query, params), total, max_points, x_key, y_key))
+    cursor.execute(query, params)
+    return cursor.fetchall()
@@ -0,0 +1,84 @@
+# template_app/app/utils/event_stream.py
+"""
+Streaming response helpers (NDJSON and Server-Sent Events)
+
+NDJSON writes one JSON document per line as rows are read, so large result
+sets never sit in memory as a single list. SSE keeps a response open and
+pushes events as they arrive; browsers reconnect on their own and send the
+last event id back in the Last-Event-ID header.
+"""
+
+import json
+import time
+
+from flask import Response, request, stream_with_context
+
+NDJSON_MIMETYPE = 'application/x-ndjson'
+SSE_MIMETYPE = 'text/event-stream'
+
+
+def stream_format():
+    """'sse', 'ndjson' or None (plain JSON), from ?format= or the Accept header"""
+    requested = request.args.get('format', '').lower()
+    if requested in ('sse', 'ndjson'):
+        return requested
+    accept = request.headers.get('Accept', '')
+    if SSE_MIMETYPE in accept:
+        return 'sse'
+    if NDJSON_MIMETYPE in accept:
+        return 'ndjson'
+    return None
+
+
+def ndjson_response(items):
+    """Stream an iterable of JSON-serialisable items, one per line"""
+    def generate():
+        for item in items:
+            yield json.dumps(item, default=str) + '\n'
+
+    return Response(stream_with_context(generate()), mimetype=NDJSON_MIMETYPE)
+
+
+def sse_event(data, event=None, event_id=None):
+    lines = []
+    if event_id is not None:
+        lines.append(f'id: {event_id}')
+    if event:
+        lines.append(f'event: {event}')
+    lines.append(f'data: {json.dumps(data, default=str)}')
+    return '\n'.join(lines) + '\n\n'
+
+
+def sse_tail(poll, last_id, event, poll_seconds=1.0, max_seconds=300, keepalive_seconds=15):
+    """
+    SSE response that calls poll(last_id) -> [(id, item)] until max_seconds.
+
+    The stream ends after max_seconds so a worker thread is never held
+    indefinitely; EventSource reconnects and resumes from Last-Event-ID.
+    """
+    def generate():
+        nonlocal last_id
+        yield f'retry: {int(poll_seconds * 1000)}\n\n'
+        started = last_sent = time.monotonic()
+        while time.monotonic() - started < max_seconds:
+            for item_id, item in poll(last_id):
+                last_id = max(last_id, item_id)
+                yield sse_event(item, event=event, event_id=item_id)
+                last_sent = time.monotonic()
+            if time.monotonic() - last_sent >= keepalive_seconds:
+                yield ': keepalive\n\n'
+                last_sent = time.monotonic()
+            time.sleep(poll_seconds)
+
+    response = Response(stream_with_context(generate()), mimetype=SSE_MIMETYPE)
+    response.headers['Cache-Control'] = 'no-cache'
+    response.headers['X-Accel-Buffering'] = 'no'  # don't let nginx buffer the stream
+    return response
+
+
+def last_event_id(default=0):
+    """Resume point sent by a reconnecting EventSource"""
+    try:
+        return int(request.headers.get('Last-Event-ID', default))
+    except (TypeError, ValueError):
+        return default
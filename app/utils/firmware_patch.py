@@ -0,0 +1,124 @@
+# template_app/app/utils/firmware_patch.py
+"""
+Re-target a prebuilt ESP32 firmware image without recompiling
+
+Generated Arduino firmware keeps its per-device settings (Wi-Fi, master URL,
+sensor identity) in one fixed-size block that starts with DEVICE_CONFIG_MAGIC.
+A fleet can be flashed from a single build: find the block, overwrite the
+fields, then fix up the image checksum and the appended SHA-256 that the
+ESP32 bootloader verifies.
+
+Images signed for secure boot cannot be patched - the signature would no
+longer match.
+"""
+
+import hashlib
+import struct
+
+DEVICE_CONFIG_MAGIC = b'SMCFG01\x00'
+
+# (field, bytes including the terminating NUL), in block order
+DEVICE_CONFIG_FIELDS = (
+    ('wifi_ssid', 33),
+    ('wifi_password', 65),
+    ('master_url', 128),
+    ('sensor_id', 64),
+    ('sensor_type', 64),
+    ('sensor_name', 64),
+)
+
+IMAGE_MAGIC = 0xE9
+IMAGE_HEADER_SIZE = 24       # common header + extended header
+HASH_APPENDED_OFFSET = 23
+CHECKSUM_SEED = 0xEF
+
+
+class FirmwarePatchError(ValueError):
+    pass
+
+
+def check_device_values(values):
+    """Raise FirmwarePatchError if a value does not fit its field"""
+    for field, size in DEVICE_CONFIG_FIELDS:
+        encoded = str(values.get(field, '')).encode('utf-8')
+        if len(encoded) >= size:
+            raise FirmwarePatchError(f"{field} is too long ({len(encoded)} bytes, max {size - 1})")
+        if b'\x00' in encoded:
+            raise FirmwarePatchError(f"{field} contains a NUL byte")
+
+
+def pack_device_block(values):
+    """The device block as it appears in a built image"""
+    check_device_values(values)
+    block = bytearray(DEVICE_CONFIG_MAGIC)
+    for field, size in DEVICE_CONFIG_FIELDS:
+        block += str(values.get(field, '')).encode('utf-8').ljust(size, b'\x00')
+    return bytes(block)
+
+
+def _segments(image):
+    """(data_offset, length) of each segment, and the offset after the last"""
+    if len(image) < IMAGE_HEADER_SIZE or image[0] != IMAGE_MAGIC:
+        raise FirmwarePatchError("Not an ESP32 application image")
+
+    segments = []
+    offset = IMAGE_HEADER_SIZE
+    for _ in range(image[1]):
+        if offset + 8 > len(image):
+            raise FirmwarePatchError("Truncated segment header")
+        _, length = struct.unpack_from('<II', image, offset)
+        offset += 8
+        if offset + length > len(image):
+            raise FirmwarePatchError("Truncated segment")
+        segments.append((offset, length))
+        offset += length
+    return segments, offset
+
+
+def patch_firmware(image, values):
+    """
+    Copy of ``image`` with its device block set to ``values``.
+
+    ``values`` maps DEVICE_CONFIG_FIELDS names to strings; missing fields
+    become empty. Raises FirmwarePatchError if the image is malformed or
+    has no (or several) device blocks.
+    """
+    image = bytearray(image)
+    segments, end = _segments(image)
+    block = pack_device_block(values)
+
+    found = [pos for start, length in segments
+             for pos in _find_all(image, DEVICE_CONFIG_MAGIC, start, start + length)]
+    if not found:
+        raise FirmwarePatchError("No device config block - was this image built from generated firmware?")
+    if len(found) > 1:
+        raise FirmwarePatchError("Several device config blocks found")
+    pos = found[0]
+    if not any(start <= pos and pos + len(block) <= start + length for start, length in segments):
+        raise FirmwarePatchError("Device config block crosses a segment boundary")
+
+    # The checksum byte (CHECKSUM_SEED XOR every segment byte) ends a 16-byte
+    # aligned run after the last segment; only the block's bytes change
+    checksum_at = end + (15 - end % 16)
+    if checksum_at >= len(image):
+        raise FirmwarePatchError("Image has no checksum")
+    checksum = image[checksum_at]
+    for old, new in zip(image[pos:pos + len(block)], block):
+        checksum ^= old ^ new
+    image[checksum_at] = checksum
+    image[pos:pos + len(block)] = block
+
+    if image[HASH_APPENDED_OFFSET] == 1:
+        hash_at = checksum_at + 1
+        if hash_at + 32 > len(image):
+            raise FirmwarePatchError("Image has no appended hash")
+        image[hash_at:hash_at + 32] = hashlib.sha256(image[:hash_at]).digest()
+
+    return bytes(image)
+
+
+def _find_all(data, needle, start, end):
+    pos = data.find(needle, start, end)
+    while pos != -1:
+        yield pos
+        pos = data.find(needle, pos + 1, end)
@@ -0,0 +1,45 @@
+# template_app/app/utils/keyset.py
+"""
+Keyset (seek) pagination helpers
+
+Pages are addressed by the sort key of the last row returned instead of an
+OFFSET, so every page is an index range scan no matter how deep it is:
+
+    WHERE sensor_id = ? AND (created_at < ? OR (created_at = ? AND id < ?))
+    ORDER BY created_at DESC, id DESC LIMIT ?
+
+The id tie-breaker keeps rows with equal timestamps from being skipped or
+repeated. Cursors are opaque, URL-safe tokens.
+"""
+
+import base64
+import json
+from datetime import datetime
+
+
+def encode_cursor(sort_value, row_id):
+    """Opaque token for the position just after a row"""
+    if isinstance(sort_value, datetime):
+        sort_value = sort_value.strftime('%Y-%m-%d %H:%M:%S.%f')
+    raw = json.dumps([sort_value, row_id], separators=(',', ':')).encode('utf-8')
+    return base64.urlsafe_b64encode(raw).decode('ascii').rstrip('=')
+
+
+def decode_cursor(token):
+    """(sort_value, row_id) from encode_cursor(); raises ValueError if malformed"""
+    try:
+        padded = token + '=' * (-len(token) % 4)
+        sort_value, row_id = json.loads(base64.urlsafe_b64decode(padded.encode('ascii')))
+        return sort_value, int(row_id)
+    except (TypeError, ValueError, UnicodeError) as e:
+        raise ValueError(f"Invalid cursor: {token!r}") from e
+
+
+def keyset_clause(sort_column, id_column='id'):
+    """WHERE fragment selecting rows after a cursor in descending order"""
+    return f' AND ({sort_column} < ? OR ({sort_column} = ? AND {id_column} < ?))'
+
+
+def keyset_params(cursor_token):
+    sort_value, row_id = decode_cursor(cursor_token)
+    return [sort_value, sort_value, row_id]
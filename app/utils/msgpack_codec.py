@@ -0,0 +1,207 @@
+"""
+Minimal MessagePack codec for sensor payloads
+
+Generated firmware can send telemetry as MessagePack (ArduinoJson's
+serializeMsgPack) instead of JSON to save airtime. Only the types ArduinoJson
+emits are supported: nil, bool, int, float, str, bin, array and map. Decoded
+payloads have the same dict shape as the JSON equivalent, so ingest code does
+not care which encoding the sensor used.
+"""
+
+import struct
+
+MSGPACK_MIMETYPES = ('application/msgpack', 'application/x-msgpack')
+
+# Nesting deeper than this is never produced by firmware
+MAX_DEPTH = 32
+
+
+class MessagePackError(ValueError):
+    """Raised for truncated or unsupported MessagePack input"""
+
+
+class _Reader:
+    def __init__(self, data):
+        self.data = memoryview(data)
+        self.pos = 0
+
+    def take(self, n):
+        if self.pos + n > len(self.data):
+            raise MessagePackError("Truncated MessagePack payload")
+        chunk = self.data[self.pos:self.pos + n]
+        self.pos += n
+        return chunk
+
+    def unpack(self, fmt):
+        size = struct.calcsize(fmt)
+        return struct.unpack(fmt, self.take(size))[0]
+
+
+def _decode(reader, depth):
+    if depth > MAX_DEPTH:
+        raise MessagePackError("MessagePack payload nested too deeply")
+
+    b = reader.take(1)[0]
+
+    if b <= 0x7f:
+        return b
+    if b >= 0xe0:
+        return b - 0x100
+    if 0xa0 <= b <= 0xbf:
+        return _text(reader, b & 0x1f)
+    if 0x90 <= b <= 0x9f:
+        return _array(reader, b & 0x0f, depth)
+    if 0x80 <= b <= 0x8f:
+        return _map(reader, b & 0x0f, depth)
+
+    if b == 0xc0:
+        return None
+    if b == 0xc2:
+        return False
+    if b == 0xc3:
+        return True
+    if b == 0xc4:
+        return bytes(reader.take(reader.unpack('>B')))
+    if b == 0xc5:
+        return bytes(reader.take(reader.unpack('>H')))
+    if b == 0xc6:
+        return bytes(reader.take(reader.unpack('>I')))
+    if b == 0xca:
+        return reader.unpack('>f')
+    if b == 0xcb:
+        return reader.unpack('>d')
+    if b == 0xcc:
+        return reader.unpack('>B')
+    if b == 0xcd:
+        return reader.unpack('>H')
+    if b == 0xce:
+        return reader.unpack('>I')
+    if b == 0xcf:
+        return reader.unpack('>Q')
+    if b == 0xd0:
+        return reader.unpack('>b')
+    if b == 0xd1:
+        return reader.unpack('>h')
+    if b == 0xd2:
+        return reader.unpack('>i')
+    if b == 0xd3:
+        return reader.unpack('>q')
+    if b == 0xd9:
+        return _text(reader, reader.unpack('>B'))
+    if b == 0xda:
+        return _text(reader, reader.unpack('>H'))
+    if b == 0xdb:
+        return _text(reader, reader.unpack('>I'))
+    if b == 0xdc:
+        return _array(reader, reader.unpack('>H'), depth)
+    if b == 0xdd:
+        return _array(reader, reader.unpack('>I'), depth)
+    if b == 0xde:
+        return _map(reader, reader.unpack('>H'), depth)
+    if b == 0xdf:
+        return _map(reader, reader.unpack('>I'), depth)
+
+    raise MessagePackError(f"Unsupported MessagePack type 0x{b:02x}")
+
+
+def _text(reader, length):
+    try:
+        return bytes(reader.take(length)).decode('utf-8')
+    except UnicodeDecodeError as e:
+        raise MessagePackError(f"Invalid UTF-8 in MessagePack string: {e}")
+
+
+def _array(reader, length, depth):
+    return [_decode(reader, depth + 1) for _ in range(length)]
+
+
+def _map(reader, length, depth):
+    result = {}
+    for _ in range(length):
+        key = _decode(reader, depth + 1)
+        if isinstance(key, (list, dict)):
+            raise MessagePackError("MessagePack map keys must be scalars")
+        result[key] = _decode(reader, depth + 1)
+    return result
+
+
+def unpackb(data):
+    """Decode a single MessagePack object, rejecting trailing bytes"""
+    reader = _Reader(data)
+    value = _decode(reader, 0)
+    if reader.pos != len(reader.data):
+        raise MessagePackError("Trailing bytes after MessagePack object")
+    return value
+
+
+def packb(value):
+    """Encode a value with the smallest representation, as ArduinoJson does"""
+    out = bytearray()
+    _encode(value, out)
+    return bytes(out)
+
+
+def _encode(value, out):
+    if value is None:
+        out.append(0xc0)
+    elif value is True:
+        out.append(0xc3)
+    elif value is False:
+        out.append(0xc2)
+    elif isinstance(value, int):
+        _encode_int(value, out)
+    elif isinstance(value, float):
+        out.append(0xcb)
+        out += struct.pack('>d', value)
+    elif isinstance(value, str):
+        raw = value.encode('utf-8')
+        _encode_header(len(raw), out, 0xa0, 31, 0xd9, 0xda, 0xdb)
+        out += raw
+    elif isinstance(value, (bytes, bytearray)):
+        _encode_header(len(value), out, None, 0, 0xc4, 0xc5, 0xc6)
+        out += value
+    elif isinstance(value, (list, tuple)):
+        _encode_header(len(value), out, 0x90, 15, None, 0xdc, 0xdd)
+        for item in value:
+            _encode(item, out)
+    elif isinstance(value, dict):
+        _encode_header(len(value), out, 0x80, 15, None, 0xde, 0xdf)
+        for key, item in value.items():
+            _encode(key, out)
+            _encode(item, out)
+    else:
+        raise MessagePackError(f"Cannot encode {type(value).__name__} as MessagePack")
+
+
+def _encode_header(length, out, fix, fix_max, op8, op16, op32):
+    if fix is not None and length <= fix_max:
+        out.append(fix | length)
+    elif op8 is not None and length <= 0xff:
+        out += struct.pack('>BB', op8, length)
+    elif length <= 0xffff:
+        out += struct.pack('>BH', op16, length)
+    else:
+        out += struct.pack('>BI', op32, length)
+
+
+def _encode_int(value, out):
+    if 0 <= value <= 0x7f:
+        out.append(value)
+    elif -32 <= value < 0:
+        out.append(value & 0xff)
+    elif value > 0:
+        for op, fmt, limit in ((0xcc, '>B', 0xff), (0xcd, '>H', 0xffff),
+                               (0xce, '>I', 0xffffffff), (0xcf, '>Q', 0xffffffffffffffff)):
+            if value <= limit:
+                out.append(op)
+                out += struct.pack(fmt, value)
+                return
+        raise MessagePackError("Integer too large for MessagePack")
+    else:
+        for op, fmt, limit in ((0xd0, '>b', -0x80), (0xd1, '>h', -0x8000),
+                               (0xd2, '>i', -0x80000000), (0xd3, '>q', -0x8000000000000000)):
+            if value >= limit:
+                out.append(op)
+                out += struct.pack(fmt, value)
+                return
+        raise MessagePackError("Integer too small for MessagePack")
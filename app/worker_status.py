@@ -0,0 +1,87 @@
+# template_app/app/worker_status.py
+"""
+Background Worker Status
+========================
+
+Device polling, sensor retention and the job queue run in the background
+worker (worker.py), but /api/health and /api/metrics are usually answered
+by a web worker, which has none of that state. The background worker
+therefore writes its latest reports to one WorkerStatus row every
+WORKER_STATUS_SECONDS, and web workers read them from there.
+"""
+
+import json
+import logging
+import os
+from datetime import datetime, timezone
+
+logger = logging.getLogger(__name__)
+
+WORKER_STATUS_SECONDS = 15
+
+
+class WorkerStatus:
+    """The background worker's reports, shared through the database"""
+
+    name = 'worker'
+
+    def collect(self):
+        """This process's background reports"""
+        from .device_scheduler import device_scheduler
+        from .job_queue import job_queue
+        from .services.sensor_retention_service import sensor_retention
+
+        return {
+            'pid': os.getpid(),
+            'device_poll': device_scheduler.last_cycle,
+            'job_queue': job_queue.stats(),
+            'sensor_retention': sensor_retention.last_report if sensor_retention.enabled else None,
+        }
+
+    def publish(self):
+        """Store collect() for the web workers"""
+        from .db import get_dedicated_connection
+
+        now = datetime.now(timezone.utc).strftime('%Y-%m-%d %H:%M:%S')
+        conn = get_dedicated_connection()
+        try:
+            cursor = conn.cursor()
+            cursor.execute('''
+                INSERT INTO WorkerStatus (name, report, updated_at) VALUES (?, ?, ?)
+                ON DUPLICATE KEY UPDATE report = VALUES(report), updated_at = VALUES(updated_at)
+            ''', (self.name, json.dumps(self.collect(), default=str), now))
+            conn.commit()
+        finally:
+            conn.close()
+
+    def read(self):
+        """The last published reports plus their age, or None if the worker never reported"""
+        from .db import get_connection
+
+        conn = get_connection()
+        try:
+            cursor = conn.cursor()
+            cursor.execute('SELECT report, updated_at FROM WorkerStatus WHERE name = ?', (self.name,))
+            row = cursor.fetchone()
+        finally:
+            conn.close()
+        if not row:
+            return None
+
+        report = json.loads(row['report'])
+        updated_at = row['updated_at']
+        if isinstance(updated_at, str):
+            updated_at = datetime.strptime(updated_at, '%Y-%m-%d %H:%M:%S')
+        updated_at = updated_at.replace(tzinfo=timezone.utc)
+        report['updated_at'] = updated_at.isoformat()
+        report['age_seconds'] = round((datetime.now(timezone.utc) - updated_at).total_seconds(), 1)
+        return report
+
+    def current(self, role):
+        """Reports for a health or metrics response served in the given APP_ROLE"""
+        if role == 'web':
+            return self.read()
+        return self.collect()
+
+
+worker_status = WorkerStatus()
@@ -0,0 +1,131 @@
+# template_app/gunicorn.conf.py
+"""
+Production server settings (the container's default command):
+
+    gunicorn -c gunicorn.conf.py wsgi:app
+
+WEB_CONCURRENCY processes with GUNICORN_THREADS threads each serve requests.
+A thread is held for the whole of a command long-poll or an NDJSON/SSE
+stream, so size threads for those rather than for CPU. Slow external calls
+go to the job queue instead of holding a thread (app/job_queue.py).
+In-memory caches are per process. What invalidates them is read from the
+database (app/cache_versions.py, plus the EntryChange log that saved-search
+match sets are updated from), so a write handled by one web worker is seen
+by the others on their next request.
+
+Before any worker starts, the master creates and migrates the schema
+(init_db) once, so web workers never see missing tables or columns and the
+first start after an upgrade (e.g. the sensor rollup backfill) happens
+before requests are accepted. The master also starts the single background
+worker (worker.py) and restarts it if it exits. Set GUNICORN_SPAWN_WORKER=false
+when the worker runs as its own container or service instead.
+
+Every process writes its metrics to METRICS_DIR (emptied here at start),
+so a scrape of /api/metrics answered by any web worker covers all web
+workers and the background worker (app/metrics.py).
+
+A backup restore sends the master SIGHUP, which replaces the web workers,
+and stops worker.py through the job queue so it is restarted as well.
+"""
+import os
+import subprocess
+import sys
+import tempfile
+import threading
+import time
+
+os.environ.setdefault('APP_ROLE', 'web')
+os.environ.setdefault('DEBUG', 'false')
+# Web workers and worker.py write their metrics here; a scrape merges them
+os.environ.setdefault('METRICS_DIR', os.path.join(tempfile.gettempdir(), 'template-metrics'))
+
+bind = f"{os.environ.get('HOST', '0.0.0.0')}:{os.environ.get('PORT', '5001')}"
+workers = int(os.environ.get('WEB_CONCURRENCY', 2))
+worker_class = 'gthread'
+threads = int(os.environ.get('GUNICORN_THREADS', 16))
+timeout = int(os.environ.get('GUNICORN_TIMEOUT', 120))
+graceful_timeout = 30
+# Sensors keep one connection open across the requests of a check-in
+keepalive = 5
+accesslog = '-' if os.environ.get('GUNICORN_ACCESS_LOG', 'false').lower() == 'true' else None
+errorlog = '-'
+
+SCHEMA_RETRY_SECONDS = 5
+SCHEMA_WAIT_SECONDS = 120  # How long to wait for the database at startup
+
+WORKER_SCRIPT = os.path.join(os.path.dirname(os.path.abspath(__file__)), 'worker.py')
+WORKER_RESTART_DELAY = 5
+
+def on_starting(server):
+    from dotenv import load_dotenv
+    load_dotenv()  # Load .env before app config is imported (as wsgi.py does)
+
+    from app import create_app
+    from app.db import init_db
+    from app.metrics import clear_metrics_dir
+
+    clear_metrics_dir(os.environ['METRICS_DIR'])
+    app = create_app(role='migrate')
+    deadline = time.monotonic() + SCHEMA_WAIT_SECONDS
+    while True:
+        try:
+            with app.app_context():
+                server.log.info("Initializing database...")
+                init_db()
+            server.log.info("Database initialized.")
+            return
+        except Exception as e:
+            if time.monotonic() >= deadline:
+                raise
+            server.log.warning(f"Database not ready ({e}); retrying in {SCHEMA_RETRY_SECONDS}s")
+            time.sleep(SCHEMA_RETRY_SECONDS)
+
+
+def _background(server):
+    # Kept on the arbiter: a reload (SIGHUP, e.g. after a backup restore)
+    # executes this file again, which would reset module-level state
+    if not hasattr(server, 'background_worker'):
+        server.background_worker = {'process': None, 'stopping': False}
+    return server.background_worker
+
+
+def _spawn_background_worker(server):
+    env = dict(os.environ, APP_ROLE='worker')
+    background = _background(server)
+    background['process'] = subprocess.Popen([sys.executable, WORKER_SCRIPT], env=env)
+    server.log.info(f"Started background worker (pid {background['process'].pid})")
+
+
+def _watch_background_worker(server):
+    background = _background(server)
+    while True:
+        code = background['process'].wait()
+        if background['stopping']:
+            return
+        server.log.warning(f"Background worker exited with {code}; restarting in {WORKER_RESTART_DELAY}s")
+        time.sleep(WORKER_RESTART_DELAY)
+        if background['stopping']:
+            return
+        _spawn_background_worker(server)
+
+
+def when_ready(server):
+    if os.environ.get('GUNICORN_SPAWN_WORKER', 'true').lower() != 'true':
+        return
+    if _background(server)['process'] is not None:
+        return  # Already running (configuration reload)
+    _spawn_background_worker(server)
+    threading.Thread(target=_watch_background_worker, args=(server,), daemon=True).start()
+
+
+def on_exit(server):
+    background = _background(server)
+    background['stopping'] = True
+    process = background['process']
+    if process is None or process.poll() is not None:
+        return
+    process.terminate()
+    try:
+        process.wait(timeout=graceful_timeout)
+    except subprocess.TimeoutExpired:
+        process.kill()
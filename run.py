@@ -42,6 +42,11 @@ if __name__ == '__main__':
     except Exception as e:
         logging.error(f"Error starting mDNS: {e}")
 
+    # Speak HTTP/1.1 so sensors can keep one connection open across the
+    # heartbeat/config/script requests of a check-in (werkzeug defaults to 1.0)
+    from werkzeug.serving import WSGIRequestHandler
+    WSGIRequestHandler.protocol_version = "HTTP/1.1"
+
     try:
         app.run(debug=app.config.get('DEBUG', True),
                 host=app.config.get('HOST', '0.0.0.0'),
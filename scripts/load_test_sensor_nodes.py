@@ -0,0 +1,356 @@
+#!/usr/bin/env python3
+"""
+Sensor Master Control Load Test
+===============================
+
+Simulates N sensor nodes speaking the generated firmware's protocol against
+a running instance and reports throughput and latency per endpoint:
+
+- register   POST /api/sensor-master/register (JSON, once per node)
+- checkin    POST /api/sensor-master/checkin (MessagePack, like PAYLOAD_MSGPACK)
+- heartbeat  POST /api/sensor-master/heartbeat (JSON, MicroPython nodes)
+- data       POST /api/sensor-master/data (MessagePack samples batch)
+- logs       POST /api/sensor-master/logs (MessagePack)
+- script     GET  /api/sensor-master/script/<id> with If-None-Match, only
+             when a check-in says the script changed (as the firmware does)
+
+Requests are issued on a fixed schedule (open loop), so a saturated server
+shows up as growing latency and schedule lag instead of a lower request
+rate. Intervals default to the firmware's; --time-scale compresses them.
+
+Usage:
+    python scripts/load_test_sensor_nodes.py --url http://localhost:5001 \\
+        --nodes 200 --duration 120 --time-scale 10 --label mariadb --json mariadb.json
+
+    # Later, after a change - prints the difference against the saved run
+    python scripts/load_test_sensor_nodes.py --nodes 200 --duration 120 \\
+        --time-scale 10 --baseline mariadb.json
+
+Simulated sensors are named loadtest_<run>_<n>; --cleanup unregisters them
+afterwards. Point this at a disposable instance (e.g. docker-compose-mariadb.yml):
+it writes real registrations, readings and logs.
+"""
+
+import argparse
+import heapq
+import importlib.util
+import json
+import os
+import random
+import sys
+import threading
+import time
+from collections import defaultdict
+from concurrent.futures import ThreadPoolExecutor
+
+import requests
+
+REPO_ROOT = os.path.abspath(os.path.join(os.path.dirname(__file__), '..'))
+
+# The app's own codec, loaded by path so the Flask app is not imported
+_spec = importlib.util.spec_from_file_location(
+    'msgpack_codec', os.path.join(REPO_ROOT, 'app', 'utils', 'msgpack_codec.py'))
+msgpack_codec = importlib.util.module_from_spec(_spec)
+_spec.loader.exec_module(msgpack_codec)
+
+MSGPACK = 'application/msgpack'
+
+# Generated firmware timing (milliseconds in the firmware, seconds here)
+FIRMWARE_CHECK_IN_INTERVAL = 300
+FIRMWARE_DATA_INTERVAL = 60
+REQUEST_TIMEOUT = 10  # CONNECTION_TIMEOUT
+TELEMETRY_CHUNK = 8   # Samples per data POST
+
+ENDPOINTS = ('register', 'checkin', 'heartbeat', 'data', 'logs', 'script')
+
+
+class Stats:
+    """Latencies, errors and schedule lag per endpoint"""
+
+    def __init__(self):
+        self.latencies = defaultdict(list)
+        self.errors = defaultdict(int)
+        self.lag = []
+        self._lock = threading.Lock()
+
+    def record(self, endpoint, seconds, ok, lag=None):
+        with self._lock:
+            self.latencies[endpoint].append(seconds)
+            if not ok:
+                self.errors[endpoint] += 1
+            if lag is not None:
+                self.lag.append(lag)
+
+    def summary(self, elapsed, register_elapsed):
+        """Per-endpoint figures; registration is timed over its own phase"""
+        report = {}
+        for endpoint in ENDPOINTS:
+            samples = sorted(self.latencies.get(endpoint, ()))
+            if not samples:
+                continue
+            report[endpoint] = {
+                'requests': len(samples),
+                'errors': self.errors.get(endpoint, 0),
+                'throughput': round(len(samples) / (register_elapsed if endpoint == 'register' else elapsed), 2),
+                'p50_ms': round(percentile(samples, 50) * 1000, 1),
+                'p99_ms': round(percentile(samples, 99) * 1000, 1),
+                'max_ms': round(samples[-1] * 1000, 1),
+            }
+        return report
+
+
+def percentile(sorted_samples, pct):
+    """Nearest-rank percentile of an ascending list"""
+    rank = max(1, int(round(pct / 100.0 * len(sorted_samples))))
+    return sorted_samples[min(rank, len(sorted_samples)) - 1]
+
+
+class SimulatedNode:
+    """One sensor: a keep-alive session plus the state the firmware keeps"""
+
+    def __init__(self, base_url, sensor_id, args, stats):
+        self.base_url = base_url.rstrip('/')
+        self.sensor_id = sensor_id
+        self.args = args
+        self.stats = stats
+        self.session = requests.Session()
+        self.started = time.time()
+        self.config_hash = ''
+        self.script = {}
+        self.temperature = random.uniform(15, 25)
+        self.registered = False
+
+    def _request(self, endpoint, method, path, lag=None, payload=None, msgpack=False, headers=None):
+        headers = dict(headers or {})
+        body = None
+        if payload is not None:
+            if msgpack:
+                body = msgpack_codec.packb(payload)
+                headers['Content-Type'] = MSGPACK
+            else:
+                body = json.dumps(payload)
+                headers['Content-Type'] = 'application/json'
+
+        started = time.perf_counter()
+        try:
+            response = self.session.request(method, self.base_url + path, data=body,
+                                            headers=headers, timeout=REQUEST_TIMEOUT)
+            ok = response.status_code in (200, 201, 202, 304)
+        except requests.RequestException:
+            response, ok = None, False
+        self.stats.record(endpoint, time.perf_counter() - started, ok, lag)
+        return response if ok else None
+
+    def register(self, lag=None):
+        response = self._request('register', 'POST', '/api/sensor-master/register', lag, {
+            'sensor_id': self.sensor_id,
+            'sensor_name': f'Load test {self.sensor_id}',
+            'sensor_type': 'esp32_loadtest',
+            'hardware_info': 'ESP32-WROOM-32',
+            'firmware_version': '1.1.0',
+            'ip_address': '',
+            'mac_address': '02:00:00:%02x:%02x:%02x' % tuple(random.randrange(256) for _ in range(3)),
+            'capabilities': ['temperature', 'relay_control', 'target_temperature'],
+        })
+        self.registered = response is not None
+
+    def _metrics(self):
+        return {'uptime': int(time.time() - self.started), 'free_memory': random.randint(150000, 200000),
+                'wifi_rssi': random.randint(-80, -40)}
+
+    def checkin(self, lag=None):
+        payload = {'sensor_id': self.sensor_id, 'status': 'online', 'ip_address': '',
+                   'config_hash': self.config_hash, 'metrics': self._metrics()}
+        if self.script:
+            payload.update(self.script)
+        response = self._request('checkin', 'POST', '/api/sensor-master/checkin', lag, payload, msgpack=True)
+        if response is None:
+            return
+        try:
+            body = response.json()
+        except ValueError:
+            return
+        if body.get('config_changed'):
+            self.config_hash = body.get('config_hash') or ''
+        if (body.get('script') or {}).get('changed'):
+            self.fetch_script()
+
+    def heartbeat(self, lag=None):
+        self._request('heartbeat', 'POST', '/api/sensor-master/heartbeat', lag,
+                      {'sensor_id': self.sensor_id, 'status': 'online', 'metrics': self._metrics()})
+
+    def fetch_script(self):
+        headers = {}
+        if self.script.get('script_hash'):
+            headers['If-None-Match'] = f'"{self.script["script_hash"]}"'
+        response = self._request('script', 'GET', f'/api/sensor-master/script/{self.sensor_id}',
+                                 headers=headers)
+        if response is None or response.status_code == 304:
+            return
+        try:
+            body = response.json()
+        except ValueError:
+            return
+        if body.get('script_available'):
+            self.script = {'script_id': body.get('script_id'), 'script_version': body.get('version'),
+                           'script_hash': body.get('script_hash')}
+
+    def data(self, lag=None):
+        now = int(time.time())
+        samples = []
+        for i in range(self.args.batch):
+            self.temperature += random.uniform(-0.2, 0.2)
+            samples.append({
+                'timestamp': now - (self.args.batch - 1 - i) * self.args.data_interval,
+                'temperature': round(self.temperature, 2),
+                'target': 20.0,
+                'relay_state': int(self.temperature < 20.0),
+                'valid': True,
+            })
+        for i in range(0, len(samples), TELEMETRY_CHUNK):
+            self._request('data', 'POST', '/api/sensor-master/data', lag,
+                          {'sensor_id': self.sensor_id, 'mode': 'online',
+                           'samples': samples[i:i + TELEMETRY_CHUNK]}, msgpack=True)
+
+    def logs(self, lag=None):
+        self._request('logs', 'POST', '/api/sensor-master/logs', lag,
+                      {'sensor_id': self.sensor_id, 'message': f'load test t={self.temperature:.2f}',
+                       'level': 'info'}, msgpack=True)
+
+    def unregister(self):
+        try:
+            self.session.delete(f'{self.base_url}/api/sensor-master/sensors/{self.sensor_id}',
+                                timeout=REQUEST_TIMEOUT)
+        except requests.RequestException:
+            pass
+
+
+def run(args):
+    stats = Stats()
+    run_id = args.run_id or time.strftime('%H%M%S')
+    nodes = [SimulatedNode(args.url, f'loadtest_{run_id}_{n:04d}', args, stats) for n in range(args.nodes)]
+
+    # (action, interval) per node; 0 disables an action
+    scale = args.time_scale
+    schedule = [(name, interval / scale) for name, interval in (
+        ('checkin', args.checkin_interval), ('heartbeat', args.heartbeat_interval),
+        ('data', args.data_interval * args.batch), ('logs', args.log_interval)) if interval > 0]
+
+    pool = ThreadPoolExecutor(max_workers=args.concurrency)
+
+    print(f"Registering {len(nodes)} nodes over {args.ramp:.0f}s...")
+    start = time.monotonic()
+    for n, node in enumerate(nodes):
+        due = start + args.ramp * n / max(1, len(nodes))
+        time.sleep(max(0.0, due - time.monotonic()))
+        pool.submit(node.register)
+    pool.shutdown(wait=True)
+    register_elapsed = max(time.monotonic() - start, 1e-9)
+    registered = [node for node in nodes if node.registered]
+    print(f"  {len(registered)}/{len(nodes)} registered")
+    if not registered:
+        print("No node could register - is the instance reachable?")
+        return stats.summary(1.0, register_elapsed), 0.0
+
+    # Spread each node's first request over one interval, like nodes booted at random times
+    queue = []
+    start = time.monotonic()
+    for index, node in enumerate(registered):
+        for name, interval in schedule:
+            heapq.heappush(queue, (start + random.uniform(0, interval), index, name, interval))
+
+    pool = ThreadPoolExecutor(max_workers=args.concurrency)
+    deadline = start + args.duration
+    print(f"Running for {args.duration:.0f}s "
+          f"({', '.join(f'{name} every {interval:g}s' for name, interval in schedule)} per node)...")
+    while queue and queue[0][0] < deadline:
+        due, index, name, interval = heapq.heappop(queue)
+        time.sleep(max(0.0, due - time.monotonic()))
+        node = registered[index]
+        pool.submit(lambda node=node, name=name, due=due: getattr(node, name)(lag=time.monotonic() - due))
+        heapq.heappush(queue, (due + interval, index, name, interval))
+    pool.shutdown(wait=True)
+    elapsed = time.monotonic() - start
+
+    if args.cleanup:
+        print("Unregistering simulated nodes...")
+        with ThreadPoolExecutor(max_workers=args.concurrency) as cleanup:
+            list(cleanup.map(SimulatedNode.unregister, nodes))
+
+    lag = sorted(stats.lag)
+    lag_p99 = percentile(lag, 99) if lag else 0.0
+    return stats.summary(elapsed, register_elapsed), lag_p99
+
+
+def print_report(report, lag_p99, baseline=None):
+    print(f"\n{'endpoint':<10} {'requests':>9} {'errors':>7} {'req/s':>8} {'p50 ms':>8} {'p99 ms':>8} {'max ms':>8}")
+    for endpoint, row in report.items():
+        print(f"{endpoint:<10} {row['requests']:>9} {row['errors']:>7} {row['throughput']:>8} "
+              f"{row['p50_ms']:>8} {row['p99_ms']:>8} {row['max_ms']:>8}")
+        base = (baseline or {}).get('endpoints', {}).get(endpoint)
+        if base:
+            print(f"{'  vs base':<10} {'':>9} {row['errors'] - base['errors']:>+7} "
+                  f"{row['throughput'] - base['throughput']:>+8.2f} {row['p50_ms'] - base['p50_ms']:>+8.1f} "
+                  f"{row['p99_ms'] - base['p99_ms']:>+8.1f} {row['max_ms'] - base['max_ms']:>+8.1f}")
+    print(f"\nSchedule lag p99: {lag_p99 * 1000:.1f} ms (high = the client or server cannot keep up)")
+    if baseline:
+        print(f"Baseline: {baseline.get('label') or 'unlabelled'} "
+              f"({baseline.get('nodes')} nodes, {baseline.get('duration')}s)")
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Load test sensor ingest and check-in with simulated nodes')
+    parser.add_argument('--url', default='http://localhost:5001', help='Instance base URL')
+    parser.add_argument('--nodes', type=int, default=50, help='Simulated sensor nodes')
+    parser.add_argument('--duration', type=float, default=60, help='Seconds of steady load after registration')
+    parser.add_argument('--ramp', type=float, default=10, help='Seconds over which nodes register')
+    parser.add_argument('--time-scale', type=float, default=1.0,
+                        help='Divide every interval by this (10 = ten times the firmware rate)')
+    parser.add_argument('--checkin-interval', type=float, default=FIRMWARE_CHECK_IN_INTERVAL,
+                        help='Seconds between check-ins (0 = off)')
+    parser.add_argument('--heartbeat-interval', type=float, default=0,
+                        help='Seconds between heartbeats, as MicroPython nodes send (0 = off)')
+    parser.add_argument('--data-interval', type=float, default=FIRMWARE_DATA_INTERVAL,
+                        help='Seconds between samples')
+    parser.add_argument('--batch', type=int, default=1,
+                        help='Samples per upload (TELEMETRY_UPLOAD_BATCH, sent 8 per POST; deep sleep uses 32)')
+    parser.add_argument('--log-interval', type=float, default=0, help='Seconds between remote logs (0 = off)')
+    parser.add_argument('--concurrency', type=int, default=32, help='Requests in flight at most')
+    parser.add_argument('--run-id', help='Suffix for simulated sensor ids (default: current time)')
+    parser.add_argument('--label', default='', help='Name for this run in the JSON report, e.g. the backend')
+    parser.add_argument('--json', help='Write the report to this file')
+    parser.add_argument('--baseline', help='Compare against a report written with --json')
+    parser.add_argument('--cleanup', action='store_true', help='Unregister the simulated nodes afterwards')
+    args = parser.parse_args()
+
+    if args.nodes < 1 or args.batch < 1 or args.time_scale <= 0:
+        parser.error('--nodes and --batch must be at least 1, --time-scale positive')
+
+    baseline = None
+    if args.baseline:
+        with open(args.baseline) as f:
+            baseline = json.load(f)
+
+    report, lag_p99 = run(args)
+    print_report(report, lag_p99, baseline)
+
+    if args.json:
+        with open(args.json, 'w') as f:
+            json.dump({
+                'label': args.label,
+                'url': args.url,
+                'nodes': args.nodes,
+                'duration': args.duration,
+                'time_scale': args.time_scale,
+                'batch': args.batch,
+                'schedule_lag_p99_ms': round(lag_p99 * 1000, 1),
+                'endpoints': report,
+            }, f, indent=2)
+        print(f"Report written to {args.json}")
+
+    if any(row['errors'] for row in report.values()):
+        sys.exit(1)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,120 @@
+#!/usr/bin/env python3
+"""
+Test the metrics registry behind /api/metrics
+"""
+
+import sys
+import os
+import shutil
+import tempfile
+sys.path.insert(0, os.path.join(os.path.dirname(__file__), '..', '..'))
+
+from app.metrics import Metrics, record_query, snapshot_gauges
+
+
+PROCESS = 'role="all"'
+
+
+def series(name, labels=''):
+    """Sample key with the recording process's role label in front"""
+    return f'{name}{{{PROCESS}{"," + labels if labels else ""}}}'
+
+
+def parse(text):
+    """{'name{labels}': value} for every sample line"""
+    samples = {}
+    for line in text.splitlines():
+        if line and not line.startswith('#'):
+            key, value = line.rsplit(' ', 1)
+            samples[key] = float(value)
+    return samples
+
+
+def test_background_cycle_histogram():
+    """Test that a timed cycle lands in the right buckets with its DB statements"""
+    print("🧪 Testing background cycle histogram...")
+
+    metrics = Metrics()
+    with metrics.timed('device_poll'):
+        for _ in range(3):
+            record_query(0.001)
+    samples = parse(metrics.render())
+
+    name = 'template_background_cycle_duration_seconds'
+    assert samples[series(f'{name}_count', 'job="device_poll"')] == 1
+    assert samples[series(f'{name}_bucket', 'job="device_poll",le="+Inf"')] == 1
+    assert samples[series(f'{name}_bucket', 'job="device_poll",le="30.0"')] == 1
+
+    queries = 'template_background_cycle_db_queries'
+    assert samples[series(f'{queries}_bucket', 'job="device_poll",le="2"')] == 0
+    assert samples[series(f'{queries}_bucket', 'job="device_poll",le="5"')] == 1
+    assert samples[series(f'{queries}_sum', 'job="device_poll"')] == 3
+    print("✅ Cycle recorded with 3 statements")
+
+
+def test_merged_across_processes():
+    """Test that a scrape merges the registries of every process sharing METRICS_DIR"""
+    print("🧪 Testing metrics merged across processes...")
+
+    metrics = Metrics()
+    metrics.directory = tempfile.mkdtemp()
+    with metrics.timed('device_poll'):
+        pass
+
+    pid = os.fork()
+    if pid == 0:
+        # A forked worker starts empty and records its own cycles
+        try:
+            metrics.role = 'worker'
+            with metrics.timed('device_poll'):
+                pass
+            with metrics.timed('job_sync'):
+                pass
+            metrics.flush()
+        finally:
+            os._exit(0)
+    os.waitpid(pid, 0)
+
+    samples = parse(metrics.render())
+    name = 'template_background_cycle_duration_seconds_count'
+    assert samples[series(name, 'job="device_poll"')] == 1
+    assert samples[f'{name}{{role="worker",job="device_poll"}}'] == 1
+    assert samples[f'{name}{{role="worker",job="job_sync"}}'] == 1
+    assert len(os.listdir(metrics.directory)) == 2
+    shutil.rmtree(metrics.directory)
+    print("✅ One scrape covers every process")
+
+
+def test_snapshot_gauges():
+    """Test that stats() snapshots become gauges and shared names merge"""
+    print("🧪 Testing snapshot gauges...")
+
+    gauges = snapshot_gauges('ingest_queue', 'Queue', {'depth': 4, 'running': True, 'mode': 'x'})
+    gauges += snapshot_gauges('db_pool', 'Pool', {'idle': 2}, (('pool', 'a'),))
+    gauges += snapshot_gauges('db_pool', 'Pool', {'idle': 5}, (('pool', 'b"c'),))
+    text = Metrics().render(gauges)
+    samples = parse(text)
+
+    assert samples[series('template_ingest_queue_depth')] == 4
+    assert samples[series('template_ingest_queue_running')] == 1
+    assert 'template_ingest_queue_mode' not in text
+    assert samples[series('template_db_pool_idle', 'pool="a"')] == 2
+    assert samples[series('template_db_pool_idle', 'pool="b\\"c"')] == 5
+    assert text.count('# TYPE template_db_pool_idle gauge') == 1
+    print("✅ Gauges rendered")
+
+
+if __name__ == "__main__":
+    print("🚀 Starting metrics tests...\n")
+
+    try:
+        test_background_cycle_histogram()
+        test_merged_across_processes()
+        test_snapshot_gauges()
+    except Exception as e:
+        print(f"\n❌ Test failed with error: {e}")
+        import traceback
+        traceback.print_exc()
+        sys.exit(1)
+
+    print("\n🎉 Metrics are working correctly!")
@@ -0,0 +1,156 @@
+#!/usr/bin/env python3
+"""
+Test incremental maintenance of cached saved-search match sets
+"""
+
+import sys
+import os
+sys.path.insert(0, os.path.join(os.path.dirname(__file__), '..', '..'))
+
+from app.cache_versions import cache_versions
+from app.services.saved_search_cache import SavedSearchCache, MaterializedSearch
+
+
+class SharedDatabase:
+    """CacheVersion and EntryChange rows shared by the caches of several 'processes'"""
+
+    def __init__(self):
+        self.versions = {}
+        self.changes = []
+        cache_versions._read = lambda: dict(self.versions)
+        cache_versions.bump_now = self.bump
+        cache_versions.refresh_seconds = 0
+
+    def bump(self, *names):
+        for name in names:
+            self.versions[name] = self.versions.get(name, 0) + 1
+
+    def process(self, **kwargs):
+        cache = SavedSearchCache(**kwargs)
+        cache._publish_changes = self.publish
+        cache._read_changes = lambda after, limit: [c for c in self.changes if c[0] > after][:limit]
+        cache._latest_seq = lambda: self.changes[-1][0] if self.changes else 0
+        return cache
+
+    def publish(self, entry_ids):
+        self.bump('entry_changes')
+        seq = self.changes[-1][0] if self.changes else 0
+        self.changes.extend((seq + offset, entry_id) for offset, entry_id in enumerate(entry_ids, 1))
+
+
+def entry(entry_id, title):
+    return {'id': entry_id, 'title': title, 'created_at': f'2024-01-{entry_id:02d} 00:00:00'}
+
+
+def test_pending_changes():
+    """Test that reported entry ids are queued and applied to a match set"""
+    print("🧪 Testing pending entry changes...")
+
+    cache = SharedDatabase().process()
+    materialized = MaterializedSearch(('sig',), 'Open items', [entry(1, 'b'), entry(2, 'a')])
+    cache.put_materialized(7, materialized, cache.load_token())
+
+    assert cache.get_materialized(7, ('sig',)) is materialized
+    cache.entries_changed([2, 3])
+    assert cache.get_materialized(7, ('sig',)) is materialized
+    assert cache.take_pending(materialized) == {2, 3}
+    assert cache.take_pending(materialized) == set()
+
+    # 2 no longer matches, 3 is new
+    cache.apply_changes(materialized, {2, 3}, [entry(3, 'c')])
+    ordered = cache.ordered_entries(materialized, lambda e: e['title'], False)
+    assert [e['id'] for e in ordered] == [1, 3]
+
+    assert cache.get_materialized(7, ('edited',)) is None
+    print("✅ Changes applied without a reload")
+
+
+def test_changes_during_load():
+    """Test that changes reported while a search loads are queued on it"""
+    print("🧪 Testing changes racing a load...")
+
+    cache = SharedDatabase().process(max_pending=3)
+    token = cache.load_token()
+    cache.entries_changed([5])
+    cache.sync()
+    loaded = MaterializedSearch(('sig',), 'All', [entry(1, 'a')])
+    cache.put_materialized(1, loaded, token)
+    assert loaded.pending == {5}
+
+    # Too many changes to replay: the load is not kept
+    token = cache.load_token()
+    for entry_id in range(10, 15):
+        cache.entries_changed([entry_id])
+        cache.sync()
+    cache.put_materialized(2, MaterializedSearch(('sig',), 'All', []), token)
+    assert cache.get_materialized(2, ('sig',)) is None
+
+    # invalidate() drops everything, including loads already running
+    token = cache.load_token()
+    cache.invalidate()
+    cache.put_materialized(3, MaterializedSearch(('sig',), 'All', []), token)
+    assert cache.get_materialized(3, ('sig',)) is None
+    print("✅ Racing loads keep or drop their result safely")
+
+
+def test_changes_across_processes():
+    """Test that changes and invalidations published by one process reach another"""
+    print("🧪 Testing changes made by another process...")
+
+    db = SharedDatabase()
+    web_1, web_2 = db.process(), db.process()
+    materialized = MaterializedSearch(('sig',), 'All', [entry(1, 'a')])
+    web_2.put_materialized(1, materialized, web_2.load_token())
+    web_2.put_result((2, True), {'entries': []})
+
+    web_1.entries_changed([1, 4])
+    assert web_2.get_materialized(1, ('sig',)) is materialized
+    assert materialized.pending == {1, 4}
+    assert web_2.get_result((2, True)) is None
+
+    # A write that didn't report its entries drops every process's searches
+    web_2.put_result((2, True), {'entries': []})
+    db.bump('saved_searches')
+    assert web_2.get_materialized(1, ('sig',)) is None
+    assert web_2.get_result((2, True)) is None
+
+    # A process that fell too far behind starts over at the latest change
+    materialized = MaterializedSearch(('sig',), 'All', [])
+    web_2.put_materialized(1, materialized, web_2.load_token())
+    web_1.entries_changed(range(100, 100 + web_2.max_pending + 1))
+    assert web_2.get_materialized(1, ('sig',)) is None
+    assert web_2.load_token()[1] == db.changes[-1][0]
+    print("✅ Other processes see published changes")
+
+
+def test_ttl_results():
+    """Test the short-lived result cache for SQL and date-range searches"""
+    print("🧪 Testing TTL results...")
+
+    cache = SharedDatabase().process()
+    cache.put_result((1, True), {'entries': []})
+    assert cache.get_result((1, True)) == {'entries': []}
+    cache.entries_changed([1])
+    assert cache.get_result((1, True)) is None
+
+    cache.ttl_seconds = 0
+    cache.put_result((1, True), {'entries': []})
+    assert cache.get_result((1, True)) is None
+    print("✅ Results expire on change or TTL")
+
+
+if __name__ == "__main__":
+    print("🚀 Starting saved search cache tests...\n")
+
+    try:
+        test_pending_changes()
+        test_changes_during_load()
+        test_changes_across_processes()
+        test_ttl_results()
+    except Exception as e:
+        print(f"\n❌ Test failed with error: {e}")
+        import traceback
+        traceback.print_exc()
+        sys.exit(1)
+
+    print("\n🎉 Saved search cache is working correctly!")
@@ -0,0 +1,76 @@
+#!/usr/bin/env python3
+"""
+Test Niimbot raster row encoding (no printer needed)
+"""
+
+import sys
+import os
+import struct
+sys.path.insert(0, os.path.join(os.path.dirname(__file__), '..', '..'))
+
+from PIL import Image
+from app.services.niimbot_raster import encode_rows, pack_rows, PRINT_BITMAP_ROW, PRINT_EMPTY_ROW
+
+
+def reference_row(img, y):
+    """Per-pixel packing the printer clients used before (black = dot)"""
+    row = bytearray((img.width + 7) // 8)
+    for x in range(img.width):
+        if img.getpixel((x, y)) == 0:
+            row[x // 8] |= 1 << (7 - x % 8)
+    return bytes(row)
+
+
+def test_pack_rows_matches_reference():
+    """Test bulk packing against the per-pixel loop, including row padding"""
+    print("🧪 Testing row packing...")
+
+    for width in (384, 50):
+        img = Image.new('1', (width, 6), 1)
+        for x in range(0, width, 3):
+            img.putpixel((x, 1), 0)
+        img.putpixel((width - 1, 4), 0)
+
+        rows = list(pack_rows(img))
+        assert rows == [reference_row(img, y) for y in range(img.height)], width
+    print("✅ Rows packed like the per-pixel encoder")
+
+
+def test_runs_and_blank_rows():
+    """Test that repeated rows are merged and blank rows use PrintEmptyRow"""
+    print("🧪 Testing row runs...")
+
+    img = Image.new('1', (96, 300), 1)
+    for y in range(10, 20):
+        for x in range(8, 16):
+            img.putpixel((x, y), 0)
+
+    packets = list(encode_rows(img))
+    assert packets[0] == (PRINT_EMPTY_ROW, struct.pack(">HB", 0, 10))
+    packet_type, payload = packets[1]
+    assert packet_type == PRINT_BITMAP_ROW
+    assert struct.unpack(">H3BB", payload[:6]) == (10, 8, 0, 0, 10)
+    assert payload[6:] == b'\x00\xff' + bytes(10)
+    # 280 blank rows span two packets of at most 255
+    assert packets[2:] == [(PRINT_EMPTY_ROW, struct.pack(">HB", 20, 255)),
+                           (PRINT_EMPTY_ROW, struct.pack(">HB", 275, 25))]
+
+    # White ink without counts (legacy clients invert before encoding)
+    _, payload = next(encode_rows(Image.new('1', (16, 1), 1), ink="white", counts=False))
+    assert payload == struct.pack(">H3BB", 0, 0, 0, 0, 1) + b'\xff\xff'
+    print("✅ Repeated and blank rows merged")
+
+
+if __name__ == "__main__":
+    print("🚀 Starting Niimbot raster tests...\n")
+
+    try:
+        test_pack_rows_matches_reference()
+        test_runs_and_blank_rows()
+    except Exception as e:
+        print(f"\n❌ Test failed with error: {e}")
+        import traceback
+        traceback.print_exc()
+        sys.exit(1)
+
+    print("\n🎉 Niimbot raster encoding is working correctly!")
@@ -0,0 +1,99 @@
+#!/usr/bin/env python3
+"""
+Test the command push waiters behind the command long-poll endpoint
+"""
+
+import sys
+import os
+import threading
+import time
+sys.path.insert(0, os.path.join(os.path.dirname(__file__), '..', '..'))
+
+from app.services.command_push import CommandPush
+from app.services.esp32_code_generator import ESP32CodeGenerator
+from app.api.sensor_master_api import PIN_CONTROL_ACTIONS, pin_level
+
+
+def test_notify_wakes_waiter():
+    """Test that a queued command wakes a waiting long-poll right away"""
+    print("🧪 Testing waiter wake-up...")
+
+    push = CommandPush()
+    version = push.version('esp-1')
+    threading.Timer(0.05, push.notify, args=('esp-1',)).start()
+
+    started = time.monotonic()
+    assert push.wait('esp-1', version, timeout=5)
+    assert time.monotonic() - started < 1
+    print("✅ Waiter woken by notify")
+
+
+def test_wait_is_per_sensor():
+    """Test that other sensors' commands and stale versions behave"""
+    print("🧪 Testing per-sensor versions...")
+
+    push = CommandPush()
+    version = push.version('esp-1')
+    push.notify('esp-2')
+    assert not push.wait('esp-1', version, timeout=0.05)
+
+    # A command queued between reading the version and waiting is not missed
+    push.notify('esp-1')
+    assert push.wait('esp-1', version, timeout=0)
+    print("✅ Versions are tracked per sensor")
+
+
+def test_wake_token():
+    """Test that wake tokens are stable per sensor and keyed on the secret"""
+    print("🧪 Testing wake tokens...")
+
+    push = CommandPush()
+    push._secret = b'secret-a'
+    token = push.wake_token('esp-1')
+    assert len(token) == 32 and token == push.wake_token('esp-1')
+    assert token != push.wake_token('esp-2')
+
+    other = CommandPush()
+    other._secret = b'secret-b'
+    assert token != other.wake_token('esp-1')
+    print("✅ Tokens differ per sensor and secret")
+
+
+def test_firmware_runs_pin_control():
+    """Test that generated firmware runs every pin-control action the API queues"""
+    print("🧪 Testing pin-control commands in generated firmware...")
+
+    class NoDatabase:
+        def cursor(self):
+            return None
+
+    generator = ESP32CodeGenerator(NoDatabase())
+    arduino = generator._generate_arduino_code({'sensor_id': 'esp-1'}, 'http://master:5001', 'ssid', 'pass')
+    micropython = generator._micropython_core()
+
+    assert 'strcmp(commandType, "execute_script") == 0' in arduino
+    assert "command_type == 'execute_script'" in micropython
+    for action in set(PIN_CONTROL_ACTIONS.values()):
+        assert f'strcmp(type, "{action}") == 0' in arduino
+        assert f"action_type == '{action}'" in micropython
+
+    assert pin_level('HIGH') and pin_level(True) and pin_level(1) and pin_level('on')
+    assert not pin_level('LOW') and not pin_level(False) and not pin_level(0)
+    print("✅ Pin-control commands are handled by the firmware")
+
+
+if __name__ == "__main__":
+    print("🚀 Starting command push tests...\n")
+
+    try:
+        test_notify_wakes_waiter()
+        test_wait_is_per_sensor()
+        test_wake_token()
+        test_firmware_runs_pin_control()
+    except Exception as e:
+        print(f"\n❌ Test failed with error: {e}")
+        import traceback
+        traceback.print_exc()
+        sys.exit(1)
+
+    print("\n🎉 Command push is working correctly!")
@@ -0,0 +1,178 @@
+#!/usr/bin/env python3
+"""
+Test the device registry cache used by the sensor data ingest path
+"""
+
+import sys
+import os
+from datetime import datetime, timedelta, timezone
+sys.path.insert(0, os.path.join(os.path.dirname(__file__), '..', '..'))
+
+from app.cache_versions import cache_versions
+from app.services.device_registry import DeviceRegistry, parse_stored_timestamp
+
+# CacheVersion stand-in shared by every "process" in these tests
+versions = {}
+
+
+def bump_versions(*names):
+    for name in names:
+        versions[name] = versions.get(name, 0) + 1
+
+
+cache_versions._read = lambda: dict(versions)
+cache_versions.bump_now = bump_versions
+cache_versions.refresh_seconds = 0
+
+
+class FakeCursor:
+    """Answers the registry's lookups from fixed rows and counts queries"""
+
+    def __init__(self, device=None, registered=(), links=()):
+        self.device = device
+        self.registered = set(registered)
+        self.links = list(links)
+        self.queries = 0
+        self.rowcount = 0
+        self._result = None
+
+    def execute(self, sql, params=()):
+        self.queries += 1
+        if sql.strip().startswith('UPDATE RegisteredDevices SET last_data_stored'):
+            stored_at, _, not_after = params
+            last = self.device['last_data_stored']
+            self.rowcount = int(last is None or last <= not_after)
+            if self.rowcount:
+                self.device['last_data_stored'] = stored_at
+        elif 'FROM RegisteredDevices' in sql:
+            self._result = [self.device] if self.device else []
+        elif 'FROM SensorRegistration' in sql:
+            self._result = [{'id': 1}] if params[0] in self.registered else []
+        elif 'FROM DeviceEntryLinks' in sql:
+            self._result = self.links
+        else:
+            raise AssertionError(f"Unexpected query: {sql}")
+
+    def fetchone(self):
+        return self._result[0] if self._result else None
+
+    def fetchall(self):
+        return self._result
+
+
+def test_cached_lookup():
+    """Test that a second lookup for the same sensor does no queries"""
+    print("🧪 Testing cached lookups...")
+
+    cursor = FakeCursor(registered=['esp_01'])
+    registry = DeviceRegistry()
+
+    entry = registry.get(cursor, 'esp_01')
+    assert entry['has_registration'] and entry['device_id'] is None
+    queries = cursor.queries
+    assert registry.get(cursor, 'esp_01') is entry
+    assert cursor.queries == queries
+
+    # Unknown sensors are cached too, until something registers them
+    assert registry.get(cursor, 'ghost') is None
+    queries = cursor.queries
+    assert registry.get(cursor, 'ghost') is None
+    assert cursor.queries == queries
+    registry.invalidate('ghost')
+    registry.get(cursor, 'ghost')
+    assert cursor.queries > queries
+    print("✅ Repeat lookups served from memory")
+
+
+def test_invalidation_and_last_stored():
+    """Test device invalidation, TTL expiry and in-memory last-stored times"""
+    print("🧪 Testing invalidation...")
+
+    # No links, so the mapping lookup (which lives in device_api) is skipped
+    cursor = FakeCursor(
+        device={'id': 7, 'polling_interval': None, 'polling_enabled': 1,
+                'last_data_stored': '2024-01-01T00:00:00Z'},
+    )
+    registry = DeviceRegistry()
+
+    entry = registry.get(cursor, 'esp_02')
+    assert entry['device_id'] == 7 and entry['polling_interval'] == 30
+    assert entry['last_stored'] == datetime(2024, 1, 1, tzinfo=timezone.utc)
+    assert not entry['has_links'] and entry['record_links'] == []
+
+    later = entry['last_stored'] + timedelta(minutes=5)
+    registry.note_stored('esp_02', later)
+    assert registry.get(cursor, 'esp_02')['last_stored'] == later
+
+    registry.invalidate_device(7)
+    queries = cursor.queries
+    registry.get(cursor, 'esp_02')
+    assert cursor.queries > queries
+
+    expiring = DeviceRegistry(ttl_seconds=0)
+    expiring.get(cursor, 'esp_02')
+    queries = cursor.queries
+    expiring.get(cursor, 'esp_02')
+    assert cursor.queries > queries
+
+    # An edit handled by another process invalidates this one as well
+    other = DeviceRegistry()
+    other.get(cursor, 'esp_02')
+    registry.invalidate_device(7)
+    queries = cursor.queries
+    other.get(cursor, 'esp_02')
+    assert cursor.queries > queries
+    print("✅ Edits and TTL force a reload, stored times stay in memory")
+
+
+def test_claim_stored():
+    """Test the conditional last_data_stored update behind push rate limiting"""
+    print("🧪 Testing stored-sample claims...")
+
+    cursor = FakeCursor(device={'id': 7, 'polling_interval': 60, 'polling_enabled': 1,
+                                'last_data_stored': None})
+    registry = DeviceRegistry()
+    t0 = datetime(2024, 1, 1, 12, 0, tzinfo=timezone.utc)
+
+    assert registry.claim_stored(cursor, 7, t0, t0 + timedelta(seconds=90), 60)
+    assert cursor.device['last_data_stored'] == '2024-01-01 12:01:30'
+
+    # A second process storing within the interval loses
+    assert not registry.claim_stored(cursor, 7, t0 + timedelta(seconds=120), t0 + timedelta(seconds=120), 60)
+    assert registry.claim_stored(cursor, 7, t0 + timedelta(seconds=150), t0 + timedelta(seconds=150), 60)
+
+    # note_stored never moves the in-memory time backwards
+    registry.get(cursor, 'esp_03')
+    registry.note_stored('esp_03', t0 + timedelta(minutes=5))
+    registry.note_stored('esp_03', t0)
+    assert registry.get(cursor, 'esp_03')['last_stored'] == t0 + timedelta(minutes=5)
+    print("✅ Only one writer stores per interval")
+
+
+def test_parse_stored_timestamp():
+    """Test parsing of stored timestamps in the shapes the database returns"""
+    print("🧪 Testing timestamp parsing...")
+
+    assert parse_stored_timestamp(None) is None
+    assert parse_stored_timestamp('not a date') is None
+    naive = parse_stored_timestamp('2024-01-01 12:00:00')
+    assert naive.tzinfo is timezone.utc
+    assert parse_stored_timestamp(datetime(2024, 1, 1)) == datetime(2024, 1, 1, tzinfo=timezone.utc)
+    print("✅ Timestamps parsed as UTC")
+
+
+if __name__ == "__main__":
+    print("🚀 Starting device registry tests...\n")
+
+    try:
+        test_cached_lookup()
+        test_invalidation_and_last_stored()
+        test_claim_stored()
+        test_parse_stored_timestamp()
+    except Exception as e:
+        print(f"\n❌ Test failed with error: {e}")
+        import traceback
+        traceback.print_exc()
+        sys.exit(1)
+
+    print("\n🎉 Device registry cache is working correctly!")
@@ -0,0 +1,74 @@
+#!/usr/bin/env python3
+"""
+Test LTTB downsampling of chart series
+"""
+
+import sys
+import os
+import math
+from datetime import datetime, timedelta
+sys.path.insert(0, os.path.join(os.path.dirname(__file__), '..', '..'))
+
+from app.utils.downsample import lttb, decimate_rows, timestamp_seconds
+
+
+def test_lttb_budget_and_extremes():
+    """Test that LTTB honours the budget, keeps the ends and keeps a spike"""
+    print("🧪 Testing LTTB selection...")
+
+    points = [(i, math.sin(i / 50.0), i) for i in range(10000)]
+    points[4321] = (4321, 25.0, 4321)  # a single spike must survive
+
+    kept = list(lttb(iter(points), 300, total=len(points)))
+    assert len(kept) <= 300
+    assert kept[0] == 0 and kept[-1] == 9999
+    assert 4321 in kept
+    assert kept == sorted(kept)
+
+    # Short series come back untouched
+    assert list(lttb(points[:10], 300)) == list(range(10))
+    print(f"✅ 10000 points -> {len(kept)}, spike and endpoints kept")
+
+
+def test_lttb_stream_length_mismatch():
+    """Test that a stream shorter or longer than the announced total is handled"""
+    print("🧪 Testing stream length mismatches...")
+
+    points = [(i, float(i % 7), i) for i in range(1000)]
+    shorter = list(lttb(iter(points[:600]), 100, total=1000))
+    assert shorter[0] == 0 and shorter[-1] == 599
+
+    longer = list(lttb(iter(points), 100, total=800))
+    assert longer[-1] == 999 and len(longer) <= 101
+    print("✅ Mismatched totals still end on the last row")
+
+
+def test_decimate_rows():
+    """Test decimation of database-shaped rows keyed by timestamp"""
+    print("🧪 Testing row decimation...")
+
+    start = datetime(2024, 1, 1)
+    rows = [{'recorded_at': start + timedelta(minutes=i), 'value': i % 10} for i in range(2000)]
+    rows[100]['value'] = None  # non-numeric values never crash the pass
+    kept = list(decimate_rows(iter(rows), len(rows), 200, 'recorded_at', 'value'))
+    assert len(kept) <= 200 and kept[0] is rows[0] and kept[-1] is rows[-1]
+
+    assert timestamp_seconds('2024-01-01T00:00:00Z') == timestamp_seconds(datetime(2024, 1, 1))
+    assert timestamp_seconds('not a time') is None
+    print("✅ Rows decimated in order")
+
+
+if __name__ == "__main__":
+    print("🚀 Starting downsampling tests...\n")
+
+    try:
+        test_lttb_budget_and_extremes()
+        test_lttb_stream_length_mismatch()
+        test_decimate_rows()
+    except Exception as e:
+        print(f"\n❌ Test failed with error: {e}")
+        import traceback
+        traceback.print_exc()
+        sys.exit(1)
+
+    print("\n🎉 Downsampling is working correctly!")
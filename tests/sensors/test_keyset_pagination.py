@@ -0,0 +1,73 @@
+#!/usr/bin/env python3
+"""
+Test keyset pagination cursors used by the sensor log and telemetry endpoints
+"""
+
+import sys
+import os
+from datetime import datetime
+sys.path.insert(0, os.path.join(os.path.dirname(__file__), '..', '..'))
+
+from app.utils.keyset import decode_cursor, encode_cursor, keyset_clause, keyset_params
+
+
+def page(rows, limit, cursor=None):
+    """Apply the endpoint's ORDER BY / keyset WHERE to in-memory rows"""
+    ordered = sorted(rows, key=lambda r: (r['created_at'], r['id']), reverse=True)
+    if cursor:
+        created_at, _, row_id = keyset_params(cursor)
+        ordered = [r for r in ordered if r['created_at'] < created_at
+                   or (r['created_at'] == created_at and r['id'] < row_id)]
+    rows = ordered[:limit + 1]
+    next_cursor = encode_cursor(rows[limit - 1]['created_at'], rows[limit - 1]['id']) if len(rows) > limit else None
+    return rows[:limit], next_cursor
+
+
+def test_cursor_round_trip():
+    """Test cursor encoding, including datetimes and bad tokens"""
+    print("🧪 Testing cursor encoding...")
+
+    token = encode_cursor('2024-03-01T10:00:00+00:00', 42)
+    assert decode_cursor(token) == ('2024-03-01T10:00:00+00:00', 42)
+    assert '=' not in token and '/' not in token
+    assert decode_cursor(encode_cursor(datetime(2024, 3, 1, 10), 7)) == ('2024-03-01 10:00:00.000000', 7)
+
+    for bad in ('', 'not-a-cursor', encode_cursor('x', 1)[:-3]):
+        try:
+            decode_cursor(bad)
+        except ValueError:
+            continue
+        raise AssertionError(f"accepted {bad!r}")
+
+    assert keyset_clause('created_at').count('?') == len(keyset_params(token))
+    print("✅ Cursors round-trip")
+
+
+def test_pages_cover_ties():
+    """Test that walking pages returns every row once, even with equal timestamps"""
+    print("🧪 Testing page walk...")
+
+    rows = [{'id': i, 'created_at': f'2024-03-01 10:00:{i // 3:02d}'} for i in range(1, 11)]
+    seen, cursor = [], None
+    while True:
+        batch, cursor = page(rows, 3, cursor)
+        seen.extend(r['id'] for r in batch)
+        if not cursor:
+            break
+    assert seen == sorted(seen, reverse=True) and sorted(seen) == list(range(1, 11))
+    print("✅ Every row returned exactly once")
+
+
+if __name__ == "__main__":
+    print("🚀 Starting keyset pagination tests...\n")
+
+    try:
+        test_cursor_round_trip()
+        test_pages_cover_ties()
+    except Exception as e:
+        print(f"\n❌ Test failed with error: {e}")
+        import traceback
+        traceback.print_exc()
+        sys.exit(1)
+
+    print("\n🎉 Keyset pagination is working correctly!")
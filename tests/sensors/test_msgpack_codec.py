@@ -0,0 +1,77 @@
+#!/usr/bin/env python3
+"""
+Test the MessagePack codec used for compact sensor telemetry
+"""
+
+import sys
+import os
+import struct
+sys.path.insert(0, os.path.join(os.path.dirname(__file__), '..', '..'))
+
+from app.utils.msgpack_codec import MessagePackError, packb, unpackb
+
+
+def test_firmware_payload():
+    """Test a payload laid out the way ArduinoJson's serializeMsgPack emits it"""
+    print("🧪 Testing firmware-style payload decoding...")
+
+    payload = (
+        b'\x83'
+        b'\xa9sensor_id' b'\xa6esp_01'
+        b'\xa7samples' b'\x91\x82'
+        b'\xa9timestamp' b'\xce' + struct.pack('>I', 1700000000) +
+        b'\xabtemperature' b'\xca' + struct.pack('>f', 25.5) +
+        b'\xa5valid' b'\xc3'
+    )
+    data = unpackb(payload)
+
+    assert data == {
+        'sensor_id': 'esp_01',
+        'samples': [{'timestamp': 1700000000, 'temperature': 25.5}],
+        'valid': True,
+    }
+    print("✅ Decoded to the same shape as the JSON payload")
+
+
+def test_round_trip():
+    """Test that encoding and decoding preserve every supported type"""
+    print("🧪 Testing round trip...")
+
+    value = {
+        'none': None, 'flags': [True, False],
+        'ints': [0, 127, 128, 65536, 2 ** 40, -1, -33, -40000, -(2 ** 40)],
+        'float': -12.25, 'text': 'x' * 300, 'raw': b'\x00\x01',
+        'nested': {'list': list(range(20))},
+    }
+    assert unpackb(packb(value)) == value
+    assert len(packb(value)) < len(str(value))
+    print(f"✅ Round trip intact ({len(packb(value))} bytes)")
+
+
+def test_malformed_input():
+    """Test that truncated or unsupported input raises MessagePackError"""
+    print("🧪 Testing malformed input...")
+
+    for bad in (b'', b'\xa5abc', b'\x81\xa1k', b'\xc1', b'\x01\x02', b'\x91' * 40 + b'\x00'):
+        try:
+            unpackb(bad)
+            assert False, f"Expected MessagePackError for {bad!r}"
+        except MessagePackError:
+            pass
+    print("✅ Malformed payloads rejected")
+
+
+if __name__ == "__main__":
+    print("🚀 Starting MessagePack codec tests...\n")
+
+    try:
+        test_firmware_payload()
+        test_round_trip()
+        test_malformed_input()
+    except Exception as e:
+        print(f"\n❌ Test failed with error: {e}")
+        import traceback
+        traceback.print_exc()
+        sys.exit(1)
+
+    print("\n🎉 MessagePack codec is working correctly!")
@@ -0,0 +1,196 @@
+#!/usr/bin/env python3
+"""
+Test the compiled sensor notification rule engine
+"""
+
+import sys
+import os
+from datetime import datetime, timedelta
+sys.path.insert(0, os.path.join(os.path.dirname(__file__), '..', '..'))
+
+from app.cache_versions import cache_versions
+from app.services.notification_rule_engine import (
+    NotificationRuleEngine, compile_condition, parse_sensor_value
+)
+
+# CacheVersion stand-in shared by every "process" in these tests
+versions = {}
+
+
+def bump_versions(*names):
+    for name in names:
+        versions[name] = versions.get(name, 0) + 1
+
+
+cache_versions._read = lambda: dict(versions)
+cache_versions.bump_now = bump_versions
+cache_versions.refresh_seconds = 0
+
+
+def rule(rule_id, sensor_type, condition, threshold, secondary=None, entry_id=None,
+         entry_type_id=None, cooldown=60):
+    return {
+        'id': rule_id, 'sensor_type': sensor_type, 'condition_type': condition,
+        'threshold_value': threshold, 'threshold_value_secondary': secondary,
+        'entry_id': entry_id, 'entry_type_id': entry_type_id, 'cooldown_minutes': cooldown,
+        'notification_title': f'Rule {rule_id}', 'notification_message': 'Triggered',
+        'priority': 'high',
+    }
+
+
+class FakeCursor:
+    """Answers the engine's queries from in-memory tables"""
+
+    def __init__(self, rules, entries, last_notified=None):
+        self.rules = rules
+        self.entries = entries
+        self.last_notified = last_notified or {}
+        self.inserted = []
+        self.queries = []
+        self.lastrowid = 0
+        self._rows = []
+
+    def execute(self, sql, params=()):
+        self.queries.append(sql)
+        if 'FROM NotificationRule' in sql:
+            self._rows = self.rules
+        elif 'FROM Entry' in sql:
+            self._rows = [{'id': i, **self.entries[i]} for i in params if i in self.entries]
+        elif 'FROM Notification' in sql:
+            self._rows = [{'entry_id': i, 'last_created': self.last_notified[i]}
+                          for i in params if i in self.last_notified]
+        elif sql.strip().startswith('INSERT INTO Notification'):
+            self.lastrowid += 1
+            self.inserted.append(params)
+
+    def fetchall(self):
+        return self._rows
+
+    def fetchone(self):
+        return self._rows[0] if self._rows else {'last_created': None}
+
+
+def test_conditions():
+    """Test compiled predicates and value parsing"""
+    print("🧪 Testing compiled conditions...")
+
+    assert compile_condition('greater_than', 30)(30.5)
+    assert not compile_condition('less_than', 10)(10)
+    assert compile_condition('equals', 5)(5.004)
+    assert compile_condition('between', 20, 10)(15)
+    assert compile_condition('between', 10, None) is None
+    assert compile_condition('change_rate', 1) is None
+    assert compile_condition('greater_than', None) is None
+
+    assert parse_sensor_value('232724 bytes') == 232724
+    assert parse_sensor_value('-3.5C') == -3.5
+    assert parse_sensor_value('open') is None
+    print("✅ Conditions compiled")
+
+
+def test_batch_matching_and_scope():
+    """Test rule scoping by sensor type, entry and entry type"""
+    print("🧪 Testing batch evaluation...")
+
+    cursor = FakeCursor(
+        rules=[
+            rule(1, 'Temperature', 'greater_than', 30, cooldown=0),
+            rule(2, 'Temperature', 'less_than', 5, entry_id=2, cooldown=0),
+            rule(3, 'Humidity', 'greater_than', 80, entry_type_id=9, cooldown=0),
+        ],
+        entries={1: {'status': 'Active', 'entry_type_id': 1},
+                 2: {'status': 'Active', 'entry_type_id': 9},
+                 3: {'status': 'inactive', 'entry_type_id': 1}},
+    )
+    engine = NotificationRuleEngine()
+    created = engine.evaluate(cursor, [
+        (1, 'Temperature', '31.2', 't'),   # rule 1
+        (1, 'Temperature', '2', 't'),      # rule 2 is for entry 2 only
+        (2, 'Temperature', '2', 't'),      # rule 2
+        (1, 'Humidity', '90', 't'),        # rule 3 needs entry type 9
+        (2, 'Humidity', '90 %', 't'),      # rule 3
+        (3, 'Temperature', '40', 't'),     # inactive entry
+        (1, 'Pressure', '1000', 't'),      # no rules for this type
+    ])
+    assert [(n['rule_id'], n['entry_id']) for n in created] == [(1, 1), (2, 2), (3, 2)]
+    assert len(cursor.inserted) == 3
+
+    # A batch of types without rules does no database work at all
+    cursor.queries.clear()
+    assert engine.evaluate(cursor, [(1, 'Pressure', '1', 't')]) == []
+    assert cursor.queries == []
+    print("✅ Rules matched only where they apply")
+
+
+def test_cooldown_in_memory():
+    """Test per-entry cooldown seeded once from the database"""
+    print("🧪 Testing cooldowns...")
+
+    recent = (datetime.now() - timedelta(minutes=10)).isoformat()
+    cursor = FakeCursor(
+        rules=[rule(1, 'Temperature', 'greater_than', 30, cooldown=60)],
+        entries={1: {'status': 'Active', 'entry_type_id': 1},
+                 2: {'status': 'Active', 'entry_type_id': 1}},
+        last_notified={1: recent},
+    )
+    engine = NotificationRuleEngine()
+
+    created = engine.evaluate(cursor, [(1, 'Temperature', '35', 't'), (2, 'Temperature', '35', 't'),
+                                       (2, 'Temperature', '36', 't')])
+    assert [n['entry_id'] for n in created] == [2]
+    engine.committed(created)
+
+    cursor.queries.clear()
+    assert engine.evaluate(cursor, [(2, 'Temperature', '40', 't')]) == []
+    assert not any('GROUP BY' in q for q in cursor.queries)  # no cooldown lookup
+
+    # A rule edit in another process reloads this one's rules too
+    NotificationRuleEngine().invalidate()
+    cursor.rules = [rule(1, 'Temperature', 'greater_than', 30, cooldown=0)]
+    cursor.last_notified = {}
+    assert len(engine.evaluate(cursor, [(1, 'Temperature', '35', 't')])) == 1
+    print("✅ Cooldowns kept in memory between batches")
+
+
+def test_cooldown_across_processes():
+    """Test the database re-check and that only committed notifications are remembered"""
+    print("🧪 Testing cooldowns shared with other processes...")
+
+    cursor = FakeCursor(
+        rules=[rule(1, 'Temperature', 'greater_than', 30, cooldown=60)],
+        entries={1: {'status': 'Active', 'entry_type_id': 1}},
+    )
+    engine = NotificationRuleEngine()
+
+    # Rolled back: nothing committed, so the next batch may notify again
+    assert len(engine.evaluate(cursor, [(1, 'Temperature', '35', 't')])) == 1
+    assert len(engine.evaluate(cursor, [(1, 'Temperature', '35', 't')])) == 1
+
+    # Another process notified after this one seeded its cooldown memory
+    cursor.last_notified = {1: (datetime.now() - timedelta(minutes=1)).isoformat()}
+    cursor.inserted.clear()
+    assert engine.evaluate(cursor, [(1, 'Temperature', '35', 't')]) == []
+    assert cursor.inserted == []
+
+    # Readings below the threshold never query the cooldown
+    cursor.queries.clear()
+    assert engine.evaluate(cursor, [(1, 'Temperature', '20', 't')]) == []
+    assert not any('FROM Notification' in q for q in cursor.queries)
+    print("✅ Cooldowns re-checked in the database before notifying")
+
+
+if __name__ == "__main__":
+    print("🚀 Starting notification rule engine tests...\n")
+
+    try:
+        test_conditions()
+        test_batch_matching_and_scope()
+        test_cooldown_in_memory()
+        test_cooldown_across_processes()
+    except Exception as e:
+        print(f"\n❌ Test failed with error: {e}")
+        import traceback
+        traceback.print_exc()
+        sys.exit(1)
+
+    print("\n🎉 Notification rule engine is working correctly!")
@@ -0,0 +1,96 @@
+#!/usr/bin/env python3
+"""
+Test that devices pushing their own data are not polled on top of it
+"""
+
+import sys
+import os
+from datetime import datetime, timedelta, timezone
+sys.path.insert(0, os.path.join(os.path.dirname(__file__), '..', '..'))
+
+from app.cache_versions import cache_versions
+from app.device_scheduler import DEFAULT_DEVICE_POLL_INTERVAL, next_poll_time
+import app.api.sensor_master_api as sensor_master_api
+from app.services.device_registry import DeviceRegistry
+
+cache_versions._read = lambda: {}
+
+
+class FakeCursor:
+    """A registered device without entry links; records RegisteredDevices updates"""
+
+    def __init__(self, polling_interval):
+        self.polling_interval = polling_interval
+        self.updates = []
+        self.rowcount = 0
+        self._rows = []
+
+    def execute(self, sql, params=()):
+        sql = ' '.join(sql.split())
+        if sql.startswith('UPDATE RegisteredDevices'):
+            self.updates.append((sql, params))
+            self._rows = []
+        elif 'FROM RegisteredDevices' in sql:
+            self._rows = [{'id': 7, 'polling_interval': self.polling_interval, 'polling_enabled': 1,
+                           'last_data_stored': None}]
+        else:
+            self._rows = []  # No SensorRegistration, no entry links
+
+    def fetchone(self):
+        return self._rows[0] if self._rows else None
+
+    def fetchall(self):
+        return self._rows
+
+
+def push(polling_interval, received_at):
+    sensor_master_api.device_registry = DeviceRegistry()
+    cursor = FakeCursor(polling_interval)
+    result = sensor_master_api.store_sensor_samples(
+        cursor, 'esp_push', [(received_at, {'temperature': 21.5})], received_at,
+        sensor_master_api.SensorUploadBatch())
+    assert result is not None
+    sql, params = cursor.updates[0]
+    assert 'next_poll_at = ?' in sql
+    return params[2]
+
+
+def test_next_poll_time():
+    """Test the shared next_poll_at format and interval fallback"""
+    print("🧪 Testing next poll times...")
+
+    now = datetime(2024, 3, 10, 14, 0, tzinfo=timezone.utc)
+    assert next_poll_time(60, now) == '2024-03-10 14:01:00'
+    assert next_poll_time(None, now) == (now + timedelta(seconds=DEFAULT_DEVICE_POLL_INTERVAL)).strftime('%Y-%m-%d %H:%M:%S')
+    print("✅ Next poll times computed")
+
+
+def test_push_defers_poll():
+    """Test that a push moves next_poll_at a full interval past the push"""
+    print("🧪 Testing pushes against the polling schedule...")
+
+    received_at = datetime(2024, 3, 10, 14, 0, tzinfo=timezone.utc)
+    assert push(120, received_at) == '2024-03-10 14:02:00'
+
+    # The scheduler only polls devices with next_poll_at <= now
+    due_before = (received_at + timedelta(seconds=119)).strftime('%Y-%m-%d %H:%M:%S')
+    assert push(120, received_at) > due_before
+
+    # Devices without an interval use the scheduler's default, not the push rate limit
+    assert push(None, received_at) == next_poll_time(None, received_at)
+    print("✅ A push puts off the next scheduled poll")
+
+
+if __name__ == "__main__":
+    print("🚀 Starting push/poll schedule tests...\n")
+
+    try:
+        test_next_poll_time()
+        test_push_defers_poll()
+    except Exception as e:
+        print(f"\n❌ Test failed with error: {e}")
+        import traceback
+        traceback.print_exc()
+        sys.exit(1)
+
+    print("\n🎉 Pushes and polling share one schedule!")
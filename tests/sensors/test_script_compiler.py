@@ -0,0 +1,145 @@
+#!/usr/bin/env python3
+"""
+Test the JSON script -> firmware bytecode compiler used by sensor master control
+"""
+
+import sys
+import os
+import struct
+sys.path.insert(0, os.path.join(os.path.dirname(__file__), '..', '..'))
+
+from app.services.script_compiler import (
+    OPCODES, SYMBOLS, TAG_SYM, ScriptCompileError, compile_script,
+    firmware_opcode_enum
+)
+
+
+def _code_section(program):
+    """Skip the header and pools, returning the code bytes"""
+    assert program[:2] == b'SB'
+    pos = 4
+    n_consts = program[pos]
+    pos += 1 + n_consts * 4
+    n_strings = program[pos]
+    pos += 1
+    for _ in range(n_strings):
+        pos += program[pos] + 2
+    code_len = struct.unpack_from('<H', program, pos)[0]
+    return program[pos + 2:pos + 2 + code_len]
+
+
+def test_simple_script():
+    """Test that a flat script compiles to the expected opcodes"""
+    print("🧪 Testing simple script compilation...")
+
+    result = compile_script({"actions": [
+        {"type": "gpio_write", "pin": 5, "value": "HIGH"},
+        {"type": "delay", "ms": 250},
+    ]})
+    code = _code_section(result['program'])
+
+    assert code[0] == OPCODES['GPIO_WRITE'] and code[1] == 5 and code[2] == 1
+    assert code[3] == OPCODES['DELAY']
+    assert struct.unpack_from('<I', code, 4)[0] == 250
+    assert code[-1] == OPCODES['END']
+    assert result['size'] == len(result['program'])
+    print(f"✅ Compiled to {result['size']} bytes")
+
+
+def test_branches_and_loops():
+    """Test that if/else and loop jump targets land inside the code"""
+    print("🧪 Testing branch and loop compilation...")
+
+    result = compile_script({"actions": [
+        {"type": "if", "condition": {"left": "sensor.temp", "operator": ">", "right": 25},
+         "then": [{"type": "set_relay", "pin": 4, "state": "on"}],
+         "else": [{"type": "set_relay", "pin": 4, "state": "off"}]},
+        {"type": "loop", "count": 3, "do": [{"type": "log", "message": "tick {uptime}"}]},
+    ]})
+    code = _code_section(result['program'])
+
+    assert code[0] == OPCODES['JMP_IF_NOT']
+    else_target = struct.unpack_from('<H', code, 8)[0]
+    assert 0 < else_target < len(code)
+    assert code[else_target] == OPCODES['SET_RELAY']
+    assert OPCODES['LOOP_INIT'] in code and OPCODES['LOOP_NEXT'] in code
+    print("✅ Jump targets resolved")
+
+
+def test_symbols_resolved_at_compile_time():
+    """Test that value keys become symbol ids instead of runtime strings"""
+    print("🧪 Testing symbol resolution...")
+
+    result = compile_script({"actions": [
+        {"type": "if", "condition": {"left": "gpio.12", "operator": "==", "right": "sensor.temp"},
+         "then": []},
+    ]})
+    code = _code_section(result['program'])
+
+    assert tuple(code[2:5]) == (TAG_SYM, SYMBOLS['gpio'], 12)
+    assert tuple(code[5:8]) == (TAG_SYM, SYMBOLS['sensor.temp'], 0)
+    assert not result['warnings']
+
+    result = compile_script({"actions": [
+        {"type": "if", "condition": {"left": "sensor.bogus", "right": 1}, "then": []},
+    ]})
+    assert result['warnings'], "Expected a warning for an unknown key"
+    print("✅ Keys resolved to symbols")
+
+
+def test_unsupported_actions_warn():
+    """Test that unknown actions are skipped with a warning instead of failing"""
+    print("🧪 Testing unsupported action handling...")
+
+    result = compile_script('{"actions": [{"type": "weather_fetch"}]}')
+    assert result['warnings'], "Expected a warning for weather_fetch"
+    print(f"✅ Warning raised: {result['warnings'][0]}")
+
+
+def test_size_limit():
+    """Test that oversized scripts are rejected"""
+    print("🧪 Testing program size limit...")
+
+    actions = [{"type": "delay", "ms": i} for i in range(64)]
+    try:
+        compile_script({"actions": actions}, max_program_bytes=64)
+        assert False, "Expected ScriptCompileError"
+    except ScriptCompileError as e:
+        print(f"✅ Rejected: {e}")
+
+    # Constants beyond the firmware's 32-bit float range
+    condition = {"left": "sensor.temp", "operator": ">", "right": 1e39}
+    try:
+        compile_script({"actions": [{"type": "if", "condition": condition, "then": []}]})
+        assert False, "Expected ScriptCompileError"
+    except ScriptCompileError as e:
+        print(f"✅ Rejected: {e}")
+
+
+def test_firmware_enum():
+    """Test that the generated C++ enum covers every opcode"""
+    print("🧪 Testing firmware opcode enum...")
+
+    enum_body = firmware_opcode_enum()
+    for name in OPCODES:
+        assert f"OP_{name} =" in enum_body
+    print("✅ Enum matches compiler opcodes")
+
+
+if __name__ == "__main__":
+    print("🚀 Starting script compiler tests...\n")
+
+    try:
+        test_simple_script()
+        test_branches_and_loops()
+        test_symbols_resolved_at_compile_time()
+        test_unsupported_actions_warn()
+        test_size_limit()
+        test_firmware_enum()
+    except Exception as e:
+        print(f"\n❌ Test failed with error: {e}")
+        import traceback
+        traceback.print_exc()
+        sys.exit(1)
+
+    print("\n🎉 Script compiler is working correctly!")
@@ -0,0 +1,131 @@
+#!/usr/bin/env python3
+"""
+Test the in-memory sensor range index used for range-based sensor data reads
+"""
+
+import sys
+import os
+import random
+sys.path.insert(0, os.path.join(os.path.dirname(__file__), '..', '..'))
+
+from app.cache_versions import cache_versions
+from app.services.sensor_range_index import (
+    IntervalTree, SensorRangeIndex, merge_spans, span_contains, spans_sql
+)
+
+# CacheVersion stand-in shared by every "process" in these tests
+versions = {}
+
+
+def bump_versions(*names):
+    for name in names:
+        versions[name] = versions.get(name, 0) + 1
+
+
+cache_versions._read = lambda: dict(versions)
+cache_versions.bump_now = bump_versions
+cache_versions.refresh_seconds = 0
+
+
+class FakeCursor:
+    """Serves SensorDataEntryRanges rows and counts loads"""
+
+    def __init__(self, ranges):
+        self.ranges = ranges
+        self.loads = 0
+
+    def execute(self, sql, params=()):
+        assert 'FROM SensorDataEntryRanges' in sql
+        self.loads += 1
+
+    def fetchall(self):
+        return [
+            {'id': i, 'entry_id': entry_id, 'sensor_type': sensor_type,
+             'start_sensor_id': start, 'end_sensor_id': end}
+            for i, (entry_id, sensor_type, start, end) in enumerate(self.ranges, start=1)
+        ]
+
+
+def test_interval_tree_matches_scan():
+    """Test interval tree overlap queries against a brute-force scan"""
+    print("🧪 Testing interval tree queries...")
+
+    rng = random.Random(7)
+    intervals = []
+    for payload in range(500):
+        start = rng.randrange(0, 10000)
+        intervals.append((start, start + rng.randrange(0, 300), payload))
+    tree = IntervalTree(intervals)
+
+    for _ in range(200):
+        lo = rng.randrange(0, 10300)
+        hi = lo + rng.randrange(0, 50)
+        expected = sorted(p for s, e, p in intervals if s <= hi and e >= lo)
+        assert sorted(tree.overlapping(lo, hi)) == expected
+
+    assert IntervalTree([]).overlapping(0, 10) == []
+    print("✅ Overlap queries match a full scan")
+
+
+def test_span_helpers():
+    """Test span merging, membership and SQL generation"""
+    print("🧪 Testing span helpers...")
+
+    spans = merge_spans([(10, 20), (1, 5), (21, 25), (4, 8), (40, 40)])
+    assert spans == [(1, 8), (10, 25), (40, 40)]
+    assert span_contains(spans, 10) and span_contains(spans, 40)
+    assert not span_contains(spans, 9) and not span_contains(spans, 0)
+
+    clause, params = spans_sql(spans)
+    assert clause.count('BETWEEN') == 3 and params == [1, 8, 10, 25, 40, 40]
+    print("✅ Spans merged and rendered")
+
+
+def test_index_cache():
+    """Test per-entry spans, range lookups and invalidation"""
+    print("🧪 Testing range index cache...")
+
+    cursor = FakeCursor([
+        (1, 'Temperature', 1, 10),
+        (1, 'Temperature', 11, 20),
+        (2, 'Temperature', 5, 30),
+        (1, 'Humidity', 100, 110),
+    ])
+    index = SensorRangeIndex()
+
+    assert index.spans_for_entries(cursor, [1], 'Temperature') == [(1, 20)]
+    assert index.spans_for_entries(cursor, [1]) == [(1, 20), (100, 110)]
+    assert index.entry_spans(cursor, [1, 2, 3], 'Temperature') == {1: [(1, 20)], 2: [(5, 30)]}
+    assert sorted(index.ranges_overlapping(cursor, 12, 12)) == [2, 3]
+    assert index.ranges_overlapping(cursor, 105, 200, 'Humidity') == [4]
+    assert index.ranges_overlapping(cursor, 1, 5, 'Pressure') == []
+    assert cursor.loads == 1
+
+    cursor.ranges.append((3, 'Temperature', 40, 50))
+    index.invalidate()
+    assert index.entry_spans(cursor, [3], 'Temperature') == {3: [(40, 50)]}
+    assert cursor.loads == 2
+
+    # A write in another process reloads this one's index too
+    other = SensorRangeIndex()
+    cursor.ranges.append((4, 'Temperature', 60, 70))
+    other.invalidate()
+    assert index.entry_spans(cursor, [4], 'Temperature') == {4: [(60, 70)]}
+    assert cursor.loads == 3
+    print("✅ Index served from memory until invalidated")
+
+
+if __name__ == "__main__":
+    print("🚀 Starting sensor range index tests...\n")
+
+    try:
+        test_interval_tree_matches_scan()
+        test_span_helpers()
+        test_index_cache()
+    except Exception as e:
+        print(f"\n❌ Test failed with error: {e}")
+        import traceback
+        traceback.print_exc()
+        sys.exit(1)
+
+    print("\n🎉 Sensor range index is working correctly!")
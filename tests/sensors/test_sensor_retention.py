@@ -0,0 +1,133 @@
+#!/usr/bin/env python3
+"""
+Test sensor data retention and rollup tier selection
+"""
+
+import sys
+import os
+from datetime import datetime
+sys.path.insert(0, os.path.join(os.path.dirname(__file__), '..', '..'))
+
+from app.cache_versions import cache_versions
+from app.services.sensor_retention_service import (
+    SensorRetention, parse_retention_overrides, retention_cutoff
+)
+
+cache_versions.bump_now = lambda *names: None  # sensor_range_index.invalidate()
+
+NOW = datetime(2024, 6, 15, 13, 30)
+
+
+class FakeDatabase:
+    """Answers the retention job's statements from in-memory tables"""
+
+    def __init__(self, shared, ranges):
+        self.shared = shared  # [(id, sensor_type, recorded_at)]
+        self.ranges = ranges  # [[entry_id, sensor_type, start_id, end_id]]
+        self.horizons = {}
+        self.commits = 0
+        self.batches = []
+        self.rowcount = 0
+        self._rows = []
+
+    def cursor(self):
+        return self
+
+    def commit(self):
+        self.commits += 1
+
+    def execute(self, sql, params=()):
+        sql = ' '.join(sql.split())
+        self.rowcount = 0
+        if sql.startswith('INSERT INTO SensorRetentionHorizon'):
+            self.horizons[params[0]] = params[1]
+        elif sql.startswith('DELETE FROM SensorData WHERE'):
+            self.batches.append('SensorData')
+        elif sql.startswith('SELECT MIN(id) AS boundary'):
+            ids = [i for i, t, at in self.shared if t == params[0] and at >= params[1]]
+            self._rows = [{'boundary': min(ids) if ids else None}]
+        elif sql.startswith('SELECT MAX(id) AS last_id'):
+            ids = [i for i, t, at in self.shared if t == params[0]]
+            self._rows = [{'last_id': max(ids) if ids else None}]
+        elif sql.startswith('DELETE FROM SensorDataEntryRanges'):
+            kept = [r for r in self.ranges if not (r[1] == params[0] and r[3] < params[1])]
+            self.rowcount = len(self.ranges) - len(kept)
+            self.ranges = kept
+        elif sql.startswith('UPDATE SensorDataEntryRanges'):
+            boundary, sensor_type = params[0], params[1]
+            for r in self.ranges:
+                if r[1] == sensor_type and r[2] < boundary <= r[3]:
+                    r[2] = boundary
+                    self.rowcount += 1
+        elif sql.startswith('DELETE FROM SharedSensorData'):
+            sensor_type, boundary, limit = params
+            doomed = [row for row in self.shared if row[1] == sensor_type and row[0] < boundary][:limit]
+            self.shared = [row for row in self.shared if row not in doomed]
+            self.rowcount = len(doomed)
+            self.batches.append('SharedSensorData')
+        elif 'information_schema' in sql:
+            self._rows = [{'TABLE_NAME': 'SharedSensorData', 'AVG_ROW_LENGTH': 100}]
+
+    def fetchone(self):
+        return self._rows[0]
+
+    def fetchall(self):
+        return self._rows
+
+
+def test_policy():
+    """Test overrides, midnight cut-offs and rollup tier fallback"""
+    print("🧪 Testing retention policy...")
+
+    assert parse_retention_overrides('Temperature=90, Signal Strength=7,bad=x,') == {
+        'Temperature': 90, 'Signal Strength': 7}
+    assert retention_cutoff(0, NOW) is None
+    assert retention_cutoff(10, NOW) == datetime(2024, 6, 5)
+
+    retention = SensorRetention()
+    retention.rollup_days = {60: 7, 3600: 90}
+    assert retention.covering_resolution(60, datetime(2024, 6, 14), NOW) == 60
+    assert retention.covering_resolution(60, datetime(2024, 5, 1), NOW) == 3600
+    assert retention.covering_resolution(60, datetime(2023, 1, 1), NOW) == 86400
+    assert retention.covering_resolution(3600, datetime(2024, 6, 14), NOW) == 3600
+    print("✅ Policy resolved")
+
+
+def test_prune_keeps_ranges_on_retained_rows():
+    """Test batched deletes below the first retained id, with ranges moved onto it"""
+    print("🧪 Testing raw pruning...")
+
+    shared = [(i, 'Temperature', '2024-05-01 00:00:00') for i in range(1, 8)]
+    shared += [(8, 'Humidity', '2024-05-01 00:00:00'), (9, 'Temperature', '2024-06-14T10:00:00'),
+               (10, 'Temperature', '2024-06-01 09:00:00')]  # old but above the boundary: kept
+    db = FakeDatabase(shared, ranges=[[1, 'Temperature', 1, 3], [2, 'Temperature', 2, 10],
+                                      [3, 'Humidity', 8, 8]])
+    retention = SensorRetention()
+    retention.by_type = {'Temperature': 30}
+    retention.batch_size = 3
+
+    report = retention.run(db, now=NOW)
+    assert db.horizons == {'Temperature': '2024-05-16 00:00:00'}
+    assert [row[0] for row in db.shared] == [8, 9, 10]
+    assert db.ranges == [[2, 'Temperature', 9, 10], [3, 'Humidity', 8, 8]]
+    assert report['deleted']['SharedSensorData'] == 7
+    assert db.batches.count('SharedSensorData') == 3  # 3 + 3 + 1
+    assert report['ranges_removed'] == 1 and report['ranges_trimmed'] == 1
+    assert report['sensor_types'] == {'Temperature': 7}
+    assert report['estimated_bytes'] == 700
+    print("✅ Old readings pruned, linked ranges kept")
+
+
+if __name__ == "__main__":
+    print("🚀 Starting sensor retention tests...\n")
+
+    try:
+        test_policy()
+        test_prune_keeps_ranges_on_retained_rows()
+    except Exception as e:
+        print(f"\n❌ Test failed with error: {e}")
+        import traceback
+        traceback.print_exc()
+        sys.exit(1)
+
+    print("\n🎉 Sensor retention is working correctly!")
@@ -0,0 +1,103 @@
+#!/usr/bin/env python3
+"""
+Test the sensor data rollup helpers used for trend charts
+"""
+
+import sys
+import os
+sys.path.insert(0, os.path.join(os.path.dirname(__file__), '..', '..'))
+
+from app.services.sensor_rollup_service import (
+    aggregate_rollups, bucket_start, choose_resolution, parse_numeric, record_rollups
+)
+
+
+class FakeCursor:
+    """Collects executemany calls (and the cache version bumps)"""
+
+    def __init__(self):
+        self.batches = []
+        self.statements = []
+
+    def execute(self, sql, params=()):
+        self.statements.append((sql, list(params)))
+
+    def executemany(self, sql, params):
+        self.batches.append((sql, list(params)))
+
+
+def test_parse_and_bucket():
+    """Test value parsing and bucket boundaries"""
+    print("🧪 Testing value parsing and buckets...")
+
+    assert parse_numeric('23.5°C') == 23.5
+    assert parse_numeric('-4') == -4.0
+    assert parse_numeric(12) == 12.0
+    assert parse_numeric('on') is None
+    assert parse_numeric('1.2.3') is None
+    assert parse_numeric(None) is None
+
+    # ISO strings with or without offsets bucket on their wall-clock time
+    assert bucket_start('2024-03-10T14:37:52.123+00:00', 60) == '2024-03-10 14:37:00'
+    assert bucket_start('2024-03-10 14:37:52', 3600) == '2024-03-10 14:00:00'
+    assert bucket_start('2024-03-10T14:37:52Z', 86400) == '2024-03-10 00:00:00'
+    assert bucket_start('yesterday', 60) is None
+    print("✅ Values and buckets parsed")
+
+
+def test_aggregate_rollups():
+    """Test folding readings into min/max/sum/count per bucket"""
+    print("🧪 Testing rollup aggregation...")
+
+    points = [
+        (1, 'Temperature', '20.0', '2024-03-10T14:00:05+00:00'),
+        (1, 'Temperature', '22.0', '2024-03-10T14:00:45+00:00'),
+        (1, 'Temperature', '30.0', '2024-03-10T14:05:00+00:00'),
+        (2, 'Temperature', '10.0', '2024-03-10T14:00:10+00:00'),
+        (1, 'Relay', 'on', '2024-03-10T14:00:10+00:00'),
+    ]
+    rows = {row[:4]: row[4:] for row in aggregate_rollups(points)}
+
+    assert rows[(1, 'Temperature', 60, '2024-03-10 14:00:00')] == (20.0, 22.0, 42.0, 2)
+    assert rows[(1, 'Temperature', 60, '2024-03-10 14:05:00')] == (30.0, 30.0, 30.0, 1)
+    assert rows[(1, 'Temperature', 3600, '2024-03-10 14:00:00')] == (20.0, 30.0, 72.0, 3)
+    assert rows[(2, 'Temperature', 86400, '2024-03-10 00:00:00')] == (10.0, 10.0, 10.0, 1)
+    assert not any(key[1] == 'Relay' for key in rows)
+
+    cursor = FakeCursor()
+    assert record_rollups(cursor, points) == len(rows)
+    assert len(cursor.batches) == 1 and 'ON DUPLICATE KEY UPDATE' in cursor.batches[0][0]
+    # Widget cache versions are bumped in the same transaction
+    assert 'CacheVersion' in cursor.statements[0][0]
+    assert cursor.statements[0][1] == ['sensor:*', 'sensor:Temperature']
+    assert record_rollups(cursor, []) == 0 and len(cursor.batches) == 1
+    print("✅ Readings folded into one row per bucket")
+
+
+def test_choose_resolution():
+    """Test resolution choice against the point budget"""
+    print("🧪 Testing resolution choice...")
+
+    day = 86400
+    assert choose_resolution(day, 500) == 60
+    assert choose_resolution(7 * day, 500) == 3600
+    assert choose_resolution(365 * day, 500) == 86400
+    assert choose_resolution(3600, 500) is None  # short ranges use raw readings
+    assert choose_resolution(0, 500) is None
+    print("✅ Resolution follows range and budget")
+
+
+if __name__ == "__main__":
+    print("🚀 Starting sensor rollup tests...\n")
+
+    try:
+        test_parse_and_bucket()
+        test_aggregate_rollups()
+        test_choose_resolution()
+    except Exception as e:
+        print(f"\n❌ Test failed with error: {e}")
+        import traceback
+        traceback.print_exc()
+        sys.exit(1)
+
+    print("\n🎉 Sensor rollups are working correctly!")
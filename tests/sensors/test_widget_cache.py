@@ -0,0 +1,142 @@
+#!/usr/bin/env python3
+"""
+Test the dashboard widget cache and its data-version invalidation
+"""
+
+import sys
+import os
+sys.path.insert(0, os.path.join(os.path.dirname(__file__), '..', '..'))
+
+from app.cache_versions import cache_versions
+from app.services.widget_cache import WidgetCache, data_versions
+
+
+class VersionTable:
+    """CacheVersion stand-in: a cursor whose bumps land in a shared dict"""
+
+    def __init__(self):
+        self.versions = {}
+
+    def execute(self, sql, params=()):
+        for name in params:
+            self.versions[name] = self.versions.get(name, 0) + 1
+
+
+table = VersionTable()
+cache_versions._read = lambda: dict(table.versions)
+cache_versions.refresh_seconds = 0
+
+
+def make_widget(widget_type='chart', source_type='saved_search', source_id=1):
+    return {'widget_type': widget_type, 'data_source_type': source_type, 'data_source_id': source_id}
+
+
+class Counter:
+    """compute() stand-in that counts calls"""
+
+    def __init__(self, result=None):
+        self.calls = 0
+        self.result = result or {'entries': []}
+
+    def __call__(self):
+        self.calls += 1
+        return dict(self.result)
+
+
+def test_hits_and_config_keys():
+    """Test that identical widgets hit and different configs miss"""
+    print("🧪 Testing cache keys...")
+
+    cache = WidgetCache()
+    compute = Counter()
+    cache.get_or_compute(make_widget(), {'a': 1}, compute)
+    cache.get_or_compute(make_widget(), {'a': 1}, compute)
+    assert compute.calls == 1
+
+    cache.get_or_compute(make_widget(), {'a': 2}, compute)
+    cache.get_or_compute(make_widget(source_id=2), {'a': 1}, compute)
+    assert compute.calls == 3
+
+    cache.get_or_compute(make_widget(), {'a': 1}, compute, refresh=True)
+    assert compute.calls == 4
+
+    stats = cache.stats()
+    assert stats['hits'] == 1 and stats['misses'] == 4 and stats['size'] == 3
+    print("✅ Keyed by widget config, refresh recomputes")
+
+
+def test_version_invalidation():
+    """Test entry writes invalidate everything and sensor writes only their type"""
+    print("🧪 Testing data version invalidation...")
+
+    cache = WidgetCache()
+    temp_chart = (make_widget('line_chart', 'sensor_data'), {'sensor_type': 'Temperature'})
+    list_widget = (make_widget('list'), {})
+    temp, listing = Counter(), Counter()
+
+    cache.get_or_compute(*temp_chart, temp)
+    cache.get_or_compute(*list_widget, listing)
+
+    data_versions.bump_sensor_types(table, ['Humidity'])
+    cache.get_or_compute(*temp_chart, temp)
+    cache.get_or_compute(*list_widget, listing)
+    assert temp.calls == 1 and listing.calls == 1
+
+    data_versions.bump_sensor_types(table, ['Temperature'])
+    cache.get_or_compute(*temp_chart, temp)
+    cache.get_or_compute(*list_widget, listing)
+    assert temp.calls == 2 and listing.calls == 1
+
+    data_versions.bump_entries(table)
+    cache.get_or_compute(*temp_chart, temp)
+    cache.get_or_compute(*list_widget, listing)
+    assert temp.calls == 3 and listing.calls == 2
+
+    # A write committed by another process bumps the same table
+    table.versions['entries'] += 1
+    cache.get_or_compute(*list_widget, listing)
+    assert listing.calls == 3
+    print("✅ Writes invalidate only dependent widgets")
+
+
+def test_bypass_errors_and_eviction():
+    """Test uncached widget types, error results and LRU eviction"""
+    print("🧪 Testing bypass, errors and eviction...")
+
+    cache = WidgetCache(max_entries=2)
+    summary = Counter()
+    cache.get_or_compute(make_widget('ai_summary'), {}, summary)
+    cache.get_or_compute(make_widget('ai_summary'), {}, summary)
+    assert summary.calls == 2 and cache.stats()['bypassed'] == 2
+
+    failing = Counter({'error': 'Saved search not found'})
+    cache.get_or_compute(make_widget(), {}, failing)
+    cache.get_or_compute(make_widget(), {}, failing)
+    assert failing.calls == 2
+
+    compute = Counter()
+    for source_id in (1, 2, 3):
+        cache.get_or_compute(make_widget(source_id=source_id), {'n': 1}, compute)
+    cache.get_or_compute(make_widget(source_id=1), {'n': 1}, compute)
+    assert cache.stats()['size'] == 2 and compute.calls == 4
+
+    cache.ttl_seconds = 0
+    cache.get_or_compute(make_widget(source_id=3), {'n': 1}, compute)
+    assert compute.calls == 5
+    print("✅ Uncached types and errors recomputed, LRU bounded")
+
+
+if __name__ == "__main__":
+    print("🚀 Starting widget cache tests...\n")
+
+    try:
+        test_hits_and_config_keys()
+        test_version_invalidation()
+        test_bypass_errors_and_eviction()
+    except Exception as e:
+        print(f"\n❌ Test failed with error: {e}")
+        import traceback
+        traceback.print_exc()
+        sys.exit(1)
+
+    print("\n🎉 Widget cache is working correctly!")
@@ -0,0 +1,94 @@
+# template_app/worker.py
+"""
+Background worker: the task scheduler (cron-style jobs), device polling and
+the job queue, run in one process next to the gunicorn web workers.
+
+    python worker.py
+
+gunicorn.conf.py starts (and restarts) it by default, after the master has
+run init_db(); run on its own it initializes the database first. Run
+exactly one per database. Its device polling, retention and job queue
+reports are written to the database for the web workers' /api/health
+(app/worker_status.py), and started by gunicorn it shares METRICS_DIR
+with them, so the web port's /api/metrics includes its cycle timings. Set
+WORKER_PORT to also serve /api/health and /api/metrics from this process.
+"""
+from dotenv import load_dotenv
+load_dotenv()  # Load .env before app config is imported
+
+import os
+import signal
+import threading
+import logging
+
+os.environ.setdefault('APP_ROLE', 'worker')
+
+from app import create_app
+from app.job_queue import job_queue
+
+logging.basicConfig(level=logging.INFO, format='%(asctime)s - %(levelname)s - %(message)s')
+
+stopping = threading.Event()
+
+
+@job_queue.register('restart_worker')
+def _restart_worker(payload):
+    """Queued by a backup restore: exit so a fresh worker starts from the restored data"""
+    logging.info("Restart requested; stopping background worker.")
+    stopping.set()
+
+
+app = create_app()
+
+
+def main():
+    with app.app_context():
+        from app.db import init_db
+        logging.info("Initializing database...")
+        init_db()
+        logging.info("Database initialized.")
+
+    for signum in (signal.SIGTERM, signal.SIGINT):
+        signal.signal(signum, lambda *_: stopping.set())
+
+    # Announce the service once per host rather than once per web worker
+    announcer = None
+    try:
+        from app.utils.discovery import ServiceAnnouncer
+        announcer = ServiceAnnouncer(port=app.config.get('PORT', 5001))
+        announcer.start()
+    except ImportError:
+        logging.warning("zeroconf not installed. mDNS service discovery disabled.")
+    except Exception as e:
+        logging.error(f"Error starting mDNS: {e}")
+
+    server = None
+    worker_port = int(os.environ.get('WORKER_PORT', 0))
+    if worker_port:
+        from werkzeug.serving import make_server
+        server = make_server(app.config.get('HOST', '0.0.0.0'), worker_port, app, threaded=True)
+        threading.Thread(target=server.serve_forever, daemon=True).start()
+        logging.info(f"Worker health and metrics on port {worker_port}")
+
+    logging.info("Background worker running.")
+    from app.worker_status import worker_status, WORKER_STATUS_SECONDS
+    while not stopping.is_set():
+        try:
+            with app.app_context():
+                worker_status.publish()
+        except Exception as e:
+            logging.warning(f"Could not publish worker status: {e}")
+        stopping.wait(WORKER_STATUS_SECONDS)
+
+    logging.info("Stopping background worker...")
+    from app.device_scheduler import device_scheduler
+    job_queue.stop()
+    device_scheduler.stop()
+    if server is not None:
+        server.shutdown()
+    if announcer is not None:
+        announcer.stop()
+
+
+if __name__ == '__main__':
+    main()
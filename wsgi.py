@@ -0,0 +1,21 @@
+# template_app/wsgi.py
+"""
+WSGI entry point for the production server:
+
+    gunicorn -c gunicorn.conf.py wsgi:app
+
+Each gunicorn worker builds its own app with APP_ROLE=web, so it serves
+requests only; the schedulers, device polling and the job queue run once,
+in the background worker (worker.py). The schema is already up to date:
+the gunicorn master runs init_db() before forking (see gunicorn.conf.py).
+"""
+from dotenv import load_dotenv
+load_dotenv()  # Load .env before app config is imported
+
+import os
+
+os.environ.setdefault('APP_ROLE', 'web')
+
+from app import create_app
+
+app = create_app()